@@ -133,10 +133,10 @@ sourceItem
 typeRef
     : builtinType
     | IDENTIFIER
-    | K_ARRAY '[' commaList ']' K_OF typeRef
+    | K_ARRAY^ '[' arrayBounds ']' K_OF typeRef
     ;
 
-commaList: (',' )*;
+arrayBounds: DEC? (',' DEC?)*;
 
 builtinType
     : K_BOOL | K_BYTE | K_INT | K_UINT | K_LONG | K_ULONG | K_CHAR | K_STRING
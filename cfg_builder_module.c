@@ -1,4 +1,5 @@
 #include "cfg_builder_module.h"
+#include "ssa_builder_module.h"
 
 #include <ctype.h>
 #include <stdbool.h>
@@ -6,9 +7,14 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <limits.h>
+
+#define LOOP_UNROLL_MAX_OPS 96
+
+static int g_unroll_factor = LOOP_UNROLL_DEFAULT_FACTOR;
+static int g_full_unroll_max_trips = LOOP_UNROLL_DEFAULT_FULL_TRIPS;
 
 static void fprintEscaped(FILE *out, const char *s);
-const char* nodeTypeToString(NodeType type);
 const char* edgeTypeToString(EdgeType type);
 static ControlFlowGraph* buildEmptyCFG(void);
 
@@ -310,6 +316,36 @@ static pANTLR3_BASE_TREE findChildByText(pANTLR3_BASE_TREE node, const char* tex
     return NULL;
 }
 
+static char* extractTypeText(pANTLR3_BASE_TREE node);
+
+// `array [4, 3] of int` is rooted at the array keyword with the brackets,
+// bounds and element type as children; it becomes "array[4,3] of int".
+static char* extractArrayTypeText(pANTLR3_BASE_TREE node)
+{
+    StringBuilder sb;
+    sbInit(&sb);
+    sbAppend(&sb, "array[");
+
+    ANTLR3_UINT32 count = node->getChildCount(node);
+    ANTLR3_UINT32 i = 0;
+    while (i < count && strcmp(get_ast_node_text(node->getChild(node, i)), "[") != 0) {
+        i++;
+    }
+    for (i++; i < count; i++) {
+        const char* text = get_ast_node_text(node->getChild(node, i));
+        if (strcmp(text, "]") == 0) {
+            break;
+        }
+        sbAppend(&sb, text);
+    }
+    sbAppend(&sb, "] of ");
+
+    char* element = count > 0 ? extractTypeText(node->getChild(node, count - 1)) : NULL;
+    sbAppend(&sb, element ? element : "int");
+    free(element);
+    return sb.data;
+}
+
 static char* extractTypeText(pANTLR3_BASE_TREE node)
 {
     if (!node) {
@@ -320,6 +356,10 @@ static char* extractTypeText(pANTLR3_BASE_TREE node)
         return strdup("void");
     }
 
+    if (strcmp(get_ast_node_text(node), "array") == 0) {
+        return extractArrayTypeText(node);
+    }
+
     return flattenTreeText(node);
 }
 
@@ -646,6 +686,9 @@ static void fillSubprogramInfo(SubprogramInfo* info,
 
         pANTLR3_BASE_TREE block_node = findChildByText(body_node, "BLOCK");
         info->cfg = block_node ? buildCFG(block_node) : buildEmptyCFG();
+        simplifyCFG(info->cfg);
+        buildLoopNest(info->cfg);
+        unrollCountedLoops(info->cfg);
     } else {
         info->cfg = buildEmptyCFG();
     }
@@ -736,6 +779,11 @@ static void initUserTypeInfo(UserTypeInfo* type_info)
     type_info->declared_methods = NULL;
     type_info->declared_method_count = 0;
     type_info->total_size_bytes = 0;
+    type_info->flat_slots = NULL;
+    type_info->flat_slot_count = 0;
+    type_info->method_table = NULL;
+    type_info->method_table_capacity = 0;
+    type_info->method_count = 0;
 }
 
 static void collectInterfaceMethodSignature(UserTypeInfo* type_info, pANTLR3_BASE_TREE method_node)
@@ -831,16 +879,6 @@ static bool sameMethodShape(const MethodSignatureInfo* left, const MethodSignatu
     return true;
 }
 
-static bool sameMethodContract(const MethodSignatureInfo* left, const MethodSignatureInfo* right)
-{
-    if (!sameMethodShape(left, right)) {
-        return false;
-    }
-
-    return strcmp(left->return_type ? left->return_type : "void",
-                  right->return_type ? right->return_type : "void") == 0;
-}
-
 
 const char* nodeTypeToString(NodeType type)
 {
@@ -883,12 +921,24 @@ static CFGNode* createCFGNode(NodeType type)
     node->type = type;
     node->statements = NULL;
     node->stmt_count = 0;
+    node->line = 0;
+    node->column = 0;
     node->nextDefault = NULL;
     node->nextConditional = NULL;
 
     return node;
 }
 
+static void appendStatement(CFGNode* node, OpNode* statement)
+{
+    node->statements = realloc(node->statements, (node->stmt_count + 1) * sizeof(OpNode*));
+    node->statements[node->stmt_count++] = statement;
+    if (node->line == 0 && statement && statement->line > 0) {
+        node->line = statement->line;
+        node->column = statement->column;
+    }
+}
+
 
 static void flowAppend(FlowResult* result_flow, FlowResult donor)
 {
@@ -995,10 +1045,7 @@ static FlowResult processStatement(pANTLR3_BASE_TREE node,
             }
         }
 
-        current_block->statements = realloc(current_block->statements,
-                                           (current_block->stmt_count + 1) *
-                                           sizeof(OpNode*));
-        current_block->statements[current_block->stmt_count++] = buildOpTree(node);
+        appendStatement(current_block, buildOpTree(node));
 
         if (continue_current_block)
             return flow_result;
@@ -1069,10 +1116,7 @@ static FlowResult processIfStatement(pANTLR3_BASE_TREE if_node,
         {
             pANTLR3_BASE_TREE condition_node = child_node;
             // Обработка блока statements
-            if_block->statements = realloc(if_block->statements,
-                                               (if_block->stmt_count + 1) *
-                                               sizeof(OpNode*));
-            if_block->statements[if_block->stmt_count++] = buildOpTree(condition_node);
+            appendStatement(if_block, buildOpTree(condition_node));
         }
 
         else if (strcmp(get_ast_node_text(child_node), "THEN") == 0)
@@ -1167,10 +1211,7 @@ static FlowResult processWhileStatement(pANTLR3_BASE_TREE while_node,
         {
             pANTLR3_BASE_TREE condition_node = child_node;
             // Обработка блока statements
-            while_block->statements = realloc(while_block->statements,
-                                               (while_block->stmt_count + 1) *
-                                               sizeof(OpNode*));
-            while_block->statements[while_block->stmt_count++] = buildOpTree(condition_node);
+            appendStatement(while_block, buildOpTree(condition_node));
         }
 
         else if (strcmp(get_ast_node_text(child_node), "DO") == 0)
@@ -1278,10 +1319,7 @@ static FlowResult processRepeatStatement(pANTLR3_BASE_TREE repeat_node,
             CFGNode* until_block = createCFGNode(NODE_REPEAT_CONDITION);
             addNode(cfg, until_block);
 
-            until_block->statements = realloc(until_block->statements,
-                                               (until_block->stmt_count + 1) *
-                                               sizeof(OpNode*));
-            until_block->statements[until_block->stmt_count++] = buildOpTree(condition_node);
+            appendStatement(until_block, buildOpTree(condition_node));
 
             for (int k = 0; k < end_of_repeatable_part_flow.exit_count; k++)
             {
@@ -1393,6 +1431,7 @@ static ControlFlowGraph* buildEmptyCFG(void)
     cfg->max_edges = 4;
     cfg->edges = malloc(cfg->max_edges * sizeof(CFGEdge*));
     cfg->edge_count = 0;
+    cfg->loop_nest = NULL;
 
     cfg->entry = createCFGNode(NODE_ENTRY);
     cfg->exit = createCFGNode(NODE_EXIT);
@@ -1418,6 +1457,7 @@ ControlFlowGraph* buildCFG(pANTLR3_BASE_TREE blockNode)
     cfg->max_edges = 100;
     cfg->edges = malloc(cfg->max_edges * sizeof(CFGEdge*));
     cfg->edge_count = 0;
+    cfg->loop_nest = NULL;
 
     // Создаем entry узел
     cfg->entry = createCFGNode(NODE_ENTRY);
@@ -1459,6 +1499,631 @@ ControlFlowGraph* buildCFG(pANTLR3_BASE_TREE blockNode)
     return cfg;
 }
 
+static bool isForwardableBlock(const CFGNode* node)
+{
+    return node->type == NODE_BASIC_BLOCK
+        && node->stmt_count == 0
+        && !node->nextConditional
+        && node->nextDefault
+        && node->nextDefault != node;
+}
+
+// Follows a chain of empty blocks to the first node that does real work.
+static CFGNode* resolveForwardedNode(CFGNode* node, CFGNode** forward, int limit)
+{
+    for (int steps = 0; node && forward[node->id] != node && steps < limit; steps++) {
+        node = forward[node->id];
+    }
+    return node;
+}
+
+// Cleans up what buildCFG leaves behind: empty basic blocks are bypassed,
+// nodes the entry cannot reach are dropped, and a basic block whose only
+// successor is a basic block with no other predecessor absorbs it. Ids are
+// renumbered densely and cfg->edges is rebuilt from the successor pointers.
+// Each edge keeps its type: nextConditional edges stay EDGE_TRUE, and a
+// nextDefault edge keeps the type of the edge it replaces.
+void simplifyCFG(ControlFlowGraph* cfg)
+{
+    if (!cfg || !cfg->entry || cfg->node_count == 0) {
+        return;
+    }
+
+    int n = cfg->node_count;
+    for (int i = 0; i < n; i++) {
+        cfg->nodes[i]->id = i;
+    }
+
+    EdgeType* default_types = malloc(sizeof(EdgeType) * n);
+    CFGNode** forward = malloc(sizeof(CFGNode*) * n);
+    bool* reachable = calloc(n, sizeof(bool));
+    bool* merged = calloc(n, sizeof(bool));
+    int* pred_counts = calloc(n, sizeof(int));
+    CFGNode** stack = malloc(sizeof(CFGNode*) * n);
+    if (!default_types || !forward || !reachable || !merged || !pred_counts || !stack) {
+        free(default_types);
+        free(forward);
+        free(reachable);
+        free(merged);
+        free(pred_counts);
+        free(stack);
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        default_types[i] = EDGE_CLASSIC;
+        forward[i] = isForwardableBlock(cfg->nodes[i]) ? cfg->nodes[i]->nextDefault : cfg->nodes[i];
+    }
+    for (int i = 0; i < cfg->edge_count; i++) {
+        CFGEdge* edge = cfg->edges[i];
+        if (edge && edge->from && edge->type != EDGE_TRUE) {
+            default_types[edge->from->id] = edge->type;
+        }
+    }
+
+    // A cycle made only of empty blocks keeps one of its blocks.
+    for (int i = 0; i < n; i++) {
+        CFGNode* target = resolveForwardedNode(cfg->nodes[i], forward, n);
+        if (forward[target->id] != target) {
+            forward[i] = cfg->nodes[i];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        CFGNode* node = cfg->nodes[i];
+        node->nextDefault = resolveForwardedNode(node->nextDefault, forward, n);
+        node->nextConditional = resolveForwardedNode(node->nextConditional, forward, n);
+    }
+
+    int depth = 0;
+    stack[depth++] = cfg->entry;
+    reachable[cfg->entry->id] = true;
+    while (depth > 0) {
+        CFGNode* node = stack[--depth];
+        CFGNode* successors[2] = { node->nextDefault, node->nextConditional };
+        for (int i = 0; i < 2; i++) {
+            if (!successors[i]) {
+                continue;
+            }
+            pred_counts[successors[i]->id]++;
+            if (!reachable[successors[i]->id]) {
+                reachable[successors[i]->id] = true;
+                stack[depth++] = successors[i];
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        CFGNode* node = cfg->nodes[i];
+        if (!reachable[i] || merged[i] || node->type != NODE_BASIC_BLOCK) {
+            continue;
+        }
+
+        CFGNode* next = node->nextDefault;
+        while (!node->nextConditional && next && next != node && next->type == NODE_BASIC_BLOCK
+               && pred_counts[next->id] == 1) {
+            if (next->stmt_count > 0) {
+                node->statements = realloc(node->statements,
+                                           sizeof(OpNode*) * (node->stmt_count + next->stmt_count));
+                memcpy(node->statements + node->stmt_count, next->statements, sizeof(OpNode*) * next->stmt_count);
+                node->stmt_count += next->stmt_count;
+                next->stmt_count = 0;
+            }
+            if (node->line == 0) {
+                node->line = next->line;
+                node->column = next->column;
+            }
+            node->nextDefault = next->nextDefault;
+            node->nextConditional = next->nextConditional;
+            default_types[i] = default_types[next->id];
+            merged[next->id] = true;
+            next = node->nextDefault;
+        }
+    }
+
+    for (int i = 0; i < cfg->edge_count; i++) {
+        free(cfg->edges[i]);
+    }
+    cfg->edge_count = 0;
+
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        CFGNode* node = cfg->nodes[i];
+        bool keep = node == cfg->entry || node == cfg->exit
+            || (reachable[i] && !merged[i] && forward[i] == node);
+        if (!keep) {
+            for (int s = 0; s < node->stmt_count; s++) {
+                freeOpTree(node->statements[s]);
+            }
+            free(node->statements);
+            free(node);
+            continue;
+        }
+
+        if (node->nextConditional) {
+            addEdge(cfg, createCFGEdge(node, node->nextConditional, EDGE_TRUE));
+        }
+        if (node->nextDefault) {
+            addEdge(cfg, createCFGEdge(node, node->nextDefault, default_types[i]));
+        }
+        cfg->nodes[kept++] = node;
+    }
+    cfg->node_count = kept;
+
+    for (int i = 0; i < cfg->node_count; i++) {
+        cfg->nodes[i]->id = i;
+    }
+
+    free(default_types);
+    free(forward);
+    free(reachable);
+    free(merged);
+    free(pred_counts);
+    free(stack);
+
+    // Removed nodes may still be listed in a nest built earlier.
+    if (cfg->loop_nest) {
+        buildLoopNest(cfg);
+    }
+}
+
+// A single-block loop stepping one variable by a constant towards a bound
+// that the body never writes. The variable is on the left of relation.
+typedef struct {
+    CFGNode* test;          // while header or repeat condition
+    CFGNode* body;
+    CFGNode* entry_pred;    // only predecessor outside the loop, if it is a plain block
+    const OpNode* variable;
+    const OpNode* bound;
+    OpType relation;
+    int step;
+    int body_ops;
+    bool is_repeat;
+} CountedLoop;
+
+void setLoopUnrollOptions(int factor, int full_unroll_max_trips)
+{
+    g_unroll_factor = factor;
+    g_full_unroll_max_trips = full_unroll_max_trips;
+}
+
+static bool parseDecimalLiteral(const OpNode* node, int* value)
+{
+    if (!node || node->type != OP_LITERAL || !node->text || node->text[0] == '\0') {
+        return false;
+    }
+
+    char* end = NULL;
+    long parsed = strtol(node->text, &end, 10);
+    if (*end != '\0' || parsed < INT_MIN || parsed > INT_MAX) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+static int countOpTreeNodes(const OpNode* node)
+{
+    if (!node) {
+        return 0;
+    }
+
+    int count = 1;
+    for (int i = 0; i < node->operand_count; i++) {
+        count += countOpTreeNodes(node->operands[i]);
+    }
+    return count;
+}
+
+// Member paths are matched on every segment, so `this.i` counts as `i`.
+static bool opTreeMentionsName(const OpNode* node, const char* name)
+{
+    if (!node) {
+        return false;
+    }
+    if ((node->type == OP_IDENTIFIER || node->type == OP_MEMBER_ACCESS) && node->text && strcmp(node->text, name) == 0) {
+        return true;
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        if (opTreeMentionsName(node->operands[i], name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool assignmentMayWrite(const OpNode* statement, const OpNode* storage)
+{
+    if (!statement || statement->type != OP_ASSIGNMENT || statement->operand_count == 0) {
+        return false;
+    }
+    if (storage->type == OP_LITERAL) {
+        return false;
+    }
+
+    // An element store writes its array, not the names in its index.
+    const OpNode* target = statement->operands[0];
+    if (target && target->type == OP_ARRAY_INDEX && target->operand_count > 0) {
+        target = target->operands[0];
+    }
+
+    for (const OpNode* part = storage; part; part = part->operand_count > 0 ? part->operands[0] : NULL) {
+        if (part->text && opTreeMentionsName(target, part->text)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool matchStepAssignment(const OpNode* statement, const char* name, int* step)
+{
+    if (!statement || statement->type != OP_ASSIGNMENT || statement->operand_count != 2) {
+        return false;
+    }
+
+    const OpNode* target = statement->operands[0];
+    const OpNode* value = statement->operands[1];
+    if (!target || target->type != OP_IDENTIFIER || strcmp(target->text, name) != 0
+        || !value || value->operand_count != 2
+        || (value->type != OP_ADDITION && value->type != OP_SUBTRACTION)) {
+        return false;
+    }
+
+    const OpNode* left = value->operands[0];
+    const OpNode* right = value->operands[1];
+    int amount = 0;
+    bool left_is_variable = left && left->type == OP_IDENTIFIER && strcmp(left->text, name) == 0;
+    bool right_is_variable = right && right->type == OP_IDENTIFIER && strcmp(right->text, name) == 0;
+    if (left_is_variable && parseDecimalLiteral(right, &amount)) {
+        *step = value->type == OP_ADDITION ? amount : -amount;
+    } else if (value->type == OP_ADDITION && right_is_variable && parseDecimalLiteral(left, &amount)) {
+        *step = amount;
+    } else {
+        return false;
+    }
+    return *step != 0 && *step != INT_MIN;
+}
+
+static OpType mirrorRelation(OpType relation)
+{
+    switch (relation) {
+        case OP_LESS_THAN:             return OP_GREATER_THAN;
+        case OP_LESS_THAN_OR_EQUAL:    return OP_GREATER_THAN_OR_EQUAL;
+        case OP_GREATER_THAN:          return OP_LESS_THAN;
+        case OP_GREATER_THAN_OR_EQUAL: return OP_LESS_THAN_OR_EQUAL;
+        default:                       return relation;
+    }
+}
+
+// Takes the variable from operand variable_index of the relation.
+static bool matchLoopCondition(const OpNode* condition, int variable_index, CountedLoop* loop)
+{
+    if (!condition || condition->operand_count != 2 || mirrorRelation(condition->type) == condition->type) {
+        return false;
+    }
+
+    const OpNode* variable = condition->operands[variable_index];
+    const OpNode* bound = condition->operands[1 - variable_index];
+    if (!variable || variable->type != OP_IDENTIFIER || !variable->text || !bound) {
+        return false;
+    }
+
+    int ignored = 0;
+    loop->variable = variable;
+    loop->bound = bound;
+    loop->relation = variable_index == 0 ? condition->type : mirrorRelation(condition->type);
+    return parseDecimalLiteral(bound, &ignored)
+        || ((bound->type == OP_IDENTIFIER || bound->type == OP_MEMBER_ACCESS)
+            && !opTreeMentionsName(bound, variable->text));
+}
+
+// The body must step the variable exactly once, towards the bound, and
+// leave every other storage the condition reads alone.
+static bool matchLoopBody(CountedLoop* loop)
+{
+    int step_count = 0;
+    loop->body_ops = 0;
+    for (int i = 0; i < loop->body->stmt_count; i++) {
+        const OpNode* statement = loop->body->statements[i];
+        int step = 0;
+        if (matchStepAssignment(statement, loop->variable->text, &step)) {
+            loop->step = step;
+            step_count++;
+        } else if (assignmentMayWrite(statement, loop->variable)) {
+            return false;
+        }
+        if (assignmentMayWrite(statement, loop->bound)) {
+            return false;
+        }
+        loop->body_ops += countOpTreeNodes(statement);
+    }
+
+    bool ascending = loop->relation == OP_LESS_THAN || loop->relation == OP_LESS_THAN_OR_EQUAL;
+    return step_count == 1 && (loop->step > 0) == ascending;
+}
+
+// Recognises `while v REL bound do body` and `repeat body while v REL bound`
+// where body is one block containing exactly one `v := v +/- literal`.
+static bool matchCountedLoop(const ControlFlowGraph* cfg, const CFGLoop* cfg_loop, CountedLoop* loop)
+{
+    if (cfg_loop->block_count != 2 || cfg_loop->latch_count != 1) {
+        return false;
+    }
+
+    memset(loop, 0, sizeof(*loop));
+    CFGNode* header = cfg_loop->header;
+    CFGNode* other = cfg_loop->blocks[0] == header ? cfg_loop->blocks[1] : cfg_loop->blocks[0];
+    if (header->type == NODE_WHILE && other->type == NODE_BASIC_BLOCK
+        && header->nextConditional == other && other->nextDefault == header) {
+        loop->test = header;
+        loop->body = other;
+    } else if (header->type == NODE_BASIC_BLOCK && other->type == NODE_REPEAT_CONDITION
+               && header->nextDefault == other && other->nextConditional == header) {
+        loop->test = other;
+        loop->body = header;
+        loop->is_repeat = true;
+    } else {
+        return false;
+    }
+
+    if (loop->body->nextConditional || loop->test->stmt_count != 1 || loop->body->stmt_count == 0
+        || !loop->test->nextDefault) {
+        return false;
+    }
+
+    // Either side of the relation may be the counter, as in `n > i`.
+    const OpNode* condition = loop->test->statements[0];
+    if (!(matchLoopCondition(condition, 0, loop) && matchLoopBody(loop))
+        && !(matchLoopCondition(condition, 1, loop) && matchLoopBody(loop))) {
+        return false;
+    }
+
+    int entry_count = 0;
+    for (int i = 0; i < cfg->node_count; i++) {
+        CFGNode* node = cfg->nodes[i];
+        if (node == loop->test || node == loop->body
+            || (node->nextDefault != cfg_loop->header && node->nextConditional != cfg_loop->header)) {
+            continue;
+        }
+        entry_count++;
+        if (node->type == NODE_BASIC_BLOCK && !node->nextConditional) {
+            loop->entry_pred = node;
+        }
+    }
+    if (entry_count != 1) {
+        loop->entry_pred = NULL;
+    }
+    return true;
+}
+
+// Trip count of a loop testing before each iteration, starting from start.
+static long long countTestedTrips(long long start, long long bound, OpType relation, int step)
+{
+    long long span = 0;
+    switch (relation) {
+        case OP_LESS_THAN:             span = bound - start; break;
+        case OP_LESS_THAN_OR_EQUAL:    span = bound - start + 1; break;
+        case OP_GREATER_THAN:          span = start - bound; break;
+        case OP_GREATER_THAN_OR_EQUAL: span = start - bound + 1; break;
+        default:                       return -1;
+    }
+    long long magnitude = step < 0 ? -(long long)step : step;
+    return span <= 0 ? 0 : (span + magnitude - 1) / magnitude;
+}
+
+// Exact trip count when the entry block ends by storing a literal into the
+// variable and the bound is a literal; -1 otherwise.
+static long long countExactTrips(const CountedLoop* loop)
+{
+    int bound = 0;
+    if (!loop->entry_pred || !parseDecimalLiteral(loop->bound, &bound)) {
+        return -1;
+    }
+
+    for (int i = loop->entry_pred->stmt_count - 1; i >= 0; i--) {
+        const OpNode* statement = loop->entry_pred->statements[i];
+        if (!assignmentMayWrite(statement, loop->variable)) {
+            continue;
+        }
+
+        int start = 0;
+        const OpNode* target = statement->operands[0];
+        if (statement->operand_count != 2 || target->type != OP_IDENTIFIER
+            || strcmp(target->text, loop->variable->text) != 0
+            || !parseDecimalLiteral(statement->operands[1], &start)) {
+            return -1;
+        }
+        if (loop->is_repeat) {
+            return 1 + countTestedTrips((long long)start + loop->step, bound, loop->relation, loop->step);
+        }
+        return countTestedTrips(start, bound, loop->relation, loop->step);
+    }
+    return -1;
+}
+
+static void appendStatementCopies(CFGNode* target, const CFGNode* source, int copies)
+{
+    if (copies <= 0) {
+        return;
+    }
+
+    int total = target->stmt_count + source->stmt_count * copies;
+    OpNode** statements = realloc(target->statements, sizeof(OpNode*) * total);
+    if (!statements) {
+        return;
+    }
+
+    target->statements = statements;
+    for (int c = 0; c < copies; c++) {
+        for (int i = 0; i < source->stmt_count; i++) {
+            target->statements[target->stmt_count++] = cloneOpTree(source->statements[i]);
+        }
+    }
+    if (target->line == 0) {
+        target->line = source->line;
+        target->column = source->column;
+    }
+}
+
+static void removeLoopNodes(ControlFlowGraph* cfg, CFGNode* first, CFGNode* second)
+{
+    int kept_edges = 0;
+    for (int i = 0; i < cfg->edge_count; i++) {
+        CFGEdge* edge = cfg->edges[i];
+        if (edge->from == first || edge->from == second || edge->to == first || edge->to == second) {
+            free(edge);
+        } else {
+            cfg->edges[kept_edges++] = edge;
+        }
+    }
+    cfg->edge_count = kept_edges;
+
+    int kept_nodes = 0;
+    for (int i = 0; i < cfg->node_count; i++) {
+        CFGNode* node = cfg->nodes[i];
+        if (node != first && node != second) {
+            cfg->nodes[kept_nodes++] = node;
+            continue;
+        }
+        for (int s = 0; s < node->stmt_count; s++) {
+            freeOpTree(node->statements[s]);
+        }
+        free(node->statements);
+        free(node);
+    }
+    cfg->node_count = kept_nodes;
+}
+
+// Replaces the loop with trips copies of its body appended to the entry block.
+static void fullyUnrollLoop(ControlFlowGraph* cfg, const CountedLoop* loop, int trips)
+{
+    CFGNode* pred = loop->entry_pred;
+    CFGNode* header = loop->is_repeat ? loop->body : loop->test;
+    CFGNode* after = loop->test->nextDefault;
+
+    appendStatementCopies(pred, loop->body, trips);
+    pred->nextDefault = after;
+    for (int i = 0; i < cfg->edge_count; i++) {
+        if (cfg->edges[i]->from == pred && cfg->edges[i]->to == header) {
+            cfg->edges[i]->to = after;
+        }
+    }
+    removeLoopNodes(cfg, loop->test, loop->body);
+}
+
+// Puts a guard in front of the loop test that runs factor bodies per check
+// while factor more iterations are certain; the original loop runs the
+// remaining ones. The guard tests `v REL bound && span > lookahead`, where
+// span is the distance left to the bound, instead of `v + lookahead REL
+// bound`, which wraps near the int range and would run past the bound.
+// Returns false when the lookahead itself does not fit an int.
+static bool partiallyUnrollLoop(ControlFlowGraph* cfg, const CountedLoop* loop, int factor)
+{
+    long long lookahead = (long long)(factor - 1) * (loop->step < 0 ? -(long long)loop->step : loop->step);
+    if (lookahead > INT_MAX) {
+        return false;
+    }
+
+    // The relation is checked first, so the span is never negative: it either
+    // holds the distance or wraps below zero and fails the guard.
+    bool ascending = loop->step > 0;
+    OpNode* span = buildBinaryOpTree(OP_SUBTRACTION,
+                                     cloneOpTree(ascending ? loop->bound : loop->variable),
+                                     cloneOpTree(ascending ? loop->variable : loop->bound));
+    bool strict = loop->relation == OP_LESS_THAN || loop->relation == OP_GREATER_THAN;
+    OpNode* ahead = buildBinaryOpTree(strict ? OP_GREATER_THAN : OP_GREATER_THAN_OR_EQUAL,
+                                      span, buildIntLiteralOpTree((int)lookahead));
+    OpNode* in_range = buildBinaryOpTree(loop->relation, cloneOpTree(loop->variable), cloneOpTree(loop->bound));
+
+    CFGNode* guard = createCFGNode(NODE_WHILE);
+    CFGNode* unrolled = createCFGNode(NODE_BASIC_BLOCK);
+    appendStatement(guard, buildBinaryOpTree(OP_LOGICAL_AND, in_range, ahead));
+    appendStatementCopies(unrolled, loop->body, factor);
+
+    // Entries into the test from outside the loop go through the guard; in a
+    // repeat loop the body itself is the only such entry.
+    for (int i = 0; i < cfg->node_count; i++) {
+        CFGNode* node = cfg->nodes[i];
+        if (node == loop->test || (!loop->is_repeat && node == loop->body)) {
+            continue;
+        }
+        if (node->nextDefault == loop->test) {
+            node->nextDefault = guard;
+        }
+        if (node->nextConditional == loop->test) {
+            node->nextConditional = guard;
+        }
+    }
+    for (int i = 0; i < cfg->edge_count; i++) {
+        CFGEdge* edge = cfg->edges[i];
+        if (edge->to == loop->test && edge->from != loop->test && (loop->is_repeat || edge->from != loop->body)) {
+            edge->to = guard;
+        }
+    }
+
+    guard->nextConditional = unrolled;
+    guard->nextDefault = loop->test;
+    unrolled->nextDefault = guard;
+    addNode(cfg, guard);
+    addNode(cfg, unrolled);
+    addEdge(cfg, createCFGEdge(guard, unrolled, EDGE_TRUE));
+    addEdge(cfg, createCFGEdge(guard, loop->test, EDGE_FALSE));
+    addEdge(cfg, createCFGEdge(unrolled, guard, EDGE_CLASSIC));
+    return true;
+}
+
+// Unrolls innermost counted loops found in cfg->loop_nest: fully when the
+// exact trip count is small, otherwise by the configured factor. Returns the
+// number of loops changed; the CFG is re-simplified and its nest rebuilt.
+int unrollCountedLoops(ControlFlowGraph* cfg)
+{
+    if (!cfg || !cfg->loop_nest || cfg->loop_nest->loop_count == 0) {
+        return 0;
+    }
+
+    const LoopNest* nest = cfg->loop_nest;
+    bool* has_children = calloc(nest->loop_count, sizeof(bool));
+    CountedLoop* candidates = malloc(sizeof(CountedLoop) * nest->loop_count);
+    if (!has_children || !candidates) {
+        free(has_children);
+        free(candidates);
+        return 0;
+    }
+
+    for (int l = 0; l < nest->loop_count; l++) {
+        if (nest->loops[l].parent >= 0) {
+            has_children[nest->loops[l].parent] = true;
+        }
+    }
+
+    // Matched before any rewrite, while the nest still describes the CFG.
+    int candidate_count = 0;
+    for (int l = 0; l < nest->loop_count; l++) {
+        if (!has_children[l] && matchCountedLoop(cfg, &nest->loops[l], &candidates[candidate_count])) {
+            candidate_count++;
+        }
+    }
+
+    int changed = 0;
+    for (int c = 0; c < candidate_count; c++) {
+        const CountedLoop* loop = &candidates[c];
+        long long trips = g_full_unroll_max_trips > 0 ? countExactTrips(loop) : -1;
+        if (trips >= 0 && trips <= g_full_unroll_max_trips && trips * loop->body_ops <= LOOP_UNROLL_MAX_OPS) {
+            fullyUnrollLoop(cfg, loop, (int)trips);
+            changed++;
+        } else if (g_unroll_factor >= 2 && (long long)loop->body_ops * g_unroll_factor <= LOOP_UNROLL_MAX_OPS
+                   && partiallyUnrollLoop(cfg, loop, g_unroll_factor)) {
+            changed++;
+        }
+    }
+
+    free(has_children);
+    free(candidates);
+    if (changed > 0) {
+        simplifyCFG(cfg);
+    }
+    return changed;
+}
+
 const UserTypeInfo* findUserTypeInfo(const SubprogramCollection* collection, const char* name)
 {
     if (!collection || !name) {
@@ -1533,6 +2198,49 @@ const FieldInfo* findResolvedFieldInfo(const UserTypeInfo* type_info, const char
     return findFieldInArray(type_info->resolved_fields, type_info->resolved_field_count, field_name);
 }
 
+bool getArrayTypeShape(const char* type_name, int* length, int* dimensions, const char** element_type)
+{
+    if (!type_name || strncmp(type_name, "array[", 6) != 0) {
+        return false;
+    }
+
+    const char* close = strchr(type_name, ']');
+    if (!close || strncmp(close, "] of ", 5) != 0) {
+        return false;
+    }
+
+    int total = 1;
+    int count = 1;
+    const char* p = type_name + 6;
+    while (p <= close) {
+        const char* end = p;
+        while (end < close && *end != ',') {
+            end++;
+        }
+        long bound = end > p ? strtol(p, NULL, 10) : -1;
+        if (bound <= 0 || total < 0 || bound > INT_MAX / (total > 0 ? total : 1)) {
+            total = -1;
+        } else {
+            total *= (int)bound;
+        }
+        if (end < close) {
+            count++;
+        }
+        p = end + 1;
+    }
+
+    if (length) {
+        *length = total;
+    }
+    if (dimensions) {
+        *dimensions = count;
+    }
+    if (element_type) {
+        *element_type = close + 5;
+    }
+    return true;
+}
+
 static int resolveTypeSizeBytes(SubprogramCollection* collection, const char* type_name, char** visiting, int visiting_count);
 
 static int ensureResolvedUserTypeLayout(SubprogramCollection* collection,
@@ -1622,6 +2330,16 @@ static int resolveTypeSizeBytes(SubprogramCollection* collection, const char* ty
         return getBuiltinTypeSizeBytes(type_name);
     }
 
+    int length = 0;
+    const char* element_type = NULL;
+    if (getArrayTypeShape(type_name, &length, NULL, &element_type)) {
+        if (length <= 0) {
+            appendCollectionError(collection, "Array type '%s' must declare a positive length for every dimension.", type_name);
+            return 4;
+        }
+        return length * resolveTypeSizeBytes(collection, element_type, visiting, visiting_count);
+    }
+
     UserTypeInfo* type_info = findMutableUserTypeInfo(collection, type_name);
     if (!type_info) {
         appendCollectionError(collection, "Unknown type '%s'.", type_name ? type_name : "<null>");
@@ -1642,9 +2360,113 @@ int getTypeSizeBytes(const SubprogramCollection* collection, const char* type_na
         return getBuiltinTypeSizeBytes(type_name);
     }
 
+    const UserTypeInfo* type_info = findUserTypeInfo(collection, type_name);
+    if (type_info && type_info->flat_slot_count > 0) {
+        return type_info->total_size_bytes;
+    }
+
     return resolveTypeSizeBytes((SubprogramCollection*)collection, type_name, NULL, 0);
 }
 
+static void appendFlattenedSlot(FlattenedSlotInfo** slots, int* count, const char* path, const char* type_name, int offset_bytes)
+{
+    FlattenedSlotInfo* new_slots = realloc(*slots, sizeof(FlattenedSlotInfo) * (*count + 1));
+    if (!new_slots) {
+        return;
+    }
+
+    *slots = new_slots;
+    FlattenedSlotInfo* slot = &(*slots)[*count];
+    slot->path = strdup(path ? path : "");
+    slot->type_name = strdup(type_name ? type_name : "int");
+    slot->offset_bytes = offset_bytes;
+    (*count)++;
+}
+
+static void ensureFlattenedUserTypeLayout(SubprogramCollection* collection, UserTypeInfo* type_info);
+
+// Appends the leaves of one value stored at path. Arrays expand to their
+// elements as `path[k]`, so an array occupies consecutive slots.
+static void appendFlattenedValue(SubprogramCollection* collection,
+                                 FlattenedSlotInfo** slots,
+                                 int* count,
+                                 const char* path,
+                                 const char* type_name,
+                                 int offset_bytes)
+{
+    int length = 0;
+    const char* element_type = NULL;
+    if (getArrayTypeShape(type_name, &length, NULL, &element_type) && length > 0) {
+        int element_size = getTypeSizeBytes(collection, element_type);
+        for (int k = 0; k < length; k++) {
+            char element_path[512];
+            snprintf(element_path, sizeof(element_path), "%s[%d]", path, k);
+            appendFlattenedValue(collection, slots, count, element_path, element_type, offset_bytes + k * element_size);
+        }
+        return;
+    }
+
+    UserTypeInfo* nested = isBuiltinTypeName(type_name) ? NULL : findMutableUserTypeInfo(collection, type_name);
+    ensureFlattenedUserTypeLayout(collection, nested);
+    if (!nested || nested->flat_slot_count <= 0) {
+        appendFlattenedSlot(slots, count, path, type_name, offset_bytes);
+        return;
+    }
+
+    for (int j = 0; j < nested->flat_slot_count; j++) {
+        const FlattenedSlotInfo* leaf = &nested->flat_slots[j];
+        char leaf_path[512];
+        if (leaf->path[0]) {
+            snprintf(leaf_path, sizeof(leaf_path), "%s.%s", path, leaf->path);
+        } else {
+            snprintf(leaf_path, sizeof(leaf_path), "%s", path);
+        }
+        appendFlattenedSlot(slots, count, leaf_path, leaf->type_name, offset_bytes + leaf->offset_bytes);
+    }
+}
+
+// Expands nested class fields in place. Base fields come first in
+// resolved_fields, so a base class table is a prefix of a derived one.
+static void ensureFlattenedUserTypeLayout(SubprogramCollection* collection, UserTypeInfo* type_info)
+{
+    if (!type_info || type_info->kind != USER_TYPE_CLASS || type_info->flat_slot_count != 0) {
+        return;
+    }
+
+    // Marks the type in progress; a recursive field then stays a single slot.
+    type_info->flat_slot_count = -1;
+
+    FlattenedSlotInfo* slots = NULL;
+    int count = 0;
+    for (int i = 0; i < type_info->resolved_field_count; i++) {
+        const FieldInfo* field = &type_info->resolved_fields[i];
+        appendFlattenedValue(collection, &slots, &count, field->name ? field->name : "field",
+                             field->type_name, field->offset_bytes);
+    }
+
+    if (count == 0) {
+        appendFlattenedSlot(&slots, &count, "", "int", 0);
+    }
+
+    type_info->flat_slots = slots;
+    type_info->flat_slot_count = count;
+}
+
+int getFlattenedSlotCount(const SubprogramCollection* collection, const char* type_name)
+{
+    int length = 0;
+    const char* element_type = NULL;
+    if (getArrayTypeShape(type_name, &length, NULL, &element_type) && length > 0) {
+        return length * getFlattenedSlotCount(collection, element_type);
+    }
+
+    const UserTypeInfo* type_info = isBuiltinTypeName(type_name) ? NULL : findUserTypeInfo(collection, type_name);
+    if (!type_info || type_info->kind != USER_TYPE_CLASS || type_info->flat_slot_count <= 0) {
+        return 1;
+    }
+    return type_info->flat_slot_count;
+}
+
 static void collectProgramItems(SubprogramCollection* collection,
                                 const char* source_file,
                                 pANTLR3_BASE_TREE tree)
@@ -1790,39 +2612,142 @@ static void buildMethodSignatureFromSubprogram(MethodSignatureInfo* signature, c
     signature->return_type = info->return_type ? strdup(info->return_type) : strdup("void");
 }
 
-static const SubprogramInfo* findMethodInTypeHierarchy(const SubprogramCollection* collection,
-                                                       const UserTypeInfo* type_info,
-                                                       const MethodSignatureInfo* required)
+static unsigned int hashMethodKey(const char* name, const char* const* param_types, int param_count)
 {
-    if (!collection || !type_info || !required) {
-        return NULL;
+    unsigned int hash = 2166136261u;
+    for (const char* c = name; c && *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+    for (int i = 0; i < param_count; i++) {
+        hash = (hash ^ (unsigned char)',') * 16777619u;
+        for (const char* c = param_types ? param_types[i] : NULL; c && *c; c++) {
+            hash = (hash ^ (unsigned char)*c) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Same comparison as sameMethodShape, against a method's own signature.
+static bool methodMatchesKey(const SubprogramInfo* info, const char* name, const char* const* param_types, int param_count)
+{
+    if (!info->name || !name || strcmp(info->name, name) != 0 || info->param_count != param_count) {
+        return false;
+    }
+
+    for (int i = 0; i < param_count; i++) {
+        const char* own_type = info->param_types ? info->param_types[i] : NULL;
+        const char* other_type = param_types ? param_types[i] : NULL;
+        if (own_type != other_type && (!own_type || !other_type || strcmp(own_type, other_type) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keeps the first method with a given signature, so own methods shadow
+// inherited ones and duplicate declarations resolve to the earliest.
+static void insertTypeMethod(UserTypeInfo* type_info, const SubprogramInfo* method)
+{
+    const char* const* param_types = (const char* const*)method->param_types;
+    unsigned int mask = (unsigned int)type_info->method_table_capacity - 1;
+    unsigned int index = hashMethodKey(method->name, param_types, method->param_count) & mask;
+    while (type_info->method_table[index]) {
+        if (methodMatchesKey(type_info->method_table[index], method->name, param_types, method->param_count)) {
+            return;
+        }
+        index = (index + 1) & mask;
     }
 
+    type_info->method_table[index] = method;
+    type_info->method_count++;
+}
+
+static void ensureTypeMethodTable(SubprogramCollection* collection, UserTypeInfo* type_info)
+{
+    if (!type_info || type_info->kind != USER_TYPE_CLASS || type_info->method_table_capacity != 0) {
+        return;
+    }
+
+    // Marks the type in progress; a cyclic base chain then contributes nothing.
+    type_info->method_table_capacity = -1;
+
+    UserTypeInfo* base_type = type_info->base_type_name
+        ? findMutableUserTypeInfo(collection, type_info->base_type_name)
+        : NULL;
+    ensureTypeMethodTable(collection, base_type);
+    bool has_base_table = base_type && base_type->method_table_capacity > 0;
+
+    int entry_count = has_base_table ? base_type->method_count : 0;
     for (int i = 0; i < collection->count; i++) {
         const SubprogramInfo* info = &collection->items[i];
-        if (!info->owner_type_name || strcmp(info->owner_type_name, type_info->name) != 0) {
-            continue;
+        if (info->owner_type_name && strcmp(info->owner_type_name, type_info->name) == 0) {
+            entry_count++;
         }
+    }
 
-        MethodSignatureInfo candidate;
-        buildMethodSignatureFromSubprogram(&candidate, info);
-        bool matches = sameMethodContract(&candidate, required);
-        freeMethodSignature(&candidate);
-        if (matches) {
-            return info;
-        }
+    int capacity = 8;
+    while (capacity < entry_count * 2) {
+        capacity *= 2;
     }
+    type_info->method_table = calloc(capacity, sizeof(SubprogramInfo*));
+    if (!type_info->method_table) {
+        type_info->method_table_capacity = 0;
+        return;
+    }
+    type_info->method_table_capacity = capacity;
+    type_info->method_count = 0;
 
-    if (type_info->base_type_name) {
-        const UserTypeInfo* base_type = findUserTypeInfo(collection, type_info->base_type_name);
-        if (base_type) {
-            return findMethodInTypeHierarchy(collection, base_type, required);
+    for (int i = 0; i < collection->count; i++) {
+        const SubprogramInfo* info = &collection->items[i];
+        if (info->owner_type_name && info->name && strcmp(info->owner_type_name, type_info->name) == 0) {
+            insertTypeMethod(type_info, info);
+        }
+    }
+    for (int i = 0; has_base_table && i < base_type->method_table_capacity; i++) {
+        if (base_type->method_table[i]) {
+            insertTypeMethod(type_info, base_type->method_table[i]);
         }
     }
+}
 
+const SubprogramInfo* findTypeMethod(const UserTypeInfo* type_info,
+                                     const char* name,
+                                     const char* const* param_types,
+                                     int param_count)
+{
+    if (!type_info || !name || type_info->method_table_capacity <= 0) {
+        return NULL;
+    }
+
+    unsigned int mask = (unsigned int)type_info->method_table_capacity - 1;
+    unsigned int index = hashMethodKey(name, param_types, param_count) & mask;
+    while (type_info->method_table[index]) {
+        const SubprogramInfo* method = type_info->method_table[index];
+        if (methodMatchesKey(method, name, param_types, param_count)) {
+            return method;
+        }
+        index = (index + 1) & mask;
+    }
     return NULL;
 }
 
+static const SubprogramInfo* findMethodInTypeHierarchy(const UserTypeInfo* type_info, const MethodSignatureInfo* required)
+{
+    if (!type_info || !required) {
+        return NULL;
+    }
+
+    const SubprogramInfo* method = findTypeMethod(type_info,
+                                                  required->name,
+                                                  (const char* const*)required->param_types,
+                                                  required->param_count);
+    if (!method || strcmp(method->return_type ? method->return_type : "void",
+                          required->return_type ? required->return_type : "void") != 0) {
+        return NULL;
+    }
+    return method;
+}
+
 static void validateProgramItems(SubprogramCollection* collection)
 {
     if (!collection) {
@@ -1849,6 +2774,11 @@ static void validateProgramItems(SubprogramCollection* collection)
         ensureResolvedUserTypeLayout(collection, type_info, NULL, 0);
     }
 
+    for (int i = 0; i < collection->user_type_count; i++) {
+        ensureFlattenedUserTypeLayout(collection, &collection->user_types[i]);
+        ensureTypeMethodTable(collection, &collection->user_types[i]);
+    }
+
     for (int i = 0; i < collection->count; i++) {
         SubprogramInfo* info = &collection->items[i];
 
@@ -1886,7 +2816,7 @@ static void validateProgramItems(SubprogramCollection* collection)
         if (owner_type && owner_type->base_type_name) {
             const UserTypeInfo* base_type = findUserTypeInfo(collection, owner_type->base_type_name);
             if (base_type) {
-                const SubprogramInfo* base_method = findMethodInTypeHierarchy(collection, base_type, &current);
+                const SubprogramInfo* base_method = findMethodInTypeHierarchy(base_type, &current);
                 if (base_method) {
                     appendCollectionError(collection,
                                           "Method override is forbidden: '%s' in class '%s' matches a base method signature.",
@@ -1913,7 +2843,7 @@ static void validateProgramItems(SubprogramCollection* collection)
 
             for (int method_index = 0; method_index < interface_type->declared_method_count; method_index++) {
                 const MethodSignatureInfo* required = &interface_type->declared_methods[method_index];
-                const SubprogramInfo* found = findMethodInTypeHierarchy(collection, type_info, required);
+                const SubprogramInfo* found = findMethodInTypeHierarchy(type_info, required);
                 if (!found || (!found->has_body && !found->import_info.is_imported)) {
                     appendCollectionError(collection,
                                           "Class '%s' does not implement interface method '%s'.",
@@ -2009,6 +2939,12 @@ SubprogramInfo* generateSubprogramInfo(const char* source_file, pANTLR3_BASE_TRE
             free(type_info->resolved_fields ? type_info->resolved_fields[j].declaring_type_name : NULL);
         }
         free(type_info->resolved_fields);
+        for (int j = 0; j < type_info->flat_slot_count; j++) {
+            free(type_info->flat_slots[j].path);
+            free(type_info->flat_slots[j].type_name);
+        }
+        free(type_info->flat_slots);
+        free(type_info->method_table);
         for (int j = 0; j < type_info->declared_method_count; j++) {
             freeMethodSignature(&type_info->declared_methods[j]);
         }
@@ -2047,11 +2983,26 @@ void freeCFG(ControlFlowGraph* cfg)
         free(cfg->edges ? cfg->edges[i] : NULL);
     }
 
+    freeLoopNest(cfg->loop_nest);
     free(cfg->nodes);
     free(cfg->edges);
     free(cfg);
 }
 
+void freeLoopNest(LoopNest* nest)
+{
+    if (!nest) {
+        return;
+    }
+
+    for (int i = 0; i < nest->loop_count; i++) {
+        free(nest->loops[i].blocks);
+        free(nest->loops[i].latches);
+    }
+    free(nest->loops);
+    free(nest);
+}
+
 static void freeSubprogramInfo(SubprogramInfo* info)
 {
     if (!info) {
@@ -2113,6 +3064,13 @@ static void freeUserTypeInfo(UserTypeInfo* type_info)
     }
     free(type_info->resolved_fields);
 
+    for (int i = 0; i < type_info->flat_slot_count; i++) {
+        free(type_info->flat_slots[i].path);
+        free(type_info->flat_slots[i].type_name);
+    }
+    free(type_info->flat_slots);
+    free(type_info->method_table);
+
     for (int i = 0; i < type_info->declared_method_count; i++) {
         freeMethodSignature(&type_info->declared_methods[i]);
     }
@@ -25,6 +25,9 @@ typedef struct CFGNode {
     // For basic block
     OpNode** statements;
     int stmt_count;
+    // Source position of the first statement, 0 when the node has none.
+    int line;
+    int column;
     struct CFGNode* nextDefault;
     struct CFGNode* nextConditional;
 } CFGNode;
@@ -51,6 +54,23 @@ typedef struct {
     int exit_count;
 } FlowResult;
 
+// Natural loop found from the back edges into header. Loops are stored
+// outermost first, so a parent always precedes its children.
+typedef struct {
+    CFGNode* header;
+    CFGNode** blocks;     // header first, then the rest of the body
+    int block_count;
+    CFGNode** latches;    // sources of the back edges
+    int latch_count;
+    int parent;           // index of the enclosing loop, -1 at top level
+    int depth;            // 1 for outermost loops
+} CFGLoop;
+
+typedef struct {
+    CFGLoop* loops;
+    int loop_count;
+} LoopNest;
+
 typedef struct ControlFlowGraph {
     CFGNode* entry;
     CFGNode* exit;
@@ -60,6 +80,7 @@ typedef struct ControlFlowGraph {
     CFGEdge** edges;
     int edge_count;
     int max_edges;
+    LoopNest* loop_nest;
 } ControlFlowGraph;
 
 typedef enum {
@@ -80,6 +101,14 @@ typedef struct {
     int offset_bytes;
 } FieldInfo;
 
+// One storage slot of a flattened class value. Leaves are listed in slot
+// order, so a leaf's index is its slot offset from the value's first slot.
+typedef struct {
+    char* path;           // field path below the value, "" for a field-less class
+    char* type_name;
+    int offset_bytes;
+} FlattenedSlotInfo;
+
 typedef struct {
     char* name;
     char** param_types;
@@ -93,7 +122,7 @@ typedef struct {
     char* entry_name;
 } ImportInfo;
 
-typedef struct {
+typedef struct SubprogramInfo {
     char* name;
     char* owner_type_name;
     char* asm_name;
@@ -125,6 +154,12 @@ typedef struct {
     MethodSignatureInfo* declared_methods;
     int declared_method_count;
     int total_size_bytes;
+    FlattenedSlotInfo* flat_slots;   // built once the resolved layout is known
+    int flat_slot_count;
+    // Open-addressed by name and parameter types; includes inherited methods.
+    const struct SubprogramInfo** method_table;
+    int method_table_capacity;
+    int method_count;
 } UserTypeInfo;
 
 typedef struct {
@@ -154,13 +189,31 @@ SubprogramInfo* generateSubprogramInfo(const char* source_file, pANTLR3_BASE_TRE
 SubprogramCollection generateSubprogramInfoCollection(const char* source_file, pANTLR3_BASE_TREE tree);
 void cfgToDot(ControlFlowGraph* cfg, FILE* out);
 void cfgNodesToDot(ControlFlowGraph* cfg, FILE* out);
+// Node kind as the DOT labels show it, e.g. "ENTRY_POINT".
+const char* nodeTypeToString(NodeType type);
+void simplifyCFG(ControlFlowGraph* cfg);
+// Partial unroll factor (below 2 disables) and the largest exact trip count
+// unrolled completely (0 disables) used by unrollCountedLoops.
+#define LOOP_UNROLL_DEFAULT_FACTOR 4
+#define LOOP_UNROLL_DEFAULT_FULL_TRIPS 8
+void setLoopUnrollOptions(int factor, int full_unroll_max_trips);
+int unrollCountedLoops(ControlFlowGraph* cfg);
 void freeCFG(ControlFlowGraph* cfg);
+void freeLoopNest(LoopNest* nest);
 
 // Subprogram helpers
 void freeSubprogramCollection(SubprogramCollection* collection);
 const UserTypeInfo* findUserTypeInfo(const SubprogramCollection* collection, const char* name);
 const FieldInfo* findResolvedFieldInfo(const UserTypeInfo* type_info, const char* field_name);
 int getTypeSizeBytes(const SubprogramCollection* collection, const char* type_name);
+int getFlattenedSlotCount(const SubprogramCollection* collection, const char* type_name);
+// Splits "array[N] of T" as written by the parser. length is the element
+// count over all dimensions, or -1 when a bound is missing.
+bool getArrayTypeShape(const char* type_name, int* length, int* dimensions, const char** element_type);
+const SubprogramInfo* findTypeMethod(const UserTypeInfo* type_info,
+                                     const char* name,
+                                     const char* const* param_types,
+                                     int param_count);
 
 // Call graph helpers
 CallGraph* buildCallGraph(const SubprogramCollection* collection);
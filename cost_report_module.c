@@ -0,0 +1,333 @@
+#include "cost_report_module.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "myvm_isa.h"
+
+// A node inside k nested loops is assumed to run COST_LOOP_WEIGHT^k times.
+#define COST_LOOP_WEIGHT 10
+#define COST_MAX_LOOP_DEPTH 6
+
+typedef struct {
+    int node_id;
+    int instruction_count;
+    int size_bytes;
+    int loop_depth;
+} NodeCost;
+
+typedef struct {
+    int return_id;
+    int spill_count;
+    int loop_depth;
+    int instructions;   // spills, call protocol and return dispatch per call
+} CallCost;
+
+typedef struct {
+    char* name;
+    int instruction_count;
+    int size_bytes;
+    int max_loop_depth;
+    long long estimated_cost;
+    long long call_overhead;
+    NodeCost* nodes;
+    int node_count;
+    CallCost* calls;
+    int call_count;
+} MethodCost;
+
+struct CostReport {
+    MethodCost* methods;
+    int method_count;
+};
+
+static int instruction_size(const Instruction* instr)
+{
+    for (int i = 0; i < MYVM_INSTRUCTION_COUNT; i++) {
+        if (strcmp(MYVM_INSTRUCTIONS[i].mnemonic, instr->mnemonic) == 0) {
+            return MYVM_INSTRUCTIONS[i].size_bytes;
+        }
+    }
+    // Labels take no space and never execute.
+    return 0;
+}
+
+// printSubprogramImage drops a jmp to the next instruction unless it belongs
+// to the table after a jmpt.
+static void measure_instructions(const SubprogramImage* image, int* sizes)
+{
+    bool in_table = false;
+    for (int i = 0; i < image->instruction_count; i++) {
+        const Instruction* instr = &image->instructions[i];
+        sizes[i] = instruction_size(instr);
+        if (strcmp(instr->mnemonic, MYVM_MNEMONIC_JMP) != 0 || instr->operand_count != 1) {
+            in_table = strcmp(instr->mnemonic, MYVM_MNEMONIC_JMPT) == 0;
+            continue;
+        }
+        char* end = NULL;
+        long target = strtol(instr->operands[0], &end, 10);
+        if (!in_table && end != instr->operands[0] && *end == '\0' && target == i + 1) {
+            sizes[i] = 0;
+        }
+    }
+}
+
+static long long loop_weight(int depth)
+{
+    long long weight = 1;
+    for (int i = 0; i < depth && i < COST_MAX_LOOP_DEPTH; i++) {
+        weight *= COST_LOOP_WEIGHT;
+    }
+    return weight;
+}
+
+static int find_block_depth(const SubprogramImage* image, int instruction)
+{
+    for (int i = 0; i < image->block_count; i++) {
+        const ImageBlock* block = &image->blocks[i];
+        if (instruction >= block->first_instruction
+            && instruction < block->first_instruction + block->instruction_count) {
+            return block->loop_depth;
+        }
+    }
+    return 0;
+}
+
+// Saved slots reload as ldg2 pairs and restore one stg each; the call pushes
+// its return id and jumps; the callee jumps to the dispatch, which runs
+// dup/pushi/jeq for every site up to this one, then pop and jmp back.
+static int call_instruction_count(const ImageCallSite* site)
+{
+    int spills = (site->spill_count + 1) / 2 + site->spill_count;
+    return spills + 2 + 1 + 3 * site->return_id + 2;
+}
+
+static void free_method_cost(MethodCost* method)
+{
+    free(method->name);
+    free(method->nodes);
+    free(method->calls);
+}
+
+CostReport* createCostReport(void)
+{
+    return calloc(1, sizeof(CostReport));
+}
+
+void freeCostReport(CostReport* report)
+{
+    if (!report) {
+        return;
+    }
+    for (int i = 0; i < report->method_count; i++) {
+        free_method_cost(&report->methods[i]);
+    }
+    free(report->methods);
+    free(report);
+}
+
+bool costReportAddImage(CostReport* report, const SubprogramImage* image, const char* entry_label)
+{
+    if (!report || !image) {
+        return false;
+    }
+
+    MethodCost* methods = realloc(report->methods, sizeof(MethodCost) * (report->method_count + 1));
+    if (!methods) {
+        return false;
+    }
+    report->methods = methods;
+
+    MethodCost method;
+    memset(&method, 0, sizeof(method));
+    method.name = strdup(entry_label ? entry_label : "<unknown>");
+    method.nodes = malloc(sizeof(NodeCost) * (image->block_count > 0 ? image->block_count : 1));
+    method.calls = malloc(sizeof(CallCost) * (image->call_site_count > 0 ? image->call_site_count : 1));
+    if (!method.name || !method.nodes || !method.calls) {
+        free_method_cost(&method);
+        return false;
+    }
+
+    // Instructions outside every node (the receiver prologue) run once.
+    int* depths = calloc(image->instruction_count > 0 ? image->instruction_count : 1, sizeof(int));
+    int* sizes = malloc(sizeof(int) * (image->instruction_count > 0 ? image->instruction_count : 1));
+    if (!depths || !sizes) {
+        free(depths);
+        free(sizes);
+        free_method_cost(&method);
+        return false;
+    }
+    measure_instructions(image, sizes);
+
+    for (int i = 0; i < image->block_count; i++) {
+        const ImageBlock* block = &image->blocks[i];
+        NodeCost* node = &method.nodes[method.node_count++];
+        node->node_id = block->node_id;
+        node->instruction_count = 0;
+        node->size_bytes = 0;
+        node->loop_depth = block->loop_depth;
+        for (int j = block->first_instruction; j < block->first_instruction + block->instruction_count; j++) {
+            if (sizes[j] > 0) {
+                node->instruction_count++;
+                node->size_bytes += sizes[j];
+            }
+            depths[j] = block->loop_depth;
+        }
+        if (block->loop_depth > method.max_loop_depth) {
+            method.max_loop_depth = block->loop_depth;
+        }
+    }
+
+    for (int i = 0; i < image->instruction_count; i++) {
+        if (sizes[i] > 0) {
+            method.instruction_count++;
+            method.size_bytes += sizes[i];
+            method.estimated_cost += loop_weight(depths[i]);
+        }
+    }
+    free(depths);
+    free(sizes);
+
+    for (int i = 0; i < image->call_site_count; i++) {
+        const ImageCallSite* site = &image->call_sites[i];
+        CallCost* call = &method.calls[method.call_count++];
+        call->return_id = site->return_id;
+        call->spill_count = site->spill_count;
+        call->loop_depth = find_block_depth(image, site->jump_instruction);
+        call->instructions = call_instruction_count(site);
+
+        long long weight = loop_weight(call->loop_depth);
+        method.call_overhead += weight * call->instructions;
+        // The body already counts the spills and the call; the callee's jump
+        // and the dispatch run outside this image.
+        method.estimated_cost += weight * (1 + 3 * site->return_id + 2);
+    }
+
+    report->methods[report->method_count++] = method;
+    return true;
+}
+
+void costReportObserveImage(const SubprogramImage* image, const char* entry_label, void* user_data)
+{
+    costReportAddImage((CostReport*)user_data, image, entry_label);
+}
+
+static int compare_methods(const void* left, const void* right)
+{
+    const MethodCost* a = *(const MethodCost* const*)left;
+    const MethodCost* b = *(const MethodCost* const*)right;
+    if (a->estimated_cost != b->estimated_cost) {
+        return a->estimated_cost > b->estimated_cost ? -1 : 1;
+    }
+    if (a->size_bytes != b->size_bytes) {
+        return a->size_bytes > b->size_bytes ? -1 : 1;
+    }
+    return strcmp(a->name, b->name);
+}
+
+static const MethodCost** sort_methods(const CostReport* report)
+{
+    const MethodCost** sorted = malloc(sizeof(MethodCost*) * (report->method_count > 0 ? report->method_count : 1));
+    if (!sorted) {
+        return NULL;
+    }
+    for (int i = 0; i < report->method_count; i++) {
+        sorted[i] = &report->methods[i];
+    }
+    qsort(sorted, report->method_count, sizeof(MethodCost*), compare_methods);
+    return sorted;
+}
+
+static int total_spill_count(const MethodCost* method)
+{
+    int spills = 0;
+    for (int i = 0; i < method->call_count; i++) {
+        spills += method->calls[i].spill_count;
+    }
+    return spills;
+}
+
+void costReportWriteTable(const CostReport* report, FILE* out)
+{
+    if (!report || !out) {
+        return;
+    }
+    const MethodCost** sorted = sort_methods(report);
+    if (!sorted) {
+        return;
+    }
+
+    fprintf(out, "%-32s %7s %7s %6s %6s %6s %7s %12s %12s %6s\n",
+            "method", "instrs", "bytes", "nodes", "depth", "calls", "spills", "est. cost", "call cost", "call%");
+    for (int i = 0; i < report->method_count; i++) {
+        const MethodCost* method = sorted[i];
+        int call_share = method->estimated_cost > 0
+            ? (int)(method->call_overhead * 100 / method->estimated_cost)
+            : 0;
+        fprintf(out, "%-32s %7d %7d %6d %6d %6d %7d %12lld %12lld %5d%%\n",
+                method->name, method->instruction_count, method->size_bytes, method->node_count,
+                method->max_loop_depth, method->call_count, total_spill_count(method),
+                method->estimated_cost, method->call_overhead, call_share > 100 ? 100 : call_share);
+    }
+    fprintf(out, "\nest. cost: executed instructions, a node in k nested loops counted %d^k times, plus\n",
+            COST_LOOP_WEIGHT);
+    fprintf(out, "the return dispatch of every call; call cost: spills, call protocol and dispatch.\n");
+
+    free(sorted);
+}
+
+static void write_json_string(FILE* out, const char* text)
+{
+    fputc('"', out);
+    for (const char* p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if ((unsigned char)*p < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char)*p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+void costReportWriteJson(const CostReport* report, FILE* out)
+{
+    if (!report || !out) {
+        return;
+    }
+    const MethodCost** sorted = sort_methods(report);
+    if (!sorted) {
+        return;
+    }
+
+    fprintf(out, "{\n  \"loop_weight\": %d,\n  \"methods\": [", COST_LOOP_WEIGHT);
+    for (int i = 0; i < report->method_count; i++) {
+        const MethodCost* method = sorted[i];
+        fprintf(out, "%s\n    {\n      \"name\": ", i > 0 ? "," : "");
+        write_json_string(out, method->name);
+        fprintf(out, ",\n      \"instructions\": %d,\n      \"bytes\": %d,\n      \"max_loop_depth\": %d,\n",
+                method->instruction_count, method->size_bytes, method->max_loop_depth);
+        fprintf(out, "      \"estimated_cost\": %lld,\n      \"call_overhead\": %lld,\n",
+                method->estimated_cost, method->call_overhead);
+
+        fprintf(out, "      \"nodes\": [");
+        for (int j = 0; j < method->node_count; j++) {
+            const NodeCost* node = &method->nodes[j];
+            fprintf(out, "%s\n        { \"id\": %d, \"instructions\": %d, \"bytes\": %d, \"loop_depth\": %d }",
+                    j > 0 ? "," : "", node->node_id, node->instruction_count, node->size_bytes, node->loop_depth);
+        }
+        fprintf(out, "%s],\n", method->node_count > 0 ? "\n      " : "");
+
+        fprintf(out, "      \"calls\": [");
+        for (int j = 0; j < method->call_count; j++) {
+            const CallCost* call = &method->calls[j];
+            fprintf(out, "%s\n        { \"return_id\": %d, \"spill_slots\": %d, \"loop_depth\": %d, \"instructions\": %d }",
+                    j > 0 ? "," : "", call->return_id, call->spill_count, call->loop_depth, call->instructions);
+        }
+        fprintf(out, "%s]\n    }", method->call_count > 0 ? "\n      " : "");
+    }
+    fprintf(out, "%s]\n}\n", report->method_count > 0 ? "\n  " : "");
+
+    free(sorted);
+}
@@ -0,0 +1,22 @@
+#ifndef COST_REPORT_MODULE_H
+#define COST_REPORT_MODULE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "to_asm_module.h"
+
+typedef struct CostReport CostReport;
+
+CostReport* createCostReport(void);
+void freeCostReport(CostReport* report);
+// Measures one final image; jump operands must still be instruction indices.
+bool costReportAddImage(CostReport* report, const SubprogramImage* image, const char* entry_label);
+// AsmImageObserver adapter, pass the report as user_data.
+void costReportObserveImage(const SubprogramImage* image, const char* entry_label, void* user_data);
+// One row per method, most expensive first.
+void costReportWriteTable(const CostReport* report, FILE* out);
+// Same data plus the per-node and per-call breakdown.
+void costReportWriteJson(const CostReport* report, FILE* out);
+
+#endif
@@ -12,9 +12,30 @@
 #include "parser_module.h"
 #include "cfg_builder_module.h"
 #include "to_asm_module.h"
+#include "to_x86_module.h"
+#include "to_c_module.h"
+#include "ngram_miner_module.h"
+#include "cost_report_module.h"
 
 #define PATH_SEPARATOR '\\'
 
+typedef enum {
+    TARGET_MYVM,
+    TARGET_X86_64,
+    TARGET_C
+} OutputTarget;
+
+static OutputTarget g_target = TARGET_MYVM;
+static NgramMiner* g_ngram_miner = NULL;
+static const char* g_ngram_report_path = NULL;
+static bool g_cost_report = false;
+static CostReport* g_file_cost_report = NULL;
+static bool g_profile = false;
+static int g_unroll_factor = LOOP_UNROLL_DEFAULT_FACTOR;
+static int g_unroll_full_trips = LOOP_UNROLL_DEFAULT_FULL_TRIPS;
+
+#define NGRAM_REPORT_TOP_COUNT 20
+
 int create_directory(const char* path)
 {
     return mkdir(path);
@@ -77,6 +98,42 @@ static char* sanitize_filename_component(const char* name)
     return clean;
 }
 
+// Hands each final myvm image to the n-gram miner and the cost report.
+static void observe_image(const SubprogramImage* image, const char* entry_label, void* user_data)
+{
+    (void)user_data;
+    if (g_ngram_miner) {
+        ngramMinerObserveImage(image, entry_label, g_ngram_miner);
+    }
+    if (g_file_cost_report) {
+        costReportObserveImage(image, entry_label, g_file_cost_report);
+    }
+}
+
+static void write_cost_report(const char* base_name)
+{
+    char table_path[1024];
+    char json_path[1024];
+    snprintf(table_path, sizeof(table_path), "%s.cost.txt", base_name);
+    snprintf(json_path, sizeof(json_path), "%s.cost.json", base_name);
+
+    FILE* table_file = fopen(table_path, "w");
+    FILE* json_file = fopen(json_path, "w");
+    if (!table_file || !json_file) {
+        fprintf(stderr, "Cannot open cost report files: %s, %s\n", table_path, json_path);
+    } else {
+        costReportWriteTable(g_file_cost_report, table_file);
+        costReportWriteJson(g_file_cost_report, json_file);
+        printf("Cost report saved to: %s, %s\n", table_path, json_path);
+    }
+    if (table_file) {
+        fclose(table_file);
+    }
+    if (json_file) {
+        fclose(json_file);
+    }
+}
+
 int process_file(const char* input_file_path, const char* ast_dir, const char* cfg_dir)
 {
     printf("\n=== Processing file: %s ===\n", input_file_path);
@@ -175,6 +232,54 @@ int process_file(const char* input_file_path, const char* ast_dir, const char* c
     fclose(call_graph_file);
     printf("Call graph saved to: %s\n", call_graph_path);
 
+    if (g_target == TARGET_X86_64) {
+        char x86_path[1024];
+        snprintf(x86_path, sizeof(x86_path), "%s.s", base_name);
+        FILE* x86_file = fopen(x86_path, "w");
+        if (!x86_file) {
+            fprintf(stderr, "Cannot open x86-64 output file: %s\n", x86_path);
+            goto cleanup;
+        }
+
+        char* x86_error = NULL;
+        bool x86_ok = generateProgramX86(&subprograms, x86_file, &x86_error);
+        fclose(x86_file);
+        if (!x86_ok) {
+            remove(x86_path);
+            fprintf(stderr, "x86-64 generation failed: %s\n", x86_error ? x86_error : "unknown error");
+            free(x86_error);
+            goto cleanup;
+        }
+
+        printf("x86-64 assembly saved to: %s (link with x86_runtime.c)\n", x86_path);
+        success = 1;
+        goto cleanup;
+    }
+
+    if (g_target == TARGET_C) {
+        char c_path[1024];
+        snprintf(c_path, sizeof(c_path), "%s.c", base_name);
+        FILE* c_file = fopen(c_path, "w");
+        if (!c_file) {
+            fprintf(stderr, "Cannot open C output file: %s\n", c_path);
+            goto cleanup;
+        }
+
+        char* c_error = NULL;
+        bool c_ok = generateProgramC(&subprograms, c_file, &c_error);
+        fclose(c_file);
+        if (!c_ok) {
+            remove(c_path);
+            fprintf(stderr, "C generation failed: %s\n", c_error ? c_error : "unknown error");
+            free(c_error);
+            goto cleanup;
+        }
+
+        printf("C source saved to: %s (build with cc -O2)\n", c_path);
+        success = 1;
+        goto cleanup;
+    }
+
     char asm_path[1024];
     snprintf(asm_path, sizeof(asm_path), "%s.asm", base_name);
     FILE* asm_file = fopen(asm_path, "w");
@@ -184,8 +289,36 @@ int process_file(const char* input_file_path, const char* ast_dir, const char* c
     }
 
     char* asm_error = NULL;
+    setAsmDeadMethodReport(stdout);
+    if (g_cost_report) {
+        g_file_cost_report = createCostReport();
+    }
+    char profile_path[1024];
+    FILE* profile_file = NULL;
+    if (g_profile) {
+        snprintf(profile_path, sizeof(profile_path), "%s.profile.map", base_name);
+        profile_file = fopen(profile_path, "w");
+        if (!profile_file) {
+            fprintf(stderr, "Cannot open profile map file: %s\n", profile_path);
+        }
+        setAsmProfileMap(profile_file);
+    }
     bool asm_ok = generateProgramAsm(&subprograms, asm_file, &asm_error);
     fclose(asm_file);
+    if (profile_file) {
+        setAsmProfileMap(NULL);
+        fclose(profile_file);
+        if (asm_ok) {
+            printf("Profile map saved to: %s (run tools/profile_report on it)\n", profile_path);
+        } else {
+            remove(profile_path);
+        }
+    }
+    if (asm_ok && g_file_cost_report) {
+        write_cost_report(base_name);
+    }
+    freeCostReport(g_file_cost_report);
+    g_file_cost_report = NULL;
 
     if (!asm_ok) {
         remove(asm_path);
@@ -227,6 +360,54 @@ void print_help(const char* program_name)
     printf("Options:\n");
     printf("    --help        Display this help message\n");
     printf("    --multiple    Enter multiple files mode\n");
+    printf("    --target=T    Output for T: myvm (default, .asm) or x86-64 (.s)\n");
+    printf("    --emit=c      Output C11 source (.c) instead of assembly\n");
+    printf("    --cost-report Write <name>.cost.txt and <name>.cost.json with the size and\n");
+    printf("                  estimated cost of every myvm method\n");
+    printf("    --profile     Count every CFG node of the myvm program, print the counters\n");
+    printf("                  on halt and write <name>.profile.map for profile_report\n");
+    printf("    --inline-budget=N\n");
+    printf("                  Inline myvm callees of at most N operations (default 24, 0 disables)\n");
+    printf("    --unroll-factor=N\n");
+    printf("                  Run N copies of a counted loop body per test (default 4, below 2\n");
+    printf("                  disables partial unrolling)\n");
+    printf("    --unroll-full-trips=N\n");
+    printf("                  Unroll counted loops of at most N known trips completely\n");
+    printf("                  (default 8, 0 disables)\n");
+    printf("    --mine-ngrams=F\n");
+    printf("                  Write frequent myvm instruction sequences of all inputs,\n");
+    printf("                  with candidate superinstructions, to report file F\n");
+    printf("                  options must come before the other arguments\n");
+}
+
+// Reads the N of a numeric option; only plain non-negative decimals are accepted.
+static bool parse_count_option(const char* text, int* out_value)
+{
+    char* end = NULL;
+    long value = strtol(text, &end, 10);
+    if (*text < '0' || *text > '9' || *end != '\0' || value > 1000000) {
+        return false;
+    }
+    *out_value = (int)value;
+    return true;
+}
+
+// Writes the --mine-ngrams report once every input has been compiled.
+static void finish_ngram_report(void)
+{
+    if (!g_ngram_miner) {
+        return;
+    }
+    FILE* out = fopen(g_ngram_report_path, "w");
+    if (out) {
+        ngramMinerWriteReport(g_ngram_miner, NGRAM_REPORT_TOP_COUNT, out);
+        fclose(out);
+        printf("N-gram report saved to: %s\n", g_ngram_report_path);
+    } else {
+        fprintf(stderr, "Failed to open n-gram report file: %s\n", g_ngram_report_path);
+    }
+    freeNgramMiner(g_ngram_miner);
+    g_ngram_miner = NULL;
 }
 
 void print_results(const char* ast_dir, const char* cfg_dir, int processed_files_count, int total_files_count)
@@ -245,6 +426,84 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    int option_count = 0;
+    while (1 + option_count < argc && (strncmp(argv[1 + option_count], "--target=", 9) == 0
+                                       || strncmp(argv[1 + option_count], "--emit=", 7) == 0
+                                       || strncmp(argv[1 + option_count], "--mine-ngrams=", 14) == 0
+                                       || strcmp(argv[1 + option_count], "--cost-report") == 0
+                                       || strncmp(argv[1 + option_count], "--inline-budget=", 16) == 0
+                                       || strncmp(argv[1 + option_count], "--unroll-factor=", 16) == 0
+                                       || strncmp(argv[1 + option_count], "--unroll-full-trips=", 20) == 0
+                                       || strcmp(argv[1 + option_count], "--profile") == 0)) {
+        const char* option = argv[1 + option_count];
+        if (strcmp(option, "--cost-report") == 0) {
+            g_cost_report = true;
+            option_count++;
+            continue;
+        }
+        if (strcmp(option, "--profile") == 0) {
+            g_profile = true;
+            option_count++;
+            continue;
+        }
+        const char* target = strchr(option, '=') + 1;
+        if (strncmp(option, "--inline-budget=", 16) == 0) {
+            int max_ops;
+            if (!parse_count_option(target, &max_ops)) {
+                fprintf(stderr, "Error: --inline-budget needs a non-negative number, got '%s'\n\n", target);
+                print_help(argv[0]);
+                return 1;
+            }
+            setAsmInlineBudget(max_ops);
+        } else if (strncmp(option, "--unroll-factor=", 16) == 0) {
+            if (!parse_count_option(target, &g_unroll_factor)) {
+                fprintf(stderr, "Error: --unroll-factor needs a non-negative number, got '%s'\n\n", target);
+                print_help(argv[0]);
+                return 1;
+            }
+            setLoopUnrollOptions(g_unroll_factor, g_unroll_full_trips);
+        } else if (strncmp(option, "--unroll-full-trips=", 20) == 0) {
+            if (!parse_count_option(target, &g_unroll_full_trips)) {
+                fprintf(stderr, "Error: --unroll-full-trips needs a non-negative number, got '%s'\n\n", target);
+                print_help(argv[0]);
+                return 1;
+            }
+            setLoopUnrollOptions(g_unroll_factor, g_unroll_full_trips);
+        } else if (strncmp(option, "--mine-ngrams=", 14) == 0) {
+            if (!g_ngram_miner) {
+                g_ngram_miner = createNgramMiner(2, 4);
+            }
+            if (!g_ngram_miner || *target == '\0') {
+                fprintf(stderr, "Error: --mine-ngrams needs a report file\n\n");
+                print_help(argv[0]);
+                return 1;
+            }
+            g_ngram_report_path = target;
+        } else if (strncmp(option, "--emit=", 7) == 0) {
+            if (strcmp(target, "c") != 0) {
+                fprintf(stderr, "Error: Unknown output '%s'\n\n", target);
+                print_help(argv[0]);
+                return 1;
+            }
+            g_target = TARGET_C;
+        } else if (strcmp(target, "myvm") == 0) {
+            g_target = TARGET_MYVM;
+        } else if (strcmp(target, "x86-64") == 0) {
+            g_target = TARGET_X86_64;
+        } else {
+            fprintf(stderr, "Error: Unknown target '%s'\n\n", target);
+            print_help(argv[0]);
+            return 1;
+        }
+        option_count++;
+    }
+    if (g_ngram_miner || g_cost_report) {
+        setAsmImageObserver(observe_image, NULL);
+    }
+    argv[option_count] = argv[0];
+    argv += option_count;
+    argc -= option_count;
+
     if (argc == 4 && strcmp(argv[1], "--multiple") != 0) {
         const char* input_file_path = argv[1];
         const char* ast_dir = argv[2];
@@ -257,6 +516,7 @@ int main(int argc, char* argv[])
 
         printf("\n");
         print_results(ast_dir, cfg_dir, processed_files_count, 1);
+        finish_ngram_report();
         return 0;
     }
 
@@ -291,6 +551,7 @@ int main(int argc, char* argv[])
         }
 
         print_results(ast_dir, cfg_dir, processed_files_count, total_files_count);
+        finish_ngram_report();
         return 0;
     }
 
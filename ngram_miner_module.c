@@ -0,0 +1,496 @@
+#include "ngram_miner_module.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "myvm_isa.h"
+
+#define NGRAM_MAX_LENGTH 4
+#define NGRAM_MAX_OPERANDS (NGRAM_MAX_LENGTH * MYVM_MAX_OPERANDS)
+// A site inside k nested loops is assumed to run NGRAM_LOOP_WEIGHT^k times.
+#define NGRAM_LOOP_WEIGHT 10
+#define NGRAM_MAX_LOOP_DEPTH 3
+
+typedef struct {
+    char* key;                       // mnemonics joined by "; "
+    const MyVmInstructionInfo* parts[NGRAM_MAX_LENGTH];
+    int length;
+    int operand_count;
+    char* operand_values[NGRAM_MAX_OPERANDS];  // value shared by every site
+    bool operand_varies[NGRAM_MAX_OPERANDS];
+    int site_count;
+    long long weighted_count;
+    int last_image;                  // 1-based image number of the latest site
+    int image_count;                 // images with at least one site
+} NgramEntry;
+
+struct NgramMiner {
+    int min_length;
+    int max_length;
+    NgramEntry* entries;
+    int entry_count;
+    int entry_capacity;
+    int* buckets;                    // entry index or -1, open addressing
+    int bucket_count;
+    int image_count;
+    long long instruction_count;
+};
+
+static const MyVmInstructionInfo* find_info(const char* mnemonic)
+{
+    for (int i = 0; i < MYVM_INSTRUCTION_COUNT; i++) {
+        if (strcmp(MYVM_INSTRUCTIONS[i].mnemonic, mnemonic) == 0) {
+            return &MYVM_INSTRUCTIONS[i];
+        }
+    }
+    return NULL;
+}
+
+static bool is_jump_info(const MyVmInstructionInfo* info)
+{
+    return info->operand_count > 0 && info->operands[0] == MYVM_OPERAND_ADDR24;
+}
+
+// Control leaves the sequence after jumps and halt, so they may only end one.
+static bool ends_straight_line(const MyVmInstructionInfo* info)
+{
+    return is_jump_info(info) || info->opcode == MYVM_OP_HALT;
+}
+
+static bool parse_target(const char* text, int* out_index)
+{
+    if (!text || !*text) {
+        return false;
+    }
+    char* end = NULL;
+    long value = strtol(text, &end, 10);
+    if (*end != '\0' || value < 0 || value > INT_MAX) {
+        return false;
+    }
+    *out_index = (int)value;
+    return true;
+}
+
+static unsigned long hash_key(const char* key)
+{
+    unsigned long hash = 2166136261UL;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        hash = (hash ^ *p) * 16777619UL;
+    }
+    return hash;
+}
+
+static bool grow_buckets(NgramMiner* miner)
+{
+    int bucket_count = miner->bucket_count > 0 ? miner->bucket_count * 2 : 256;
+    int* buckets = malloc(sizeof(int) * bucket_count);
+    if (!buckets) {
+        return false;
+    }
+    for (int i = 0; i < bucket_count; i++) {
+        buckets[i] = -1;
+    }
+    for (int i = 0; i < miner->entry_count; i++) {
+        unsigned long slot = hash_key(miner->entries[i].key) & (unsigned long)(bucket_count - 1);
+        while (buckets[slot] >= 0) {
+            slot = (slot + 1) & (unsigned long)(bucket_count - 1);
+        }
+        buckets[slot] = i;
+    }
+    free(miner->buckets);
+    miner->buckets = buckets;
+    miner->bucket_count = bucket_count;
+    return true;
+}
+
+static NgramEntry* find_or_add_entry(NgramMiner* miner, const char* key, const MyVmInstructionInfo** parts, int length)
+{
+    if ((miner->entry_count + 1) * 4 > miner->bucket_count * 3 && !grow_buckets(miner)) {
+        return NULL;
+    }
+
+    unsigned long mask = (unsigned long)(miner->bucket_count - 1);
+    unsigned long slot = hash_key(key) & mask;
+    while (miner->buckets[slot] >= 0) {
+        NgramEntry* entry = &miner->entries[miner->buckets[slot]];
+        if (strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (miner->entry_count == miner->entry_capacity) {
+        int capacity = miner->entry_capacity > 0 ? miner->entry_capacity * 2 : 128;
+        NgramEntry* entries = realloc(miner->entries, sizeof(NgramEntry) * capacity);
+        if (!entries) {
+            return NULL;
+        }
+        miner->entries = entries;
+        miner->entry_capacity = capacity;
+    }
+
+    NgramEntry* entry = &miner->entries[miner->entry_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->key = strdup(key);
+    if (!entry->key) {
+        return NULL;
+    }
+    entry->length = length;
+    for (int i = 0; i < length; i++) {
+        entry->parts[i] = parts[i];
+        entry->operand_count += parts[i]->operand_count;
+    }
+    miner->buckets[slot] = miner->entry_count++;
+    return entry;
+}
+
+static void record_operands(NgramEntry* entry, const Instruction* site)
+{
+    int operand = 0;
+    for (int i = 0; i < entry->length; i++) {
+        const MyVmInstructionInfo* info = entry->parts[i];
+        for (int j = 0; j < info->operand_count; j++, operand++) {
+            const char* value = j < site[i].operand_count ? site[i].operands[j] : "";
+            // Jump targets differ per image even when the indices agree.
+            if (info->operands[j] == MYVM_OPERAND_ADDR24) {
+                entry->operand_varies[operand] = true;
+            } else if (entry->site_count == 0) {
+                entry->operand_values[operand] = strdup(value);
+                entry->operand_varies[operand] = entry->operand_values[operand] == NULL;
+            } else if (!entry->operand_varies[operand] && strcmp(entry->operand_values[operand], value) != 0) {
+                entry->operand_varies[operand] = true;
+            }
+        }
+    }
+}
+
+NgramMiner* createNgramMiner(int min_length, int max_length)
+{
+    if (min_length < 2) {
+        min_length = 2;
+    }
+    if (max_length > NGRAM_MAX_LENGTH) {
+        max_length = NGRAM_MAX_LENGTH;
+    }
+    if (max_length < min_length) {
+        return NULL;
+    }
+
+    NgramMiner* miner = calloc(1, sizeof(NgramMiner));
+    if (!miner) {
+        return NULL;
+    }
+    miner->min_length = min_length;
+    miner->max_length = max_length;
+    return miner;
+}
+
+void freeNgramMiner(NgramMiner* miner)
+{
+    if (!miner) {
+        return;
+    }
+    for (int i = 0; i < miner->entry_count; i++) {
+        free(miner->entries[i].key);
+        for (int j = 0; j < miner->entries[i].operand_count; j++) {
+            free(miner->entries[i].operand_values[j]);
+        }
+    }
+    free(miner->entries);
+    free(miner->buckets);
+    free(miner);
+}
+
+bool ngramMinerAddImage(NgramMiner* miner, const SubprogramImage* image)
+{
+    if (!miner || !image || image->instruction_count == 0) {
+        return true;
+    }
+
+    int count = image->instruction_count;
+    const MyVmInstructionInfo** infos = calloc(count, sizeof(*infos));
+    bool* is_target = calloc(count, sizeof(bool));
+    int* loop_depth = calloc(count + 1, sizeof(int));
+    if (!infos || !is_target || !loop_depth) {
+        free(infos);
+        free(is_target);
+        free(loop_depth);
+        return false;
+    }
+
+    // Labels and unknown mnemonics stay NULL and split the stream; every
+    // backward jump encloses one more loop level from its target to itself.
+    for (int i = 0; i < count; i++) {
+        infos[i] = find_info(image->instructions[i].mnemonic);
+        int target = 0;
+        if (infos[i] && is_jump_info(infos[i]) && image->instructions[i].operand_count > 0
+            && parse_target(image->instructions[i].operands[0], &target) && target < count) {
+            is_target[target] = true;
+            if (target <= i) {
+                loop_depth[target]++;
+                loop_depth[i + 1]--;
+            }
+        }
+    }
+    for (int i = 1; i <= count; i++) {
+        loop_depth[i] += loop_depth[i - 1];
+    }
+
+    bool ok = true;
+    char key[NGRAM_MAX_LENGTH * 16];
+    for (int start = 0; ok && start < count; start++) {
+        int depth = loop_depth[start] < NGRAM_MAX_LOOP_DEPTH ? loop_depth[start] : NGRAM_MAX_LOOP_DEPTH;
+        long long weight = 1;
+        for (int d = 0; d < depth; d++) {
+            weight *= NGRAM_LOOP_WEIGHT;
+        }
+
+        size_t key_length = 0;
+        for (int length = 1; length <= miner->max_length && start + length <= count; length++) {
+            int last = start + length - 1;
+            if (!infos[last] || (length > 1 && (is_target[last] || ends_straight_line(infos[last - 1])))) {
+                break;
+            }
+            key_length += (size_t)snprintf(key + key_length, sizeof(key) - key_length, "%s%s",
+                                           length > 1 ? "; " : "", infos[last]->mnemonic);
+            if (length < miner->min_length) {
+                continue;
+            }
+
+            NgramEntry* entry = find_or_add_entry(miner, key, infos + start, length);
+            if (!entry) {
+                ok = false;
+                break;
+            }
+            record_operands(entry, &image->instructions[start]);
+            if (entry->last_image != miner->image_count + 1) {
+                entry->last_image = miner->image_count + 1;
+                entry->image_count++;
+            }
+            entry->site_count++;
+            entry->weighted_count += weight;
+        }
+    }
+
+    miner->image_count++;
+    miner->instruction_count += count;
+    free(infos);
+    free(is_target);
+    free(loop_depth);
+    return ok;
+}
+
+void ngramMinerObserveImage(const SubprogramImage* image, const char* entry_label, void* user_data)
+{
+    (void)entry_label;
+    ngramMinerAddImage((NgramMiner*)user_data, image);
+}
+
+// Operands are folded into the candidate only when every site agrees and the
+// sites come from more than one image, so one unrolled loop does not decide.
+static bool is_fixed_operand(const NgramEntry* entry, int operand)
+{
+    return !entry->operand_varies[operand] && entry->image_count > 1;
+}
+
+static long long entry_score(const NgramEntry* entry)
+{
+    return entry->weighted_count * (entry->length - 1);
+}
+
+static int compare_entries(const void* left, const void* right)
+{
+    const NgramEntry* a = *(const NgramEntry* const*)left;
+    const NgramEntry* b = *(const NgramEntry* const*)right;
+    long long score_a = entry_score(a);
+    long long score_b = entry_score(b);
+    if (score_a != score_b) {
+        return score_a > score_b ? -1 : 1;
+    }
+    if (a->site_count != b->site_count) {
+        return a->site_count > b->site_count ? -1 : 1;
+    }
+    return strcmp(a->key, b->key);
+}
+
+// Uppercase pdsl spelling of a mnemonic or operand value ("and_" -> AND, -1 -> N1).
+static void append_name_part(char* name, size_t size, const char* text)
+{
+    size_t length = strlen(name);
+    if (length > 0 && length + 1 < size) {
+        name[length++] = '_';
+    }
+    for (const char* p = text; *p && length + 1 < size; p++) {
+        if (*p == '-') {
+            name[length++] = 'N';
+        } else if (isalnum((unsigned char)*p)) {
+            name[length++] = (char)toupper((unsigned char)*p);
+        } else if (p[1] != '\0' && length > 0 && name[length - 1] != '_') {
+            name[length++] = '_';
+        }
+    }
+    name[length] = '\0';
+}
+
+static void build_candidate_name(const NgramEntry* entry, char* name, size_t size)
+{
+    name[0] = '\0';
+    int operand = 0;
+    for (int i = 0; i < entry->length; i++) {
+        append_name_part(name, size, entry->parts[i]->mnemonic);
+        for (int j = 0; j < entry->parts[i]->operand_count; j++, operand++) {
+            if (is_fixed_operand(entry, operand)) {
+                append_name_part(name, size, entry->operand_values[operand]);
+            }
+        }
+    }
+}
+
+static void write_pdsl_candidate(const NgramEntry* entry, const char* name, int opcode, FILE* out)
+{
+    int field_count = 0;
+    int size_bytes = MYVM_OPCODE_SIZE;
+    int operand = 0;
+
+    fprintf(out, "    OP_%s = ", name);
+    for (int bit = 8 * MYVM_OPCODE_SIZE - 1; bit >= 0; bit--) {
+        fputc((opcode >> bit) & 1 ? '1' : '0', out);
+    }
+    fprintf(out, ",\n");
+
+    for (int i = 0; i < entry->length; i++) {
+        for (int j = 0; j < entry->parts[i]->operand_count; j++, operand++) {
+            if (!is_fixed_operand(entry, operand)) {
+                MyVmOperandKind kind = entry->parts[i]->operands[j];
+                if (field_count == 0) {
+                    fprintf(out, "    encode FMT_%s sequence = {", name);
+                }
+                fprintf(out, "%s%s as X%d", field_count > 0 ? ", " : "", MYVM_OPERAND_FIELD_NAMES[kind], field_count + 1);
+                size_bytes += MYVM_OPERAND_SIZES[kind];
+                field_count++;
+            }
+        }
+    }
+    if (field_count > 0) {
+        fprintf(out, "};\n");
+    }
+
+    if (field_count > 0) {
+        fprintf(out, "    instruction %s = { OPC.OP_%s, sequence FMT_%s } {\n", name, name, name);
+    } else {
+        fprintf(out, "    instruction %s = { OPC.OP_%s } {\n", name, name);
+    }
+
+    operand = 0;
+    int field = 0;
+    for (int i = 0; i < entry->length; i++) {
+        const MyVmInstructionInfo* info = entry->parts[i];
+        char part_name[32] = "";
+        append_name_part(part_name, sizeof(part_name), info->mnemonic);
+        fprintf(out, "        /* body of %s", part_name);
+        for (int j = 0; j < info->operand_count; j++, operand++) {
+            if (!is_fixed_operand(entry, operand)) {
+                fprintf(out, "%s X%d", j == 0 ? " with" : ",", ++field);
+            } else {
+                fprintf(out, "%s %s", j == 0 ? " with" : ",", entry->operand_values[operand]);
+            }
+        }
+        fprintf(out, " */\n");
+    }
+    if (ends_straight_line(entry->parts[entry->length - 1])) {
+        fprintf(out, "        /* falls through to ip + %d */\n", size_bytes);
+    } else {
+        fprintf(out, "        ip = ip + %d;\n", size_bytes);
+    }
+    fprintf(out, "    };\n");
+}
+
+static void write_selection_pattern(const NgramEntry* entry, const char* name, FILE* out)
+{
+    fprintf(out, "    // %s\n", entry->key);
+    fprintf(out, "    if (ctx->instructions.count - ctx->fusion_barrier >= %d", entry->length);
+    int operand = 0;
+    for (int i = 0; i < entry->length; i++) {
+        const MyVmInstructionInfo* info = entry->parts[i];
+        char part_name[32] = "";
+        append_name_part(part_name, sizeof(part_name), info->mnemonic);
+        fprintf(out, "\n        && strcmp(ctx->instructions.items[ctx->instructions.count - %d].mnemonic, MYVM_MNEMONIC_%s) == 0",
+                entry->length - i, part_name);
+        for (int j = 0; j < info->operand_count; j++, operand++) {
+            if (is_fixed_operand(entry, operand)) {
+                fprintf(out, "\n        && strcmp(ctx->instructions.items[ctx->instructions.count - %d].operands[%d], \"%s\") == 0",
+                        entry->length - i, j, entry->operand_values[operand]);
+            }
+        }
+    }
+    fprintf(out, ") {\n");
+    fprintf(out, "        // merge the remaining operands of the last %d instructions into one MYVM_MNEMONIC_%s\n",
+            entry->length, name);
+    fprintf(out, "    }\n");
+}
+
+void ngramMinerWriteReport(const NgramMiner* miner, int top_count, FILE* out)
+{
+    if (!miner || !out) {
+        return;
+    }
+
+    const NgramEntry** ranked = malloc(sizeof(NgramEntry*) * (miner->entry_count > 0 ? miner->entry_count : 1));
+    if (!ranked) {
+        return;
+    }
+    int ranked_count = 0;
+    for (int i = 0; i < miner->entry_count; i++) {
+        // A sequence seen once is not worth an opcode.
+        if (miner->entries[i].site_count > 1) {
+            ranked[ranked_count++] = &miner->entries[i];
+        }
+    }
+    qsort(ranked, ranked_count, sizeof(NgramEntry*), compare_entries);
+    if (top_count > 0 && ranked_count > top_count) {
+        ranked_count = top_count;
+    }
+
+    int next_opcode = 0;
+    for (int i = 0; i < MYVM_INSTRUCTION_COUNT; i++) {
+        if ((int)MYVM_INSTRUCTIONS[i].opcode >= next_opcode) {
+            next_opcode = (int)MYVM_INSTRUCTIONS[i].opcode + 1;
+        }
+    }
+
+    fprintf(out, "Instruction n-grams from %d images, %lld instructions\n", miner->image_count, miner->instruction_count);
+    fprintf(out, "score = weighted sites * (length - 1) dispatches; a site in k nested loops weighs %d^k.\n",
+            NGRAM_LOOP_WEIGHT);
+    fprintf(out, "Sites of overlapping sequences are counted separately, so scores do not add up.\n");
+
+    for (int i = 0; i < ranked_count; i++) {
+        const NgramEntry* entry = ranked[i];
+        char name[128];
+        build_candidate_name(entry, name, sizeof(name));
+
+        int bytes_saved = (entry->length - 1) * MYVM_OPCODE_SIZE;
+        for (int j = 0, operand = 0; j < entry->length; j++) {
+            for (int k = 0; k < entry->parts[j]->operand_count; k++, operand++) {
+                if (is_fixed_operand(entry, operand)) {
+                    bytes_saved += MYVM_OPERAND_SIZES[entry->parts[j]->operands[k]];
+                }
+            }
+        }
+
+        fprintf(out, "\n%d. %s\n", i + 1, entry->key);
+        fprintf(out, "   sites %d, weighted %lld, score %lld, %d bytes smaller per site\n",
+                entry->site_count, entry->weighted_count, entry_score(entry), bytes_saved);
+        if (next_opcode < (1 << (8 * MYVM_OPCODE_SIZE))) {
+            fprintf(out, "   target-definitions.pdsl:\n");
+            write_pdsl_candidate(entry, name, next_opcode++, out);
+        } else {
+            fprintf(out, "   no free opcode left for %s\n", name);
+        }
+        fprintf(out, "   to_asm_module.c:\n");
+        write_selection_pattern(entry, name, out);
+    }
+
+    free(ranked);
+}
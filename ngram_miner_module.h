@@ -0,0 +1,23 @@
+#ifndef NGRAM_MINER_MODULE_H
+#define NGRAM_MINER_MODULE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "to_asm_module.h"
+
+typedef struct NgramMiner NgramMiner;
+
+// Counts straight-line instruction sequences of min_length..max_length
+// (at most 4) across every image it is given.
+NgramMiner* createNgramMiner(int min_length, int max_length);
+void freeNgramMiner(NgramMiner* miner);
+// Adds one final image; jump operands must still be instruction indices.
+bool ngramMinerAddImage(NgramMiner* miner, const SubprogramImage* image);
+// AsmImageObserver adapter, pass the miner as user_data.
+void ngramMinerObserveImage(const SubprogramImage* image, const char* entry_label, void* user_data);
+// Writes the top_count sequences by estimated dispatch savings, each with a
+// candidate target-definitions.pdsl instruction and a to_asm_module.c pattern.
+void ngramMinerWriteReport(const NgramMiner* miner, int top_count, FILE* out);
+
+#endif
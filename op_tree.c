@@ -86,6 +86,10 @@ static OpNode* createOpNode(OpType type)
     node->operands = NULL;
     node->operand_count = 0;
     node->text = NULL;
+    node->line = 0;
+    node->column = 0;
+    node->resolved_type = NULL;
+    node->resolved_callee = NULL;
 
     return node;
 }
@@ -187,6 +191,18 @@ static OpNode* buildOpNodeWithChildren(OpType type, pANTLR3_BASE_TREE node)
     return op_node;
 }
 
+// A parenthesized right operand is a group written in the source and is
+// never re-associated, so a - (b + c) keeps its meaning.
+static OpNode* buildBinaryOp(OpType type, pANTLR3_BASE_TREE node)
+{
+    OpNode* op_node = buildOpNodeWithChildren(type, node);
+    if (node && node->getChildCount(node) == 2
+        && strcmp(getNodeText(node->getChild(node, 1)), "IN_BRACES") == 0) {
+        return op_node;
+    }
+    return leftAssociateBinary(op_node);
+}
+
 static const char* getIdentifierName(pANTLR3_BASE_TREE node)
 {
     if (!node) {
@@ -383,7 +399,39 @@ static OpNode* buildArrayIndexOp(pANTLR3_BASE_TREE node)
     return op_node;
 }
 
+static OpNode* buildOpTreeNode(pANTLR3_BASE_TREE node);
+
+// Imaginary tokens such as ASSIGN carry no position of their own; their
+// first operand's position stands in.
+static void copyPosition(OpNode* op_node, pANTLR3_BASE_TREE node)
+{
+    if (!op_node || op_node->line > 0) {
+        return;
+    }
+
+    if (node && node->getLine(node) > 0) {
+        op_node->line = (int)node->getLine(node);
+        op_node->column = (int)node->getCharPositionInLine(node);
+        return;
+    }
+
+    for (int i = 0; i < op_node->operand_count; i++) {
+        if (op_node->operands[i] && op_node->operands[i]->line > 0) {
+            op_node->line = op_node->operands[i]->line;
+            op_node->column = op_node->operands[i]->column;
+            return;
+        }
+    }
+}
+
 OpNode* buildOpTree(pANTLR3_BASE_TREE node)
+{
+    OpNode* op_node = buildOpTreeNode(node);
+    copyPosition(op_node, node);
+    return op_node;
+}
+
+static OpNode* buildOpTreeNode(pANTLR3_BASE_TREE node)
 {
     if (!node) {
         return NULL;
@@ -410,45 +458,46 @@ OpNode* buildOpTree(pANTLR3_BASE_TREE node)
     }
 
     if (strcmp(text, "ADD") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_ADDITION, node));
+        return buildBinaryOp(OP_ADDITION, node);
     }
     if (strcmp(text, "SUBTRACT") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_SUBTRACTION, node));
+        return buildBinaryOp(OP_SUBTRACTION, node);
     }
     if (strcmp(text, "MULTIPLY") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_MULTIPLICATION, node));
+        return buildBinaryOp(OP_MULTIPLICATION, node);
     }
     if (strcmp(text, "DIVISION") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_DIVISION, node));
+        return buildBinaryOp(OP_DIVISION, node);
     }
     if (strcmp(text, "RESIDUE") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_MODULO, node));
+        return buildBinaryOp(OP_MODULO, node);
     }
 
-    if (strcmp(text, "AND") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_LOGICAL_AND, node));
+    // '&&' and '||' are rooted by their literal tokens in the grammar.
+    if (strcmp(text, "AND") == 0 || strcmp(text, "&&") == 0) {
+        return buildBinaryOp(OP_LOGICAL_AND, node);
     }
-    if (strcmp(text, "OR") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_LOGICAL_OR, node));
+    if (strcmp(text, "OR") == 0 || strcmp(text, "||") == 0) {
+        return buildBinaryOp(OP_LOGICAL_OR, node);
     }
 
     if (strcmp(text, "EQUALS") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_EQUAL, node));
+        return buildBinaryOp(OP_EQUAL, node);
     }
     if (strcmp(text, "NOT_EQUALS") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_NOT_EQUAL, node));
+        return buildBinaryOp(OP_NOT_EQUAL, node);
     }
     if (strcmp(text, "LESS_THAN") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_LESS_THAN, node));
+        return buildBinaryOp(OP_LESS_THAN, node);
     }
     if (strcmp(text, "LESS_THAN_OR_EQUALS") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_LESS_THAN_OR_EQUAL, node));
+        return buildBinaryOp(OP_LESS_THAN_OR_EQUAL, node);
     }
     if (strcmp(text, "MORE_THAN") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_GREATER_THAN, node));
+        return buildBinaryOp(OP_GREATER_THAN, node);
     }
     if (strcmp(text, "MORE_THAN_OR_EQUALS") == 0) {
-        return leftAssociateBinary(buildOpNodeWithChildren(OP_GREATER_THAN_OR_EQUAL, node));
+        return buildBinaryOp(OP_GREATER_THAN_OR_EQUAL, node);
     }
 
     if (strcmp(text, "UNARY_OPERATION") == 0) {
@@ -482,6 +531,52 @@ OpNode* buildOpTree(pANTLR3_BASE_TREE node)
     return op_node;
 }
 
+OpNode* cloneOpTree(const OpNode* node)
+{
+    if (!node) {
+        return NULL;
+    }
+
+    OpNode* copy = createOpNode(node->type);
+    if (!copy) {
+        return NULL;
+    }
+
+    copy->text = node->text ? strdup(node->text) : NULL;
+    copy->line = node->line;
+    copy->column = node->column;
+    for (int i = 0; i < node->operand_count; i++) {
+        addOperand(copy, cloneOpTree(node->operands[i]));
+    }
+    return copy;
+}
+
+OpNode* buildBinaryOpTree(OpType type, OpNode* left, OpNode* right)
+{
+    OpNode* op_node = createOpNode(type);
+    if (!op_node) {
+        freeOpTree(left);
+        freeOpTree(right);
+        return NULL;
+    }
+
+    addOperand(op_node, left);
+    addOperand(op_node, right);
+    copyPosition(op_node, NULL);
+    return op_node;
+}
+
+OpNode* buildIntLiteralOpTree(int value)
+{
+    OpNode* op_node = createOpNode(OP_LITERAL);
+    if (op_node) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%d", value);
+        op_node->text = strdup(buffer);
+    }
+    return op_node;
+}
+
 void freeOpTree(OpNode* node)
 {
     if (!node) {
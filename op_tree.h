@@ -31,15 +31,26 @@ typedef enum {
     OP_UNKNOWN
 } OpType;
 
+struct SubprogramInfo;
+
 typedef struct OpNode {
     OpType type;
     struct OpNode** operands;
     int operand_count;
     char* text;
+    // Source position of the tree the node was built from, 0 when unknown.
+    int line;
+    int column;
+    // Set by the backend annotation pass; neither pointer is owned.
+    const char* resolved_type;
+    const struct SubprogramInfo* resolved_callee;
 } OpNode;
 
 OpNode* buildOpTree(pANTLR3_BASE_TREE node);
 void freeOpTree(OpNode* node);
+OpNode* cloneOpTree(const OpNode* node);
+OpNode* buildBinaryOpTree(OpType type, OpNode* left, OpNode* right);
+OpNode* buildIntLiteralOpTree(int value);
 
 void printOpTree(const OpNode* node, int indent);
 void opTreeToDot(const OpNode* node, FILE* out);
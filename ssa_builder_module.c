@@ -0,0 +1,1119 @@
+#include "ssa_builder_module.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    SsaRef* items;
+    int count;
+    int capacity;
+} SsaRefList;
+
+typedef struct {
+    SsaForm* form;
+    SsaSlotResolver resolver;
+    void* user_data;
+    SsaRefList* refs;
+} SsaBuildContext;
+
+static int compare_node_addresses(const void* a, const void* b)
+{
+    uintptr_t left = (uintptr_t)*(const CFGNode* const*)a;
+    uintptr_t right = (uintptr_t)*(const CFGNode* const*)b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+int findSsaBlockIndex(const SsaForm* form, const CFGNode* node)
+{
+    if (!form || !node) {
+        return -1;
+    }
+
+    int low = 0;
+    int high = form->block_count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (form->lookup_nodes[mid] == node) {
+            return form->lookup_indices[mid];
+        }
+        if ((uintptr_t)form->lookup_nodes[mid] < (uintptr_t)node) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+static bool build_lookup(SsaForm* form)
+{
+    int count = form->block_count;
+    form->lookup_nodes = malloc(sizeof(CFGNode*) * (count > 0 ? count : 1));
+    form->lookup_indices = malloc(sizeof(int) * (count > 0 ? count : 1));
+    if (!form->lookup_nodes || !form->lookup_indices) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        form->lookup_nodes[i] = form->blocks[i].node;
+    }
+    qsort((void*)form->lookup_nodes, count, sizeof(CFGNode*), compare_node_addresses);
+    for (int i = 0; i < count; i++) {
+        for (int low = 0, high = count - 1; low <= high;) {
+            int mid = low + (high - low) / 2;
+            if (form->lookup_nodes[mid] == form->blocks[i].node) {
+                form->lookup_indices[mid] = i;
+                break;
+            }
+            if ((uintptr_t)form->lookup_nodes[mid] < (uintptr_t)form->blocks[i].node) {
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+    }
+    return true;
+}
+
+static int get_successors(const SsaForm* form, int block, int out[2])
+{
+    const CFGNode* node = form->blocks[block].node;
+    int count = 0;
+    int conditional = findSsaBlockIndex(form, node->nextConditional);
+    int fallthrough = findSsaBlockIndex(form, node->nextDefault);
+    if (conditional >= 0) {
+        out[count++] = conditional;
+    }
+    if (fallthrough >= 0 && fallthrough != conditional) {
+        out[count++] = fallthrough;
+    }
+    return count;
+}
+
+static bool build_predecessors(SsaForm* form)
+{
+    int* counts = calloc(form->block_count + 1, sizeof(int));
+    if (!counts) {
+        return false;
+    }
+
+    for (int b = 0; b < form->block_count; b++) {
+        int succs[2];
+        int succ_count = get_successors(form, b, succs);
+        for (int i = 0; i < succ_count; i++) {
+            counts[succs[i]]++;
+        }
+    }
+
+    bool ok = true;
+    for (int b = 0; b < form->block_count && ok; b++) {
+        form->blocks[b].preds = malloc(sizeof(int) * (counts[b] > 0 ? counts[b] : 1));
+        ok = form->blocks[b].preds != NULL;
+    }
+    for (int b = 0; b < form->block_count && ok; b++) {
+        int succs[2];
+        int succ_count = get_successors(form, b, succs);
+        for (int i = 0; i < succ_count; i++) {
+            SsaBlock* succ = &form->blocks[succs[i]];
+            succ->preds[succ->pred_count++] = b;
+        }
+    }
+
+    free(counts);
+    return ok;
+}
+
+// Lengauer-Tarjan with path compression, run over DFS numbers.
+static int lt_eval(int v, int* ancestor, int* label, const int* semi, int* stack)
+{
+    if (ancestor[v] < 0) {
+        return v;
+    }
+
+    int depth = 0;
+    int u = v;
+    while (ancestor[ancestor[u]] >= 0) {
+        stack[depth++] = u;
+        u = ancestor[u];
+    }
+    while (depth > 0) {
+        u = stack[--depth];
+        int a = ancestor[u];
+        if (semi[label[a]] < semi[label[u]]) {
+            label[u] = label[a];
+        }
+        ancestor[u] = ancestor[a];
+    }
+    return label[v];
+}
+
+static bool build_dominators(SsaForm* form)
+{
+    int n = form->block_count;
+    int* dfnum = malloc(sizeof(int) * n);
+    int* vertex = malloc(sizeof(int) * n);
+    int* parent = malloc(sizeof(int) * n);
+    int* semi = malloc(sizeof(int) * n);
+    int* idom = malloc(sizeof(int) * n);
+    int* ancestor = malloc(sizeof(int) * n);
+    int* label = malloc(sizeof(int) * n);
+    int* bucket_head = malloc(sizeof(int) * n);
+    int* bucket_next = malloc(sizeof(int) * n);
+    int* stack = malloc(sizeof(int) * n);
+    int* cursor = malloc(sizeof(int) * n);
+    bool ok = dfnum && vertex && parent && semi && idom && ancestor && label
+        && bucket_head && bucket_next && stack && cursor;
+
+    int reached = 0;
+    if (ok) {
+        for (int i = 0; i < n; i++) {
+            dfnum[i] = -1;
+        }
+
+        // Iterative DFS numbering from the entry.
+        int depth = 0;
+        dfnum[form->entry_block] = reached;
+        vertex[reached] = form->entry_block;
+        parent[reached] = -1;
+        reached++;
+        stack[depth] = form->entry_block;
+        cursor[depth] = 0;
+        depth++;
+        while (depth > 0) {
+            int b = stack[depth - 1];
+            int succs[2];
+            int succ_count = get_successors(form, b, succs);
+            if (cursor[depth - 1] >= succ_count) {
+                depth--;
+                continue;
+            }
+            int s = succs[cursor[depth - 1]++];
+            if (dfnum[s] >= 0) {
+                continue;
+            }
+            dfnum[s] = reached;
+            vertex[reached] = s;
+            parent[reached] = dfnum[b];
+            reached++;
+            stack[depth] = s;
+            cursor[depth] = 0;
+            depth++;
+        }
+
+        for (int i = 0; i < reached; i++) {
+            semi[i] = i;
+            label[i] = i;
+            ancestor[i] = -1;
+            idom[i] = -1;
+            bucket_head[i] = -1;
+        }
+
+        for (int w = reached - 1; w > 0; w--) {
+            const SsaBlock* block = &form->blocks[vertex[w]];
+            for (int p = 0; p < block->pred_count; p++) {
+                int v = dfnum[block->preds[p]];
+                if (v < 0) {
+                    continue;
+                }
+                int u = lt_eval(v, ancestor, label, semi, stack);
+                if (semi[u] < semi[w]) {
+                    semi[w] = semi[u];
+                }
+            }
+
+            bucket_next[w] = bucket_head[semi[w]];
+            bucket_head[semi[w]] = w;
+            ancestor[w] = parent[w];
+
+            for (int v = bucket_head[parent[w]]; v >= 0; v = bucket_next[v]) {
+                int u = lt_eval(v, ancestor, label, semi, stack);
+                idom[v] = semi[u] < semi[v] ? u : parent[w];
+            }
+            bucket_head[parent[w]] = -1;
+        }
+
+        for (int w = 1; w < reached; w++) {
+            if (idom[w] != semi[w]) {
+                idom[w] = idom[idom[w]];
+            }
+        }
+
+        for (int b = 0; b < n; b++) {
+            form->blocks[b].reachable = dfnum[b] >= 0;
+            form->blocks[b].idom = dfnum[b] > 0 ? vertex[idom[dfnum[b]]] : -1;
+        }
+    }
+
+    // Dominator tree children, then an iterative preorder walk for depths
+    // and the subtree intervals used by ssaDominates.
+    if (ok) {
+        form->dom_child_start = calloc(n + 1, sizeof(int));
+        form->dom_children = malloc(sizeof(int) * (n > 0 ? n : 1));
+        form->dom_preorder = malloc(sizeof(int) * (n > 0 ? n : 1));
+        form->dom_pre_index = malloc(sizeof(int) * (n > 0 ? n : 1));
+        form->dom_subtree_end = malloc(sizeof(int) * (n > 0 ? n : 1));
+        ok = form->dom_child_start && form->dom_children && form->dom_preorder
+            && form->dom_pre_index && form->dom_subtree_end;
+    }
+    if (ok) {
+        for (int b = 0; b < n; b++) {
+            if (form->blocks[b].idom >= 0) {
+                form->dom_child_start[form->blocks[b].idom + 1]++;
+            }
+        }
+        for (int b = 0; b < n; b++) {
+            form->dom_child_start[b + 1] += form->dom_child_start[b];
+        }
+        for (int b = 0; b < n; b++) {
+            cursor[b] = form->dom_child_start[b];
+        }
+        for (int b = 0; b < n; b++) {
+            if (form->blocks[b].idom >= 0) {
+                form->dom_children[cursor[form->blocks[b].idom]++] = b;
+            }
+        }
+
+        for (int b = 0; b < n; b++) {
+            form->dom_pre_index[b] = -1;
+            form->dom_subtree_end[b] = -1;
+        }
+
+        int order = 0;
+        int depth = 0;
+        stack[depth] = form->entry_block;
+        cursor[depth] = form->dom_child_start[form->entry_block];
+        depth++;
+        form->blocks[form->entry_block].dom_depth = 0;
+        form->dom_pre_index[form->entry_block] = order;
+        form->dom_preorder[order++] = form->entry_block;
+        while (depth > 0) {
+            int b = stack[depth - 1];
+            if (cursor[depth - 1] >= form->dom_child_start[b + 1]) {
+                form->dom_subtree_end[b] = order;
+                depth--;
+                continue;
+            }
+            int child = form->dom_children[cursor[depth - 1]++];
+            form->blocks[child].dom_depth = form->blocks[b].dom_depth + 1;
+            form->dom_pre_index[child] = order;
+            form->dom_preorder[order++] = child;
+            stack[depth] = child;
+            cursor[depth] = form->dom_child_start[child];
+            depth++;
+        }
+        form->reachable_count = order;
+    }
+
+    free(dfnum);
+    free(vertex);
+    free(parent);
+    free(semi);
+    free(idom);
+    free(ancestor);
+    free(label);
+    free(bucket_head);
+    free(bucket_next);
+    free(stack);
+    free(cursor);
+    return ok;
+}
+
+bool ssaDominates(const SsaForm* form, int dominator, int block)
+{
+    if (!form || dominator < 0 || block < 0 || dominator >= form->block_count || block >= form->block_count) {
+        return false;
+    }
+
+    int position = form->dom_pre_index[block];
+    int start = form->dom_pre_index[dominator];
+    if (position < 0 || start < 0) {
+        return false;
+    }
+    return position >= start && position < form->dom_subtree_end[dominator];
+}
+
+// Dominance frontiers by walking each join point's predecessors up to its
+// immediate dominator. The marks array keeps every frontier duplicate-free.
+static bool build_frontiers(SsaForm* form)
+{
+    int n = form->block_count;
+    int* marks = malloc(sizeof(int) * (n > 0 ? n : 1));
+    if (!marks) {
+        return false;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int b = 0; b < n; b++) {
+            marks[b] = -1;
+        }
+
+        for (int b = 0; b < n; b++) {
+            const SsaBlock* block = &form->blocks[b];
+            if (!block->reachable || block->pred_count < 2) {
+                continue;
+            }
+
+            for (int p = 0; p < block->pred_count; p++) {
+                int runner = block->preds[p];
+                if (!form->blocks[runner].reachable) {
+                    continue;
+                }
+                while (runner >= 0 && runner != block->idom && marks[runner] != b) {
+                    marks[runner] = b;
+                    SsaBlock* runner_block = &form->blocks[runner];
+                    if (pass == 0) {
+                        runner_block->frontier_count++;
+                    } else {
+                        runner_block->frontier[runner_block->frontier_count++] = b;
+                    }
+                    runner = runner_block->idom;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (int b = 0; b < n; b++) {
+                SsaBlock* block = &form->blocks[b];
+                block->frontier = malloc(sizeof(int) * (block->frontier_count > 0 ? block->frontier_count : 1));
+                if (!block->frontier) {
+                    free(marks);
+                    return false;
+                }
+                block->frontier_count = 0;
+            }
+        }
+    }
+
+    free(marks);
+    return true;
+}
+
+static void ref_list_add(SsaRefList* list, const OpNode* node, int slot, bool is_def)
+{
+    if (list->count + 1 > list->capacity) {
+        int new_capacity = list->capacity == 0 ? 8 : list->capacity * 2;
+        SsaRef* new_items = realloc(list->items, sizeof(SsaRef) * new_capacity);
+        if (!new_items) {
+            return;
+        }
+        list->items = new_items;
+        list->capacity = new_capacity;
+    }
+
+    SsaRef* ref = &list->items[list->count++];
+    ref->node = node;
+    ref->slot = slot;
+    ref->version = -1;
+    ref->is_def = is_def;
+}
+
+static bool is_storage_leaf(const OpNode* node)
+{
+    return node && (node->type == OP_IDENTIFIER || node->type == OP_MEMBER_ACCESS);
+}
+
+static void add_leaf_refs(SsaBuildContext* ctx, SsaRefList* list, const OpNode* leaf, const OpNode* owner, bool is_def)
+{
+    int first_slot = -1;
+    int slot_count = 0;
+    if (!ctx->resolver(ctx->user_data, leaf, &first_slot, &slot_count)) {
+        return;
+    }
+
+    for (int i = 0; i < slot_count; i++) {
+        int slot = first_slot + i;
+        if (slot >= 0 && slot < ctx->form->slot_count) {
+            ref_list_add(list, owner, slot, is_def);
+        }
+    }
+}
+
+// Records reads and writes in the order emit_expression evaluates them.
+static void collect_refs(SsaBuildContext* ctx, SsaRefList* list, const OpNode* node)
+{
+    if (!node) {
+        return;
+    }
+
+    if (is_storage_leaf(node)) {
+        add_leaf_refs(ctx, list, node, node, false);
+        return;
+    }
+
+    if (node->type == OP_ASSIGNMENT && node->operand_count > 0) {
+        for (int i = 1; i < node->operand_count; i++) {
+            collect_refs(ctx, list, node->operands[i]);
+        }
+        const OpNode* target = node->operands[0];
+        if (is_storage_leaf(target)) {
+            add_leaf_refs(ctx, list, target, node, true);
+        } else if (target) {
+            for (int i = 0; i < target->operand_count; i++) {
+                collect_refs(ctx, list, target->operands[i]);
+            }
+            // An element store redefines the whole array after reading it.
+            if (target->type == OP_ARRAY_INDEX && target->operand_count > 0 && is_storage_leaf(target->operands[0])) {
+                add_leaf_refs(ctx, list, target->operands[0], node, true);
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        collect_refs(ctx, list, node->operands[i]);
+    }
+}
+
+static bool add_phi(SsaBlock* block, int slot, int* capacity)
+{
+    if (block->phi_count + 1 > *capacity) {
+        int new_capacity = *capacity == 0 ? 4 : *capacity * 2;
+        SsaPhi* new_phis = realloc(block->phis, sizeof(SsaPhi) * new_capacity);
+        if (!new_phis) {
+            return false;
+        }
+        block->phis = new_phis;
+        *capacity = new_capacity;
+    }
+
+    SsaPhi* phi = &block->phis[block->phi_count];
+    phi->slot = slot;
+    phi->result = -1;
+    phi->arg_count = block->pred_count;
+    phi->args = malloc(sizeof(int) * (block->pred_count > 0 ? block->pred_count : 1));
+    if (!phi->args) {
+        return false;
+    }
+    for (int i = 0; i < block->pred_count; i++) {
+        phi->args[i] = slot;
+    }
+    block->phi_count++;
+    return true;
+}
+
+// Places phis at the iterated dominance frontier of every slot's definition
+// blocks. Stamps instead of per-slot clearing keep this linear in the
+// number of placements.
+static bool place_phis(SsaForm* form)
+{
+    int n = form->block_count;
+    int slots = form->slot_count;
+    int* def_start = calloc(slots + 1, sizeof(int));
+    int* last_def_block = malloc(sizeof(int) * (slots > 0 ? slots : 1));
+    int* has_phi = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* queued = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* worklist = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* phi_capacity = calloc(n > 0 ? n : 1, sizeof(int));
+    bool ok = def_start && last_def_block && has_phi && queued && worklist && phi_capacity;
+
+    int* def_blocks = NULL;
+    if (ok) {
+        for (int pass = 0; pass < 2 && ok; pass++) {
+            for (int s = 0; s < slots; s++) {
+                last_def_block[s] = -1;
+            }
+            for (int b = 0; b < n; b++) {
+                const SsaBlock* block = &form->blocks[b];
+                if (!block->reachable) {
+                    continue;
+                }
+                for (int r = 0; r < block->ref_count; r++) {
+                    const SsaRef* ref = &block->refs[r];
+                    if (!ref->is_def || last_def_block[ref->slot] == b) {
+                        continue;
+                    }
+                    last_def_block[ref->slot] = b;
+                    if (pass == 0) {
+                        def_start[ref->slot + 1]++;
+                    } else {
+                        def_blocks[def_start[ref->slot]++] = b;
+                    }
+                }
+            }
+
+            if (pass == 0) {
+                for (int s = 0; s < slots; s++) {
+                    def_start[s + 1] += def_start[s];
+                }
+                def_blocks = malloc(sizeof(int) * (def_start[slots] > 0 ? def_start[slots] : 1));
+                ok = def_blocks != NULL;
+            } else {
+                // The fill advanced each start to the next slot's start.
+                for (int s = slots; s > 0; s--) {
+                    def_start[s] = def_start[s - 1];
+                }
+                def_start[0] = 0;
+            }
+        }
+    }
+
+    if (ok) {
+        for (int b = 0; b < n; b++) {
+            has_phi[b] = -1;
+            queued[b] = -1;
+        }
+
+        for (int s = 0; s < slots && ok; s++) {
+            int count = 0;
+            for (int d = def_start[s]; d < def_start[s + 1]; d++) {
+                worklist[count++] = def_blocks[d];
+                queued[def_blocks[d]] = s;
+            }
+
+            while (count > 0 && ok) {
+                int x = worklist[--count];
+                const SsaBlock* block = &form->blocks[x];
+                for (int f = 0; f < block->frontier_count; f++) {
+                    int y = block->frontier[f];
+                    if (has_phi[y] == s) {
+                        continue;
+                    }
+                    has_phi[y] = s;
+                    ok = add_phi(&form->blocks[y], s, &phi_capacity[y]);
+                    if (ok && queued[y] != s) {
+                        queued[y] = s;
+                        worklist[count++] = y;
+                    }
+                }
+            }
+        }
+    }
+
+    free(def_start);
+    free(def_blocks);
+    free(last_def_block);
+    free(has_phi);
+    free(queued);
+    free(worklist);
+    free(phi_capacity);
+    return ok;
+}
+
+static int new_version(SsaForm* form, int slot, int block, int* capacity)
+{
+    if (form->version_count + 1 > *capacity) {
+        int new_capacity = *capacity * 2;
+        int* new_slots = realloc(form->version_slots, sizeof(int) * new_capacity);
+        if (new_slots) {
+            form->version_slots = new_slots;
+        }
+        int* new_blocks = realloc(form->version_blocks, sizeof(int) * new_capacity);
+        if (new_blocks) {
+            form->version_blocks = new_blocks;
+        }
+        if (!new_slots || !new_blocks) {
+            return -1;
+        }
+        *capacity = new_capacity;
+    }
+
+    form->version_slots[form->version_count] = slot;
+    form->version_blocks[form->version_count] = block;
+    return form->version_count++;
+}
+
+// Renames along the dominator tree with one version stack per slot. Stacks
+// are threaded through previous[] and unwound from a shared log on exit.
+static bool rename_versions(SsaForm* form)
+{
+    int n = form->block_count;
+    int slots = form->slot_count;
+    int version_capacity = slots > 0 ? slots * 2 : 2;
+    form->version_slots = malloc(sizeof(int) * version_capacity);
+    form->version_blocks = malloc(sizeof(int) * version_capacity);
+    int* top = malloc(sizeof(int) * (slots > 0 ? slots : 1));
+    int* stack = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* cursor = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* log_mark = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* previous = NULL;
+    int* log = NULL;
+    int log_count = 0;
+    int log_capacity = 0;
+    int previous_capacity = 0;
+    bool ok = form->version_slots && form->version_blocks && top && stack && cursor && log_mark;
+
+    if (ok) {
+        for (int s = 0; s < slots; s++) {
+            form->version_slots[s] = s;
+            form->version_blocks[s] = form->entry_block;
+            top[s] = s;
+        }
+        form->version_count = slots;
+    }
+
+    int depth = 0;
+    if (ok && n > 0) {
+        stack[depth] = form->entry_block;
+        cursor[depth] = -1;
+        depth++;
+    }
+
+    while (ok && depth > 0) {
+        int b = stack[depth - 1];
+        SsaBlock* block = &form->blocks[b];
+
+        if (cursor[depth - 1] < 0) {
+            log_mark[depth - 1] = log_count;
+            cursor[depth - 1] = form->dom_child_start[b];
+
+            int pushes = block->phi_count;
+            for (int r = 0; r < block->ref_count; r++) {
+                pushes += block->refs[r].is_def ? 1 : 0;
+            }
+            if (log_count + pushes > log_capacity) {
+                int new_capacity = log_capacity == 0 ? 64 : log_capacity;
+                while (new_capacity < log_count + pushes) {
+                    new_capacity *= 2;
+                }
+                int* new_log = realloc(log, sizeof(int) * new_capacity);
+                if (!new_log) {
+                    ok = false;
+                    break;
+                }
+                log = new_log;
+                log_capacity = new_capacity;
+            }
+
+            for (int p = 0; p < block->phi_count + block->ref_count && ok; p++) {
+                bool is_phi = p < block->phi_count;
+                SsaRef* ref = is_phi ? NULL : &block->refs[p - block->phi_count];
+                int slot = is_phi ? block->phis[p].slot : ref->slot;
+                if (!is_phi && !ref->is_def) {
+                    ref->version = top[slot];
+                    continue;
+                }
+
+                int version = new_version(form, slot, b, &version_capacity);
+                if (version < 0) {
+                    ok = false;
+                    break;
+                }
+                if (version >= previous_capacity) {
+                    int new_capacity = version_capacity;
+                    int* new_previous = realloc(previous, sizeof(int) * new_capacity);
+                    if (!new_previous) {
+                        ok = false;
+                        break;
+                    }
+                    previous = new_previous;
+                    previous_capacity = new_capacity;
+                }
+                previous[version] = top[slot];
+                top[slot] = version;
+                log[log_count++] = slot;
+                if (is_phi) {
+                    block->phis[p].result = version;
+                } else {
+                    ref->version = version;
+                }
+            }
+
+            int succs[2];
+            int succ_count = get_successors(form, b, succs);
+            for (int i = 0; i < succ_count; i++) {
+                SsaBlock* succ = &form->blocks[succs[i]];
+                for (int j = 0; j < succ->pred_count; j++) {
+                    if (succ->preds[j] != b) {
+                        continue;
+                    }
+                    for (int p = 0; p < succ->phi_count; p++) {
+                        succ->phis[p].args[j] = top[succ->phis[p].slot];
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (cursor[depth - 1] < form->dom_child_start[b + 1]) {
+            int child = form->dom_children[cursor[depth - 1]++];
+            stack[depth] = child;
+            cursor[depth] = -1;
+            depth++;
+            continue;
+        }
+
+        while (log_count > log_mark[depth - 1]) {
+            int slot = log[--log_count];
+            top[slot] = previous[top[slot]];
+        }
+        depth--;
+    }
+
+    free(top);
+    free(stack);
+    free(cursor);
+    free(log_mark);
+    free(previous);
+    free(log);
+    return ok;
+}
+
+// Blocks, predecessors and the dominator tree: everything that does not
+// depend on which slots the statements touch.
+static SsaForm* build_control_form(const ControlFlowGraph* cfg, int slot_count)
+{
+    SsaForm* form = calloc(1, sizeof(SsaForm));
+    if (!form) {
+        return NULL;
+    }
+
+    form->block_count = cfg->node_count;
+    form->slot_count = slot_count;
+    form->blocks = calloc(cfg->node_count > 0 ? cfg->node_count : 1, sizeof(SsaBlock));
+    if (!form->blocks) {
+        freeSsaForm(form);
+        return NULL;
+    }
+    for (int i = 0; i < cfg->node_count; i++) {
+        form->blocks[i].node = cfg->nodes[i];
+        form->blocks[i].idom = -1;
+    }
+
+    if (!build_lookup(form)) {
+        freeSsaForm(form);
+        return NULL;
+    }
+
+    form->entry_block = findSsaBlockIndex(form, cfg->entry);
+    if (form->entry_block < 0 || !build_predecessors(form) || !build_dominators(form)) {
+        freeSsaForm(form);
+        return NULL;
+    }
+    return form;
+}
+
+SsaForm* buildSsaForm(const ControlFlowGraph* cfg, int slot_count, SsaSlotResolver resolver, void* user_data)
+{
+    if (!cfg || !cfg->entry || !resolver || slot_count < 0) {
+        return NULL;
+    }
+
+    SsaForm* form = build_control_form(cfg, slot_count);
+    if (!form || !build_frontiers(form)) {
+        freeSsaForm(form);
+        return NULL;
+    }
+
+    SsaBuildContext ctx = { form, resolver, user_data, NULL };
+    for (int b = 0; b < form->block_count; b++) {
+        SsaRefList list = { NULL, 0, 0 };
+        const CFGNode* node = form->blocks[b].node;
+        for (int i = 0; i < node->stmt_count; i++) {
+            collect_refs(&ctx, &list, node->statements[i]);
+        }
+        form->blocks[b].refs = list.items;
+        form->blocks[b].ref_count = list.count;
+    }
+
+    if (!place_phis(form) || !rename_versions(form)) {
+        freeSsaForm(form);
+        return NULL;
+    }
+
+    return form;
+}
+
+void freeSsaForm(SsaForm* form)
+{
+    if (!form) {
+        return;
+    }
+
+    for (int b = 0; form->blocks && b < form->block_count; b++) {
+        SsaBlock* block = &form->blocks[b];
+        for (int p = 0; p < block->phi_count; p++) {
+            free(block->phis[p].args);
+        }
+        free(block->phis);
+        free(block->preds);
+        free(block->frontier);
+        free(block->refs);
+    }
+    free(form->blocks);
+    free(form->version_slots);
+    free(form->version_blocks);
+    free(form->dom_children);
+    free(form->dom_child_start);
+    free(form->dom_preorder);
+    free(form->dom_pre_index);
+    free(form->dom_subtree_end);
+    free((void*)form->lookup_nodes);
+    free(form->lookup_indices);
+    free(form);
+}
+
+// Orders one edge's parallel copies so no source is overwritten before it is
+// read; cycles are broken through scratch_slot.
+static int sequentialize_copies(int* dests, int* srcs, int count, int scratch_slot, SsaCopy* out)
+{
+    int emitted = 0;
+    while (count > 0) {
+        int ready = -1;
+        for (int i = 0; i < count && ready < 0; i++) {
+            bool read_later = false;
+            for (int j = 0; j < count; j++) {
+                if (j != i && srcs[j] == dests[i]) {
+                    read_later = true;
+                    break;
+                }
+            }
+            if (!read_later) {
+                ready = i;
+            }
+        }
+
+        if (ready < 0) {
+            int saved = dests[0];
+            out[emitted].dest_slot = scratch_slot;
+            out[emitted].src_slot = saved;
+            emitted++;
+            for (int j = 0; j < count; j++) {
+                if (srcs[j] == saved) {
+                    srcs[j] = scratch_slot;
+                }
+            }
+            continue;
+        }
+
+        out[emitted].dest_slot = dests[ready];
+        out[emitted].src_slot = srcs[ready];
+        emitted++;
+        dests[ready] = dests[count - 1];
+        srcs[ready] = srcs[count - 1];
+        count--;
+    }
+    return emitted;
+}
+
+SsaEdgeCopies* destructSsaForm(const SsaForm* form, int scratch_slot, int* edge_count)
+{
+    if (edge_count) {
+        *edge_count = 0;
+    }
+    if (!form || !edge_count) {
+        return NULL;
+    }
+
+    SsaEdgeCopies* edges = NULL;
+    int count = 0;
+    int capacity = 0;
+    for (int b = 0; b < form->block_count; b++) {
+        const SsaBlock* block = &form->blocks[b];
+        if (!block->reachable || block->phi_count == 0) {
+            continue;
+        }
+
+        int* dests = malloc(sizeof(int) * block->phi_count);
+        int* srcs = malloc(sizeof(int) * block->phi_count);
+        if (!dests || !srcs) {
+            free(dests);
+            free(srcs);
+            freeSsaEdgeCopies(edges, count);
+            return NULL;
+        }
+
+        for (int j = 0; j < block->pred_count; j++) {
+            if (!form->blocks[block->preds[j]].reachable) {
+                continue;
+            }
+
+            int pending = 0;
+            for (int p = 0; p < block->phi_count; p++) {
+                int dest = form->version_slots[block->phis[p].result];
+                int src = form->version_slots[block->phis[p].args[j]];
+                if (dest != src) {
+                    dests[pending] = dest;
+                    srcs[pending] = src;
+                    pending++;
+                }
+            }
+            if (pending == 0) {
+                continue;
+            }
+
+            if (count + 1 > capacity) {
+                capacity = capacity == 0 ? 4 : capacity * 2;
+                SsaEdgeCopies* new_edges = realloc(edges, sizeof(SsaEdgeCopies) * capacity);
+                if (!new_edges) {
+                    free(dests);
+                    free(srcs);
+                    freeSsaEdgeCopies(edges, count);
+                    return NULL;
+                }
+                edges = new_edges;
+            }
+
+            SsaEdgeCopies* edge = &edges[count];
+            edge->from_block = block->preds[j];
+            edge->to_block = b;
+            edge->copies = malloc(sizeof(SsaCopy) * pending * 2);
+            edge->copy_count = edge->copies ? sequentialize_copies(dests, srcs, pending, scratch_slot, edge->copies) : 0;
+            count++;
+        }
+
+        free(dests);
+        free(srcs);
+    }
+
+    *edge_count = count;
+    return edges;
+}
+
+void freeSsaEdgeCopies(SsaEdgeCopies* edges, int edge_count)
+{
+    for (int i = 0; edges && i < edge_count; i++) {
+        free(edges[i].copies);
+    }
+    free(edges);
+}
+
+static int compare_loops_outermost_first(const void* a, const void* b)
+{
+    const CFGLoop* left = a;
+    const CFGLoop* right = b;
+    if (left->block_count != right->block_count) {
+        return right->block_count - left->block_count;
+    }
+    return left->header->id - right->header->id;
+}
+
+// One natural loop per header: the body is everything that reaches a latch
+// without passing through the header, so loops sharing a header merge.
+static void collect_loop_body(const SsaForm* form, CFGLoop* loop, const int* latches, int* marks, int* worklist)
+{
+    int header = findSsaBlockIndex(form, loop->header);
+    int stamp = header;
+    int count = 0;
+    marks[header] = stamp;
+    loop->blocks[loop->block_count++] = loop->header;
+    for (int i = 0; i < loop->latch_count; i++) {
+        if (marks[latches[i]] != stamp) {
+            marks[latches[i]] = stamp;
+            worklist[count++] = latches[i];
+        }
+    }
+
+    while (count > 0) {
+        int b = worklist[--count];
+        const SsaBlock* block = &form->blocks[b];
+        loop->blocks[loop->block_count++] = block->node;
+        for (int p = 0; p < block->pred_count; p++) {
+            int pred = block->preds[p];
+            if (form->blocks[pred].reachable && marks[pred] != stamp) {
+                marks[pred] = stamp;
+                worklist[count++] = pred;
+            }
+        }
+    }
+}
+
+LoopNest* buildLoopNest(ControlFlowGraph* cfg)
+{
+    if (!cfg || !cfg->entry) {
+        return NULL;
+    }
+
+    freeLoopNest(cfg->loop_nest);
+    cfg->loop_nest = NULL;
+
+    SsaForm* form = build_control_form(cfg, 0);
+    LoopNest* nest = calloc(1, sizeof(LoopNest));
+    int n = form ? form->block_count : 0;
+    int* header_loop = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* marks = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* worklist = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* latches = malloc(sizeof(int) * (n > 0 ? n : 1));
+    bool ok = form && nest && header_loop && marks && worklist && latches;
+
+    if (ok) {
+        for (int b = 0; b < n; b++) {
+            header_loop[b] = -1;
+            marks[b] = -1;
+        }
+
+        // A back edge is one whose target dominates its source.
+        for (int b = 0; b < n && ok; b++) {
+            int succs[2];
+            int succ_count = form->blocks[b].reachable ? get_successors(form, b, succs) : 0;
+            for (int i = 0; i < succ_count && ok; i++) {
+                int header = succs[i];
+                if (!ssaDominates(form, header, b)) {
+                    continue;
+                }
+                if (header_loop[header] < 0) {
+                    CFGLoop* loops = realloc(nest->loops, sizeof(CFGLoop) * (nest->loop_count + 1));
+                    if (!loops) {
+                        ok = false;
+                        break;
+                    }
+                    nest->loops = loops;
+                    header_loop[header] = nest->loop_count;
+                    memset(&nest->loops[nest->loop_count], 0, sizeof(CFGLoop));
+                    nest->loops[nest->loop_count].header = form->blocks[header].node;
+                    nest->loops[nest->loop_count].latches = malloc(sizeof(CFGNode*) * form->blocks[header].pred_count);
+                    nest->loops[nest->loop_count].parent = -1;
+                    ok = nest->loops[nest->loop_count].latches != NULL;
+                    nest->loop_count++;
+                }
+                if (ok) {
+                    CFGLoop* loop = &nest->loops[header_loop[header]];
+                    loop->latches[loop->latch_count++] = form->blocks[b].node;
+                }
+            }
+        }
+
+        for (int l = 0; l < nest->loop_count && ok; l++) {
+            CFGLoop* loop = &nest->loops[l];
+            loop->blocks = malloc(sizeof(CFGNode*) * n);
+            ok = loop->blocks != NULL;
+            for (int i = 0; ok && i < loop->latch_count; i++) {
+                latches[i] = findSsaBlockIndex(form, loop->latches[i]);
+            }
+            if (ok) {
+                collect_loop_body(form, loop, latches, marks, worklist);
+            }
+        }
+    }
+
+    // Larger loops first; the innermost loop already holding a header is its
+    // parent because natural loops with distinct headers nest or are disjoint.
+    if (ok && nest->loop_count > 0) {
+        qsort(nest->loops, nest->loop_count, sizeof(CFGLoop), compare_loops_outermost_first);
+        int* innermost = header_loop;
+        for (int b = 0; b < n; b++) {
+            innermost[b] = -1;
+        }
+        for (int l = 0; l < nest->loop_count; l++) {
+            CFGLoop* loop = &nest->loops[l];
+            loop->parent = innermost[findSsaBlockIndex(form, loop->header)];
+            loop->depth = loop->parent < 0 ? 1 : nest->loops[loop->parent].depth + 1;
+            for (int i = 0; i < loop->block_count; i++) {
+                innermost[findSsaBlockIndex(form, loop->blocks[i])] = l;
+            }
+        }
+    }
+
+    free(header_loop);
+    free(marks);
+    free(worklist);
+    free(latches);
+    freeSsaForm(form);
+    if (!ok) {
+        freeLoopNest(nest);
+        return NULL;
+    }
+
+    cfg->loop_nest = nest;
+    return nest;
+}
+
+bool loopContainsNode(const CFGLoop* loop, const CFGNode* node)
+{
+    for (int i = 0; loop && i < loop->block_count; i++) {
+        if (loop->blocks[i] == node) {
+            return true;
+        }
+    }
+    return false;
+}
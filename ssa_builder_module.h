@@ -0,0 +1,88 @@
+#ifndef SSA_BUILDER_MODULE_H
+#define SSA_BUILDER_MODULE_H
+
+#include <stdbool.h>
+
+#include "cfg_builder_module.h"
+
+// Maps an identifier or member-access leaf to the contiguous range of
+// flattened storage slots it names. Returns false for names without storage.
+typedef bool (*SsaSlotResolver)(void* user_data, const OpNode* leaf, int* first_slot, int* slot_count);
+
+// Versions 0..slot_count-1 are the values slots hold on method entry.
+typedef struct {
+    int slot;
+    int result;
+    int* args;      // one version per entry of the block's preds
+    int arg_count;
+} SsaPhi;
+
+typedef struct {
+    const OpNode* node;  // identifier/member-access leaf, or the assignment for defs
+    int slot;
+    int version;
+    bool is_def;
+} SsaRef;
+
+typedef struct {
+    CFGNode* node;
+    int idom;          // block index, -1 for the entry and unreachable blocks
+    int dom_depth;
+    int* preds;
+    int pred_count;
+    int* frontier;
+    int frontier_count;
+    SsaPhi* phis;
+    int phi_count;
+    SsaRef* refs;      // statement reads and writes in evaluation order
+    int ref_count;
+    bool reachable;
+} SsaBlock;
+
+typedef struct {
+    int dest_slot;
+    int src_slot;
+} SsaCopy;
+
+// Parallel phi copies sequentialised for one CFG edge.
+typedef struct {
+    int from_block;
+    int to_block;
+    SsaCopy* copies;
+    int copy_count;
+} SsaEdgeCopies;
+
+typedef struct {
+    SsaBlock* blocks;
+    int block_count;
+    int entry_block;
+    int slot_count;
+    int* version_slots;      // storage slot of every version
+    int* version_blocks;     // block holding each version's definition
+    int version_count;
+    int* dom_children;       // dominator tree as CSR over dom_child_start
+    int* dom_child_start;
+    int* dom_preorder;       // reachable blocks, dominators first
+    int* dom_pre_index;      // position in dom_preorder, -1 when unreachable
+    int* dom_subtree_end;    // one past the last preorder position dominated
+    int reachable_count;
+    const CFGNode** lookup_nodes;   // block nodes sorted by address
+    int* lookup_indices;
+} SsaForm;
+
+SsaForm* buildSsaForm(const ControlFlowGraph* cfg, int slot_count, SsaSlotResolver resolver, void* user_data);
+void freeSsaForm(SsaForm* form);
+int findSsaBlockIndex(const SsaForm* form, const CFGNode* node);
+bool ssaDominates(const SsaForm* form, int dominator, int block);
+
+// Lowers phis whose operands live in different slots to copies on the
+// incoming edges. scratch_slot breaks copy cycles.
+SsaEdgeCopies* destructSsaForm(const SsaForm* form, int scratch_slot, int* edge_count);
+void freeSsaEdgeCopies(SsaEdgeCopies* edges, int edge_count);
+
+// Finds natural loops from the dominator back edges and attaches the nest to
+// cfg->loop_nest, replacing any previous one.
+LoopNest* buildLoopNest(ControlFlowGraph* cfg);
+bool loopContainsNode(const CFGLoop* loop, const CFGNode* node);
+
+#endif
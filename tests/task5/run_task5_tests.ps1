@@ -1,5 +1,9 @@
 param(
-    [string]$CompilerPath = "S:\CLionProjects\MyCompiler\cmake-build-debug\MyCompiler.exe"
+    [string]$CompilerPath = "S:\CLionProjects\MyCompiler\cmake-build-debug\MyCompiler.exe",
+    # Where myvm_run and the other tool targets were built; defaults to the compiler's directory.
+    [string]$ToolDirectory = "",
+    # C compiler that links the native builds of -CrossCheck cases.
+    [string]$CCompilerPath = "gcc"
 )
 
 $ErrorActionPreference = "Stop"
@@ -19,9 +23,13 @@ function Invoke-CompilerCase {
         [string]$Name,
         [string]$InputPath,
         [bool]$ShouldSucceed,
+        [string[]]$Options = @(),
         [string[]]$ExpectedOutputSubstrings = @(),
         [string[]]$ExpectedAsmSubstrings = @(),
-        [string[]]$ForbiddenAsmSubstrings = @()
+        [string[]]$ForbiddenAsmSubstrings = @(),
+        # Other files the compiler writes into the case directory, each mapped
+        # to the texts it must contain.
+        [hashtable]$ExpectedFiles = @{}
     )
 
     $tmpRoot = Join-Path $PSScriptRoot "tmp"
@@ -43,7 +51,7 @@ function Invoke-CompilerCase {
     Push-Location $caseRoot
     try {
         $process = Start-Process -FilePath $CompilerPath `
-            -ArgumentList @($inputFile.FullName, $astDir, $cfgDir) `
+            -ArgumentList ($Options + @($inputFile.FullName, $astDir, $cfgDir)) `
             -WorkingDirectory $caseRoot `
             -RedirectStandardOutput $stdoutPath `
             -RedirectStandardError $stderrPath `
@@ -91,16 +99,345 @@ function Invoke-CompilerCase {
         }
     }
 
+    foreach ($fileName in $ExpectedFiles.Keys) {
+        $filePath = Join-Path $caseRoot $fileName
+        if (-not (Test-Path -LiteralPath $filePath)) {
+            throw "Case '$Name' did not write '$fileName'. Output:`n$output"
+        }
+        $fileText = Get-Content -LiteralPath $filePath -Raw
+        foreach ($expectedText in $ExpectedFiles[$fileName]) {
+            if (-not $fileText.Contains($expectedText)) {
+                throw "Case '$Name' file '$fileName' does not contain expected text '$expectedText'."
+            }
+        }
+    }
+
     Write-Host "[PASS] $Name"
 }
 
+function Invoke-Captured {
+    param(
+        [string]$FilePath,
+        [string[]]$Arguments = @(),
+        [string]$InputText = "",
+        [string]$WorkingDirectory,
+        [int]$TimeoutSeconds = 60
+    )
+
+    $stdinPath = Join-Path $WorkingDirectory "run_stdin.txt"
+    $stdoutPath = Join-Path $WorkingDirectory "run_stdout.txt"
+    $stderrPath = Join-Path $WorkingDirectory "run_stderr.txt"
+    Set-Content -LiteralPath $stdinPath -Value $InputText -NoNewline
+
+    $startArguments = @{
+        FilePath = $FilePath
+        WorkingDirectory = $WorkingDirectory
+        RedirectStandardInput = $stdinPath
+        RedirectStandardOutput = $stdoutPath
+        RedirectStandardError = $stderrPath
+        PassThru = $true
+        NoNewWindow = $true
+    }
+    if ($Arguments.Count -gt 0) {
+        $startArguments.ArgumentList = $Arguments
+    }
+
+    $process = Start-Process @startArguments
+    $null = $process.Handle
+    if (-not $process.WaitForExit($TimeoutSeconds * 1000)) {
+        $process.Kill()
+        throw "'$FilePath' did not finish within $TimeoutSeconds seconds."
+    }
+    $process.WaitForExit()
+
+    return [pscustomobject]@{
+        ExitCode = $process.ExitCode
+        Output = (Get-Content -LiteralPath $stdoutPath | Out-String)
+        Errors = (Get-Content -LiteralPath $stderrPath | Out-String)
+    }
+}
+
+# Printed values separated by single spaces, however the program spaced them.
+function ConvertTo-ValueList {
+    param([string]$Text)
+
+    return (($Text -split "\s+") | Where-Object { $_ -ne "" }) -join " "
+}
+
+# Builds InputPath natively with Backend ("c" or "x86-64") and the case's
+# Options and checks that every run prints what the myvm build printed. The
+# generated C must also compile without warnings.
+function Invoke-NativeCheck {
+    param(
+        [string]$Name,
+        [string]$InputPath,
+        [object[]]$Runs,
+        [string[]]$Options = @(),
+        [string]$Backend
+    )
+
+    if (-not (Get-Command $CCompilerPath -ErrorAction SilentlyContinue)) {
+        Write-Host "[SKIP] $Name ($Backend, no C compiler '$CCompilerPath')"
+        return
+    }
+    # The x86-64 backend emits System V code and its runtime uses libc stdio.
+    if ($Backend -eq "x86-64" -and $exeSuffix) {
+        Write-Host "[SKIP] $Name ($Backend, needs a System V host)"
+        return
+    }
+
+    $caseRoot = Join-Path (Join-Path $PSScriptRoot "tmp") ($Name + "-" + $Backend)
+    New-CleanDirectory -Path $caseRoot
+    New-Item -ItemType Directory -Path (Join-Path $caseRoot "ast") | Out-Null
+    New-Item -ItemType Directory -Path (Join-Path $caseRoot "cfg") | Out-Null
+
+    $inputFile = Get-Item -LiteralPath $InputPath
+    $baseName = [System.IO.Path]::GetFileNameWithoutExtension($inputFile.Name)
+    $programPath = Join-Path $caseRoot ("program" + $exeSuffix)
+    if ($Backend -eq "c") {
+        $sourcePath = Join-Path $caseRoot ($baseName + ".c")
+        $backendOption = "--emit=c"
+        $buildArguments = @("-std=c11", "-O2", "-Wall", "-Wextra", "-Werror", "-o", $programPath, $sourcePath)
+    } else {
+        $sourcePath = Join-Path $caseRoot ($baseName + ".s")
+        $backendOption = "--target=$Backend"
+        $buildArguments = @("-o", $programPath, $sourcePath, $X86RuntimePath)
+    }
+
+    $compiled = Invoke-Captured -FilePath $CompilerPath `
+        -Arguments ($Options + @($backendOption, $inputFile.FullName, "ast", "cfg")) `
+        -WorkingDirectory $caseRoot
+    if (-not (Test-Path -LiteralPath $sourcePath)) {
+        throw "Case '$Name' produced no $Backend output.`n$($compiled.Output)$($compiled.Errors)"
+    }
+
+    $built = Invoke-Captured -FilePath $CCompilerPath -Arguments $buildArguments -WorkingDirectory $caseRoot
+    if ($built.ExitCode -ne 0) {
+        throw "Case '$Name' $Backend build failed.`n$($built.Output)$($built.Errors)"
+    }
+
+    foreach ($run in $Runs) {
+        $result = Invoke-Captured -FilePath $programPath -InputText $run.Input -WorkingDirectory $caseRoot
+        $actual = ConvertTo-ValueList $result.Output
+        if ($result.ExitCode -ne 0 -or $actual -ne $run.Output) {
+            throw "Case '$Name' on $Backend with input '$($run.Input)' printed '$actual' (exit code $($result.ExitCode)), expected '$($run.Output)'.`n$($result.Errors)"
+        }
+    }
+
+    Write-Host "[PASS] $Name ($Backend, $($Runs.Count) runs)"
+}
+
+# Compiles InputPath for myvm and runs it once per entry of Runs, each an
+# @{ Input = "stdin text"; Output = "expected values" } table. Every backend
+# named in CrossCheck must then print the same values.
+function Invoke-RunCase {
+    param(
+        [string]$Name,
+        [string]$InputPath,
+        [object[]]$Runs,
+        [string[]]$Options = @(),
+        [string[]]$CrossCheck = @(),
+        [string[]]$ExpectedOutputSubstrings = @(),
+        [string[]]$ExpectedAsmSubstrings = @(),
+        [string[]]$ForbiddenAsmSubstrings = @()
+    )
+
+    Invoke-CompilerCase -Name $Name `
+        -InputPath $InputPath `
+        -ShouldSucceed $true `
+        -Options $Options `
+        -ExpectedOutputSubstrings $ExpectedOutputSubstrings `
+        -ExpectedAsmSubstrings $ExpectedAsmSubstrings `
+        -ForbiddenAsmSubstrings $ForbiddenAsmSubstrings
+
+    $caseRoot = Join-Path (Join-Path $PSScriptRoot "tmp") $Name
+    $baseName = [System.IO.Path]::GetFileNameWithoutExtension($InputPath)
+    $asmPath = Join-Path $caseRoot ($baseName + ".asm")
+
+    foreach ($run in $Runs) {
+        $result = Invoke-Captured -FilePath $VmPath -Arguments @($asmPath) -InputText $run.Input -WorkingDirectory $caseRoot
+        $actual = ConvertTo-ValueList $result.Output
+        if ($result.ExitCode -ne 0 -or $actual -ne $run.Output) {
+            throw "Case '$Name' on myvm with input '$($run.Input)' printed '$actual' (exit code $($result.ExitCode)), expected '$($run.Output)'.`n$($result.Errors)"
+        }
+    }
+
+    Write-Host "[PASS] $Name (myvm, $($Runs.Count) runs)"
+
+    foreach ($backend in $CrossCheck) {
+        Invoke-NativeCheck -Name $Name -InputPath $InputPath -Runs $Runs -Options $Options -Backend $backend
+    }
+}
+
+# Runs pdsl_tablegen over a copy of target-definitions.pdsl in which every key
+# of Replace is swapped for its value, then checks the header it writes or,
+# for a broken description, that it fails with the expected diagnostics.
+function Invoke-TablegenCase {
+    param(
+        [string]$Name,
+        [hashtable]$Replace = @{},
+        [bool]$ShouldSucceed = $true,
+        [string[]]$ExpectedHeaderSubstrings = @(),
+        [string[]]$ExpectedOutputSubstrings = @()
+    )
+
+    $caseRoot = Join-Path (Join-Path $PSScriptRoot "tmp") $Name
+    New-CleanDirectory -Path $caseRoot
+    $pdslPath = Join-Path $caseRoot "target-definitions.pdsl"
+    $headerPath = Join-Path $caseRoot "myvm_isa.h"
+
+    $description = Get-Content -LiteralPath $PdslPath -Raw
+    foreach ($key in $Replace.Keys) {
+        if (-not $description.Contains($key)) {
+            throw "Case '$Name': target-definitions.pdsl does not contain '$key'."
+        }
+        $description = $description.Replace($key, $Replace[$key])
+    }
+    Set-Content -LiteralPath $pdslPath -Value $description -NoNewline
+
+    $result = Invoke-Captured -FilePath $TablegenPath -Arguments @($pdslPath, $headerPath) -WorkingDirectory $caseRoot
+    $output = $result.Output + $result.Errors
+    if ($ShouldSucceed -and $result.ExitCode -ne 0) {
+        throw "Case '$Name' expected a header, but pdsl_tablegen failed. Output:`n$output"
+    }
+    if (-not $ShouldSucceed -and $result.ExitCode -eq 0) {
+        throw "Case '$Name' expected pdsl_tablegen to fail. Output:`n$output"
+    }
+
+    foreach ($expected in $ExpectedOutputSubstrings) {
+        if ($output -notlike "*$expected*") {
+            throw "Case '$Name' output does not contain expected text '$expected'. Output:`n$output"
+        }
+    }
+    if ($ExpectedHeaderSubstrings.Count -gt 0) {
+        $header = Get-Content -LiteralPath $headerPath -Raw
+        foreach ($expected in $ExpectedHeaderSubstrings) {
+            if (-not $header.Contains($expected)) {
+                throw "Case '$Name' header does not contain expected text '$expected'."
+            }
+        }
+    }
+
+    Write-Host "[PASS] $Name"
+}
+
+# Compiles with --profile, runs the program on myvm and checks what
+# profile_report makes of the dumped counters.
+function Invoke-ProfileCase {
+    param(
+        [string]$Name,
+        [string]$InputPath,
+        [string]$ProgramInput = "",
+        [string[]]$ExpectedReportSubstrings = @()
+    )
+
+    Invoke-CompilerCase -Name $Name `
+        -InputPath $InputPath `
+        -ShouldSucceed $true `
+        -Options @("--profile") `
+        -ExpectedOutputSubstrings @("Profile map saved to:")
+
+    $caseRoot = Join-Path (Join-Path $PSScriptRoot "tmp") $Name
+    $baseName = [System.IO.Path]::GetFileNameWithoutExtension($InputPath)
+    $asmPath = Join-Path $caseRoot ($baseName + ".asm")
+    $mapPath = Join-Path $caseRoot ($baseName + ".profile.map")
+    $programOutputPath = Join-Path $caseRoot "program_output.txt"
+
+    $result = Invoke-Captured -FilePath $VmPath -Arguments @($asmPath) -InputText $ProgramInput -WorkingDirectory $caseRoot
+    if ($result.ExitCode -ne 0) {
+        throw "Case '$Name' failed on myvm with input '$ProgramInput' (exit code $($result.ExitCode)).`n$($result.Errors)"
+    }
+    Set-Content -LiteralPath $programOutputPath -Value $result.Output -NoNewline
+
+    $report = Invoke-Captured -FilePath $ProfileReportPath -Arguments @($mapPath, $programOutputPath) -WorkingDirectory $caseRoot
+    if ($report.ExitCode -ne 0) {
+        throw "Case '$Name': profile_report failed.`n$($report.Output)$($report.Errors)"
+    }
+    foreach ($expected in $ExpectedReportSubstrings) {
+        if (-not $report.Output.Contains($expected)) {
+            throw "Case '$Name' profile report does not contain expected text '$expected'. Report:`n$($report.Output)"
+        }
+    }
+
+    Write-Host "[PASS] $Name"
+}
+
+# Writes a program with more distinct constants worth pooling than pushc can
+# address: 13200 values used three times, spread over methods of 100
+# statements, plus ten values used five times that must win a pool place.
+function New-ConstantPoolProgram {
+    param([string]$Path)
+
+    $lines = New-Object System.Collections.Generic.List[string]
+    for ($m = 0; $m -lt 132; $m++) {
+        $lines.Add("method part$m(s: int): int")
+        $lines.Add("begin")
+        for ($k = $m * 100; $k -lt ($m + 1) * 100; $k++) {
+            $value = 100000 + $k
+            $lines.Add("    s := s + $value + $value - $value;")
+        }
+        $lines.Add("    s;")
+        $lines.Add("end;")
+        $lines.Add("")
+    }
+    $lines.Add("method hot(s: int): int")
+    $lines.Add("begin")
+    for ($k = 0; $k -lt 10; $k++) {
+        $value = 200000 + $k
+        $lines.Add("    s := s + $value + $value + $value - $value - $value;")
+    }
+    $lines.Add("    s;")
+    $lines.Add("end;")
+    $lines.Add("")
+    $lines.Add("method main()")
+    $lines.Add("var s: int;")
+    $lines.Add("begin")
+    $lines.Add("    s := read();")
+    for ($m = 0; $m -lt 132; $m++) {
+        $lines.Add("    s := part$m(s);")
+    }
+    $lines.Add("    s := hot(s);")
+    $lines.Add("    write(s);")
+    $lines.Add("end;")
+    $lines.Add("")
+    $lines.Add("method read();")
+    $lines.Add("method write(num : int);")
+    Set-Content -LiteralPath $Path -Value ($lines -join "`n")
+}
+
 if (-not (Test-Path -LiteralPath $CompilerPath)) {
     throw "Compiler not found: $CompilerPath"
 }
 
+if (-not $ToolDirectory) {
+    $ToolDirectory = Split-Path -Parent $CompilerPath
+}
+$exeSuffix = ""
+if ([System.Environment]::OSVersion.Platform -eq [System.PlatformID]::Win32NT) {
+    $exeSuffix = ".exe"
+}
+$VmPath = Join-Path $ToolDirectory ("myvm_run" + $exeSuffix)
+if (-not (Test-Path -LiteralPath $VmPath)) {
+    throw "myvm_run not found: $VmPath (build the myvm_run target)"
+}
+
+$TablegenPath = Join-Path $ToolDirectory ("pdsl_tablegen" + $exeSuffix)
+if (-not (Test-Path -LiteralPath $TablegenPath)) {
+    throw "pdsl_tablegen not found: $TablegenPath (build the pdsl_tablegen target)"
+}
+$ProfileReportPath = Join-Path $ToolDirectory ("profile_report" + $exeSuffix)
+if (-not (Test-Path -LiteralPath $ProfileReportPath)) {
+    throw "profile_report not found: $ProfileReportPath (build the profile_report target)"
+}
+$PdslPath = Join-Path (Join-Path $PSScriptRoot "..\..") "target-definitions.pdsl"
+$X86RuntimePath = Join-Path (Join-Path $PSScriptRoot "..\..") "x86_runtime.c"
+
 $inputRoot = Join-Path $PSScriptRoot "inputs"
-$exampleRoot = Join-Path (Join-Path $PSScriptRoot "..\..") "examples\task5"
+$exampleRoot = Join-Path (Join-Path $PSScriptRoot "..\..") "info\examples\task5"
 New-CleanDirectory -Path (Join-Path $PSScriptRoot "tmp")
+$generatedRoot = Join-Path (Join-Path $PSScriptRoot "tmp") "generated"
+New-CleanDirectory -Path $generatedRoot
+New-ConstantPoolProgram -Path (Join-Path $generatedRoot "constant_pool_cap.txt")
 
 Invoke-CompilerCase -Name "valid_member_access" `
     -InputPath (Join-Path $exampleRoot "member_access.txt") `
@@ -138,4 +475,292 @@ Invoke-CompilerCase -Name "error_import_call_not_supported" `
     -ShouldSucceed $false `
     -ExpectedOutputSubstrings @("import")
 
+Invoke-RunCase -Name "valid_loop_layout" `
+    -InputPath (Join-Path $inputRoot "valid_loop_layout.txt") `
+    -Runs @(
+        @{ Input = "10"; Output = "90 3 2 1 12 720 200 100 200" },
+        @{ Input = "0"; Output = "0 3 2 1 12 720 200 100 200" }
+    ) `
+    -ExpectedAsmSubstrings @("jlt main_L") `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_short_circuit" `
+    -InputPath (Join-Path $inputRoot "valid_short_circuit.txt") `
+    -Runs @(
+        @{ Input = "5"; Output = "0 1 2 3 3 0 13 8 3" },
+        @{ Input = "2"; Output = "0 1 2 1 12 8 2" },
+        @{ Input = "0"; Output = "0 1 9" }
+    ) `
+    -ForbiddenAsmSubstrings @("and_", "or_") `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_inlining" `
+    -InputPath (Join-Path $inputRoot "valid_inlining.txt") `
+    -Runs @(@{ Input = "7"; Output = "12 7 34 7 100 28 3" }) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_inlining_disabled" `
+    -InputPath (Join-Path $inputRoot "valid_inlining.txt") `
+    -Options @("--inline-budget=0") `
+    -Runs @(@{ Input = "7"; Output = "12 7 34 7 100 28 3" }) `
+    -ExpectedAsmSubstrings @("M_sys_ret_case_1") `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_inlined_leaf" `
+    -InputPath (Join-Path $inputRoot "valid_inlined_leaf.txt") `
+    -Runs @(@{ Input = "3"; Output = "12 7" }) `
+    -ExpectedAsmSubstrings @("M_sys_ret_dispatch:") `
+    -ForbiddenAsmSubstrings @("M_sys_ret_case_") `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-CompilerCase -Name "error_inline_budget_negative" `
+    -InputPath (Join-Path $inputRoot "valid_inlining.txt") `
+    -Options @("--inline-budget=-1") `
+    -ShouldSucceed $false `
+    -ExpectedOutputSubstrings @("--inline-budget needs a non-negative number")
+
+Invoke-RunCase -Name "valid_tail_calls" `
+    -InputPath (Join-Path $inputRoot "valid_tail_calls.txt") `
+    -Runs @(@{ Input = "3"; Output = "3 2 1 0 5050 5000050000 1055 2 1 0" }) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_cse" `
+    -InputPath (Join-Path $inputRoot "valid_cse.txt") `
+    -Runs @(@{ Input = "2 5"; Output = "30 9 13 1328 36 1" }) `
+    -ExpectedAsmSubstrings @("dup") `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_ssa_loop_phi" `
+    -InputPath (Join-Path $inputRoot "valid_ssa_loop_phi.txt") `
+    -Runs @(
+        @{ Input = "5"; Output = "828 10 798" },
+        @{ Input = "2"; Output = "292 3 262" },
+        @{ Input = "0"; Output = "0 3 -30" }
+    ) `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_licm" `
+    -InputPath (Join-Path $inputRoot "valid_licm.txt") `
+    -Runs @(
+        @{ Input = "4 0"; Output = "892 832 832 36" },
+        @{ Input = "2 3"; Output = "214 202 202 18" }
+    ) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_dead_methods" `
+    -InputPath (Join-Path $inputRoot "valid_dead_methods.txt") `
+    -Runs @(@{ Input = "5"; Output = "120" }) `
+    -ExpectedOutputSubstrings @(
+        "Removed unreachable method: orphan",
+        "Removed unreachable method: Acc_unused_int",
+        "Dead method elimination: 3 emitted, 3 removed"
+    ) `
+    -ForbiddenAsmSubstrings @("orphan:", "orphan2:", "Acc_unused_int:") `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_cfg_simplify" `
+    -InputPath (Join-Path $inputRoot "valid_cfg_simplify.txt") `
+    -Runs @(
+        @{ Input = "4"; Output = "10 11 12 13 14 0 9" },
+        @{ Input = "0"; Output = "10 11 12 13 14 0 1" }
+    ) `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_unroll" `
+    -InputPath (Join-Path $inputRoot "valid_unroll.txt") `
+    -Runs @(
+        @{ Input = "10"; Output = "285 22 89 5" },
+        @{ Input = "7"; Output = "91 12 89 4" },
+        @{ Input = "1"; Output = "0 1 89 1" },
+        @{ Input = "0"; Output = "0 0 89 0" }
+    ) `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_unroll_disabled" `
+    -InputPath (Join-Path $inputRoot "valid_unroll.txt") `
+    -Options @("--unroll-factor=0", "--unroll-full-trips=0") `
+    -Runs @(
+        @{ Input = "10"; Output = "285 22 89 5" },
+        @{ Input = "0"; Output = "0 0 89 0" }
+    ) `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_unroll_overflow" `
+    -InputPath (Join-Path $inputRoot "valid_unroll_overflow.txt") `
+    -Runs @(
+        @{ Input = "9223372036854775805 9223372036854775807"; Output = "9223372036854775805 9223372036854775806 -9223372036854775806 -9223372036854775807" },
+        @{ Input = "1 6"; Output = "1 2 3 4 5 -2 -3 -4 -5 -6" }
+    ) `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_unroll_bounds" `
+    -InputPath (Join-Path $inputRoot "valid_unroll_bounds.txt") `
+    -Options @("--unroll-full-trips=0") `
+    -Runs @(@{ Input = ""; Output = "240" }) `
+    -CrossCheck @("c") `
+    -ExpectedAsmSubstrings @("stgx 0", "ldgx 0") `
+    -ForbiddenAsmSubstrings @("chkb")
+
+Invoke-RunCase -Name "valid_typed_members" `
+    -InputPath (Join-Path $inputRoot "valid_typed_members.txt") `
+    -Runs @(@{ Input = "5"; Output = "5 7 20 21 1 3 6 70" }) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_nested_layout" `
+    -InputPath (Join-Path $inputRoot "valid_nested_layout.txt") `
+    -Runs @(@{ Input = "4"; Output = "30 30 -2" }) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_method_tables" `
+    -InputPath (Join-Path $inputRoot "valid_method_tables.txt") `
+    -Runs @(@{ Input = "4 5"; Output = "12 24 25 14 2 25 6 6 41" }) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_receiver_by_reference" `
+    -InputPath (Join-Path $inputRoot "valid_receiver_by_reference.txt") `
+    -Runs @(@{ Input = "5"; Output = "14 46 10 5 112 67 100" }) `
+    -ExpectedAsmSubstrings @("ldsp", "ldgi") `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_receiver_slots" `
+    -InputPath (Join-Path $inputRoot "valid_receiver_slots.txt") `
+    -Runs @(
+        @{ Input = "1"; Output = "2235 3306" },
+        @{ Input = "5"; Output = "6683 7794" }
+    ) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_receiver_slots_no_inline" `
+    -InputPath (Join-Path $inputRoot "valid_receiver_slots.txt") `
+    -Options @("--inline-budget=0") `
+    -Runs @(
+        @{ Input = "1"; Output = "2235 3306" },
+        @{ Input = "5"; Output = "6683 7794" }
+    ) `
+    -ExpectedAsmSubstrings @("ldsp", "ldgi") `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_arrays" `
+    -InputPath (Join-Path $inputRoot "valid_arrays.txt") `
+    -Runs @(
+        @{ Input = "20 3"; Output = "234 1254 63 560 9 1" },
+        @{ Input = "5 0"; Output = "234 30 63 140 0 1" }
+    ) `
+    -ExpectedAsmSubstrings @("ldgx", "stgx", "chkb") `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_array_bounds" `
+    -InputPath (Join-Path $inputRoot "valid_array_bounds.txt") `
+    -Runs @(
+        @{ Input = "3"; Output = "0 10 20 3" },
+        @{ Input = "6"; Output = "0 10 20 30" }
+    ) `
+    -CrossCheck @("c")
+
+Invoke-RunCase -Name "valid_index_range_unbounded" `
+    -InputPath (Join-Path $inputRoot "valid_index_range_unbounded.txt") `
+    -Runs @(
+        @{ Input = "5"; Output = "5 1 1" },
+        @{ Input = "1286342704553"; Output = "1286342704553 600 0" },
+        @{ Input = "1288490188200"; Output = "1288490188200" }
+    ) `
+    -CrossCheck @("c") `
+    -ExpectedAsmSubstrings @("chkb 600")
+
+Invoke-RunCase -Name "valid_fused_branches" `
+    -InputPath (Join-Path $inputRoot "valid_fused_branches.txt") `
+    -Runs @(
+        @{ Input = "10 102"; Output = "55" },
+        @{ Input = "7 43 5"; Output = "12" },
+        @{ Input = "9 42 3"; Output = "27" }
+    ) `
+    -ExpectedAsmSubstrings @("ldg2", "jlt") `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_jump_tables" `
+    -InputPath (Join-Path $inputRoot "valid_jump_tables.txt") `
+    -Runs @(
+        @{ Input = "6"; Output = "60 80 30 -1 2216" },
+        @{ Input = "3"; Output = "30 50 -1 -1 1105" },
+        @{ Input = "9"; Output = "90 -1 60 -1 2222" }
+    ) `
+    -ExpectedAsmSubstrings @("jmpt") `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-RunCase -Name "valid_constant_pool" `
+    -InputPath (Join-Path $inputRoot "valid_constant_pool.txt") `
+    -Runs @(
+        @{ Input = "10"; Output = "34" },
+        @{ Input = "2"; Output = "1" }
+    ) `
+    -ExpectedAsmSubstrings @("pushc M_const_") `
+    -CrossCheck @("c", "x86-64")
+
+# myvm_run rejects a pushc whose entry address does not fit its u16 operand.
+Invoke-RunCase -Name "valid_constant_pool_cap" `
+    -InputPath (Join-Path $generatedRoot "constant_pool_cap.txt") `
+    -Options @("--inline-budget=0") `
+    -Runs @(
+        @{ Input = "0"; Output = "1409113445" },
+        @{ Input = "-5"; Output = "1409113440" }
+    ) `
+    -ExpectedAsmSubstrings @("M_const_13106:") `
+    -ForbiddenAsmSubstrings @("M_const_13107:") `
+    -CrossCheck @("c", "x86-64")
+
+Invoke-TablegenCase -Name "tablegen_isa_header" `
+    -ExpectedHeaderSubstrings @("MYVM_OP_LDG2 = 0x50", "#define MYVM_SIZE_CHKB 3", "#define MYVM_MNEMONIC_JMPT `"jmpt`"", "{ MYVM_MNEMONIC_JMPT, MYVM_OP_JMPT, MYVM_SIZE_JMPT, 1, { MYVM_OPERAND_ADDR24 } }")
+
+Invoke-TablegenCase -Name "tablegen_error_unencoded_operand" `
+    -Replace @{ "mnemonic chkb for CHKB (IDX) IDX16;" = "mnemonic chkb for CHKB (IDX, OFF) IDX16;" } `
+    -ShouldSucceed $false `
+    -ExpectedOutputSubstrings @("mnemonic chkb lists operand 'OFF' that CHKB does not encode")
+
+Invoke-CompilerCase -Name "ngram_report" `
+    -InputPath (Join-Path $inputRoot "valid_loop_layout.txt") `
+    -ShouldSucceed $true `
+    -Options @("--mine-ngrams=ngrams.txt") `
+    -ExpectedOutputSubstrings @("N-gram report saved to: ngrams.txt") `
+    -ExpectedFiles @{
+        "ngrams.txt" = @(
+            "Instruction n-grams from 5 images",
+            "score = weighted sites * (length - 1) dispatches",
+            "1. ",
+            "target-definitions.pdsl:",
+            "instruction ",
+            "to_asm_module.c:"
+        )
+    }
+
+Invoke-CompilerCase -Name "cost_report" `
+    -InputPath (Join-Path $inputRoot "valid_loop_layout.txt") `
+    -ShouldSucceed $true `
+    -Options @("--cost-report") `
+    -ExpectedOutputSubstrings @("Cost report saved to: valid_loop_layout.cost.txt, valid_loop_layout.cost.json") `
+    -ExpectedFiles @{
+        "valid_loop_layout.cost.txt" = @("method", "est. cost", "call cost", "countdown", "main")
+        "valid_loop_layout.cost.json" = @("`"loop_weight`": 10", "`"name`": `"main`"", "`"estimated_cost`":", "`"nodes`": [")
+    }
+
+Invoke-CompilerCase -Name "line_table" `
+    -InputPath (Join-Path $inputRoot "valid_loop_layout.txt") `
+    -ShouldSucceed $true `
+    -ExpectedAsmSubstrings @("main_S1:", "section LINE_INFO", "LINEINFO_sumto_S1_line_4_col_4:", "LINEINFO_main_S1_line_45_col_4:", "LINEINFO_main_S2_line_46_col_4:")
+
+Invoke-ProfileCase -Name "profile_report" `
+    -InputPath (Join-Path $inputRoot "valid_loop_layout.txt") `
+    -ProgramInput "10" `
+    -ExpectedReportSubstrings @("node visits", "hottest nodes", "sumto", "main", "ENTRY_POINT")
+
+Invoke-RunCase -Name "valid_profile_slots" `
+    -InputPath (Join-Path $inputRoot "valid_profile_slots.txt") `
+    -Runs @(@{ Input = "3"; Output = "9" }) `
+    -CrossCheck @("c")
+
+Invoke-CompilerCase -Name "error_profile_slot_overlap" `
+    -InputPath (Join-Path $inputRoot "valid_profile_slots.txt") `
+    -ShouldSucceed $false `
+    -Options @("--profile") `
+    -ExpectedOutputSubstrings @("Method slots overlap the profiling counters.")
+
 Write-Host "All Task 5 acceptance checks passed."
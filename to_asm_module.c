@@ -7,9 +7,33 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "myvm_isa.h"
+#include "ssa_builder_module.h"
+
 #define RUNTIME_RETVAL_SLOT 7160
 #define RUNTIME_DISPATCH_LABEL "M_sys_ret_dispatch"
 #define PSEUDO_LABEL_MNEMONIC ".label"
+#define LOOP_ROTATION_MAX_OPS 16
+#define INLINE_DEFAULT_MAX_OPS 24
+#define INLINE_MAX_DEPTH 4
+#define VALUE_KEY_MAX 512
+#define LICM_MIN_COST 3
+#define RECEIVER_REF_MIN_SLOTS 4
+#define RECEIVER_REF_SLOT 0
+#define INDEX_RANGE_LIMIT (1LL << 40)
+#define INDEX_RANGE_WIDEN_PASS 3
+#define INDEX_RANGE_MAX_PASSES 64
+#define SWITCH_TABLE_MIN_ARMS 4
+#define CONST_POOL_LABEL_PREFIX "M_const_"
+// Entries follow the opening jmp; pushc addresses them through a u16 operand.
+#define CONST_POOL_MAX_ENTRIES \
+    (((1 << (8 * MYVM_OPERAND_SIZE_U16)) - 1 - MYVM_SIZE_JMP) / MYVM_SIZE_PUSHI + 1)
+#define SWITCH_TABLE_MAX_SPAN_PER_ARM 2
+// Profiling counters live in the global slots just below RUNTIME_RETVAL_SLOT.
+#define PROFILE_FIRST_SLOT 6144
+#define PROFILE_MAX_COUNTERS (RUNTIME_RETVAL_SLOT - PROFILE_FIRST_SLOT)
+#define PROFILE_DUMP_LABEL "M_sys_profile_dump"
+#define PROFILE_PORT 2
 
 typedef struct {
     Instruction* items;
@@ -27,6 +51,7 @@ typedef struct {
     int instr_index;
     int operand_index;
     CFGNode* target;
+    const CFGNode* source;
 } JumpPatch;
 
 typedef struct {
@@ -35,11 +60,38 @@ typedef struct {
     int capacity;
 } JumpPatchList;
 
+typedef struct {
+    int* jumps;
+    int count;
+    int capacity;
+} LocalLabel;
+
+typedef struct {
+    CFGNode* node;
+    LocalLabel* label;
+} BranchTarget;
+
 typedef struct {
     CFGNode* node;
     int start_index;
 } NodeEntry;
 
+// Open addressing on CFGNode::id; ids are unique but not dense once loops
+// are unrolled.
+typedef struct {
+    int* ids;        // -1 marks a free bucket
+    int* indices;    // position of the node in cfg->nodes
+    int capacity;    // power of two
+} NodeIndexMap;
+
+typedef struct {
+    const ControlFlowGraph* cfg;
+    CFGNode** order;
+    int count;
+    NodeIndexMap node_index;
+    int* positions;  // layout position by cfg->nodes position, -1 if unplaced
+} BlockLayout;
+
 typedef struct {
     int id;
     char* continue_label;
@@ -52,26 +104,135 @@ typedef struct {
     int next_id;
 } ReturnSiteList;
 
+// Counter k is global slot PROFILE_FIRST_SLOT + k and counts entries into
+// one CFG node of one method.
+typedef struct {
+    char* method;
+    int node_id;
+    NodeType node_type;
+} ProfileCounter;
+
+typedef struct {
+    ProfileCounter* items;
+    int count;
+} ProfileCounterList;
+
+// One available expression inside a basic block. Instances chosen for reuse
+// get a temp slot that the first evaluation fills with dup/stg.
+typedef struct {
+    char* key;
+    int* deps;
+    int dep_count;
+    int cost;
+    int uses;
+    int slot;
+    bool live;
+    bool materialized;
+} ValueInstance;
+
+typedef struct {
+    const OpNode** nodes;
+    int* node_values;
+    int node_count;
+    ValueInstance* values;
+    int value_count;
+} ValueTable;
+
+// Loop-invariant expression computed once in the preheader of loop. Repeats
+// of the same value in one loop share the slot; only the first is emitted.
+typedef struct {
+    const OpNode* node;
+    char* key;
+    int loop;
+    int slot;
+    bool emit;
+} LoopHoist;
+
+// Interval of values an integer may hold; low > high is the empty range.
+// Bounds at +/-INDEX_RANGE_LIMIT stand for unbounded.
+typedef struct {
+    long long low;
+    long long high;
+} IndexRange;
+
+// Run of `if v == k` tests on one slot with distinct keys, dispatched through
+// a jmpt table. Arm k is tests[k]->nextConditional; any key outside the table
+// continues at fallback, the false exit of the last test.
+typedef struct {
+    CFGNode** tests;
+    int* keys;
+    int count;
+    char* path;
+    int min_key;
+    int max_key;
+    CFGNode* fallback;
+} SwitchChain;
+
+// Active while a callee body is spliced into its caller: callee names are
+// renamed into caller slots, and the callee exit jumps to exit_label.
+typedef struct {
+    const char* slot_prefix;
+    const char* receiver_alias;
+    LocalLabel* exit_label;
+    bool result_on_stack;
+} InlineFrame;
+
 typedef struct {
     const SubprogramInfo* info;
     const SubprogramCollection* subprograms;
+    const CallGraph* call_graph;
     ReturnSiteList* return_sites;
+    ProfileCounterList* profile_counters;   // NULL unless profiling
+    int first_profile_counter;              // this method's counters start here
+    InlineFrame* inline_frame;
+    ValueTable* value_table;
+    LoopHoist* hoists;
+    int hoist_count;
+    const OpNode** unchecked_indexes;   // element accesses proven in bounds
+    int unchecked_index_count;
+    SwitchChain* switches;
+    int switch_count;
+    int inline_depth;
+    int next_inline_id;
     bool is_main_method;
     bool method_returns_value;
     bool halt_if_true_branch;
     bool has_error;
     char error_message[256];
     InstructionList instructions;
+    int fusion_barrier;   // first instruction a jump may target; nothing fuses across it
     DataItemList data_items;
     const char** var_names;
     const char** var_types;
     int var_count;
+    // Methods taking their receiver by reference keep its cell index in
+    // RECEIVER_REF_SLOT; the `this.*` slots are loaded on entry when used.
+    bool receiver_by_ref;
+    int receiver_first_slot;
+    int receiver_slot_count;
+    bool* receiver_slot_used;
+    ImageBlock* blocks;
+    int block_count;
+    ImageCallSite* call_sites;
+    int call_site_count;
+    ImageLine* lines;
+    int line_count;
 } CodegenContext;
 
+static int g_inline_max_ops = INLINE_DEFAULT_MAX_OPS;
+static FILE* g_dead_method_report = NULL;
+static FILE* g_profile_map = NULL;
+static AsmImageObserver g_image_observer = NULL;
+static void* g_image_observer_data = NULL;
+
 static int emit_instruction(CodegenContext* ctx, const char* mnemonic, int operand_count, const char** operands);
 static int emit_instruction1(CodegenContext* ctx, const char* mnemonic, const char* operand);
 static void emit_indexed_instruction(CodegenContext* ctx, const char* mnemonic, int index);
 static bool emit_expression(CodegenContext* ctx, const OpNode* node);
+static void emit_cfg_body(CodegenContext* ctx, const ControlFlowGraph* cfg);
+static int count_op_nodes(const OpNode* node);
+static bool is_conditional_node(const CFGNode* node);
+static bool passes_receiver_by_reference(const SubprogramCollection* subprograms, const SubprogramInfo* info);
 
 static void instruction_list_init(InstructionList* list)
 {
@@ -163,6 +324,7 @@ static void jump_patch_list_add(JumpPatchList* list, int instr_index, int operan
     patch->instr_index = instr_index;
     patch->operand_index = operand_index;
     patch->target = target;
+    patch->source = NULL;
 }
 
 static void return_site_list_init(ReturnSiteList* list)
@@ -266,11 +428,21 @@ static bool parse_index_operand(const char* text, int* out_value)
     return true;
 }
 
+static const MyVmInstructionInfo* find_instruction_info(const char* mnemonic)
+{
+    for (int i = 0; i < MYVM_INSTRUCTION_COUNT; i++) {
+        if (equals_ignore_case(mnemonic, MYVM_INSTRUCTIONS[i].mnemonic)) {
+            return &MYVM_INSTRUCTIONS[i];
+        }
+    }
+    return NULL;
+}
+
+// Jumps are the instructions whose operand is a 24-bit code address.
 static bool is_jump_mnemonic(const char* mnemonic)
 {
-    return equals_ignore_case(mnemonic, "jmp")
-        || equals_ignore_case(mnemonic, "jz")
-        || equals_ignore_case(mnemonic, "jnz");
+    const MyVmInstructionInfo* info = find_instruction_info(mnemonic);
+    return info && info->operand_count == 1 && info->operands[0] == MYVM_OPERAND_ADDR24;
 }
 
 static char* sanitize_label(const char* name)
@@ -442,31 +614,84 @@ static void append_codegen_slot(CodegenContext* ctx, const char* name, const cha
     ctx->var_count++;
 }
 
+// Flattened slot table of a class value type, or NULL for single-slot types.
+static const UserTypeInfo* find_flattened_type(const SubprogramCollection* subprograms, const char* type_name)
+{
+    if (is_builtin_type_name(type_name)) {
+        return NULL;
+    }
+
+    const UserTypeInfo* type_info = findUserTypeInfo(subprograms, type_name);
+    if (!type_info || type_info->kind != USER_TYPE_CLASS || type_info->flat_slot_count <= 0) {
+        return NULL;
+    }
+    return type_info;
+}
+
+static const char* flattened_slot_name(const char* prefix, const FlattenedSlotInfo* leaf, char* buffer, size_t buffer_size)
+{
+    if (!leaf->path[0]) {
+        return prefix;
+    }
+
+    snprintf(buffer, buffer_size, "%s.%s", prefix, leaf->path);
+    return buffer;
+}
+
 static void append_flattened_slots(CodegenContext* ctx, const char* prefix, const char* type_name)
 {
     if (!ctx || !prefix || !type_name) {
         return;
     }
 
-    const UserTypeInfo* type_info = findUserTypeInfo(ctx->subprograms, type_name);
-    if (!type_info || type_info->kind != USER_TYPE_CLASS) {
-        append_codegen_slot(ctx, prefix, type_name);
+    int length = 0;
+    const char* element_type = NULL;
+    if (getArrayTypeShape(type_name, &length, NULL, &element_type) && length > 0) {
+        for (int k = 0; k < length; k++) {
+            char element[512];
+            snprintf(element, sizeof(element), "%s[%d]", prefix, k);
+            append_flattened_slots(ctx, element, element_type);
+        }
         return;
     }
 
-    if (type_info->resolved_field_count == 0) {
-        append_codegen_slot(ctx, prefix, "int");
+    const UserTypeInfo* type_info = find_flattened_type(ctx->subprograms, type_name);
+    if (!type_info) {
+        append_codegen_slot(ctx, prefix, type_name);
         return;
     }
 
-    for (int i = 0; i < type_info->resolved_field_count; i++) {
-        const FieldInfo* field = &type_info->resolved_fields[i];
+    for (int i = 0; i < type_info->flat_slot_count; i++) {
+        const FlattenedSlotInfo* leaf = &type_info->flat_slots[i];
         char buffer[512];
-        snprintf(buffer, sizeof(buffer), "%s.%s", prefix, field->name ? field->name : "field");
-        if (is_builtin_type_name(field->type_name)) {
-            append_codegen_slot(ctx, buffer, field->type_name);
-        } else {
-            append_flattened_slots(ctx, buffer, field->type_name);
+        append_codegen_slot(ctx, flattened_slot_name(prefix, leaf, buffer, sizeof(buffer)), leaf->type_name);
+    }
+}
+
+// Maps a name as written in the subprogram being emitted to its slot name in
+// the image; only inlined callees are renamed.
+static const char* map_slot_name(const CodegenContext* ctx, const char* name, char* buffer, size_t buffer_size)
+{
+    const InlineFrame* frame = ctx ? ctx->inline_frame : NULL;
+    if (!frame || !name) {
+        return name;
+    }
+
+    if (frame->receiver_alias && strncmp(name, "this", 4) == 0 && (name[4] == '\0' || name[4] == '.')) {
+        snprintf(buffer, buffer_size, "%s%s", frame->receiver_alias, name + 4);
+    } else {
+        snprintf(buffer, buffer_size, "%s%s", frame->slot_prefix, name);
+    }
+    return buffer;
+}
+
+// Receiver leaves of a by-reference method are loaded on entry only if used.
+static void mark_receiver_slots_used(const CodegenContext* ctx, int first_slot, int count)
+{
+    for (int i = 0; ctx->receiver_slot_used && i < count; i++) {
+        int receiver_index = first_slot + i - ctx->receiver_first_slot;
+        if (receiver_index >= 0 && receiver_index < ctx->receiver_slot_count) {
+            ctx->receiver_slot_used[receiver_index] = true;
         }
     }
 }
@@ -477,8 +702,11 @@ static int find_var_index_exact(const CodegenContext* ctx, const char* name)
         return -1;
     }
 
+    char buffer[512];
+    name = map_slot_name(ctx, name, buffer, sizeof(buffer));
     for (int i = 0; i < ctx->var_count; i++) {
         if (ctx->var_names[i] && strcmp(ctx->var_names[i], name) == 0) {
+            mark_receiver_slots_used(ctx, i, 1);
             return i;
         }
     }
@@ -502,15 +730,6 @@ static int find_var_index(const CodegenContext* ctx, const char* name)
     return -1;
 }
 
-static const char* find_var_type(const CodegenContext* ctx, const char* name)
-{
-    int index = find_var_index(ctx, name);
-    if (index < 0 || !ctx || !ctx->var_types) {
-        return NULL;
-    }
-    return ctx->var_types[index];
-}
-
 static const char* find_declared_identifier_type(const CodegenContext* ctx, const char* name)
 {
     if (!ctx || !ctx->info || !name) {
@@ -691,103 +910,95 @@ static bool parse_int_literal(const char* text, int* out_value)
     return false;
 }
 
-static const char* infer_expression_type(CodegenContext* ctx, const OpNode* node);
-
+// Overloads are matched on the argument types left by annotate_op_tree, so
+// the arguments must be annotated before the call itself.
 static const SubprogramInfo* find_method_on_type(const SubprogramCollection* subprograms,
                                                  const char* owner_type_name,
                                                  const char* method_name,
-                                                 const OpNode* call_node,
-                                                 CodegenContext* ctx)
+                                                 const OpNode* call_node)
 {
     if (!subprograms || !owner_type_name || !method_name || !call_node) {
         return NULL;
     }
 
     const UserTypeInfo* type_info = findUserTypeInfo(subprograms, owner_type_name);
-    if (!type_info) {
+    int arg_count = call_node->operand_count - 1;
+    if (!type_info || arg_count < 0) {
         return NULL;
     }
 
-    for (int i = 0; i < subprograms->count; i++) {
-        const SubprogramInfo* info = &subprograms->items[i];
-        if (!info->owner_type_name || strcmp(info->owner_type_name, type_info->name) != 0) {
-            continue;
-        }
-        if (!info->name || strcmp(info->name, method_name) != 0) {
-            continue;
-        }
-        if (info->param_count != call_node->operand_count - 1) {
-            continue;
-        }
-
-        bool matches = true;
-        for (int arg_index = 1; arg_index < call_node->operand_count; arg_index++) {
-            const char* arg_type = infer_expression_type(ctx, call_node->operands[arg_index]);
-            const char* param_type = info->param_types ? info->param_types[arg_index - 1] : NULL;
-            if (!arg_type || !param_type || strcmp(arg_type, param_type) != 0) {
-                matches = false;
-                break;
-            }
-        }
+    const char* inline_types[8];
+    const char** arg_types = arg_count <= 8 ? inline_types : malloc(sizeof(char*) * arg_count);
+    if (!arg_types) {
+        return NULL;
+    }
 
-        if (matches) {
-            return info;
-        }
+    bool typed = true;
+    for (int i = 0; i < arg_count; i++) {
+        const OpNode* arg = call_node->operands[i + 1];
+        arg_types[i] = arg ? arg->resolved_type : NULL;
+        typed = typed && arg_types[i];
     }
 
-    if (type_info->base_type_name) {
-        return find_method_on_type(subprograms, type_info->base_type_name, method_name, call_node, ctx);
+    const SubprogramInfo* method = typed ? findTypeMethod(type_info, method_name, arg_types, arg_count) : NULL;
+    if (arg_types != inline_types) {
+        free(arg_types);
     }
+    return method;
+}
 
-    return NULL;
+static const char* literal_type_name(const char* text)
+{
+    if (!text) {
+        return "int";
+    }
+    if (strcmp(text, "true") == 0 || strcmp(text, "false") == 0) {
+        return "bool";
+    }
+    if (text[0] == '"') {
+        return "string";
+    }
+    if (text[0] == '\'') {
+        return "char";
+    }
+    return "int";
 }
 
-static const char* infer_expression_type(CodegenContext* ctx, const OpNode* node)
+// Resolves node bottom-up in the scope of ctx->info: every node gets its
+// type and every call its callee. Codegen reads these instead of inferring.
+static void annotate_op_tree(const CodegenContext* ctx, OpNode* node)
 {
-    if (!ctx || !node) {
-        return NULL;
+    if (!node) {
+        return;
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        annotate_op_tree(ctx, node->operands[i]);
     }
 
+    const OpNode* first = node->operand_count > 0 ? node->operands[0] : NULL;
+    const char* first_type = first ? first->resolved_type : NULL;
+    node->resolved_type = NULL;
+    node->resolved_callee = NULL;
+
     switch (node->type) {
         case OP_LITERAL:
-            if (!node->text) {
-                return "int";
-            }
-            if (strcmp(node->text, "true") == 0 || strcmp(node->text, "false") == 0) {
-                return "bool";
-            }
-            if (node->text[0] == '"') {
-                return "string";
-            }
-            if (node->text[0] == '\'') {
-                return "char";
-            }
-            return "int";
+            node->resolved_type = literal_type_name(node->text);
+            break;
         case OP_IDENTIFIER:
-        {
-            const char* type_name = find_var_type(ctx, node->text);
-            return type_name ? type_name : find_declared_identifier_type(ctx, node->text);
-        }
-        case OP_MEMBER_ACCESS: {
-            char* path = build_access_path(node);
-            const char* type_name = path ? find_var_type(ctx, path) : NULL;
-            free(path);
-            if (type_name) {
-                return type_name;
-            }
-
-            if (node->operand_count > 0 && node->text) {
-                const char* owner_type = infer_expression_type(ctx, node->operands[0]);
-                return find_member_type(ctx, owner_type, node->text);
-            }
-
-            return NULL;
-        }
+            node->resolved_type = find_declared_identifier_type(ctx, node->text);
+            break;
+        case OP_MEMBER_ACCESS:
+            node->resolved_type = node->text ? find_member_type(ctx, first_type, node->text) : NULL;
+            break;
         case OP_ASSIGNMENT:
-            if (node->operand_count > 0) {
-                return infer_expression_type(ctx, node->operands[0]);
-            }
-            return NULL;
+            node->resolved_type = first_type;
+            break;
+        case OP_ARRAY_INDEX: {
+            const char* element_type = NULL;
+            node->resolved_type = getArrayTypeShape(first_type, NULL, NULL, &element_type) ? element_type : NULL;
+            break;
+        }
         case OP_ADDITION:
         case OP_SUBTRACTION:
         case OP_MULTIPLICATION:
@@ -795,7 +1006,8 @@ static const char* infer_expression_type(CodegenContext* ctx, const OpNode* node
         case OP_MODULO:
         case OP_UNARY_PLUS:
         case OP_UNARY_MINUS:
-            return "int";
+            node->resolved_type = "int";
+            break;
         case OP_LOGICAL_AND:
         case OP_LOGICAL_OR:
         case OP_LOGICAL_NOT:
@@ -805,31 +1017,60 @@ static const char* infer_expression_type(CodegenContext* ctx, const OpNode* node
         case OP_LESS_THAN_OR_EQUAL:
         case OP_GREATER_THAN:
         case OP_GREATER_THAN_OR_EQUAL:
-            return "bool";
-        case OP_FUNCTION_CALL: {
-            const SubprogramInfo* callee = find_global_subprogram_by_name(ctx->subprograms, node->text);
-            return callee ? callee->return_type : NULL;
-        }
-        case OP_MEMBER_CALL: {
-            if (node->operand_count <= 0) {
-                return NULL;
-            }
-            const char* owner_type = infer_expression_type(ctx, node->operands[0]);
-            const SubprogramInfo* callee = find_method_on_type(ctx->subprograms, owner_type, node->text, node, ctx);
-            return callee ? callee->return_type : NULL;
-        }
+            node->resolved_type = "bool";
+            break;
+        case OP_FUNCTION_CALL:
+            node->resolved_callee = node->text ? find_global_subprogram_by_name(ctx->subprograms, node->text) : NULL;
+            break;
+        case OP_MEMBER_CALL:
+            node->resolved_callee = first ? find_method_on_type(ctx->subprograms, first_type, node->text, node) : NULL;
+            break;
         default:
-            return NULL;
+            break;
+    }
+
+    if (node->resolved_callee) {
+        node->resolved_type = node->resolved_callee->return_type;
+    }
+}
+
+static void annotate_subprogram(const SubprogramCollection* subprograms, const SubprogramInfo* info)
+{
+    if (!info || !info->cfg) {
+        return;
+    }
+
+    CodegenContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.info = info;
+    ctx.subprograms = subprograms;
+    for (int i = 0; i < info->cfg->node_count; i++) {
+        const CFGNode* node = info->cfg->nodes[i];
+        for (int s = 0; s < node->stmt_count; s++) {
+            annotate_op_tree(&ctx, node->statements[s]);
+        }
+    }
+}
+
+void annotateSubprogramCollection(const SubprogramCollection* subprograms)
+{
+    for (int i = 0; subprograms && i < subprograms->count; i++) {
+        annotate_subprogram(subprograms, &subprograms->items[i]);
     }
 }
 
+bool parseIntLiteral(const char* text, int* out_value)
+{
+    return parse_int_literal(text, out_value);
+}
+
 static void emit_load_from_path(CodegenContext* ctx, const char* path)
 {
     int index = find_var_index(ctx, path);
     if (index >= 0) {
-        emit_indexed_instruction(ctx, "ldg", index);
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, index);
     } else {
-        emit_instruction1(ctx, "pushi", "0");
+        emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
     }
 }
 
@@ -837,32 +1078,39 @@ static void emit_store_to_path(CodegenContext* ctx, const char* path)
 {
     int index = find_var_index(ctx, path);
     if (index >= 0) {
-        emit_indexed_instruction(ctx, "stg", index);
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, index);
     } else {
-        emit_instruction(ctx, "pop", 0, NULL);
+        emit_instruction(ctx, MYVM_MNEMONIC_POP, 0, NULL);
     }
 }
 
+// The leaves of a value occupy consecutive slots in table order, and a base
+// class table is a prefix of its derived classes, so only the first leaf is
+// looked up by name.
 static void emit_receiver_slots(CodegenContext* ctx, const char* prefix, const char* type_name)
 {
     if (!ctx || !prefix || !type_name) {
         return;
     }
 
-    const UserTypeInfo* type_info = findUserTypeInfo(ctx->subprograms, type_name);
-    if (!type_info || type_info->kind != USER_TYPE_CLASS) {
+    const UserTypeInfo* type_info = find_flattened_type(ctx->subprograms, type_name);
+    if (!type_info) {
         emit_load_from_path(ctx, prefix);
         return;
     }
 
-    for (int i = 0; i < type_info->resolved_field_count; i++) {
-        const FieldInfo* field = &type_info->resolved_fields[i];
-        char buffer[512];
-        snprintf(buffer, sizeof(buffer), "%s.%s", prefix, field->name ? field->name : "field");
-        if (is_builtin_type_name(field->type_name)) {
-            emit_load_from_path(ctx, buffer);
+    char buffer[512];
+    int first_slot = find_var_index(ctx, flattened_slot_name(prefix, &type_info->flat_slots[0], buffer, sizeof(buffer)));
+    // Only the first leaf was looked up by name; a by-reference prologue must
+    // still load every slot pushed here.
+    if (first_slot >= 0) {
+        mark_receiver_slots_used(ctx, first_slot, type_info->flat_slot_count);
+    }
+    for (int i = 0; i < type_info->flat_slot_count; i++) {
+        if (first_slot >= 0) {
+            emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, first_slot + i);
         } else {
-            emit_receiver_slots(ctx, buffer, field->type_name);
+            emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
         }
     }
 }
@@ -883,9 +1131,100 @@ static int emit_label(CodegenContext* ctx, const char* label)
     return emit_instruction1(ctx, PSEUDO_LABEL_MNEMONIC, label);
 }
 
+static void record_call_site(CodegenContext* ctx, int jump_instruction, int spill_count, int return_id)
+{
+    ImageCallSite* call_sites = realloc(ctx->call_sites, sizeof(ImageCallSite) * (ctx->call_site_count + 1));
+    if (!call_sites) {
+        set_codegen_error(ctx, "Out of memory while recording call sites.");
+        return;
+    }
+    ctx->call_sites = call_sites;
+    ctx->call_sites[ctx->call_site_count].jump_instruction = jump_instruction;
+    ctx->call_sites[ctx->call_site_count].spill_count = spill_count;
+    ctx->call_sites[ctx->call_site_count].return_id = return_id;
+    ctx->call_site_count++;
+}
+
+// Starts a new line-table entry at the next instruction. An entry that got no
+// instruction is replaced, and one repeating the previous line is dropped.
+static void mark_source_line(CodegenContext* ctx, int line, int column)
+{
+    if (line <= 0) {
+        return;
+    }
+
+    ImageLine* last = ctx->line_count > 0 ? &ctx->lines[ctx->line_count - 1] : NULL;
+    if (last && last->first_instruction == ctx->instructions.count) {
+        ctx->line_count--;
+        last = ctx->line_count > 0 ? &ctx->lines[ctx->line_count - 1] : NULL;
+    }
+    if (last && last->line == line) {
+        return;
+    }
+
+    ImageLine* lines = realloc(ctx->lines, sizeof(ImageLine) * (ctx->line_count + 1));
+    if (!lines) {
+        set_codegen_error(ctx, "Out of memory while recording source lines.");
+        return;
+    }
+    ctx->lines = lines;
+    ctx->lines[ctx->line_count].first_instruction = ctx->instructions.count;
+    ctx->lines[ctx->line_count].line = line;
+    ctx->lines[ctx->line_count].column = column;
+    ctx->line_count++;
+}
+
+// Only the method's own CFG is mapped; inlined bodies stay inside their call's node.
+static void record_image_block(CodegenContext* ctx, const LoopNest* nest, const CFGNode* node, int first_instruction)
+{
+    if (ctx->inline_frame) {
+        return;
+    }
+    ImageBlock* blocks = realloc(ctx->blocks, sizeof(ImageBlock) * (ctx->block_count + 1));
+    if (!blocks) {
+        set_codegen_error(ctx, "Out of memory while recording CFG blocks.");
+        return;
+    }
+    ctx->blocks = blocks;
+
+    ImageBlock* block = &ctx->blocks[ctx->block_count++];
+    block->node_id = node->id;
+    block->first_instruction = first_instruction;
+    block->instruction_count = ctx->instructions.count - first_instruction;
+    block->loop_depth = 0;
+    for (int i = 0; nest && i < nest->loop_count; i++) {
+        if (loopContainsNode(&nest->loops[i], node)) {
+            block->loop_depth++;
+        }
+    }
+}
+
+// Positions recorded as jump targets must stay instruction boundaries.
+static void mark_jump_target(CodegenContext* ctx)
+{
+    ctx->fusion_barrier = ctx->instructions.count;
+}
+
 static void emit_indexed_instruction(CodegenContext* ctx, const char* mnemonic, int index)
 {
     char* operand = format_int(index);
+
+    // Two loads in a row become one ldg2 unless a jump lands between them.
+    Instruction* last = ctx->instructions.count > ctx->fusion_barrier
+        ? &ctx->instructions.items[ctx->instructions.count - 1]
+        : NULL;
+    if (last && strcmp(mnemonic, MYVM_MNEMONIC_LDG) == 0 && strcmp(last->mnemonic, MYVM_MNEMONIC_LDG) == 0 && last->operand_count == 1) {
+        char** operands = realloc(last->operands, sizeof(char*) * 2);
+        if (operands) {
+            free(last->mnemonic);
+            last->mnemonic = strdup(MYVM_MNEMONIC_LDG2);
+            last->operands = operands;
+            last->operands[1] = operand;
+            last->operand_count = 2;
+            return;
+        }
+    }
+
     emit_instruction1(ctx, mnemonic, operand);
     free(operand);
 }
@@ -907,25 +1246,6 @@ static bool emit_binary_left_fold(CodegenContext* ctx, const OpNode* node, const
     return true;
 }
 
-static int count_flattened_type_slots(const SubprogramCollection* subprograms, const char* type_name)
-{
-    const UserTypeInfo* type_info = findUserTypeInfo(subprograms, type_name);
-    if (!type_info || type_info->kind != USER_TYPE_CLASS) {
-        return 1;
-    }
-
-    int count = 0;
-    for (int i = 0; i < type_info->resolved_field_count; i++) {
-        const FieldInfo* field = &type_info->resolved_fields[i];
-        if (is_builtin_type_name(field->type_name)) {
-            count++;
-        } else {
-            count += count_flattened_type_slots(subprograms, field->type_name);
-        }
-    }
-    return count;
-}
-
 static int get_subprogram_slot_count(const SubprogramCollection* subprograms, const SubprogramInfo* info)
 {
     if (!info) {
@@ -933,73 +1253,530 @@ static int get_subprogram_slot_count(const SubprogramCollection* subprograms, co
     }
 
     int slot_count = 0;
-    if (info->owner_type_name) {
-        slot_count += count_flattened_type_slots(subprograms, info->owner_type_name);
+    if (passes_receiver_by_reference(subprograms, info)) {
+        slot_count++;
+    } else if (info->owner_type_name) {
+        slot_count += getFlattenedSlotCount(subprograms, info->owner_type_name);
     }
     for (int i = 0; i < info->param_count; i++) {
-        slot_count += count_flattened_type_slots(subprograms, info->param_types ? info->param_types[i] : NULL);
+        slot_count += getFlattenedSlotCount(subprograms, info->param_types ? info->param_types[i] : NULL);
     }
     return slot_count;
 }
 
-static bool emit_call_common(CodegenContext* ctx,
-                             const SubprogramInfo* callee,
-                             const OpNode* receiver_node,
-                             const OpNode* call_node,
-                             int explicit_arg_start)
+static void local_label_add(LocalLabel* label, int instr_index)
 {
-    if (!ctx || !callee || !call_node) {
-        return false;
+    if (label->count + 1 > label->capacity) {
+        int new_capacity = label->capacity == 0 ? 4 : label->capacity * 2;
+        int* new_jumps = realloc(label->jumps, sizeof(int) * new_capacity);
+        if (!new_jumps) {
+            return;
+        }
+        label->jumps = new_jumps;
+        label->capacity = new_capacity;
     }
 
-    if (callee->import_info.is_imported) {
-        char buffer[256];
-        snprintf(buffer, sizeof(buffer), "Imported method '%s' cannot be executed because import calls are not supported by the VM backend.",
-                 callee->name ? callee->name : "<unknown>");
-        set_codegen_error(ctx, buffer);
-        return false;
-    }
+    label->jumps[label->count++] = instr_index;
+}
 
-    if (callee->owner_type_name && !receiver_node) {
-        set_codegen_error(ctx, "Internal error: method call is missing receiver.");
-        return false;
+// Points every jump recorded on the label at the next emitted instruction.
+static void local_label_bind(CodegenContext* ctx, LocalLabel* label)
+{
+    mark_jump_target(ctx);
+    for (int i = 0; i < label->count; i++) {
+        Instruction* instr = &ctx->instructions.items[label->jumps[i]];
+        if (instr->operand_count > 0) {
+            free(instr->operands[0]);
+            instr->operands[0] = format_int(ctx->instructions.count);
+        }
     }
 
-    if (!ctx->return_sites) {
-        set_codegen_error(ctx, "Internal error: call return-site tracker is missing.");
-        return false;
-    }
+    free(label->jumps);
+    label->jumps = NULL;
+    label->count = 0;
+    label->capacity = 0;
+}
 
-    if (!is_builtin_type_name(callee->return_type) && !equals_ignore_case(callee->return_type, "void")) {
-        char buffer[256];
-        snprintf(buffer, sizeof(buffer), "Custom return type '%s' is not supported in backend calls to '%s'.",
-                 callee->return_type ? callee->return_type : "<unknown>",
-                 callee->name ? callee->name : "<unknown>");
-        set_codegen_error(ctx, buffer);
-        return false;
+static void emit_branch_to(CodegenContext* ctx, JumpPatchList* patches, const char* mnemonic, BranchTarget target)
+{
+    int instr_index = emit_instruction1(ctx, mnemonic, "0");
+    if (target.node && patches) {
+        jump_patch_list_add(patches, instr_index, 0, target.node);
+    } else if (target.label) {
+        local_label_add(target.label, instr_index);
     }
+}
 
-    const ReturnSite* return_site = return_site_list_add(ctx->return_sites);
-    if (!return_site || !return_site->continue_label) {
-        set_codegen_error(ctx, "Out of memory while preparing call return site.");
+static bool call_graph_reaches(const CallGraph* graph,
+                               const SubprogramCollection* subprograms,
+                               const char* from_name,
+                               const char* target_name)
+{
+    if (!graph || !subprograms || !from_name || !target_name) {
         return false;
     }
 
-    for (int i = 0; i < ctx->var_count; i++) {
-        emit_indexed_instruction(ctx, "ldg", i);
+    // Call-graph edges name callees without their owner or overload, so all
+    // subprograms sharing a name are treated as one node.
+    int capacity = graph->edge_count + 1;
+    const char** worklist = malloc(sizeof(char*) * capacity);
+    if (!worklist) {
+        return true;
     }
 
-    if (receiver_node) {
-        char* receiver_path = build_access_path(receiver_node);
-        const char* receiver_type = callee->owner_type_name ? callee->owner_type_name
-                                                            : infer_expression_type(ctx, receiver_node);
-        if (!receiver_path || !receiver_type) {
-            free(receiver_path);
-            set_codegen_error(ctx, "Failed to resolve receiver for member call.");
-            return false;
-        }
-        emit_receiver_slots(ctx, receiver_path, receiver_type);
+    int count = 0;
+    worklist[count++] = from_name;
+    bool found = false;
+    for (int w = 0; w < count && !found; w++) {
+        for (int i = 0; i < subprograms->count && !found; i++) {
+            const SubprogramInfo* info = &subprograms->items[i];
+            if (!info->name || strcmp(info->name, worklist[w]) != 0) {
+                continue;
+            }
+
+            const char* node_name = info->asm_name ? info->asm_name : info->name;
+            for (int e = 0; e < graph->edge_count; e++) {
+                const CallGraphEdge* edge = &graph->edges[e];
+                if (!edge->caller_name || !edge->callee_name || strcmp(edge->caller_name, node_name) != 0) {
+                    continue;
+                }
+                if (strcmp(edge->callee_name, target_name) == 0) {
+                    found = true;
+                    break;
+                }
+
+                bool seen = false;
+                for (int k = 0; k < count; k++) {
+                    if (strcmp(worklist[k], edge->callee_name) == 0) {
+                        seen = true;
+                        break;
+                    }
+                }
+                if (!seen && count < capacity) {
+                    worklist[count++] = edge->callee_name;
+                }
+            }
+        }
+    }
+
+    free(worklist);
+    return found;
+}
+
+static int count_cfg_op_nodes(const ControlFlowGraph* cfg)
+{
+    int count = 0;
+    for (int i = 0; cfg && i < cfg->node_count; i++) {
+        const CFGNode* node = cfg->nodes[i];
+        for (int j = 0; node && j < node->stmt_count; j++) {
+            count += count_op_nodes(node->statements[j]);
+        }
+    }
+    return count;
+}
+
+static bool is_inline_candidate(const CodegenContext* ctx, const SubprogramInfo* callee)
+{
+    if (!ctx->call_graph || g_inline_max_ops <= 0 || ctx->inline_depth >= INLINE_MAX_DEPTH) {
+        return false;
+    }
+
+    if (!callee->has_body || !callee->cfg || callee->import_info.is_imported || callee == ctx->info) {
+        return false;
+    }
+
+    for (int i = 0; i < callee->param_count; i++) {
+        if (!is_builtin_type_name(callee->param_types ? callee->param_types[i] : NULL)) {
+            return false;
+        }
+    }
+
+    if (count_cfg_op_nodes(callee->cfg) > g_inline_max_ops) {
+        return false;
+    }
+
+    return !call_graph_reaches(ctx->call_graph, ctx->subprograms, callee->name, callee->name);
+}
+
+static bool is_own_name(const SubprogramInfo* info, const char* name)
+{
+    for (int i = 0; i < info->param_count; i++) {
+        if (info->param_names && info->param_names[i] && strcmp(info->param_names[i], name) == 0) {
+            return true;
+        }
+    }
+    for (int i = 0; i < info->local_count; i++) {
+        if (info->local_names && info->local_names[i] && strcmp(info->local_names[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool op_tree_writes_receiver(const SubprogramInfo* callee, const OpNode* node)
+{
+    if (!node) {
+        return false;
+    }
+
+    if (node->type == OP_ASSIGNMENT && node->operand_count > 0) {
+        const OpNode* target = node->operands[0];
+        if (target && target->type == OP_ARRAY_INDEX && target->operand_count > 0) {
+            target = target->operands[0];
+        }
+        char* path = build_access_path(target);
+        if (!path) {
+            return true;
+        }
+        char* dot = strchr(path, '.');
+        if (dot) {
+            *dot = '\0';
+        }
+        bool is_own = is_own_name(callee, path);
+        free(path);
+        if (!is_own) {
+            return true;
+        }
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        if (op_tree_writes_receiver(callee, node->operands[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool callee_writes_receiver(const SubprogramInfo* callee)
+{
+    const ControlFlowGraph* cfg = callee->cfg;
+    for (int i = 0; i < cfg->node_count; i++) {
+        const CFGNode* node = cfg->nodes[i];
+        for (int j = 0; node && j < node->stmt_count; j++) {
+            if (op_tree_writes_receiver(callee, node->statements[j])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Wide receivers of methods that never assign them are passed as the cell
+// index of their first slot instead of being copied field by field.
+static bool passes_receiver_by_reference(const SubprogramCollection* subprograms, const SubprogramInfo* info)
+{
+    return info && info->owner_type_name && info->has_body && info->cfg && !info->import_info.is_imported
+        && getFlattenedSlotCount(subprograms, info->owner_type_name) >= RECEIVER_REF_MIN_SLOTS
+        && !callee_writes_receiver(info);
+}
+
+// Slot offset of path inside the by-reference receiver of the method being
+// emitted, or -1 when path does not name part of it.
+static int find_receiver_reference_offset(const CodegenContext* ctx, const char* path)
+{
+    if (!ctx->receiver_by_ref || !path) {
+        return -1;
+    }
+
+    char buffer[512];
+    const char* mapped = map_slot_name(ctx, path, buffer, sizeof(buffer));
+    if (strcmp(mapped, "this") != 0 && strncmp(mapped, "this.", 5) != 0) {
+        // Bare field names address the receiver unless a local shadows them.
+        if (find_var_index_exact(ctx, path) >= 0) {
+            return -1;
+        }
+        char implicit[512];
+        snprintf(implicit, sizeof(implicit), "this.%s", path);
+        mapped = map_slot_name(ctx, implicit, buffer, sizeof(buffer));
+        if (strncmp(mapped, "this.", 5) != 0) {
+            return -1;
+        }
+    }
+
+    if (strcmp(mapped, "this") == 0) {
+        return 0;
+    }
+
+    const char* field_path = mapped + 5;
+    size_t length = strlen(field_path);
+    const UserTypeInfo* type_info = findUserTypeInfo(ctx->subprograms, ctx->info->owner_type_name);
+    for (int i = 0; type_info && i < type_info->flat_slot_count; i++) {
+        const char* leaf_path = type_info->flat_slots[i].path;
+        if (strncmp(leaf_path, field_path, length) == 0 && (leaf_path[length] == '\0' || leaf_path[length] == '.')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Pushes the cell index of the receiver at path. Slots of the current frame
+// are addressed in the copy saved by the caller protocol, which sits right
+// below the stack top after saved_slot_count saves; pass -1 when nothing was
+// saved, in which case only the method's own receiver can be referenced.
+static bool emit_receiver_reference(CodegenContext* ctx, const char* path, const char* type_name, int saved_slot_count)
+{
+    int offset = find_receiver_reference_offset(ctx, path);
+    if (offset >= 0) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, RECEIVER_REF_SLOT);
+        if (offset > 0) {
+            emit_indexed_instruction(ctx, MYVM_MNEMONIC_PUSHI, offset);
+            emit_instruction(ctx, MYVM_MNEMONIC_ADD, 0, NULL);
+        }
+        return true;
+    }
+
+    const UserTypeInfo* type_info = find_flattened_type(ctx->subprograms, type_name);
+    char buffer[512];
+    int first_slot = type_info && saved_slot_count >= 0
+        ? find_var_index(ctx, flattened_slot_name(path, &type_info->flat_slots[0], buffer, sizeof(buffer)))
+        : -1;
+    if (first_slot < 0 || first_slot >= saved_slot_count) {
+        set_codegen_error(ctx, "Failed to resolve receiver for member call.");
+        return false;
+    }
+
+    emit_instruction(ctx, MYVM_MNEMONIC_LDSP, 0, NULL);
+    emit_indexed_instruction(ctx, MYVM_MNEMONIC_PUSHI, first_slot - saved_slot_count);
+    emit_instruction(ctx, MYVM_MNEMONIC_ADD, 0, NULL);
+    return true;
+}
+
+// Returns the caller slot prefix holding the receiver, or NULL when it has no
+// flattened slots of its own.
+static char* resolve_receiver_alias(const CodegenContext* ctx, const OpNode* receiver_node)
+{
+    char* path = build_access_path(receiver_node);
+    if (!path) {
+        return NULL;
+    }
+
+    char candidates[2][512];
+    int candidate_count = 0;
+    snprintf(candidates[candidate_count++], sizeof(candidates[0]), "%s", path);
+    if (ctx->info && ctx->info->owner_type_name && strcmp(path, "this") != 0 && strncmp(path, "this.", 5) != 0) {
+        snprintf(candidates[candidate_count++], sizeof(candidates[0]), "this.%s", path);
+    }
+    free(path);
+
+    for (int c = 0; c < candidate_count; c++) {
+        char buffer[512];
+        const char* mapped = map_slot_name(ctx, candidates[c], buffer, sizeof(buffer));
+        size_t length = strlen(mapped);
+        for (int i = 0; i < ctx->var_count; i++) {
+            const char* name = ctx->var_names[i];
+            if (name && strncmp(name, mapped, length) == 0 && (name[length] == '\0' || name[length] == '.')) {
+                return strdup(mapped);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// True when every path into the exit node ends in a tail-return block, so an
+// inlined body can leave its result on the stack instead of in RETVAL.
+static bool exit_always_receives_value(const ControlFlowGraph* cfg)
+{
+    for (int i = 0; i < cfg->node_count; i++) {
+        const CFGNode* node = cfg->nodes[i];
+        if (!node || (node->nextDefault != cfg->exit && node->nextConditional != cfg->exit)) {
+            continue;
+        }
+        if (is_conditional_node(node) || node->stmt_count == 0
+            || node->nextConditional || node->nextDefault != cfg->exit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Splices the callee CFG into the current image. Arguments are bound into
+// fresh caller slots; a receiver the callee never assigns is aliased to the
+// caller's own slots instead of being copied.
+static bool emit_inline_call(CodegenContext* ctx,
+                             const SubprogramInfo* callee,
+                             const OpNode* receiver_node,
+                             const OpNode* call_node,
+                             int explicit_arg_start)
+{
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "inl%d$", ctx->next_inline_id++);
+
+    char* receiver_alias = NULL;
+    if (receiver_node) {
+        if (!callee_writes_receiver(callee)) {
+            receiver_alias = resolve_receiver_alias(ctx, receiver_node);
+        }
+        if (!receiver_alias) {
+            char* receiver_path = build_access_path(receiver_node);
+            if (!receiver_path) {
+                set_codegen_error(ctx, "Failed to resolve receiver for member call.");
+                return false;
+            }
+            emit_receiver_slots(ctx, receiver_path, callee->owner_type_name);
+            free(receiver_path);
+        }
+    }
+
+    for (int i = explicit_arg_start; i < call_node->operand_count; i++) {
+        bool has_value = emit_expression(ctx, call_node->operands[i]);
+        if (ctx->has_error) {
+            free(receiver_alias);
+            return false;
+        }
+        if (!has_value) {
+            emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+        }
+    }
+
+    char name[512];
+    int first_slot = ctx->var_count;
+    if (receiver_node && !receiver_alias) {
+        snprintf(name, sizeof(name), "%sthis", prefix);
+        append_flattened_slots(ctx, name, callee->owner_type_name);
+    }
+    for (int i = 0; i < callee->param_count; i++) {
+        snprintf(name, sizeof(name), "%s%s", prefix,
+                 callee->param_names && callee->param_names[i] ? callee->param_names[i] : "arg");
+        append_flattened_slots(ctx, name, callee->param_types[i]);
+    }
+    int bound_slot_count = ctx->var_count - first_slot;
+    for (int i = 0; i < callee->local_count; i++) {
+        snprintf(name, sizeof(name), "%s%s", prefix,
+                 callee->local_names && callee->local_names[i] ? callee->local_names[i] : "local");
+        append_flattened_slots(ctx, name,
+                               callee->local_types && callee->local_types[i] ? callee->local_types[i] : "int");
+    }
+
+    for (int i = first_slot + bound_slot_count - 1; i >= first_slot; i--) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, i);
+    }
+
+    bool returns_value = subprogram_returns_value(callee);
+    LocalLabel exit_label = {0};
+    InlineFrame frame = { prefix, receiver_alias, &exit_label, returns_value && exit_always_receives_value(callee->cfg) };
+
+    InlineFrame* saved_frame = ctx->inline_frame;
+    const SubprogramInfo* saved_info = ctx->info;
+    bool saved_returns_value = ctx->method_returns_value;
+    bool saved_is_main = ctx->is_main_method;
+    bool saved_halt = ctx->halt_if_true_branch;
+    // The callee's statements map to their own lines; the rest of the
+    // calling statement goes back to the caller's.
+    ImageLine saved_line = ctx->line_count > 0 ? ctx->lines[ctx->line_count - 1] : (ImageLine){ 0, 0, 0 };
+
+    ctx->inline_frame = &frame;
+    ctx->info = callee;
+    ctx->method_returns_value = returns_value;
+    ctx->is_main_method = false;
+    ctx->halt_if_true_branch = false;
+    ctx->inline_depth++;
+
+    emit_cfg_body(ctx, callee->cfg);
+
+    ctx->inline_depth--;
+    ctx->inline_frame = saved_frame;
+    ctx->info = saved_info;
+    ctx->method_returns_value = saved_returns_value;
+    ctx->is_main_method = saved_is_main;
+    ctx->halt_if_true_branch = saved_halt;
+
+    local_label_bind(ctx, &exit_label);
+    mark_source_line(ctx, saved_line.line, saved_line.column);
+    free(receiver_alias);
+
+    if (!returns_value) {
+        return false;
+    }
+    if (!frame.result_on_stack) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, RUNTIME_RETVAL_SLOT);
+    }
+    return true;
+}
+
+static bool emit_call_common(CodegenContext* ctx,
+                             const SubprogramInfo* callee,
+                             const OpNode* receiver_node,
+                             const OpNode* call_node,
+                             int explicit_arg_start)
+{
+    if (!ctx || !callee || !call_node) {
+        return false;
+    }
+
+    if (callee->import_info.is_imported) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "Imported method '%s' cannot be executed because import calls are not supported by the VM backend.",
+                 callee->name ? callee->name : "<unknown>");
+        set_codegen_error(ctx, buffer);
+        return false;
+    }
+
+    if (callee->owner_type_name && !receiver_node) {
+        set_codegen_error(ctx, "Internal error: method call is missing receiver.");
+        return false;
+    }
+
+    if (!ctx->return_sites) {
+        set_codegen_error(ctx, "Internal error: call return-site tracker is missing.");
+        return false;
+    }
+
+    if (!is_builtin_type_name(callee->return_type) && !equals_ignore_case(callee->return_type, "void")) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "Custom return type '%s' is not supported in backend calls to '%s'.",
+                 callee->return_type ? callee->return_type : "<unknown>",
+                 callee->name ? callee->name : "<unknown>");
+        set_codegen_error(ctx, buffer);
+        return false;
+    }
+
+    // Arguments are pushed as single values; arrays travel inside receivers.
+    for (int i = 0; i < callee->param_count; i++) {
+        if (callee->param_types && getArrayTypeShape(callee->param_types[i], NULL, NULL, NULL)) {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "Array parameter '%s' of '%s' is not supported by the ASM backend.",
+                     callee->param_names && callee->param_names[i] ? callee->param_names[i] : "<unknown>",
+                     callee->name ? callee->name : "<unknown>");
+            set_codegen_error(ctx, buffer);
+            return false;
+        }
+    }
+
+    if (is_inline_candidate(ctx, callee)) {
+        return emit_inline_call(ctx, callee, receiver_node, call_node, explicit_arg_start);
+    }
+
+    const ReturnSite* return_site = return_site_list_add(ctx->return_sites);
+    if (!return_site || !return_site->continue_label) {
+        set_codegen_error(ctx, "Out of memory while preparing call return site.");
+        return false;
+    }
+
+    // Inlined calls among the arguments may add slots; restore only what was saved.
+    int saved_slot_count = ctx->var_count;
+    for (int i = 0; i < saved_slot_count; i++) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, i);
+    }
+
+    if (receiver_node) {
+        char* receiver_path = build_access_path(receiver_node);
+        const char* receiver_type = callee->owner_type_name ? callee->owner_type_name
+                                                            : receiver_node->resolved_type;
+        if (!receiver_path || !receiver_type) {
+            free(receiver_path);
+            set_codegen_error(ctx, "Failed to resolve receiver for member call.");
+            return false;
+        }
+        if (passes_receiver_by_reference(ctx->subprograms, callee)) {
+            emit_receiver_reference(ctx, receiver_path, receiver_type, saved_slot_count);
+        } else {
+            emit_receiver_slots(ctx, receiver_path, receiver_type);
+        }
         free(receiver_path);
+        if (ctx->has_error) {
+            return false;
+        }
     }
 
     for (int i = explicit_arg_start; i < call_node->operand_count; i++) {
@@ -1008,31 +1785,32 @@ static bool emit_call_common(CodegenContext* ctx,
             return false;
         }
         if (!has_value) {
-            emit_instruction1(ctx, "pushi", "0");
+            emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
         }
     }
 
     int callee_slot_count = get_subprogram_slot_count(ctx->subprograms, callee);
     for (int i = callee_slot_count - 1; i >= 0; i--) {
-        emit_indexed_instruction(ctx, "stg", i);
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, i);
     }
 
     char* return_id = format_int(return_site->id);
-    emit_instruction1(ctx, "pushi", return_id);
+    emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, return_id);
     free(return_id);
 
     char* label = sanitize_label(callee->asm_name ? callee->asm_name : callee->name);
-    emit_instruction1(ctx, "jmp", label);
+    int jump_instruction = emit_instruction1(ctx, MYVM_MNEMONIC_JMP, label);
     free(label);
+    record_call_site(ctx, jump_instruction, saved_slot_count, return_site->id);
 
     emit_label(ctx, return_site->continue_label);
 
-    for (int i = ctx->var_count - 1; i >= 0; i--) {
-        emit_indexed_instruction(ctx, "stg", i);
+    for (int i = saved_slot_count - 1; i >= 0; i--) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, i);
     }
 
     if (subprogram_returns_value(callee)) {
-        emit_indexed_instruction(ctx, "ldg", RUNTIME_RETVAL_SLOT);
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, RUNTIME_RETVAL_SLOT);
         return true;
     }
 
@@ -1045,7 +1823,7 @@ static bool emit_function_call(CodegenContext* ctx, const OpNode* node)
         return false;
     }
 
-    const SubprogramInfo* callee = find_global_subprogram_by_name(ctx->subprograms, node->text);
+    const SubprogramInfo* callee = node->resolved_callee;
 
     if (callee && is_read_builtin(callee)) {
         if (node->operand_count != 0) {
@@ -1055,7 +1833,7 @@ static bool emit_function_call(CodegenContext* ctx, const OpNode* node)
             set_codegen_error(ctx, buffer);
             return false;
         }
-        emit_instruction(ctx, "in", 0, NULL);
+        emit_instruction(ctx, MYVM_MNEMONIC_IN, 0, NULL);
         return true;
     }
 
@@ -1070,9 +1848,9 @@ static bool emit_function_call(CodegenContext* ctx, const OpNode* node)
 
         bool has_value = emit_expression(ctx, node->operands[0]);
         if (!has_value) {
-            emit_instruction1(ctx, "pushi", "0");
+            emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
         }
-        emit_instruction(ctx, "out", 0, NULL);
+        emit_instruction(ctx, MYVM_MNEMONIC_OUT, 0, NULL);
         return false;
     }
 
@@ -1081,7 +1859,7 @@ static bool emit_function_call(CodegenContext* ctx, const OpNode* node)
             int value = 0;
             if (parse_int_literal(node->operands[0]->text, &value)) {
                 char* operand = format_int(value);
-                emit_instruction1(ctx, "setport", operand);
+                emit_instruction1(ctx, MYVM_MNEMONIC_SETPORT, operand);
                 free(operand);
                 return false;
             }
@@ -1090,7 +1868,7 @@ static bool emit_function_call(CodegenContext* ctx, const OpNode* node)
         if (node->operand_count == 1 && node->operands[0]) {
             emit_expression(ctx, node->operands[0]);
         }
-        emit_instruction(ctx, "setport", 0, NULL);
+        emit_instruction(ctx, MYVM_MNEMONIC_SETPORT, 0, NULL);
         return false;
     }
 
@@ -1124,7 +1902,7 @@ static bool emit_member_call(CodegenContext* ctx, const OpNode* node)
         return false;
     }
 
-    const char* owner_type = infer_expression_type(ctx, node->operands[0]);
+    const char* owner_type = node->operands[0] ? node->operands[0]->resolved_type : NULL;
     if (!owner_type) {
         char buffer[256];
         snprintf(buffer, sizeof(buffer), "Cannot resolve receiver type for method '%s' in '%s'.",
@@ -1134,7 +1912,7 @@ static bool emit_member_call(CodegenContext* ctx, const OpNode* node)
         return false;
     }
 
-    const SubprogramInfo* callee = find_method_on_type(ctx->subprograms, owner_type, node->text, node, ctx);
+    const SubprogramInfo* callee = node->resolved_callee;
     if (!callee) {
         char buffer[256];
         snprintf(buffer, sizeof(buffer), "Unknown method overload '%s' for receiver type '%s' in '%s'.",
@@ -1148,279 +1926,2579 @@ static bool emit_member_call(CodegenContext* ctx, const OpNode* node)
     return emit_call_common(ctx, callee, node->operands[0], node, 1);
 }
 
-static bool emit_expression(CodegenContext* ctx, const OpNode* node)
+// Emits jumping code: control goes to target when the condition evaluates to
+// jump_if_true, and falls through otherwise. && and || skip the remaining
+// operands as soon as the outcome is known.
+static OpType negate_relation(OpType relation)
 {
-    if (!ctx || !node || ctx->has_error) {
-        return false;
+    switch (relation) {
+        case OP_LESS_THAN:             return OP_GREATER_THAN_OR_EQUAL;
+        case OP_LESS_THAN_OR_EQUAL:    return OP_GREATER_THAN;
+        case OP_GREATER_THAN:          return OP_LESS_THAN_OR_EQUAL;
+        case OP_GREATER_THAN_OR_EQUAL: return OP_LESS_THAN;
+        case OP_EQUAL:                 return OP_NOT_EQUAL;
+        case OP_NOT_EQUAL:             return OP_EQUAL;
+        default:                       return OP_UNKNOWN;
     }
+}
 
-    switch (node->type) {
-        case OP_LITERAL: {
-            if (!node->text) {
-                emit_instruction1(ctx, "pushi", "0");
-                return true;
-            }
+static OpType swap_relation(OpType relation)
+{
+    switch (relation) {
+        case OP_LESS_THAN:             return OP_GREATER_THAN;
+        case OP_LESS_THAN_OR_EQUAL:    return OP_GREATER_THAN_OR_EQUAL;
+        case OP_GREATER_THAN:          return OP_LESS_THAN;
+        case OP_GREATER_THAN_OR_EQUAL: return OP_LESS_THAN_OR_EQUAL;
+        default:                       return relation;
+    }
+}
 
-            if (strcmp(node->text, "true") == 0) {
-                emit_instruction1(ctx, "pushb", "1");
+static bool op_tree_contains_call(const OpNode* node);
+static int find_hoisted_slot(const CodegenContext* ctx, const OpNode* node);
+static ValueInstance* find_value_instance(const CodegenContext* ctx, const OpNode* node);
+
+// Lowers a comparison that only feeds a branch to jlt/jge/jeq/jne on the two
+// operands. `>` and `<=` have no jump of their own and are taken with the
+// operands swapped, which is only done when neither side makes a call.
+static bool emit_compare_branch(CodegenContext* ctx,
+                                JumpPatchList* patches,
+                                const OpNode* node,
+                                bool jump_if_true,
+                                BranchTarget target)
+{
+    if (!node || node->operand_count != 2 || find_hoisted_slot(ctx, node) >= 0 || find_value_instance(ctx, node)) {
+        return false;
+    }
+
+    OpType relation = jump_if_true ? node->type : negate_relation(node->type);
+    const OpNode* left = node->operands[0];
+    const OpNode* right = node->operands[1];
+    if (relation == OP_GREATER_THAN || relation == OP_LESS_THAN_OR_EQUAL) {
+        if (op_tree_contains_call(left) || op_tree_contains_call(right)) {
+            return false;
+        }
+        relation = swap_relation(relation);
+        left = node->operands[1];
+        right = node->operands[0];
+    }
+
+    const char* mnemonic = NULL;
+    switch (relation) {
+        case OP_LESS_THAN:             mnemonic = MYVM_MNEMONIC_JLT; break;
+        case OP_GREATER_THAN_OR_EQUAL: mnemonic = MYVM_MNEMONIC_JGE; break;
+        case OP_EQUAL:                 mnemonic = MYVM_MNEMONIC_JEQ; break;
+        case OP_NOT_EQUAL:             mnemonic = MYVM_MNEMONIC_JNE; break;
+        default:                       return false;
+    }
+
+    if (!emit_expression(ctx, left)) {
+        emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+    }
+    if (!emit_expression(ctx, right)) {
+        emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+    }
+    emit_branch_to(ctx, patches, mnemonic, target);
+    return true;
+}
+
+static void emit_condition_jumps(CodegenContext* ctx,
+                                 JumpPatchList* patches,
+                                 const OpNode* node,
+                                 bool jump_if_true,
+                                 BranchTarget target)
+{
+    if (!ctx || ctx->has_error) {
+        return;
+    }
+
+    bool is_and = node && node->type == OP_LOGICAL_AND;
+    bool is_or = node && node->type == OP_LOGICAL_OR;
+    if ((is_and || is_or) && node->operand_count > 0) {
+        // Operands that decide the outcome early jump straight to the target
+        // (false for &&, true for ||); otherwise they skip to the end.
+        bool direct = is_and ? !jump_if_true : jump_if_true;
+        LocalLabel skip = {0};
+        BranchTarget skip_target = { NULL, &skip };
+        for (int i = 0; i < node->operand_count; i++) {
+            bool is_last = i == node->operand_count - 1;
+            if (direct) {
+                emit_condition_jumps(ctx, patches, node->operands[i], jump_if_true, target);
+            } else if (is_last) {
+                emit_condition_jumps(ctx, patches, node->operands[i], jump_if_true, target);
+            } else {
+                emit_condition_jumps(ctx, patches, node->operands[i], is_or, skip_target);
+            }
+        }
+        local_label_bind(ctx, &skip);
+        return;
+    }
+
+    if (node && node->type == OP_LOGICAL_NOT && node->operand_count > 0) {
+        emit_condition_jumps(ctx, patches, node->operands[0], !jump_if_true, target);
+        return;
+    }
+
+    if (emit_compare_branch(ctx, patches, node, jump_if_true, target)) {
+        return;
+    }
+
+    bool has_value = emit_expression(ctx, node);
+    if (!has_value) {
+        emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+    }
+    emit_branch_to(ctx, patches, jump_if_true ? MYVM_MNEMONIC_JNZ : MYVM_MNEMONIC_JZ, target);
+}
+
+static bool emit_logical_value(CodegenContext* ctx, const OpNode* node)
+{
+    LocalLabel on_false = {0};
+    LocalLabel done = {0};
+    BranchTarget false_target = { NULL, &on_false };
+    BranchTarget done_target = { NULL, &done };
+
+    emit_condition_jumps(ctx, NULL, node, false, false_target);
+    emit_instruction1(ctx, MYVM_MNEMONIC_PUSHB, "1");
+    emit_branch_to(ctx, NULL, MYVM_MNEMONIC_JMP, done_target);
+    local_label_bind(ctx, &on_false);
+    emit_instruction1(ctx, MYVM_MNEMONIC_PUSHB, "0");
+    local_label_bind(ctx, &done);
+    return true;
+}
+
+static bool is_value_op(OpType type)
+{
+    switch (type) {
+        case OP_ADDITION:
+        case OP_SUBTRACTION:
+        case OP_MULTIPLICATION:
+        case OP_DIVISION:
+        case OP_MODULO:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_LESS_THAN:
+        case OP_LESS_THAN_OR_EQUAL:
+        case OP_GREATER_THAN:
+        case OP_GREATER_THAN_OR_EQUAL:
+        case OP_UNARY_MINUS:
+        case OP_LOGICAL_NOT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_value_leaf(const OpNode* node)
+{
+    return node && (node->type == OP_LITERAL || node->type == OP_IDENTIFIER || node->type == OP_MEMBER_ACCESS);
+}
+
+// Pure trees read slots and literals only; they are the only ones numbered.
+static bool value_tree_is_pure(const OpNode* node)
+{
+    if (!node) {
+        return false;
+    }
+    if (is_value_leaf(node)) {
+        return true;
+    }
+    if (!is_value_op(node->type) && node->type != OP_UNARY_PLUS) {
+        return false;
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        if (!value_tree_is_pure(node->operands[i])) {
+            return false;
+        }
+    }
+    return node->operand_count > 0;
+}
+
+// Instruction count emit_expression produces for a pure tree.
+static int value_tree_cost(const OpNode* node)
+{
+    if (is_value_leaf(node)) {
+        return 1;
+    }
+
+    int cost = 0;
+    for (int i = 0; i < node->operand_count; i++) {
+        cost += value_tree_cost(node->operands[i]);
+    }
+    if (node->type == OP_UNARY_MINUS || node->type == OP_LOGICAL_NOT) {
+        return cost + 2;
+    }
+    if (node->type == OP_UNARY_PLUS) {
+        return cost;
+    }
+    return cost + node->operand_count - 1;
+}
+
+static int value_leaf_slot(const CodegenContext* ctx, const OpNode* node)
+{
+    if (node->type == OP_IDENTIFIER) {
+        return find_var_index(ctx, node->text);
+    }
+
+    char* path = build_access_path(node);
+    int index = path ? find_var_index(ctx, path) : -1;
+    free(path);
+    return index;
+}
+
+// Leaves are keyed by slot index so `x` and `this.x` number alike.
+static bool value_tree_key(const CodegenContext* ctx, const OpNode* node, char* buffer, size_t size, size_t* length)
+{
+    int written;
+    if (node->type == OP_LITERAL) {
+        written = snprintf(buffer + *length, size - *length, "l%s ", node->text ? node->text : "0");
+    } else if (is_value_leaf(node)) {
+        written = snprintf(buffer + *length, size - *length, "s%d ", value_leaf_slot(ctx, node));
+    } else {
+        written = snprintf(buffer + *length, size - *length, "(%d ", (int)node->type);
+    }
+    if (written < 0 || (size_t)written >= size - *length) {
+        return false;
+    }
+    *length += written;
+
+    if (is_value_leaf(node)) {
+        return true;
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        if (!value_tree_key(ctx, node->operands[i], buffer, size, length)) {
+            return false;
+        }
+    }
+    if (*length + 2 > size) {
+        return false;
+    }
+    buffer[(*length)++] = ')';
+    buffer[*length] = '\0';
+    return true;
+}
+
+static void value_tree_deps(const CodegenContext* ctx, const OpNode* node, ValueInstance* value)
+{
+    if (node->type == OP_LITERAL) {
+        return;
+    }
+    if (is_value_leaf(node)) {
+        int slot = value_leaf_slot(ctx, node);
+        if (slot < 0) {
+            return;
+        }
+        int* deps = realloc(value->deps, sizeof(int) * (value->dep_count + 1));
+        if (!deps) {
+            return;
+        }
+        value->deps = deps;
+        value->deps[value->dep_count++] = slot;
+        return;
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        value_tree_deps(ctx, node->operands[i], value);
+    }
+}
+
+static void value_table_map(ValueTable* table, const OpNode* node, int value_index)
+{
+    const OpNode** nodes = realloc((void*)table->nodes, sizeof(OpNode*) * (table->node_count + 1));
+    int* node_values = realloc(table->node_values, sizeof(int) * (table->node_count + 1));
+    if (nodes) {
+        table->nodes = nodes;
+    }
+    if (node_values) {
+        table->node_values = node_values;
+    }
+    if (!nodes || !node_values) {
+        return;
+    }
+    table->nodes[table->node_count] = node;
+    table->node_values[table->node_count] = value_index;
+    table->node_count++;
+}
+
+static void value_table_kill_slot(ValueTable* table, int slot)
+{
+    for (int i = 0; i < table->value_count; i++) {
+        ValueInstance* value = &table->values[i];
+        for (int d = 0; value->live && d < value->dep_count; d++) {
+            if (value->deps[d] == slot) {
+                value->live = false;
+            }
+        }
+    }
+}
+
+static void value_table_kill_all(ValueTable* table)
+{
+    for (int i = 0; i < table->value_count; i++) {
+        table->values[i].live = false;
+    }
+}
+
+static int find_hoisted_slot(const CodegenContext* ctx, const OpNode* node)
+{
+    for (int i = 0; i < ctx->hoist_count; i++) {
+        if (ctx->hoists[i].node == node) {
+            return ctx->hoists[i].slot;
+        }
+    }
+    return -1;
+}
+
+// Walks a statement in emission order, numbering pure subtrees. Operands of
+// && and || may be skipped at run time, so nothing inside them is numbered.
+static void value_table_visit(const CodegenContext* ctx, ValueTable* table, const OpNode* node, bool record)
+{
+    if (!node || find_hoisted_slot(ctx, node) >= 0) {
+        return;
+    }
+
+    if (record && !is_value_leaf(node) && value_tree_is_pure(node)) {
+        char key[VALUE_KEY_MAX];
+        size_t length = 0;
+        if (value_tree_key(ctx, node, key, sizeof(key), &length)) {
+            for (int i = 0; i < table->value_count; i++) {
+                ValueInstance* value = &table->values[i];
+                if (value->live && strcmp(value->key, key) == 0) {
+                    value->uses++;
+                    value_table_map(table, node, i);
+                    return;
+                }
+            }
+
+            ValueInstance* values = realloc(table->values, sizeof(ValueInstance) * (table->value_count + 1));
+            if (values) {
+                table->values = values;
+                ValueInstance* value = &table->values[table->value_count];
+                memset(value, 0, sizeof(*value));
+                value->key = strdup(key);
+                value->cost = value_tree_cost(node);
+                value->uses = 1;
+                value->slot = -1;
+                value->live = true;
+                value_tree_deps(ctx, node, value);
+                value_table_map(table, node, table->value_count);
+                table->value_count++;
+            }
+        }
+    }
+
+    bool short_circuit = node->type == OP_LOGICAL_AND || node->type == OP_LOGICAL_OR;
+    int first_operand = node->type == OP_ASSIGNMENT ? 1 : 0;
+    for (int i = first_operand; i < node->operand_count; i++) {
+        value_table_visit(ctx, table, node->operands[i], record && !short_circuit);
+    }
+
+    if (node->type == OP_ASSIGNMENT && node->operand_count > 0 && is_value_leaf(node->operands[0])) {
+        value_table_kill_slot(table, value_leaf_slot(ctx, node->operands[0]));
+    } else if (node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL) {
+        value_table_kill_all(table);
+    }
+}
+
+static int get_temp_slot(CodegenContext* ctx, const char* kind, int temp_index)
+{
+    char name[64];
+    char buffer[512];
+    snprintf(name, sizeof(name), "%s$%d", kind, temp_index);
+    const char* mapped = map_slot_name(ctx, name, buffer, sizeof(buffer));
+    for (int i = 0; i < ctx->var_count; i++) {
+        if (ctx->var_names[i] && strcmp(ctx->var_names[i], mapped) == 0) {
+            return i;
+        }
+    }
+
+    append_codegen_slot(ctx, mapped, "int");
+    return ctx->var_count - 1;
+}
+
+// Numbers the block's statements and assigns temp slots to expressions whose
+// reuse saves more than the dup/stg needed to keep them.
+static void build_value_table(CodegenContext* ctx, const CFGNode* node, ValueTable* table)
+{
+    memset(table, 0, sizeof(*table));
+    for (int i = 0; i < node->stmt_count; i++) {
+        value_table_visit(ctx, table, node->statements[i], true);
+    }
+
+    int temp_count = 0;
+    for (int i = 0; i < table->value_count; i++) {
+        ValueInstance* value = &table->values[i];
+        if ((value->uses - 1) * (value->cost - 1) > 2) {
+            value->slot = get_temp_slot(ctx, "cse", temp_count++);
+        }
+    }
+}
+
+static void free_value_table(ValueTable* table)
+{
+    for (int i = 0; i < table->value_count; i++) {
+        free(table->values[i].key);
+        free(table->values[i].deps);
+    }
+    free(table->values);
+    free((void*)table->nodes);
+    free(table->node_values);
+    memset(table, 0, sizeof(*table));
+}
+
+static ValueInstance* find_value_instance(const CodegenContext* ctx, const OpNode* node)
+{
+    const ValueTable* table = ctx->value_table;
+    if (!table) {
+        return NULL;
+    }
+
+    for (int i = 0; i < table->node_count; i++) {
+        if (table->nodes[i] == node) {
+            ValueInstance* value = &table->values[table->node_values[i]];
+            return value->slot >= 0 ? value : NULL;
+        }
+    }
+    return NULL;
+}
+
+// Resolves the array of an element access to the slot of its element 0.
+// Only one-dimensional arrays of single-slot elements can be indexed.
+static bool find_array_storage(CodegenContext* ctx, const OpNode* node, int* first_slot, int* length)
+{
+    const OpNode* array = node->operand_count == 2 ? node->operands[0] : NULL;
+    char* path = build_access_path(array);
+    int dimensions = 0;
+    const char* element_type = NULL;
+    char buffer[256];
+
+    if (!path || !getArrayTypeShape(array->resolved_type, length, &dimensions, &element_type)) {
+        snprintf(buffer, sizeof(buffer), "Indexed value '%s' is not an array.", path ? path : "<unknown>");
+        set_codegen_error(ctx, buffer);
+        free(path);
+        return false;
+    }
+
+    if (dimensions != 1 || *length <= 0 || getFlattenedSlotCount(ctx->subprograms, element_type) != 1) {
+        snprintf(buffer, sizeof(buffer), "Array '%s' of type '%s' cannot be indexed: only one-dimensional arrays of single-slot elements are supported.",
+                 path, array->resolved_type);
+        set_codegen_error(ctx, buffer);
+        free(path);
+        return false;
+    }
+
+    size_t element_size = strlen(path) + sizeof("[0]");
+    char* element = malloc(element_size);
+    if (!element) {
+        set_codegen_error(ctx, "Out of memory while resolving array storage.");
+        free(path);
+        return false;
+    }
+    snprintf(element, element_size, "%s[0]", path);
+    *first_slot = find_var_index(ctx, element);
+    free(element);
+    if (*first_slot < 0) {
+        snprintf(buffer, sizeof(buffer), "Failed to resolve storage of array '%s'.", path);
+        set_codegen_error(ctx, buffer);
+        free(path);
+        return false;
+    }
+
+    mark_receiver_slots_used(ctx, *first_slot, *length);
+    free(path);
+    return true;
+}
+
+static bool is_unchecked_index(const CodegenContext* ctx, const OpNode* node)
+{
+    for (int i = 0; i < ctx->unchecked_index_count; i++) {
+        if (ctx->unchecked_indexes[i] == node) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pushes the element index, bounds-checked unless range analysis proved it.
+// A literal index is checked here instead and returned in *constant, and
+// nothing is pushed.
+static bool emit_array_index(CodegenContext* ctx, const OpNode* node, int length, int* constant)
+{
+    const OpNode* index = node->operands[1];
+    if (index && index->type == OP_LITERAL && parse_int_literal(index->text, constant)) {
+        if (*constant < 0 || *constant >= length) {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "Array index %d is out of bounds for length %d.", *constant, length);
+            set_codegen_error(ctx, buffer);
+        }
+        return false;
+    }
+
+    if (!emit_expression(ctx, index)) {
+        emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+    }
+    if (!is_unchecked_index(ctx, node)) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_CHKB, length);
+    }
+    return true;
+}
+
+static bool emit_array_load(CodegenContext* ctx, const OpNode* node)
+{
+    int first_slot = -1;
+    int length = 0;
+    int constant = 0;
+    if (!find_array_storage(ctx, node, &first_slot, &length)) {
+        return false;
+    }
+
+    if (emit_array_index(ctx, node, length, &constant)) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDGX, first_slot);
+    } else {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, first_slot + constant);
+    }
+    return true;
+}
+
+// Stores the value on the stack top into the element named by node.
+static void emit_array_store(CodegenContext* ctx, const OpNode* node)
+{
+    int first_slot = -1;
+    int length = 0;
+    int constant = 0;
+    if (!find_array_storage(ctx, node, &first_slot, &length)) {
+        return;
+    }
+
+    if (emit_array_index(ctx, node, length, &constant)) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STGX, first_slot);
+    } else {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, first_slot + constant);
+    }
+}
+
+static char* scalar_access_path(const OpNode* node)
+{
+    if (node && node->type == OP_IDENTIFIER && node->text) {
+        return strdup(node->text);
+    }
+    if (node && node->type == OP_MEMBER_ACCESS) {
+        return build_access_path(node);
+    }
+    return NULL;
+}
+
+// Emits `x := x + k`, `x := k + x` and `x := x - k` as one incg on the slot
+// of x. Values that value numbering or LICM keep in a temp are left alone.
+static bool emit_increment(CodegenContext* ctx, const OpNode* target, const OpNode* value)
+{
+    if (!value || value->operand_count != 2 || find_hoisted_slot(ctx, value) >= 0 || find_value_instance(ctx, value)) {
+        return false;
+    }
+
+    const OpNode* path_operand = NULL;
+    const OpNode* literal_operand = NULL;
+    if (value->type == OP_ADDITION && value->operands[0] && value->operands[0]->type == OP_LITERAL) {
+        literal_operand = value->operands[0];
+        path_operand = value->operands[1];
+    } else if (value->type == OP_ADDITION || value->type == OP_SUBTRACTION) {
+        path_operand = value->operands[0];
+        literal_operand = value->operands[1];
+    } else {
+        return false;
+    }
+
+    int amount = 0;
+    if (!literal_operand || literal_operand->type != OP_LITERAL || !parse_int_literal(literal_operand->text, &amount)
+        || (value->type == OP_SUBTRACTION && amount == INT_MIN)) {
+        return false;
+    }
+    if (value->type == OP_SUBTRACTION) {
+        amount = -amount;
+    }
+
+    char* target_path = scalar_access_path(target);
+    char* operand_path = scalar_access_path(path_operand);
+    int index = -1;
+    if (target_path && operand_path && strcmp(target_path, operand_path) == 0) {
+        index = find_var_index(ctx, target_path);
+    }
+    free(target_path);
+    free(operand_path);
+    if (index < 0) {
+        return false;
+    }
+
+    char* slot = format_int(index);
+    char* imm = format_int(amount);
+    const char* ops[2] = { slot, imm };
+    emit_instruction(ctx, MYVM_MNEMONIC_INCG, 2, ops);
+    free(slot);
+    free(imm);
+    return true;
+}
+
+static bool emit_expression_tree(CodegenContext* ctx, const OpNode* node);
+
+static bool emit_expression(CodegenContext* ctx, const OpNode* node)
+{
+    if (!ctx || !node || ctx->has_error) {
+        return false;
+    }
+
+    int hoisted_slot = find_hoisted_slot(ctx, node);
+    if (hoisted_slot >= 0) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, hoisted_slot);
+        return true;
+    }
+
+    ValueInstance* value = find_value_instance(ctx, node);
+    if (!value) {
+        return emit_expression_tree(ctx, node);
+    }
+
+    if (value->materialized) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, value->slot);
+        return true;
+    }
+
+    value->materialized = true;
+    emit_expression_tree(ctx, node);
+    emit_instruction(ctx, MYVM_MNEMONIC_DUP, 0, NULL);
+    emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, value->slot);
+    return true;
+}
+
+static bool emit_expression_tree(CodegenContext* ctx, const OpNode* node)
+{
+    if (!ctx || !node || ctx->has_error) {
+        return false;
+    }
+
+    switch (node->type) {
+        case OP_LITERAL: {
+            if (!node->text) {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+                return true;
+            }
+
+            if (strcmp(node->text, "true") == 0) {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHB, "1");
+                return true;
+            }
+            if (strcmp(node->text, "false") == 0) {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHB, "0");
+                return true;
+            }
+
+            int value = 0;
+            if (parse_int_literal(node->text, &value)) {
+                char* operand = format_int(value);
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, operand);
+                free(operand);
+            } else {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+            }
+            return true;
+        }
+        case OP_IDENTIFIER: {
+            emit_load_from_path(ctx, node->text);
+            return true;
+        }
+        case OP_MEMBER_ACCESS: {
+            char* path = build_access_path(node);
+            if (path) {
+                emit_load_from_path(ctx, path);
+                free(path);
+            } else {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+            }
+            return true;
+        }
+        case OP_ASSIGNMENT: {
+            if (node->operand_count >= 2) {
+                const OpNode* target = node->operands[0];
+                const OpNode* value = node->operands[1];
+                if (emit_increment(ctx, target, value)) {
+                    return false;
+                }
+                emit_expression(ctx, value);
+
+                if (target && target->type == OP_IDENTIFIER) {
+                    emit_store_to_path(ctx, target->text);
+                } else if (target && target->type == OP_MEMBER_ACCESS) {
+                    char* path = build_access_path(target);
+                    if (path) {
+                        emit_store_to_path(ctx, path);
+                        free(path);
+                    } else {
+                        emit_instruction(ctx, MYVM_MNEMONIC_POP, 0, NULL);
+                    }
+                } else if (target && target->type == OP_ARRAY_INDEX) {
+                    emit_array_store(ctx, target);
+                } else {
+                    emit_instruction(ctx, MYVM_MNEMONIC_POP, 0, NULL);
+                }
+            }
+            return false;
+        }
+        case OP_ADDITION:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_ADD);
+        case OP_SUBTRACTION:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_SUB);
+        case OP_MULTIPLICATION:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_MUL);
+        case OP_DIVISION:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_DIV);
+        case OP_MODULO:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_MOD);
+        case OP_LOGICAL_AND:
+        case OP_LOGICAL_OR:
+            return emit_logical_value(ctx, node);
+        case OP_EQUAL:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_EQ);
+        case OP_NOT_EQUAL:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_NE);
+        case OP_LESS_THAN:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_LT);
+        case OP_LESS_THAN_OR_EQUAL:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_LE);
+        case OP_GREATER_THAN:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_GT);
+        case OP_GREATER_THAN_OR_EQUAL:
+            return emit_binary_left_fold(ctx, node, MYVM_MNEMONIC_GE);
+        case OP_UNARY_PLUS: {
+            if (node->operand_count > 0) {
+                return emit_expression(ctx, node->operands[0]);
+            }
+            return false;
+        }
+        case OP_UNARY_MINUS: {
+            if (node->operand_count > 0) {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+                emit_expression(ctx, node->operands[0]);
+                emit_instruction(ctx, MYVM_MNEMONIC_SUB, 0, NULL);
+                return true;
+            }
+            return false;
+        }
+        case OP_LOGICAL_NOT: {
+            if (node->operand_count > 0) {
+                emit_expression(ctx, node->operands[0]);
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+                emit_instruction(ctx, MYVM_MNEMONIC_EQ, 0, NULL);
                 return true;
             }
-            if (strcmp(node->text, "false") == 0) {
-                emit_instruction1(ctx, "pushb", "0");
-                return true;
+            return false;
+        }
+        case OP_FUNCTION_CALL:
+            return emit_function_call(ctx, node);
+        case OP_MEMBER_CALL:
+            return emit_member_call(ctx, node);
+        case OP_ARRAY_INDEX:
+            return emit_array_load(ctx, node);
+        case OP_UNKNOWN:
+        default: {
+            bool result = false;
+            for (int i = 0; i < node->operand_count; i++) {
+                bool has_value = emit_expression(ctx, node->operands[i]);
+                if (i < node->operand_count - 1 && has_value) {
+                    emit_instruction(ctx, MYVM_MNEMONIC_POP, 0, NULL);
+                }
+                result = has_value;
+            }
+            if (node->operand_count == 0) {
+                emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+                result = true;
+            }
+            return result;
+        }
+    }
+}
+
+static void emit_statement(CodegenContext* ctx, const OpNode* node)
+{
+    if (!ctx || !node || ctx->has_error) {
+        return;
+    }
+
+    mark_source_line(ctx, node->line, node->column);
+    if (node->type == OP_ASSIGNMENT) {
+        emit_expression(ctx, node);
+        return;
+    }
+
+    bool has_value = emit_expression(ctx, node);
+    if (has_value) {
+        emit_instruction(ctx, MYVM_MNEMONIC_POP, 0, NULL);
+    }
+}
+
+static bool has_incoming_if_true_edge(const ControlFlowGraph* cfg, const CFGNode* node)
+{
+    if (!cfg || !node) {
+        return false;
+    }
+
+    for (int i = 0; i < cfg->edge_count; i++) {
+        CFGEdge* edge = cfg->edges[i];
+        if (!edge || edge->to != node) {
+            continue;
+        }
+
+        if (edge->type == EDGE_TRUE && edge->from && edge->from->type == NODE_IF) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void emit_jump(CodegenContext* ctx, JumpPatchList* patches, const char* mnemonic, CFGNode* target)
+{
+    if (!ctx || !patches || !mnemonic || !target) {
+        return;
+    }
+
+    const char* placeholder = "0";
+    int instr_index = emit_instruction1(ctx, mnemonic, placeholder);
+    jump_patch_list_add(patches, instr_index, 0, target);
+}
+
+static bool is_conditional_node(const CFGNode* node)
+{
+    return node && (node->type == NODE_IF
+        || node->type == NODE_WHILE
+        || node->type == NODE_REPEAT_CONDITION);
+}
+
+static unsigned node_id_bucket(int id, int capacity)
+{
+    return ((unsigned)id * 2654435761u) & (unsigned)(capacity - 1);
+}
+
+static bool node_index_map_build(NodeIndexMap* map, const ControlFlowGraph* cfg)
+{
+    int n = cfg ? cfg->node_count : 0;
+    map->capacity = 16;
+    while (map->capacity < n * 2) {
+        map->capacity *= 2;
+    }
+    map->ids = malloc(sizeof(int) * map->capacity);
+    map->indices = malloc(sizeof(int) * map->capacity);
+    if (!map->ids || !map->indices) {
+        free(map->ids);
+        free(map->indices);
+        map->ids = NULL;
+        map->indices = NULL;
+        return false;
+    }
+    for (int i = 0; i < map->capacity; i++) {
+        map->ids[i] = -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        unsigned bucket = node_id_bucket(cfg->nodes[i]->id, map->capacity);
+        while (map->ids[bucket] != -1 && map->ids[bucket] != cfg->nodes[i]->id) {
+            bucket = (bucket + 1) & (unsigned)(map->capacity - 1);
+        }
+        if (map->ids[bucket] == -1) {
+            map->ids[bucket] = cfg->nodes[i]->id;
+            map->indices[bucket] = i;
+        }
+    }
+    return true;
+}
+
+static void node_index_map_free(NodeIndexMap* map)
+{
+    free(map->ids);
+    free(map->indices);
+    map->ids = NULL;
+    map->indices = NULL;
+    map->capacity = 0;
+}
+
+// Position of node in cfg->nodes through the method's map, -1 when absent.
+static int find_cfg_node_index(const ControlFlowGraph* cfg, const NodeIndexMap* map, const CFGNode* node)
+{
+    if (!cfg || !map || !map->ids || !node || node->id < 0) {
+        return -1;
+    }
+
+    unsigned bucket = node_id_bucket(node->id, map->capacity);
+    while (map->ids[bucket] != -1) {
+        if (map->ids[bucket] == node->id) {
+            int index = map->indices[bucket];
+            return cfg->nodes[index] == node ? index : -1;
+        }
+        bucket = (bucket + 1) & (unsigned)(map->capacity - 1);
+    }
+    return -1;
+}
+
+// Successors in the order the layout prefers to fall through into them.
+// Loop bodies stay on the fall-through path of a while header, the exit of a
+// repeat condition follows it (its true edge is the taken back-edge), and
+// if-nodes keep the then-branch inline.
+static int get_preferred_successors(const CFGNode* node, CFGNode* out[2])
+{
+    CFGNode* first = node->nextDefault;
+    CFGNode* second = node->nextConditional;
+    if (node->type == NODE_WHILE || node->type == NODE_IF) {
+        first = node->nextConditional;
+        second = node->nextDefault;
+    }
+
+    int count = 0;
+    if (first) {
+        out[count++] = first;
+    }
+    if (second && second != first) {
+        out[count++] = second;
+    }
+    return count;
+}
+
+static int find_layout_position(const BlockLayout* layout, const CFGNode* node)
+{
+    if (!layout || !layout->positions) {
+        return -1;
+    }
+    int index = find_cfg_node_index(layout->cfg, &layout->node_index, node);
+    return index >= 0 ? layout->positions[index] : -1;
+}
+
+static void free_block_layout(BlockLayout* layout)
+{
+    free(layout->order);
+    free(layout->positions);
+    node_index_map_free(&layout->node_index);
+    layout->order = NULL;
+    layout->positions = NULL;
+}
+
+// Orders CFG nodes so that every block is followed by its most likely
+// successor. A node is only chained in once all of its forward (non back-edge)
+// predecessors are placed, which keeps if/else joins after both arms and puts
+// the false exit of a loop right after the loop body.
+static bool build_block_layout(const ControlFlowGraph* cfg, BlockLayout* layout)
+{
+    memset(layout, 0, sizeof(*layout));
+    layout->cfg = cfg;
+
+    int n = cfg ? cfg->node_count : 0;
+    if (n <= 0) {
+        return true;
+    }
+
+    layout->order = malloc(sizeof(CFGNode*) * n);
+    layout->positions = malloc(sizeof(int) * n);
+    int* state = calloc(n, sizeof(int));
+    int* remaining_preds = calloc(n, sizeof(int));
+    bool* back_edge = calloc((size_t)n * 2, sizeof(bool));
+    bool* placed = calloc(n, sizeof(bool));
+    int* stack = malloc(sizeof(int) * n);
+    int* stack_slot = malloc(sizeof(int) * n);
+    int* pending = malloc(sizeof(int) * n * 2);
+    if (!layout->order || !layout->positions || !node_index_map_build(&layout->node_index, cfg)
+        || !state || !remaining_preds || !back_edge || !placed || !stack || !stack_slot || !pending) {
+        free_block_layout(layout);
+        free(state);
+        free(remaining_preds);
+        free(back_edge);
+        free(placed);
+        free(stack);
+        free(stack_slot);
+        free(pending);
+        return false;
+    }
+
+    // Iterative DFS from the entry marks back-edges (edges into a node that is
+    // still on the DFS stack) and counts forward predecessors per node.
+    const NodeIndexMap* map = &layout->node_index;
+    int entry_index = find_cfg_node_index(cfg, map, cfg->entry);
+    if (entry_index < 0) {
+        entry_index = 0;
+    }
+
+    int depth = 0;
+    stack[depth] = entry_index;
+    stack_slot[depth] = 0;
+    depth++;
+    state[entry_index] = 1;
+    while (depth > 0) {
+        int current = stack[depth - 1];
+        CFGNode* successors[2];
+        int successor_count = get_preferred_successors(cfg->nodes[current], successors);
+        if (stack_slot[depth - 1] >= successor_count) {
+            state[current] = 2;
+            depth--;
+            continue;
+        }
+
+        int slot = stack_slot[depth - 1]++;
+        int next = find_cfg_node_index(cfg, map, successors[slot]);
+        if (next < 0) {
+            continue;
+        }
+
+        if (state[next] == 1) {
+            back_edge[current * 2 + slot] = true;
+            continue;
+        }
+
+        remaining_preds[next]++;
+        if (state[next] == 0) {
+            state[next] = 1;
+            stack[depth] = next;
+            stack_slot[depth] = 0;
+            depth++;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        layout->positions[i] = -1;
+    }
+
+    int pending_count = 0;
+    int unplaced_scan = 0;
+    int current = entry_index;
+    while (current >= 0) {
+        CFGNode* node = cfg->nodes[current];
+        layout->positions[current] = layout->count;
+        layout->order[layout->count++] = node;
+        placed[current] = true;
+
+        CFGNode* successors[2];
+        int successor_count = get_preferred_successors(node, successors);
+        int next = -1;
+        for (int slot = 0; slot < successor_count; slot++) {
+            int successor = find_cfg_node_index(cfg, map, successors[slot]);
+            if (successor < 0 || placed[successor]) {
+                continue;
+            }
+            if (!back_edge[current * 2 + slot] && state[current] != 0) {
+                remaining_preds[successor]--;
+            }
+            if (next < 0 && remaining_preds[successor] <= 0) {
+                next = successor;
+            } else if (pending_count < n * 2) {
+                pending[pending_count++] = successor;
+            }
+        }
+
+        if (next < 0) {
+            for (int i = pending_count - 1; i >= 0; i--) {
+                if (!placed[pending[i]] && remaining_preds[pending[i]] <= 0) {
+                    next = pending[i];
+                    break;
+                }
+            }
+        }
+        if (next < 0) {
+            while (pending_count > 0 && placed[pending[pending_count - 1]]) {
+                pending_count--;
+            }
+            if (pending_count > 0) {
+                next = pending[--pending_count];
+            }
+        }
+        while (next < 0 && unplaced_scan < n) {
+            if (!placed[unplaced_scan]) {
+                next = unplaced_scan;
+            }
+            unplaced_scan++;
+        }
+
+        current = next;
+    }
+
+    free(state);
+    free(remaining_preds);
+    free(back_edge);
+    free(placed);
+    free(stack);
+    free(stack_slot);
+    free(pending);
+    return true;
+}
+
+static int count_op_nodes(const OpNode* node)
+{
+    if (!node) {
+        return 0;
+    }
+
+    int count = 1;
+    for (int i = 0; i < node->operand_count; i++) {
+        count += count_op_nodes(node->operands[i]);
+    }
+    return count;
+}
+
+static bool op_tree_contains_call(const OpNode* node)
+{
+    if (!node) {
+        return false;
+    }
+
+    if (node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL) {
+        return true;
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        if (op_tree_contains_call(node->operands[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A while condition may be copied to the bottom of the loop body when it is
+// small and call-free; the back-edge then becomes a single conditional jump.
+static bool can_rotate_loop_condition(const CFGNode* node)
+{
+    if (!node || node->type != NODE_WHILE || !node->nextConditional || node->stmt_count <= 0) {
+        return false;
+    }
+
+    int op_count = 0;
+    for (int i = 0; i < node->stmt_count; i++) {
+        if (op_tree_contains_call(node->statements[i])) {
+            return false;
+        }
+        op_count += count_op_nodes(node->statements[i]);
+    }
+
+    return op_count <= LOOP_ROTATION_MAX_OPS;
+}
+
+static void emit_exit_sequence(CodegenContext* ctx)
+{
+    if (ctx->inline_frame) {
+        BranchTarget continuation = { NULL, ctx->inline_frame->exit_label };
+        emit_branch_to(ctx, NULL, MYVM_MNEMONIC_JMP, continuation);
+    } else if (ctx->is_main_method && ctx->profile_counters) {
+        emit_instruction1(ctx, MYVM_MNEMONIC_JMP, PROFILE_DUMP_LABEL);
+    } else if (ctx->is_main_method) {
+        emit_instruction(ctx, MYVM_MNEMONIC_HALT, 0, NULL);
+    } else {
+        emit_instruction1(ctx, MYVM_MNEMONIC_JMP, RUNTIME_DISPATCH_LABEL);
+    }
+}
+
+static void emit_transfer(CodegenContext* ctx, JumpPatchList* patches, CFGNode* target, const CFGNode* fallthrough)
+{
+    if (!target || target == fallthrough) {
+        return;
+    }
+
+    // Jumping to the exit node only to jump again: emit the exit inline.
+    if (target->type == NODE_EXIT) {
+        emit_exit_sequence(ctx);
+        return;
+    }
+
+    emit_jump(ctx, patches, MYVM_MNEMONIC_JMP, target);
+}
+
+static void emit_condition_branch(CodegenContext* ctx,
+                                  JumpPatchList* patches,
+                                  const CFGNode* node,
+                                  const CFGNode* fallthrough)
+{
+    if (node->stmt_count <= 0) {
+        emit_transfer(ctx, patches, node->nextDefault ? node->nextDefault : node->nextConditional, fallthrough);
+        return;
+    }
+
+    for (int i = 0; i < node->stmt_count - 1; i++) {
+        emit_statement(ctx, node->statements[i]);
+    }
+
+    const OpNode* condition = node->statements[node->stmt_count - 1];
+    BranchTarget on_true = { node->nextConditional, NULL };
+    BranchTarget on_false = { node->nextDefault, NULL };
+
+    if (node->nextConditional && node->nextDefault) {
+        if (node->nextDefault == fallthrough) {
+            emit_condition_jumps(ctx, patches, condition, true, on_true);
+        } else {
+            emit_condition_jumps(ctx, patches, condition, false, on_false);
+            emit_transfer(ctx, patches, node->nextConditional, fallthrough);
+        }
+    } else if (node->nextConditional) {
+        emit_condition_jumps(ctx, patches, condition, true, on_true);
+    } else if (node->nextDefault) {
+        emit_statement(ctx, condition);
+        emit_transfer(ctx, patches, node->nextDefault, fallthrough);
+    }
+}
+
+static bool is_self_call(CodegenContext* ctx, const OpNode* node)
+{
+    if (!node || !node->text) {
+        return false;
+    }
+
+    const SubprogramInfo* callee = NULL;
+    if (node->type == OP_FUNCTION_CALL) {
+        callee = node->resolved_callee;
+        if (callee && node->operand_count != callee->param_count) {
+            return false;
+        }
+    } else if (node->type == OP_MEMBER_CALL && node->operand_count > 0) {
+        callee = node->resolved_callee;
+        // A by-reference receiver can only be rebound to itself: other
+        // receivers live in slots the restarted method overwrites.
+        char* receiver_path = ctx->receiver_by_ref ? build_access_path(node->operands[0]) : NULL;
+        if (ctx->receiver_by_ref && find_receiver_reference_offset(ctx, receiver_path) != 0) {
+            callee = NULL;
+        }
+        free(receiver_path);
+    }
+
+    return callee && callee == ctx->info;
+}
+
+// Returns the call in a block that ends in a recursive call whose result is
+// returned unchanged, either directly or through `v := self(...); v;`.
+static const OpNode* find_self_tail_call(CodegenContext* ctx, const CFGNode* node)
+{
+    if (ctx->inline_frame || ctx->is_main_method || ctx->halt_if_true_branch) {
+        return NULL;
+    }
+
+    if (is_conditional_node(node) || node->stmt_count == 0 || node->nextConditional || !node->nextDefault) {
+        return NULL;
+    }
+
+    for (int i = 0; i < ctx->info->param_count; i++) {
+        if (!is_builtin_type_name(ctx->info->param_types ? ctx->info->param_types[i] : NULL)) {
+            return NULL;
+        }
+    }
+
+    const OpNode* last = node->statements[node->stmt_count - 1];
+    if (node->nextDefault->type == NODE_EXIT) {
+        return is_self_call(ctx, last) ? last : NULL;
+    }
+
+    const CFGNode* next = node->nextDefault;
+    if (!ctx->method_returns_value || !last || last->type != OP_ASSIGNMENT || last->operand_count != 2) {
+        return NULL;
+    }
+
+    const OpNode* target = last->operands[0];
+    if (!target || target->type != OP_IDENTIFIER || !target->text || !is_own_name(ctx->info, target->text)) {
+        return NULL;
+    }
+
+    if (next->type != NODE_BASIC_BLOCK || next->stmt_count != 1 || next->nextConditional
+        || !next->nextDefault || next->nextDefault->type != NODE_EXIT) {
+        return NULL;
+    }
+
+    const OpNode* returned = next->statements[0];
+    if (!returned || returned->type != OP_IDENTIFIER || !returned->text || strcmp(returned->text, target->text) != 0) {
+        return NULL;
+    }
+
+    return is_self_call(ctx, last->operands[1]) ? last->operands[1] : NULL;
+}
+
+// Rebinds the receiver and parameter slots exactly as emit_call_common would,
+// then restarts the method instead of calling it.
+static void emit_self_tail_call(CodegenContext* ctx, JumpPatchList* patches, const OpNode* call)
+{
+    int explicit_arg_start = 0;
+    if (call->type == OP_MEMBER_CALL) {
+        char* receiver_path = build_access_path(call->operands[0]);
+        if (!receiver_path) {
+            set_codegen_error(ctx, "Failed to resolve receiver for member call.");
+            return;
+        }
+        if (ctx->receiver_by_ref) {
+            emit_receiver_reference(ctx, receiver_path, ctx->info->owner_type_name, -1);
+        } else {
+            emit_receiver_slots(ctx, receiver_path, ctx->info->owner_type_name);
+        }
+        free(receiver_path);
+        explicit_arg_start = 1;
+    }
+
+    for (int i = explicit_arg_start; i < call->operand_count; i++) {
+        bool has_value = emit_expression(ctx, call->operands[i]);
+        if (ctx->has_error) {
+            return;
+        }
+        if (!has_value) {
+            emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+        }
+    }
+
+    int slot_count = get_subprogram_slot_count(ctx->subprograms, ctx->info);
+    for (int i = slot_count - 1; i >= 0; i--) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, i);
+    }
+
+    emit_jump(ctx, patches, MYVM_MNEMONIC_JMP, ctx->info->cfg->entry);
+}
+
+// Matches an if-node whose only statement is `path == literal` (either way
+// round) on a scalar slot.
+static bool match_switch_test(CodegenContext* ctx, const CFGNode* node, char** path, int* key)
+{
+    if (!node || node->type != NODE_IF || node->stmt_count != 1 || !node->nextConditional || !node->nextDefault) {
+        return false;
+    }
+
+    const OpNode* condition = node->statements[0];
+    if (!condition || condition->type != OP_EQUAL || condition->operand_count != 2) {
+        return false;
+    }
+
+    const OpNode* leaf = condition->operands[0];
+    const OpNode* literal = condition->operands[1];
+    if (leaf && leaf->type == OP_LITERAL) {
+        literal = condition->operands[0];
+        leaf = condition->operands[1];
+    }
+    if (!literal || literal->type != OP_LITERAL || !parse_int_literal(literal->text, key)) {
+        return false;
+    }
+
+    *path = scalar_access_path(leaf);
+    if (!*path || find_var_index(ctx, *path) < 0) {
+        free(*path);
+        *path = NULL;
+        return false;
+    }
+    return true;
+}
+
+static bool block_assigns_path(const CFGNode* node, const char* path)
+{
+    for (int i = 0; i < node->stmt_count; i++) {
+        const OpNode* statement = node->statements[i];
+        if (!statement || statement->type != OP_ASSIGNMENT || statement->operand_count < 1) {
+            continue;
+        }
+        char* target = scalar_access_path(statement->operands[0]);
+        bool same = target && strcmp(target, path) == 0;
+        free(target);
+        if (same) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int count_cfg_predecessors(const ControlFlowGraph* cfg, const CFGNode* node, const CFGNode* except_a, const CFGNode* except_b)
+{
+    int count = 0;
+    for (int i = 0; i < cfg->node_count; i++) {
+        const CFGNode* pred = cfg->nodes[i];
+        if (pred == except_a || pred == except_b) {
+            continue;
+        }
+        count += pred->nextDefault == node;
+        count += pred->nextConditional == node && pred->nextConditional != pred->nextDefault;
+    }
+    return count;
+}
+
+// Grows a chain from head while the next test compares the same slot with a
+// new key. The sequential form (`if v == 1 then ...; if v == 2 then ...`) is
+// accepted as well as else-if: no arm assigns v and keys are distinct, so once
+// an arm has run every later test of the chain is false. Later tests may only
+// be reached from the previous test and its arm.
+static bool grow_switch_chain(CodegenContext* ctx, const BlockLayout* layout, CFGNode* head, bool* claimed, SwitchChain* chain)
+{
+    const ControlFlowGraph* cfg = layout->cfg;
+    memset(chain, 0, sizeof(*chain));
+    int key = 0;
+    if (!match_switch_test(ctx, head, &chain->path, &key)) {
+        return false;
+    }
+
+    chain->tests = malloc(sizeof(CFGNode*) * cfg->node_count);
+    chain->keys = malloc(sizeof(int) * cfg->node_count);
+    if (!chain->tests || !chain->keys) {
+        free(chain->tests);
+        free(chain->keys);
+        free(chain->path);
+        return false;
+    }
+
+    CFGNode* test = head;
+    while (test) {
+        CFGNode* arm = test->nextConditional;
+        if (arm->type != NODE_BASIC_BLOCK || block_assigns_path(arm, chain->path)
+            || count_cfg_predecessors(cfg, arm, test, NULL) != 0) {
+            break;
+        }
+        for (int k = 0; k < chain->count; k++) {
+            if (chain->keys[k] == key) {
+                arm = NULL;
+            }
+        }
+        int index = find_cfg_node_index(cfg, &layout->node_index, test);
+        if (!arm || index < 0 || claimed[index]) {
+            break;
+        }
+
+        chain->tests[chain->count] = test;
+        chain->keys[chain->count] = key;
+        chain->count++;
+
+        CFGNode* next = test->nextDefault;
+        char* next_path = NULL;
+        if (next == head || !match_switch_test(ctx, next, &next_path, &key)) {
+            break;
+        }
+        bool same_slot = strcmp(next_path, chain->path) == 0;
+        free(next_path);
+        if (!same_slot || count_cfg_predecessors(cfg, next, test, arm) != 0) {
+            break;
+        }
+        test = next;
+    }
+
+    if (chain->count == 0) {
+        free(chain->tests);
+        free(chain->keys);
+        free(chain->path);
+        return false;
+    }
+
+    chain->fallback = chain->tests[chain->count - 1]->nextDefault;
+    chain->min_key = chain->keys[0];
+    chain->max_key = chain->keys[0];
+    for (int k = 1; k < chain->count; k++) {
+        chain->min_key = chain->keys[k] < chain->min_key ? chain->keys[k] : chain->min_key;
+        chain->max_key = chain->keys[k] > chain->max_key ? chain->keys[k] : chain->max_key;
+    }
+    return true;
+}
+
+// Chains of at least SWITCH_TABLE_MIN_ARMS tests whose keys span at most
+// SWITCH_TABLE_MAX_SPAN_PER_ARM table entries per arm become jump tables.
+static void plan_switch_chains(CodegenContext* ctx, const BlockLayout* layout)
+{
+    const ControlFlowGraph* cfg = layout->cfg;
+    if (!cfg || cfg->node_count <= 0) {
+        return;
+    }
+
+    bool* claimed = calloc(cfg->node_count, sizeof(bool));
+    if (!claimed) {
+        return;
+    }
+
+    for (int i = 0; i < cfg->node_count; i++) {
+        CFGNode* head = cfg->nodes[i];
+        if (claimed[i] || !head || head->type != NODE_IF) {
+            continue;
+        }
+
+        SwitchChain chain;
+        if (!grow_switch_chain(ctx, layout, head, claimed, &chain)) {
+            continue;
+        }
+
+        long long span = (long long)chain.max_key - chain.min_key + 1;
+        SwitchChain* grown = chain.count >= SWITCH_TABLE_MIN_ARMS && span <= (long long)chain.count * SWITCH_TABLE_MAX_SPAN_PER_ARM
+            ? realloc(ctx->switches, sizeof(SwitchChain) * (ctx->switch_count + 1))
+            : NULL;
+        if (!grown) {
+            free(chain.tests);
+            free(chain.keys);
+            free(chain.path);
+            continue;
+        }
+
+        for (int k = 0; k < chain.count; k++) {
+            int index = find_cfg_node_index(cfg, &layout->node_index, chain.tests[k]);
+            if (index >= 0) {
+                claimed[index] = true;
+            }
+        }
+        ctx->switches = grown;
+        ctx->switches[ctx->switch_count++] = chain;
+    }
+
+    free(claimed);
+}
+
+static void free_switch_chains(CodegenContext* ctx)
+{
+    for (int i = 0; i < ctx->switch_count; i++) {
+        free(ctx->switches[i].tests);
+        free(ctx->switches[i].keys);
+        free(ctx->switches[i].path);
+    }
+    free(ctx->switches);
+    ctx->switches = NULL;
+    ctx->switch_count = 0;
+}
+
+static const SwitchChain* find_switch_chain(const CodegenContext* ctx, const CFGNode* node, int* position)
+{
+    for (int i = 0; node && i < ctx->switch_count; i++) {
+        for (int k = 0; k < ctx->switches[i].count; k++) {
+            if (ctx->switches[i].tests[k] == node) {
+                *position = k;
+                return &ctx->switches[i];
             }
+        }
+    }
+    return NULL;
+}
 
-            int value = 0;
-            if (parse_int_literal(node->text, &value)) {
-                char* operand = format_int(value);
-                emit_instruction1(ctx, "pushi", operand);
-                free(operand);
-            } else {
-                emit_instruction1(ctx, "pushi", "0");
+// Keys outside [min, max] go to the fallback; the rest index a table of jmps
+// that starts right after the jmpt, with holes also going to the fallback.
+static void emit_switch_dispatch(CodegenContext* ctx, JumpPatchList* patches, const SwitchChain* chain)
+{
+    emit_load_from_path(ctx, chain->path);
+    emit_indexed_instruction(ctx, MYVM_MNEMONIC_PUSHI, chain->min_key);
+    emit_jump(ctx, patches, MYVM_MNEMONIC_JLT, chain->fallback);
+    emit_indexed_instruction(ctx, MYVM_MNEMONIC_PUSHI, chain->max_key);
+    emit_load_from_path(ctx, chain->path);
+    emit_jump(ctx, patches, MYVM_MNEMONIC_JLT, chain->fallback);
+
+    emit_load_from_path(ctx, chain->path);
+    if (chain->min_key != 0) {
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_PUSHI, chain->min_key);
+        emit_instruction(ctx, MYVM_MNEMONIC_SUB, 0, NULL);
+    }
+    emit_indexed_instruction(ctx, MYVM_MNEMONIC_JMPT, ctx->instructions.count + 1);
+
+    for (long long key = chain->min_key; key <= chain->max_key; key++) {
+        CFGNode* target = chain->fallback;
+        for (int k = 0; k < chain->count; k++) {
+            if (chain->keys[k] == key) {
+                target = chain->tests[k]->nextConditional;
             }
-            return true;
         }
-        case OP_IDENTIFIER: {
-            emit_load_from_path(ctx, node->text);
-            return true;
+        emit_jump(ctx, patches, MYVM_MNEMONIC_JMP, target);
+    }
+}
+
+// Counts entries into a node of the method's own body. Later tests of a
+// switch chain are never entered, so they get no counter.
+static void emit_indexed_profile_bump(CodegenContext* ctx, int counter)
+{
+    char* slot = format_int(PROFILE_FIRST_SLOT + counter);
+    const char* ops[2] = { slot, "1" };
+    emit_instruction(ctx, MYVM_MNEMONIC_INCG, 2, ops);
+    free(slot);
+}
+
+static void emit_profile_counter(CodegenContext* ctx, const CFGNode* node)
+{
+    if (!ctx->profile_counters || ctx->inline_frame) {
+        return;
+    }
+    int chain_position = -1;
+    if (find_switch_chain(ctx, node, &chain_position) && chain_position > 0) {
+        return;
+    }
+
+    ProfileCounterList* list = ctx->profile_counters;
+    if (list->count >= PROFILE_MAX_COUNTERS) {
+        set_codegen_error(ctx, "Too many CFG nodes to profile.");
+        return;
+    }
+    ProfileCounter* items = realloc(list->items, sizeof(ProfileCounter) * (list->count + 1));
+    if (!items) {
+        set_codegen_error(ctx, "Out of memory while allocating profile counters.");
+        return;
+    }
+    list->items = items;
+    char* method = strdup(ctx->info->asm_name ? ctx->info->asm_name : ctx->info->name);
+    if (!method) {
+        set_codegen_error(ctx, "Out of memory while allocating profile counters.");
+        return;
+    }
+    list->items[list->count].method = method;
+    list->items[list->count].node_id = node->id;
+    list->items[list->count].node_type = node->type;
+
+    emit_indexed_profile_bump(ctx, list->count);
+    list->count++;
+}
+
+// A rotated while condition re-tested at the bottom of the body bumps the
+// counter its header got when it was placed.
+static void emit_rotated_profile_counter(CodegenContext* ctx, const CFGNode* header)
+{
+    if (!ctx->profile_counters || ctx->inline_frame) {
+        return;
+    }
+    const ProfileCounterList* list = ctx->profile_counters;
+    for (int i = ctx->first_profile_counter; i < list->count; i++) {
+        if (list->items[i].node_id == header->id) {
+            emit_indexed_profile_bump(ctx, i);
+            return;
         }
-        case OP_MEMBER_ACCESS: {
-            char* path = build_access_path(node);
-            if (path) {
-                emit_load_from_path(ctx, path);
-                free(path);
-            } else {
-                emit_instruction1(ctx, "pushi", "0");
+    }
+}
+
+static void emit_node(CodegenContext* ctx,
+                      CFGNode* node,
+                      JumpPatchList* patches,
+                      const BlockLayout* layout,
+                      int position)
+{
+    if (!ctx || !node || ctx->has_error) {
+        return;
+    }
+
+    const CFGNode* fallthrough = layout && position + 1 < layout->count ? layout->order[position + 1] : NULL;
+    mark_source_line(ctx, node->line, node->column);
+    emit_profile_counter(ctx, node);
+
+    bool result_on_stack = ctx->inline_frame && ctx->inline_frame->result_on_stack;
+    if (node->type == NODE_ENTRY && ctx->method_returns_value && !ctx->is_main_method && !result_on_stack) {
+        emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, RUNTIME_RETVAL_SLOT);
+    }
+
+    if (node->type == NODE_EXIT) {
+        // An inlined body placed last simply runs into the caller's code.
+        if (!(ctx->inline_frame && !fallthrough)) {
+            emit_exit_sequence(ctx);
+        }
+        return;
+    }
+
+    int chain_position = -1;
+    const SwitchChain* chain = find_switch_chain(ctx, node, &chain_position);
+    if (chain) {
+        // Later tests of the chain are folded into the head's table.
+        if (chain_position == 0) {
+            emit_switch_dispatch(ctx, patches, chain);
+        }
+        return;
+    }
+
+    if (is_conditional_node(node)) {
+        emit_condition_branch(ctx, patches, node, fallthrough);
+        return;
+    }
+
+    ValueTable values;
+    ValueTable* saved_values = ctx->value_table;
+    build_value_table(ctx, node, &values);
+    ctx->value_table = &values;
+
+    const OpNode* tail_call = find_self_tail_call(ctx, node);
+    if (tail_call) {
+        for (int i = 0; i < node->stmt_count - 1; i++) {
+            emit_statement(ctx, node->statements[i]);
+        }
+        emit_self_tail_call(ctx, patches, tail_call);
+        ctx->value_table = saved_values;
+        free_value_table(&values);
+        return;
+    }
+
+    bool tail_returns = ctx->method_returns_value
+        && node->stmt_count > 0
+        && node->nextDefault
+        && node->nextDefault->type == NODE_EXIT
+        && !node->nextConditional;
+    int statement_count = tail_returns ? node->stmt_count - 1 : node->stmt_count;
+
+    for (int i = 0; i < statement_count; i++) {
+        emit_statement(ctx, node->statements[i]);
+    }
+
+    if (tail_returns) {
+        const OpNode* result = node->statements[node->stmt_count - 1];
+        mark_source_line(ctx, result->line, result->column);
+        bool has_value = emit_expression(ctx, result);
+        if (!has_value) {
+            emit_instruction1(ctx, MYVM_MNEMONIC_PUSHI, "0");
+        }
+        if (!result_on_stack) {
+            emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, RUNTIME_RETVAL_SLOT);
+        }
+    }
+
+    ctx->value_table = saved_values;
+    free_value_table(&values);
+
+    if (ctx->halt_if_true_branch && has_incoming_if_true_edge(ctx->info ? ctx->info->cfg : NULL, node)) {
+        emit_instruction(ctx, MYVM_MNEMONIC_HALT, 0, NULL);
+        return;
+    }
+
+    CFGNode* target = node->nextDefault ? node->nextDefault : node->nextConditional;
+
+    // An arm that ran its key fails every later test of its chain.
+    chain = find_switch_chain(ctx, target, &chain_position);
+    if (chain && chain_position > 0) {
+        target = chain->fallback;
+    }
+
+    // Back-edge into an already placed while header: re-test the condition
+    // here so the loop runs on one taken jump per iteration.
+    if (target && target != fallthrough && can_rotate_loop_condition(target)) {
+        int target_position = find_layout_position(layout, target);
+        if (target_position >= 0 && target_position <= position) {
+            emit_rotated_profile_counter(ctx, target);
+            emit_condition_branch(ctx, patches, target, fallthrough);
+            return;
+        }
+    }
+
+    emit_transfer(ctx, patches, target, fallthrough);
+}
+
+// Leaves of class or array type name the contiguous run of their slots.
+static bool resolve_ssa_slots(void* user_data, const OpNode* leaf, int* first_slot, int* slot_count)
+{
+    const CodegenContext* ctx = user_data;
+    char* path = leaf->type == OP_IDENTIFIER ? (leaf->text ? strdup(leaf->text) : NULL) : build_access_path(leaf);
+    if (!path) {
+        return false;
+    }
+
+    int index = find_var_index(ctx, path);
+    if (index >= 0) {
+        free(path);
+        *first_slot = index;
+        *slot_count = 1;
+        return true;
+    }
+
+    char candidates[2][512];
+    int candidate_count = 0;
+    snprintf(candidates[candidate_count++], sizeof(candidates[0]), "%s", path);
+    if (ctx->info && ctx->info->owner_type_name && strcmp(path, "this") != 0 && strncmp(path, "this.", 5) != 0) {
+        snprintf(candidates[candidate_count++], sizeof(candidates[0]), "this.%s", path);
+    }
+    free(path);
+
+    for (int c = 0; c < candidate_count; c++) {
+        char buffer[512];
+        const char* mapped = map_slot_name(ctx, candidates[c], buffer, sizeof(buffer));
+        size_t length = strlen(mapped);
+        int first = -1;
+        int count = 0;
+        for (int i = 0; i < ctx->var_count; i++) {
+            const char* name = ctx->var_names[i];
+            if (name && strncmp(name, mapped, length) == 0 && (name[length] == '.' || name[length] == '[')) {
+                first = first < 0 ? i : first;
+                count = i - first + 1;
             }
+        }
+        if (first >= 0) {
+            *first_slot = first;
+            *slot_count = count;
             return true;
         }
-        case OP_ASSIGNMENT: {
-            if (node->operand_count >= 2) {
-                const OpNode* target = node->operands[0];
-                const OpNode* value = node->operands[1];
-                emit_expression(ctx, value);
+    }
 
-                if (target && target->type == OP_IDENTIFIER) {
-                    emit_store_to_path(ctx, target->text);
-                } else if (target && target->type == OP_MEMBER_ACCESS) {
-                    char* path = build_access_path(target);
-                    if (path) {
-                        emit_store_to_path(ctx, path);
-                        free(path);
-                    } else {
-                        emit_instruction(ctx, "pop", 0, NULL);
-                    }
-                } else {
-                    emit_instruction(ctx, "pop", 0, NULL);
-                }
+    return false;
+}
+
+// A preheader runs even when the loop body never does, so division is only
+// hoisted by a nonzero literal.
+static bool value_tree_is_speculable(const OpNode* node)
+{
+    if (is_value_leaf(node)) {
+        return true;
+    }
+
+    if (node->type == OP_DIVISION || node->type == OP_MODULO) {
+        for (int i = 1; i < node->operand_count; i++) {
+            int divisor = 0;
+            const OpNode* operand = node->operands[i];
+            if (!operand || operand->type != OP_LITERAL || !parse_int_literal(operand->text, &divisor) || divisor == 0) {
+                return false;
+            }
+        }
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        if (!value_tree_is_speculable(node->operands[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True when every slot the tree reads holds a version defined outside the loop.
+static bool value_tree_is_invariant(const CodegenContext* ctx,
+                                    const SsaForm* form,
+                                    const SsaBlock* block,
+                                    const bool* in_loop,
+                                    const OpNode* node)
+{
+    if (node->type == OP_LITERAL) {
+        return true;
+    }
+
+    if (is_value_leaf(node)) {
+        if (value_leaf_slot(ctx, node) < 0) {
+            return false;
+        }
+        bool found = false;
+        for (int r = 0; r < block->ref_count; r++) {
+            const SsaRef* ref = &block->refs[r];
+            if (ref->node != node || ref->is_def) {
+                continue;
+            }
+            if (ref->version < 0 || in_loop[form->version_blocks[ref->version]]) {
+                return false;
+            }
+            found = true;
+        }
+        return found;
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        if (!value_tree_is_invariant(ctx, form, block, in_loop, node->operands[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void add_loop_hoist(CodegenContext* ctx, const OpNode* node, int loop_index, int* next_temp)
+{
+    char key[VALUE_KEY_MAX];
+    size_t length = 0;
+    if (!value_tree_key(ctx, node, key, sizeof(key), &length)) {
+        return;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < ctx->hoist_count && slot < 0; i++) {
+        if (ctx->hoists[i].loop == loop_index && strcmp(ctx->hoists[i].key, key) == 0) {
+            slot = ctx->hoists[i].slot;
+        }
+    }
+
+    LoopHoist* hoists = realloc(ctx->hoists, sizeof(LoopHoist) * (ctx->hoist_count + 1));
+    if (!hoists) {
+        return;
+    }
+    ctx->hoists = hoists;
+
+    LoopHoist* hoist = &ctx->hoists[ctx->hoist_count++];
+    hoist->node = node;
+    hoist->key = strdup(key);
+    hoist->loop = loop_index;
+    hoist->emit = slot < 0;
+    hoist->slot = slot >= 0 ? slot : get_temp_slot(ctx, "licm", (*next_temp)++);
+}
+
+// Hoists the largest invariant subtrees; anything smaller than a binary
+// operation on two leaves costs more to reload than to recompute.
+static void collect_loop_hoists(CodegenContext* ctx,
+                                const SsaForm* form,
+                                const SsaBlock* block,
+                                const bool* in_loop,
+                                int loop_index,
+                                const OpNode* node,
+                                int* next_temp)
+{
+    if (!node || is_value_leaf(node) || find_hoisted_slot(ctx, node) >= 0) {
+        return;
+    }
+
+    if (value_tree_is_pure(node)
+        && value_tree_cost(node) >= LICM_MIN_COST
+        && value_tree_is_speculable(node)
+        && value_tree_is_invariant(ctx, form, block, in_loop, node)) {
+        add_loop_hoist(ctx, node, loop_index, next_temp);
+        return;
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        collect_loop_hoists(ctx, form, block, in_loop, loop_index, node->operands[i], next_temp);
+    }
+}
+
+// Outer loops are planned first so an expression invariant in several
+// nested loops is computed before the outermost of them. A loop whose header
+// is entered by fall-through from its own body gets no preheader.
+static void plan_loop_hoists(CodegenContext* ctx, const ControlFlowGraph* cfg, const SsaForm* form, const BlockLayout* layout)
+{
+    const LoopNest* nest = cfg->loop_nest;
+    if (!nest || nest->loop_count == 0 || !form) {
+        return;
+    }
+
+    bool* in_loop = malloc(sizeof(bool) * (form->block_count > 0 ? form->block_count : 1));
+    if (!in_loop) {
+        return;
+    }
+
+    int next_temp = 0;
+    for (int l = 0; l < nest->loop_count; l++) {
+        const CFGLoop* loop = &nest->loops[l];
+        int position = find_layout_position(layout, loop->header);
+        if (position <= 0 || loopContainsNode(loop, layout->order[position - 1])) {
+            continue;
+        }
+
+        memset(in_loop, 0, sizeof(bool) * form->block_count);
+        for (int i = 0; i < loop->block_count; i++) {
+            in_loop[findSsaBlockIndex(form, loop->blocks[i])] = true;
+        }
+        for (int i = 0; i < loop->block_count; i++) {
+            const SsaBlock* block = &form->blocks[findSsaBlockIndex(form, loop->blocks[i])];
+            for (int j = 0; j < block->node->stmt_count; j++) {
+                collect_loop_hoists(ctx, form, block, in_loop, l, block->node->statements[j], &next_temp);
+            }
+        }
+    }
+
+    free(in_loop);
+}
+
+typedef struct {
+    const SsaForm* form;
+    IndexRange* ranges;     // one per SSA version
+} RangeAnalysis;
+
+static IndexRange index_range_make(long long low, long long high)
+{
+    IndexRange range = { low, high };
+    if (range.low <= range.high) {
+        range.low = range.low < -INDEX_RANGE_LIMIT ? -INDEX_RANGE_LIMIT : range.low;
+        range.high = range.high > INDEX_RANGE_LIMIT ? INDEX_RANGE_LIMIT : range.high;
+    }
+    return range;
+}
+
+static IndexRange index_range_full(void)
+{
+    return index_range_make(-INDEX_RANGE_LIMIT, INDEX_RANGE_LIMIT);
+}
+
+static bool index_range_is_empty(IndexRange range)
+{
+    return range.low > range.high;
+}
+
+static IndexRange index_range_union(IndexRange a, IndexRange b)
+{
+    if (index_range_is_empty(a)) {
+        return b;
+    }
+    if (index_range_is_empty(b)) {
+        return a;
+    }
+    return index_range_make(a.low < b.low ? a.low : b.low, a.high > b.high ? a.high : b.high);
+}
+
+// Sums two ranges; an unbounded end stays unbounded instead of being offset
+// as if the sentinel were a real bound.
+static IndexRange index_range_add(IndexRange a, IndexRange b)
+{
+    long long low = a.low <= -INDEX_RANGE_LIMIT || b.low <= -INDEX_RANGE_LIMIT ? -INDEX_RANGE_LIMIT : a.low + b.low;
+    long long high = a.high >= INDEX_RANGE_LIMIT || b.high >= INDEX_RANGE_LIMIT ? INDEX_RANGE_LIMIT : a.high + b.high;
+    return index_range_make(low, high);
+}
+
+static IndexRange index_range_negate(IndexRange a)
+{
+    return index_range_make(-a.high, -a.low);
+}
+
+static IndexRange index_range_multiply(IndexRange a, IndexRange b)
+{
+    long long small = 1LL << 20;
+    if (a.low < -small || a.high > small || b.low < -small || b.high > small) {
+        return index_range_full();
+    }
+
+    long long products[4] = { a.low * b.low, a.low * b.high, a.high * b.low, a.high * b.high };
+    IndexRange range = { products[0], products[0] };
+    for (int i = 1; i < 4; i++) {
+        range.low = products[i] < range.low ? products[i] : range.low;
+        range.high = products[i] > range.high ? products[i] : range.high;
+    }
+    return index_range_make(range.low, range.high);
+}
+
+// Version a scalar leaf reads in block, or -1 for multi-slot and unknown leaves.
+static int find_read_version(const SsaBlock* block, const OpNode* leaf)
+{
+    int version = -1;
+    for (int i = 0; i < block->ref_count; i++) {
+        const SsaRef* ref = &block->refs[i];
+        if (ref->node == leaf && !ref->is_def) {
+            if (version >= 0) {
+                return -1;
+            }
+            version = ref->version;
+        }
+    }
+    return version;
+}
+
+static IndexRange refine_version_range(const RangeAnalysis* analysis, int block_index, int version, IndexRange range);
+
+static IndexRange eval_index_range(const RangeAnalysis* analysis, int block_index, const OpNode* node, bool refine)
+{
+    if (!node) {
+        return index_range_full();
+    }
+
+    const SsaBlock* block = &analysis->form->blocks[block_index];
+    int value = 0;
+    switch (node->type) {
+        case OP_LITERAL:
+            return parse_int_literal(node->text, &value) ? index_range_make(value, value) : index_range_full();
+        case OP_IDENTIFIER:
+        case OP_MEMBER_ACCESS: {
+            int version = find_read_version(block, node);
+            if (version < 0) {
+                return index_range_full();
             }
-            return false;
+            IndexRange range = analysis->ranges[version];
+            return refine ? refine_version_range(analysis, block_index, version, range) : range;
+        }
+        case OP_UNARY_PLUS:
+            return node->operand_count > 0 ? eval_index_range(analysis, block_index, node->operands[0], refine)
+                                           : index_range_full();
+        case OP_UNARY_MINUS: {
+            IndexRange operand = node->operand_count > 0
+                ? eval_index_range(analysis, block_index, node->operands[0], refine)
+                : index_range_full();
+            return index_range_is_empty(operand) ? operand : index_range_negate(operand);
         }
         case OP_ADDITION:
-            return emit_binary_left_fold(ctx, node, "add");
         case OP_SUBTRACTION:
-            return emit_binary_left_fold(ctx, node, "sub");
-        case OP_MULTIPLICATION:
-            return emit_binary_left_fold(ctx, node, "mul");
-        case OP_DIVISION:
-            return emit_binary_left_fold(ctx, node, "div");
-        case OP_MODULO:
-            return emit_binary_left_fold(ctx, node, "mod");
-        case OP_LOGICAL_AND:
-            return emit_binary_left_fold(ctx, node, "and");
-        case OP_LOGICAL_OR:
-            return emit_binary_left_fold(ctx, node, "or");
-        case OP_EQUAL:
-            return emit_binary_left_fold(ctx, node, "eq");
-        case OP_NOT_EQUAL:
-            return emit_binary_left_fold(ctx, node, "ne");
-        case OP_LESS_THAN:
-            return emit_binary_left_fold(ctx, node, "lt");
-        case OP_LESS_THAN_OR_EQUAL:
-            return emit_binary_left_fold(ctx, node, "le");
-        case OP_GREATER_THAN:
-            return emit_binary_left_fold(ctx, node, "gt");
-        case OP_GREATER_THAN_OR_EQUAL:
-            return emit_binary_left_fold(ctx, node, "ge");
-        case OP_UNARY_PLUS: {
-            if (node->operand_count > 0) {
-                return emit_expression(ctx, node->operands[0]);
+        case OP_MULTIPLICATION: {
+            if (node->operand_count == 0) {
+                return index_range_full();
             }
-            return false;
-        }
-        case OP_UNARY_MINUS: {
-            if (node->operand_count > 0) {
-                emit_instruction1(ctx, "pushi", "0");
-                emit_expression(ctx, node->operands[0]);
-                emit_instruction(ctx, "sub", 0, NULL);
-                return true;
+            IndexRange range = eval_index_range(analysis, block_index, node->operands[0], refine);
+            for (int i = 1; i < node->operand_count && !index_range_is_empty(range); i++) {
+                IndexRange operand = eval_index_range(analysis, block_index, node->operands[i], refine);
+                if (index_range_is_empty(operand)) {
+                    return operand;
+                }
+                if (node->type == OP_ADDITION) {
+                    range = index_range_add(range, operand);
+                } else if (node->type == OP_SUBTRACTION) {
+                    range = index_range_add(range, index_range_negate(operand));
+                } else {
+                    range = index_range_multiply(range, operand);
+                }
             }
-            return false;
+            return range;
         }
-        case OP_LOGICAL_NOT: {
-            if (node->operand_count > 0) {
-                emit_expression(ctx, node->operands[0]);
-                emit_instruction1(ctx, "pushi", "0");
-                emit_instruction(ctx, "eq", 0, NULL);
-                return true;
+        case OP_DIVISION:
+        case OP_MODULO: {
+            const OpNode* divisor = node->operand_count == 2 ? node->operands[1] : NULL;
+            if (!divisor || divisor->type != OP_LITERAL || !parse_int_literal(divisor->text, &value) || value <= 0) {
+                return index_range_full();
             }
-            return false;
-        }
-        case OP_FUNCTION_CALL:
-            return emit_function_call(ctx, node);
-        case OP_MEMBER_CALL:
-            return emit_member_call(ctx, node);
-        case OP_ARRAY_INDEX:
-        case OP_UNKNOWN:
-        default: {
-            bool result = false;
-            for (int i = 0; i < node->operand_count; i++) {
-                bool has_value = emit_expression(ctx, node->operands[i]);
-                if (i < node->operand_count - 1 && has_value) {
-                    emit_instruction(ctx, "pop", 0, NULL);
-                }
-                result = has_value;
+            IndexRange range = eval_index_range(analysis, block_index, node->operands[0], refine);
+            if (index_range_is_empty(range)) {
+                return range;
             }
-            if (node->operand_count == 0) {
-                emit_instruction1(ctx, "pushi", "0");
-                result = true;
+            // Division truncates towards zero and the remainder takes the dividend's sign.
+            if (node->type == OP_DIVISION) {
+                return index_range_make(range.low <= -INDEX_RANGE_LIMIT ? -INDEX_RANGE_LIMIT : range.low / value,
+                                        range.high >= INDEX_RANGE_LIMIT ? INDEX_RANGE_LIMIT : range.high / value);
             }
-            return result;
+            if (range.low >= 0 && range.high < value) {
+                return range;
+            }
+            return index_range_make(range.low >= 0 ? 0 : -(value - 1), range.high <= 0 ? 0 : value - 1);
         }
+        default:
+            return index_range_full();
     }
 }
 
-static void emit_statement(CodegenContext* ctx, const OpNode* node)
+// Matches `leaf`, `leaf + literal` and `leaf - literal` reading version.
+static bool match_offset_leaf(const SsaBlock* block, const OpNode* node, int version, long long* offset)
 {
-    if (!ctx || !node || ctx->has_error) {
-        return;
+    int literal = 0;
+    if (node && (node->type == OP_IDENTIFIER || node->type == OP_MEMBER_ACCESS)) {
+        *offset = 0;
+        return find_read_version(block, node) == version;
+    }
+    if (!node || (node->type != OP_ADDITION && node->type != OP_SUBTRACTION) || node->operand_count != 2) {
+        return false;
     }
 
-    if (node->type == OP_ASSIGNMENT) {
-        emit_expression(ctx, node);
-        return;
+    const OpNode* left = node->operands[0];
+    const OpNode* right = node->operands[1];
+    if (right && right->type == OP_LITERAL && parse_int_literal(right->text, &literal)
+        && match_offset_leaf(block, left, version, offset) && *offset == 0) {
+        *offset = node->type == OP_ADDITION ? literal : -(long long)literal;
+        return true;
     }
+    if (node->type == OP_ADDITION && left && left->type == OP_LITERAL && parse_int_literal(left->text, &literal)
+        && match_offset_leaf(block, right, version, offset) && *offset == 0) {
+        *offset = literal;
+        return true;
+    }
+    return false;
+}
 
-    bool has_value = emit_expression(ctx, node);
-    if (has_value) {
-        emit_instruction(ctx, "pop", 0, NULL);
+// Matches `leaf - other` (subtracted false) and `other - leaf` (subtracted
+// true), where leaf is a match_offset_leaf form, such as the `bound - i` span
+// of a partially unrolled loop's guard.
+static bool match_leaf_difference(const SsaBlock* block,
+                                  const OpNode* node,
+                                  int version,
+                                  long long* offset,
+                                  const OpNode** other,
+                                  bool* subtracted)
+{
+    if (!node || node->type != OP_SUBTRACTION || node->operand_count != 2) {
+        return false;
+    }
+    if (match_offset_leaf(block, node->operands[0], version, offset)) {
+        *other = node->operands[1];
+        *subtracted = false;
+        return true;
+    }
+    if (match_offset_leaf(block, node->operands[1], version, offset)) {
+        *other = node->operands[0];
+        *subtracted = true;
+        return true;
     }
+    return false;
 }
 
-static int find_node_start(NodeEntry* entries, int count, CFGNode* target)
+// Narrows range by what condition, evaluated in block_index, says about
+// version when its outcome is holds.
+static IndexRange apply_condition(const RangeAnalysis* analysis,
+                                  int block_index,
+                                  const OpNode* condition,
+                                  bool holds,
+                                  int version,
+                                  IndexRange range)
 {
-    for (int i = 0; i < count; i++) {
-        if (entries[i].node == target) {
-            return entries[i].start_index;
+    if (!condition) {
+        return range;
+    }
+
+    if (condition->type == OP_LOGICAL_NOT && condition->operand_count > 0) {
+        return apply_condition(analysis, block_index, condition->operands[0], !holds, version, range);
+    }
+    if ((condition->type == OP_LOGICAL_AND && holds) || (condition->type == OP_LOGICAL_OR && !holds)) {
+        for (int i = 0; i < condition->operand_count; i++) {
+            range = apply_condition(analysis, block_index, condition->operands[i], holds, version, range);
         }
+        return range;
     }
-    return -1;
+
+    OpType relation = holds ? condition->type : negate_relation(condition->type);
+    if (condition->operand_count != 2 || relation == OP_UNKNOWN || relation == OP_NOT_EQUAL) {
+        return range;
+    }
+
+    const SsaBlock* block = &analysis->form->blocks[block_index];
+    long long offset = 0;
+    IndexRange bound;
+    int side = 0;
+    const OpNode* difference_other = NULL;
+    bool subtracted = false;
+    if (match_offset_leaf(block, condition->operands[0], version, &offset)) {
+        bound = eval_index_range(analysis, block_index, condition->operands[1], false);
+    } else if (match_offset_leaf(block, condition->operands[1], version, &offset)) {
+        relation = swap_relation(relation);
+        bound = eval_index_range(analysis, block_index, condition->operands[0], false);
+    } else {
+        if (match_leaf_difference(block, condition->operands[0], version, &offset, &difference_other, &subtracted)) {
+            side = 0;
+        } else if (match_leaf_difference(block, condition->operands[1], version, &offset, &difference_other, &subtracted)) {
+            side = 1;
+            relation = swap_relation(relation);
+        } else {
+            return range;
+        }
+
+        // leaf - d REL c is leaf REL d + c; d - leaf REL c is leaf (swapped REL) d - c.
+        IndexRange compared = eval_index_range(analysis, block_index, condition->operands[1 - side], false);
+        IndexRange operand = eval_index_range(analysis, block_index, difference_other, false);
+        if (index_range_is_empty(compared) || index_range_is_empty(operand)) {
+            return range;
+        }
+        if (subtracted) {
+            relation = swap_relation(relation);
+            bound = index_range_add(operand, index_range_negate(compared));
+        } else {
+            bound = index_range_add(operand, compared);
+        }
+    }
+    if (index_range_is_empty(bound)) {
+        return range;
+    }
+
+    long long low = range.low;
+    long long high = range.high;
+    switch (relation) {
+        case OP_LESS_THAN:             high = bound.high - 1 - offset; break;
+        case OP_LESS_THAN_OR_EQUAL:    high = bound.high - offset; break;
+        case OP_GREATER_THAN:          low = bound.low + 1 - offset; break;
+        case OP_GREATER_THAN_OR_EQUAL: low = bound.low - offset; break;
+        case OP_EQUAL:                 low = bound.low - offset; high = bound.high - offset; break;
+        default:                       break;
+    }
+    if (bound.high >= INDEX_RANGE_LIMIT) {
+        high = range.high;
+    }
+    if (bound.low <= -INDEX_RANGE_LIMIT) {
+        low = range.low;
+    }
+    return index_range_make(low > range.low ? low : range.low, high < range.high ? high : range.high);
 }
 
-static bool has_incoming_if_true_edge(const ControlFlowGraph* cfg, const CFGNode* node)
+// A block whose only predecessor is a branch sees that branch's outcome, and
+// so does every block it dominates; the dominator chain collects them all.
+static IndexRange refine_version_range(const RangeAnalysis* analysis, int block_index, int version, IndexRange range)
 {
-    if (!cfg || !node) {
+    const SsaForm* form = analysis->form;
+    for (int b = block_index; b >= 0 && !index_range_is_empty(range); b = form->blocks[b].idom) {
+        const SsaBlock* block = &form->blocks[b];
+        if (block->pred_count != 1) {
+            continue;
+        }
+
+        int branch_index = block->preds[0];
+        const CFGNode* branch = form->blocks[branch_index].node;
+        if (!is_conditional_node(branch) || branch->stmt_count == 0 || branch->nextConditional == branch->nextDefault) {
+            continue;
+        }
+
+        bool holds = branch->nextConditional == block->node;
+        range = apply_condition(analysis, branch_index, branch->statements[branch->stmt_count - 1], holds, version, range);
+    }
+    return range;
+}
+
+static bool update_version_range(RangeAnalysis* analysis, int version, IndexRange range, int pass, bool narrowing)
+{
+    IndexRange old = analysis->ranges[version];
+    IndexRange next = narrowing ? range : index_range_union(old, range);
+    if (!narrowing && pass >= INDEX_RANGE_WIDEN_PASS && !index_range_is_empty(old)) {
+        next.low = next.low < old.low ? -INDEX_RANGE_LIMIT : next.low;
+        next.high = next.high > old.high ? INDEX_RANGE_LIMIT : next.high;
+    }
+    if (next.low == old.low && next.high == old.high) {
         return false;
     }
+    analysis->ranges[version] = next;
+    return true;
+}
 
-    for (int i = 0; i < cfg->edge_count; i++) {
-        CFGEdge* edge = cfg->edges[i];
-        if (!edge || edge->to != node) {
-            continue;
+// One sweep over phis and definitions in dominator order.
+static bool sweep_version_ranges(RangeAnalysis* analysis, int pass, bool narrowing)
+{
+    const SsaForm* form = analysis->form;
+    bool changed = false;
+    for (int p = 0; p < form->reachable_count; p++) {
+        int b = form->dom_preorder[p];
+        const SsaBlock* block = &form->blocks[b];
+
+        for (int i = 0; i < block->phi_count; i++) {
+            const SsaPhi* phi = &block->phis[i];
+            IndexRange range = index_range_make(1, 0);
+            for (int a = 0; a < phi->arg_count; a++) {
+                range = index_range_union(range, phi->args[a] >= 0 ? analysis->ranges[phi->args[a]] : index_range_full());
+            }
+            changed |= update_version_range(analysis, phi->result, range, pass, narrowing);
         }
 
-        if (edge->type == EDGE_TRUE && edge->from && edge->from->type == NODE_IF) {
+        for (int i = 0; i < block->ref_count; i++) {
+            const SsaRef* ref = &block->refs[i];
+            if (!ref->is_def || ref->version < 0) {
+                continue;
+            }
+
+            int def_count = 0;
+            for (int j = 0; j < block->ref_count; j++) {
+                def_count += block->refs[j].is_def && block->refs[j].node == ref->node;
+            }
+            const OpNode* assignment = ref->node;
+            const OpNode* target = assignment->operand_count == 2 ? assignment->operands[0] : NULL;
+            bool scalar = def_count == 1 && target && (target->type == OP_IDENTIFIER || target->type == OP_MEMBER_ACCESS);
+            IndexRange range = scalar ? eval_index_range(analysis, b, assignment->operands[1], true) : index_range_full();
+            changed |= update_version_range(analysis, ref->version, range, pass, narrowing);
+        }
+    }
+    return changed;
+}
+
+static bool is_dynamic_index(const OpNode* node)
+{
+    return node->type == OP_ARRAY_INDEX && node->operand_count == 2
+        && (!node->operands[1] || node->operands[1]->type != OP_LITERAL);
+}
+
+static bool op_tree_has_dynamic_index(const OpNode* node)
+{
+    if (!node) {
+        return false;
+    }
+    if (is_dynamic_index(node)) {
+        return true;
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        if (op_tree_has_dynamic_index(node->operands[i])) {
             return true;
         }
     }
+    return false;
+}
 
+static bool cfg_has_dynamic_index(const ControlFlowGraph* cfg)
+{
+    for (int i = 0; i < cfg->node_count; i++) {
+        const CFGNode* node = cfg->nodes[i];
+        for (int j = 0; j < node->stmt_count; j++) {
+            if (op_tree_has_dynamic_index(node->statements[j])) {
+                return true;
+            }
+        }
+    }
     return false;
 }
 
-static void emit_jump(CodegenContext* ctx, JumpPatchList* patches, const char* mnemonic, CFGNode* target)
+static void collect_unchecked_indexes(CodegenContext* ctx, const RangeAnalysis* analysis, int block_index, const OpNode* node)
 {
-    if (!ctx || !patches || !mnemonic || !target) {
+    if (!node) {
         return;
     }
 
-    const char* placeholder = "0";
-    int instr_index = emit_instruction1(ctx, mnemonic, placeholder);
-    jump_patch_list_add(patches, instr_index, 0, target);
+    for (int i = 0; i < node->operand_count; i++) {
+        collect_unchecked_indexes(ctx, analysis, block_index, node->operands[i]);
+    }
+
+    int length = 0;
+    int dimensions = 0;
+    if (!is_dynamic_index(node)
+        || !getArrayTypeShape(node->operands[0] ? node->operands[0]->resolved_type : NULL, &length, &dimensions, NULL)
+        || dimensions != 1) {
+        return;
+    }
+
+    IndexRange range = eval_index_range(analysis, block_index, node->operands[1], true);
+    if (index_range_is_empty(range) || range.low < 0 || range.high >= length) {
+        return;
+    }
+
+    const OpNode** indexes = realloc((void*)ctx->unchecked_indexes, sizeof(OpNode*) * (ctx->unchecked_index_count + 1));
+    if (indexes) {
+        ctx->unchecked_indexes = indexes;
+        ctx->unchecked_indexes[ctx->unchecked_index_count++] = node;
+    }
 }
 
-static void emit_node(CodegenContext* ctx, CFGNode* node, JumpPatchList* patches)
+// Interval analysis over SSA versions. Definitions and phis are iterated to
+// a fixpoint, widened after a few sweeps and narrowed twice afterwards. Each
+// read is intersected with the branch outcomes that dominate it, which is
+// what bounds a loop counter inside its loop. Element accesses whose index
+// range lies inside the array skip the run-time check.
+static void plan_index_checks(CodegenContext* ctx, const ControlFlowGraph* cfg, const SsaForm* form)
 {
-    if (!ctx || !node || ctx->has_error) {
+    if (!form || !cfg_has_dynamic_index(cfg)) {
         return;
     }
 
-    bool is_conditional = node->type == NODE_IF
-        || node->type == NODE_WHILE
-        || node->type == NODE_REPEAT_CONDITION;
+    RangeAnalysis analysis = { form, malloc(sizeof(IndexRange) * (form->version_count > 0 ? form->version_count : 1)) };
+    if (!analysis.ranges) {
+        return;
+    }
 
-    if (node->type == NODE_ENTRY && ctx->method_returns_value && !ctx->is_main_method) {
-        emit_instruction1(ctx, "pushi", "0");
-        emit_indexed_instruction(ctx, "stg", RUNTIME_RETVAL_SLOT);
+    for (int v = 0; v < form->version_count; v++) {
+        analysis.ranges[v] = v < form->slot_count ? index_range_full() : index_range_make(1, 0);
     }
 
-    if (node->type == NODE_EXIT) {
-        if (ctx->is_main_method) {
-            emit_instruction(ctx, "halt", 0, NULL);
-        } else {
-            emit_instruction1(ctx, "jmp", RUNTIME_DISPATCH_LABEL);
+    int pass = 0;
+    while (pass < INDEX_RANGE_MAX_PASSES && sweep_version_ranges(&analysis, pass, false)) {
+        pass++;
+    }
+    if (pass == INDEX_RANGE_MAX_PASSES) {
+        free(analysis.ranges);
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        sweep_version_ranges(&analysis, pass, true);
+    }
+
+    for (int p = 0; p < form->reachable_count; p++) {
+        int b = form->dom_preorder[p];
+        const CFGNode* node = form->blocks[b].node;
+        for (int j = 0; j < node->stmt_count; j++) {
+            collect_unchecked_indexes(ctx, &analysis, b, node->statements[j]);
         }
+    }
+    free(analysis.ranges);
+}
+
+// Leaves SSA form before emission. Every version is kept in its variable's
+// own slot, so each phi copy is slot-to-itself and destructSsaForm returns no
+// edges; an edge with real copies would need a block the layout never made.
+static void destruct_ssa(CodegenContext* ctx, const SsaForm* form)
+{
+    if (!form) {
         return;
     }
 
-    if (is_conditional) {
-        for (int i = 0; i < node->stmt_count; i++) {
-            bool has_value = emit_expression(ctx, node->statements[i]);
-            if (i < node->stmt_count - 1 && has_value) {
-                emit_instruction(ctx, "pop", 0, NULL);
-            }
+    int edge_count = 0;
+    SsaEdgeCopies* edges = destructSsaForm(form, ctx->var_count, &edge_count);
+    if (edge_count > 0) {
+        set_codegen_error(ctx, "SSA destruction produced phi copies the emitter cannot place.");
+    }
+    freeSsaEdgeCopies(edges, edge_count);
+}
+
+static int find_hoisting_loop(const CodegenContext* ctx, const LoopNest* nest, const CFGNode* header)
+{
+    for (int i = 0; nest && i < ctx->hoist_count; i++) {
+        if (nest->loops[ctx->hoists[i].loop].header == header) {
+            return ctx->hoists[i].loop;
         }
+    }
+    return -1;
+}
 
-        if (node->nextConditional && node->nextDefault) {
-            emit_jump(ctx, patches, "jz", node->nextDefault);
-            emit_jump(ctx, patches, "jmp", node->nextConditional);
-        } else if (node->nextConditional) {
-            emit_jump(ctx, patches, "jnz", node->nextConditional);
-        } else if (node->nextDefault) {
-            emit_jump(ctx, patches, "jmp", node->nextDefault);
+static void emit_loop_preheader(CodegenContext* ctx, int loop_index)
+{
+    ValueTable* saved_values = ctx->value_table;
+    ctx->value_table = NULL;
+    for (int i = 0; i < ctx->hoist_count; i++) {
+        const LoopHoist* hoist = &ctx->hoists[i];
+        if (hoist->loop == loop_index && hoist->emit) {
+            emit_expression_tree(ctx, hoist->node);
+            emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, hoist->slot);
         }
+    }
+    ctx->value_table = saved_values;
+}
 
+static void emit_cfg_body(CodegenContext* ctx, const ControlFlowGraph* cfg)
+{
+    if (!ctx || !cfg || ctx->has_error) {
         return;
     }
 
-    bool tail_returns = ctx->method_returns_value
-        && node->stmt_count > 0
-        && node->nextDefault
-        && node->nextDefault->type == NODE_EXIT
-        && !node->nextConditional;
-    int statement_count = tail_returns ? node->stmt_count - 1 : node->stmt_count;
-
-    for (int i = 0; i < statement_count; i++) {
-        emit_statement(ctx, node->statements[i]);
+    NodeEntry* entries = malloc(sizeof(NodeEntry) * (cfg->node_count > 0 ? cfg->node_count : 1));
+    if (!entries) {
+        set_codegen_error(ctx, "Out of memory while allocating CFG node table.");
+        return;
+    }
+    BlockLayout layout;
+    if (!build_block_layout(cfg, &layout)) {
+        set_codegen_error(ctx, "Out of memory while computing CFG block layout.");
+        free(entries);
+        return;
     }
 
-    if (tail_returns) {
-        bool has_value = emit_expression(ctx, node->statements[node->stmt_count - 1]);
-        if (!has_value) {
-            emit_instruction1(ctx, "pushi", "0");
+    JumpPatchList patches;
+    jump_patch_list_init(&patches);
+
+    // Hoists and unchecked indexes are keyed by node, so an inlined body
+    // plans its own.
+    LoopHoist* saved_hoists = ctx->hoists;
+    int saved_hoist_count = ctx->hoist_count;
+    const OpNode** saved_unchecked = ctx->unchecked_indexes;
+    int saved_unchecked_count = ctx->unchecked_index_count;
+    ctx->hoists = NULL;
+    ctx->hoist_count = 0;
+    ctx->unchecked_indexes = NULL;
+    ctx->unchecked_index_count = 0;
+    SwitchChain* saved_switches = ctx->switches;
+    int saved_switch_count = ctx->switch_count;
+    ctx->switches = NULL;
+    ctx->switch_count = 0;
+    plan_switch_chains(ctx, &layout);
+
+    SsaForm* form = (cfg->loop_nest && cfg->loop_nest->loop_count > 0) || cfg_has_dynamic_index(cfg)
+        ? buildSsaForm(cfg, ctx->var_count, resolve_ssa_slots, ctx)
+        : NULL;
+    plan_loop_hoists(ctx, cfg, form, &layout);
+    plan_index_checks(ctx, cfg, form);
+    destruct_ssa(ctx, form);
+    freeSsaForm(form);
+
+    const LoopNest* nest = cfg->loop_nest;
+    int* preheader_starts = malloc(sizeof(int) * (nest && nest->loop_count > 0 ? nest->loop_count : 1));
+    for (int i = 0; preheader_starts && nest && i < nest->loop_count; i++) {
+        preheader_starts[i] = -1;
+    }
+
+    for (int i = 0; i < layout.count; i++) {
+        int loop_index = preheader_starts ? find_hoisting_loop(ctx, nest, layout.order[i]) : -1;
+        if (loop_index >= 0) {
+            mark_jump_target(ctx);
+            preheader_starts[loop_index] = ctx->instructions.count;
+            emit_loop_preheader(ctx, loop_index);
+        }
+
+        int first_patch = patches.count;
+        mark_jump_target(ctx);
+        entries[i].node = layout.order[i];
+        entries[i].start_index = ctx->instructions.count;
+        emit_node(ctx, layout.order[i], &patches, &layout, i);
+        record_image_block(ctx, nest, layout.order[i], entries[i].start_index);
+        for (int p = first_patch; p < patches.count; p++) {
+            patches.items[p].source = layout.order[i];
+        }
+        if (ctx->has_error) {
+            break;
         }
-        emit_indexed_instruction(ctx, "stg", RUNTIME_RETVAL_SLOT);
     }
 
-    if (ctx->halt_if_true_branch && has_incoming_if_true_edge(ctx->info ? ctx->info->cfg : NULL, node)) {
-        emit_instruction(ctx, "halt", 0, NULL);
-        return;
+    if (!ctx->has_error) {
+        for (int i = 0; i < patches.count; i++) {
+            JumpPatch* patch = &patches.items[i];
+            int target_position = find_layout_position(&layout, patch->target);
+            int target_index = target_position >= 0 ? entries[target_position].start_index : 0;
+
+            // Entries into a loop run its preheader; back edges skip it.
+            int loop_index = preheader_starts ? find_hoisting_loop(ctx, nest, patch->target) : -1;
+            if (loop_index >= 0 && preheader_starts[loop_index] >= 0
+                && !loopContainsNode(&nest->loops[loop_index], patch->source)) {
+                target_index = preheader_starts[loop_index];
+            }
+
+            Instruction* instr = &ctx->instructions.items[patch->instr_index];
+            if (patch->operand_index < instr->operand_count) {
+                free(instr->operands[patch->operand_index]);
+                instr->operands[patch->operand_index] = format_int(target_index);
+            }
+        }
     }
 
-    if (node->nextDefault) {
-        emit_jump(ctx, patches, "jmp", node->nextDefault);
-    } else if (node->nextConditional) {
-        emit_jump(ctx, patches, "jmp", node->nextConditional);
+    for (int i = 0; i < ctx->hoist_count; i++) {
+        free(ctx->hoists[i].key);
     }
+    free(ctx->hoists);
+    ctx->hoists = saved_hoists;
+    ctx->hoist_count = saved_hoist_count;
+    free((void*)ctx->unchecked_indexes);
+    ctx->unchecked_indexes = saved_unchecked;
+    ctx->unchecked_index_count = saved_unchecked_count;
+    free_switch_chains(ctx);
+    ctx->switches = saved_switches;
+    ctx->switch_count = saved_switch_count;
+
+    free(preheader_starts);
+    free(entries);
+    free_block_layout(&layout);
+    free(patches.items);
+}
+
+// Zero-byte label of line-table entry index; LINE_INFO names it again.
+static void format_line_label(char* buffer, size_t size, const char* entry, int index)
+{
+    snprintf(buffer, size, "%s_S%d", entry, index + 1);
 }
 
 void printSubprogramImage(const SubprogramImage* image, const char* entry_label, FILE* out)
@@ -1467,14 +4545,18 @@ void printSubprogramImage(const SubprogramImage* image, const char* entry_label,
         return;
     }
 
+    // The jmps after a jmpt form its table and keep their size even when
+    // one of them targets the next instruction.
+    bool in_table = false;
     for (int i = 0; i < count; i++) {
         const Instruction* instr = &image->instructions[i];
-        if (!instr || !equals_ignore_case(instr->mnemonic, "jmp") || instr->operand_count != 1) {
+        if (!instr || !equals_ignore_case(instr->mnemonic, MYVM_MNEMONIC_JMP) || instr->operand_count != 1) {
+            in_table = instr && equals_ignore_case(instr->mnemonic, MYVM_MNEMONIC_JMPT);
             continue;
         }
 
         int target = 0;
-        if (parse_index_operand(instr->operands[0], &target) && target == i + 1) {
+        if (!in_table && parse_index_operand(instr->operands[0], &target) && target == i + 1) {
             skip_jump[i] = true;
         }
     }
@@ -1512,10 +4594,16 @@ void printSubprogramImage(const SubprogramImage* image, const char* entry_label,
     }
 
     fprintf(out, "%s:\n", entry);
+    int next_line = 0;
     for (int i = 0; i < count; i++) {
         if (i != 0 && label_names[i]) {
             fprintf(out, "%s:\n", label_names[i]);
         }
+        while (next_line < image->line_count && image->lines[next_line].first_instruction <= i) {
+            char line_label[128];
+            format_line_label(line_label, sizeof(line_label), entry, next_line++);
+            fprintf(out, "%s:\n", line_label);
+        }
 
         if (skip_jump[i]) {
             continue;
@@ -1577,14 +4665,70 @@ void freeSubprogramImage(SubprogramImage* image)
             free(image->data_items[i].value.literal_name);
         }
     }
-    free(image->data_items);
-
-    free(image);
+    free(image->data_items);
+    free(image->blocks);
+    free(image->call_sites);
+    free(image->lines);
+
+    free(image);
+}
+
+// Loads the receiver fields the body read into its `this.*` slots. The loads
+// are emitted last and rotated to the front, shifting every jump target.
+static void emit_receiver_prologue(CodegenContext* ctx)
+{
+    mark_jump_target(ctx);
+    int body_count = ctx->instructions.count;
+    for (int i = 0; i < ctx->receiver_slot_count; i++) {
+        if (!ctx->receiver_slot_used[i]) {
+            continue;
+        }
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDG, RECEIVER_REF_SLOT);
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_LDGI, i);
+        emit_indexed_instruction(ctx, MYVM_MNEMONIC_STG, ctx->receiver_first_slot + i);
+    }
+
+    int prologue_count = ctx->instructions.count - body_count;
+    if (prologue_count == 0) {
+        return;
+    }
+
+    Instruction* items = ctx->instructions.items;
+    Instruction* prologue = malloc(sizeof(Instruction) * prologue_count);
+    if (!prologue) {
+        set_codegen_error(ctx, "Out of memory while emitting receiver prologue.");
+        return;
+    }
+    memcpy(prologue, items + body_count, sizeof(Instruction) * prologue_count);
+    memmove(items + prologue_count, items, sizeof(Instruction) * body_count);
+    memcpy(items, prologue, sizeof(Instruction) * prologue_count);
+    free(prologue);
+
+    for (int i = 0; i < ctx->block_count; i++) {
+        ctx->blocks[i].first_instruction += prologue_count;
+    }
+    for (int i = 0; i < ctx->call_site_count; i++) {
+        ctx->call_sites[i].jump_instruction += prologue_count;
+    }
+    for (int i = 0; i < ctx->line_count; i++) {
+        ctx->lines[i].first_instruction += prologue_count;
+    }
+    for (int i = prologue_count; i < ctx->instructions.count; i++) {
+        Instruction* instr = &items[i];
+        int target = 0;
+        if (is_jump_mnemonic(instr->mnemonic) && instr->operand_count > 0
+            && parse_index_operand(instr->operands[0], &target)) {
+            free(instr->operands[0]);
+            instr->operands[0] = format_int(target + prologue_count);
+        }
+    }
 }
 
 static SubprogramImage* toAsmModuleInternal(const SubprogramInfo* info,
                                             const SubprogramCollection* subprograms,
+                                            const CallGraph* call_graph,
                                             ReturnSiteList* return_sites,
+                                            ProfileCounterList* profile_counters,
                                             bool is_main_method,
                                             bool halt_if_true_branch,
                                             char** error_message)
@@ -1604,7 +4748,10 @@ static SubprogramImage* toAsmModuleInternal(const SubprogramInfo* info,
     memset(&ctx, 0, sizeof(ctx));
     ctx.info = info;
     ctx.subprograms = subprograms;
+    ctx.call_graph = call_graph;
     ctx.return_sites = return_sites;
+    ctx.profile_counters = profile_counters;
+    ctx.first_profile_counter = profile_counters ? profile_counters->count : 0;
     ctx.is_main_method = is_main_method;
     ctx.method_returns_value = subprogram_returns_value(info);
     ctx.halt_if_true_branch = halt_if_true_branch;
@@ -1620,7 +4767,10 @@ static SubprogramImage* toAsmModuleInternal(const SubprogramInfo* info,
         return NULL;
     }
 
-    if (info->owner_type_name) {
+    ctx.receiver_by_ref = !is_main_method && passes_receiver_by_reference(subprograms, info);
+    if (ctx.receiver_by_ref) {
+        append_codegen_slot(&ctx, "this$ref", "int");
+    } else if (info->owner_type_name) {
         append_flattened_slots(&ctx, "this", info->owner_type_name);
     }
     for (int i = 0; i < info->param_count; i++) {
@@ -1633,36 +4783,30 @@ static SubprogramImage* toAsmModuleInternal(const SubprogramInfo* info,
                                info->local_names && info->local_names[i] ? info->local_names[i] : "local",
                                info->local_types && info->local_types[i] ? info->local_types[i] : "int");
     }
-
-    ControlFlowGraph* cfg = info->cfg;
-    NodeEntry* entries = malloc(sizeof(NodeEntry) * cfg->node_count);
-    if (!entries) {
-        if (error_message) {
-            *error_message = strdup("Out of memory while allocating CFG node table.");
-        }
-        free(ctx.var_names);
-        free(ctx.var_types);
-        free(ctx.data_items.items);
-        return NULL;
+    if (ctx.receiver_by_ref) {
+        ctx.receiver_first_slot = ctx.var_count;
+        append_flattened_slots(&ctx, "this", info->owner_type_name);
+        ctx.receiver_slot_count = ctx.var_count - ctx.receiver_first_slot;
+        ctx.receiver_slot_used = calloc(ctx.receiver_slot_count, sizeof(bool));
+    }
+    if (profile_counters && ctx.var_count > PROFILE_FIRST_SLOT) {
+        set_codegen_error(&ctx, "Method slots overlap the profiling counters.");
     }
-    JumpPatchList patches;
-    jump_patch_list_init(&patches);
 
-    for (int i = 0; i < cfg->node_count; i++) {
-        entries[i].node = cfg->nodes[i];
-        entries[i].start_index = ctx.instructions.count;
-        emit_node(&ctx, cfg->nodes[i], &patches);
-        if (ctx.has_error) {
-            break;
-        }
+    emit_cfg_body(&ctx, info->cfg);
+    if (ctx.receiver_by_ref && !ctx.has_error) {
+        emit_receiver_prologue(&ctx);
+    }
+    // Emission adds slots of its own (cse/licm temps, inlined callees), so check again.
+    if (profile_counters && !ctx.has_error && ctx.var_count > PROFILE_FIRST_SLOT) {
+        set_codegen_error(&ctx, "Method slots overlap the profiling counters.");
     }
+    free(ctx.receiver_slot_used);
 
     if (ctx.has_error) {
         if (error_message) {
             *error_message = strdup(ctx.error_message[0] ? ctx.error_message : "ASM generation failed.");
         }
-        free(entries);
-        free(patches.items);
         for (int i = 0; i < ctx.var_count; i++) {
             free((void*)ctx.var_names[i]);
             free((void*)ctx.var_types[i]);
@@ -1678,31 +4822,28 @@ static SubprogramImage* toAsmModuleInternal(const SubprogramInfo* info,
         }
         free(ctx.instructions.items);
         free(ctx.data_items.items);
+        free(ctx.blocks);
+        free(ctx.call_sites);
+        free(ctx.lines);
         return NULL;
     }
 
-    for (int i = 0; i < patches.count; i++) {
-        JumpPatch* patch = &patches.items[i];
-        int target_index = find_node_start(entries, cfg->node_count, patch->target);
-        if (target_index < 0) {
-            target_index = 0;
-        }
-
-        Instruction* instr = &ctx.instructions.items[patch->instr_index];
-        if (patch->operand_index < instr->operand_count) {
-            free(instr->operands[patch->operand_index]);
-            instr->operands[patch->operand_index] = format_int(target_index);
-        }
-    }
-
     SubprogramImage* image = malloc(sizeof(SubprogramImage));
     image->data_items = ctx.data_items.items;
     image->data_item_count = ctx.data_items.count;
     image->instructions = ctx.instructions.items;
     image->instruction_count = ctx.instructions.count;
+    image->blocks = ctx.blocks;
+    image->block_count = ctx.block_count;
+    image->call_sites = ctx.call_sites;
+    image->call_site_count = ctx.call_site_count;
+    // A trailing entry that got no instruction maps nothing.
+    if (ctx.line_count > 0 && ctx.lines[ctx.line_count - 1].first_instruction >= ctx.instructions.count) {
+        ctx.line_count--;
+    }
+    image->lines = ctx.lines;
+    image->line_count = ctx.line_count;
 
-    free(entries);
-    free(patches.items);
     for (int i = 0; i < ctx.var_count; i++) {
         free((void*)ctx.var_names[i]);
         free((void*)ctx.var_types[i]);
@@ -1713,6 +4854,27 @@ static SubprogramImage* toAsmModuleInternal(const SubprogramInfo* info,
     return image;
 }
 
+void setAsmInlineBudget(int max_ops)
+{
+    g_inline_max_ops = max_ops;
+}
+
+void setAsmDeadMethodReport(FILE* out)
+{
+    g_dead_method_report = out;
+}
+
+void setAsmProfileMap(FILE* out)
+{
+    g_profile_map = out;
+}
+
+void setAsmImageObserver(AsmImageObserver observer, void* user_data)
+{
+    g_image_observer = observer;
+    g_image_observer_data = user_data;
+}
+
 SubprogramImage* toAsmModule(const SubprogramInfo* info)
 {
     SubprogramCollection subprograms;
@@ -1722,9 +4884,10 @@ SubprogramImage* toAsmModule(const SubprogramInfo* info)
     subprograms.user_type_count = 0;
     subprograms.errors = NULL;
     subprograms.error_count = 0;
+    annotate_subprogram(&subprograms, info);
     ReturnSiteList return_sites;
     return_site_list_init(&return_sites);
-    SubprogramImage* image = toAsmModuleInternal(info, &subprograms, &return_sites, true, false, NULL);
+    SubprogramImage* image = toAsmModuleInternal(info, &subprograms, NULL, &return_sites, NULL, true, false, NULL);
     return_site_list_free(&return_sites);
     return image;
 }
@@ -1754,6 +4917,151 @@ static const SubprogramInfo* find_main_method(const SubprogramCollection* subpro
     return NULL;
 }
 
+static bool is_emitted_subprogram(const SubprogramInfo* info)
+{
+    return info && info->name && !is_method_builtin_declaration(info)
+        && !info->import_info.is_imported && info->has_body;
+}
+
+static int compare_edges_by_caller(const void* left, const void* right)
+{
+    const CallGraphEdge* a = *(const CallGraphEdge* const*)left;
+    const CallGraphEdge* b = *(const CallGraphEdge* const*)right;
+    return strcmp(a->caller_name, b->caller_name);
+}
+
+static int compare_subprograms_by_name(const void* left, const void* right)
+{
+    const SubprogramInfo* a = *(const SubprogramInfo* const*)left;
+    const SubprogramInfo* b = *(const SubprogramInfo* const*)right;
+    return strcmp(a->name, b->name);
+}
+
+// First edge in the caller-sorted index whose caller is not below name.
+static int lower_bound_edges(const CallGraphEdge* const* edges, int count, const char* name)
+{
+    int low = 0;
+    int high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (strcmp(edges[mid]->caller_name, name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int lower_bound_subprograms(const SubprogramInfo* const* infos, int count, const char* name)
+{
+    int low = 0;
+    int high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (strcmp(infos[mid]->name, name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Marks what main can reach on the call graph. Edges name callees without
+// their owner or overload, so every subprogram sharing a called name is kept.
+// Edges are sorted by caller and methods by name once, so each step of the
+// walk is a binary search. Returns NULL when out of memory; callers then keep
+// everything.
+static bool* mark_reachable_subprograms(const SubprogramCollection* subprograms,
+                                        const CallGraph* graph,
+                                        const SubprogramInfo* main_method)
+{
+    int count = subprograms->count;
+    int edge_total = graph ? graph->edge_count : 0;
+    bool* reachable = calloc(count > 0 ? count : 1, sizeof(bool));
+    int* worklist = malloc(sizeof(int) * (count > 0 ? count : 1));
+    const CallGraphEdge** edges = malloc(sizeof(CallGraphEdge*) * (edge_total > 0 ? edge_total : 1));
+    const SubprogramInfo** by_name = malloc(sizeof(SubprogramInfo*) * (count > 0 ? count : 1));
+    if (!graph || !reachable || !worklist || !edges || !by_name) {
+        free(reachable);
+        free(worklist);
+        free(edges);
+        free(by_name);
+        return NULL;
+    }
+
+    int edge_count = 0;
+    for (int e = 0; e < edge_total; e++) {
+        if (graph->edges[e].caller_name && graph->edges[e].callee_name) {
+            edges[edge_count++] = &graph->edges[e];
+        }
+    }
+    qsort(edges, edge_count, sizeof(CallGraphEdge*), compare_edges_by_caller);
+
+    int named_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (subprograms->items[i].name) {
+            by_name[named_count++] = &subprograms->items[i];
+        }
+    }
+    qsort(by_name, named_count, sizeof(SubprogramInfo*), compare_subprograms_by_name);
+
+    int pending = 0;
+    int main_index = (int)(main_method - subprograms->items);
+    reachable[main_index] = true;
+    worklist[pending++] = main_index;
+    while (pending > 0) {
+        const SubprogramInfo* caller = &subprograms->items[worklist[--pending]];
+        const char* caller_name = caller->asm_name ? caller->asm_name : caller->name;
+        if (!caller_name) {
+            continue;
+        }
+        for (int e = lower_bound_edges(edges, edge_count, caller_name);
+             e < edge_count && strcmp(edges[e]->caller_name, caller_name) == 0;
+             e++) {
+            const char* callee_name = edges[e]->callee_name;
+            for (int n = lower_bound_subprograms(by_name, named_count, callee_name);
+                 n < named_count && strcmp(by_name[n]->name, callee_name) == 0;
+                 n++) {
+                int i = (int)(by_name[n] - subprograms->items);
+                if (!reachable[i]) {
+                    reachable[i] = true;
+                    worklist[pending++] = i;
+                }
+            }
+        }
+    }
+
+    free(worklist);
+    free(edges);
+    free(by_name);
+    return reachable;
+}
+
+static void report_dead_methods(const SubprogramCollection* subprograms, const bool* reachable, FILE* out)
+{
+    if (!out || !reachable) {
+        return;
+    }
+
+    int removed = 0;
+    int emitted = 0;
+    for (int i = 0; i < subprograms->count; i++) {
+        const SubprogramInfo* info = &subprograms->items[i];
+        if (!is_emitted_subprogram(info)) {
+            continue;
+        }
+        if (reachable[i]) {
+            emitted++;
+            continue;
+        }
+        fprintf(out, "Removed unreachable method: %s\n", info->asm_name ? info->asm_name : info->name);
+        removed++;
+    }
+    fprintf(out, "Dead method elimination: %d emitted, %d removed\n", emitted, removed);
+}
+
 static void print_metadata_label(FILE* out, const char* raw_text)
 {
     if (!out || !raw_text) {
@@ -1769,6 +5077,241 @@ static void print_metadata_label(FILE* out, const char* raw_text)
     free(label);
 }
 
+// One distinct pushi immediate across the emitted program. Values chosen for
+// the pool get an id and are pushed with `pushc M_const_<id>`.
+typedef struct {
+    int value;
+    int uses;
+    int id;
+} ConstPoolEntry;
+
+typedef struct {
+    ConstPoolEntry* items;
+    int count;
+    int pooled_count;
+} ConstPool;
+
+static bool parse_immediate_operand(const char* text, int* out_value)
+{
+    if (!text || !*text) {
+        return false;
+    }
+
+    char* endptr = NULL;
+    long value = strtol(text, &endptr, 10);
+    if (!endptr || *endptr != '\0' || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+
+    *out_value = (int)value;
+    return true;
+}
+
+static int compare_pool_entries(const void* left, const void* right)
+{
+    int a = ((const ConstPoolEntry*)left)->value;
+    int b = ((const ConstPoolEntry*)right)->value;
+    return (a > b) - (a < b);
+}
+
+static const ConstPoolEntry* find_pool_entry(const ConstPool* pool, int value)
+{
+    ConstPoolEntry key = { value, 0, -1 };
+    return bsearch(&key, pool->items, pool->count, sizeof(ConstPoolEntry), compare_pool_entries);
+}
+
+// Bytes saved by pooling entry; positive only from three uses on.
+static int pool_entry_saving(const ConstPoolEntry* entry)
+{
+    return entry->uses * (MYVM_SIZE_PUSHI - MYVM_SIZE_PUSHC) - MYVM_SIZE_PUSHI;
+}
+
+static int compare_savings_descending(const void* left, const void* right)
+{
+    int a = *(const int*)left;
+    int b = *(const int*)right;
+    return (b > a) - (b < a);
+}
+
+// A value pushed n times costs n pushi, or n pushc plus one pool entry, which
+// is itself a pushi; it is pooled only when that is smaller. Past
+// CONST_POOL_MAX_ENTRIES only the entries that save the most are kept, so
+// every address fits pushc's operand.
+static bool build_constant_pool(SubprogramImage* const* images, int image_count, ConstPool* pool)
+{
+    pool->items = NULL;
+    pool->count = 0;
+    pool->pooled_count = 0;
+
+    int total = 0;
+    for (int i = 0; i < image_count; i++) {
+        for (int j = 0; images[i] && j < images[i]->instruction_count; j++) {
+            total += equals_ignore_case(images[i]->instructions[j].mnemonic, MYVM_MNEMONIC_PUSHI);
+        }
+    }
+    if (total == 0) {
+        return true;
+    }
+
+    pool->items = malloc(sizeof(ConstPoolEntry) * total);
+    if (!pool->items) {
+        return false;
+    }
+
+    for (int i = 0; i < image_count; i++) {
+        for (int j = 0; images[i] && j < images[i]->instruction_count; j++) {
+            const Instruction* instr = &images[i]->instructions[j];
+            int value = 0;
+            if (equals_ignore_case(instr->mnemonic, MYVM_MNEMONIC_PUSHI) && instr->operand_count == 1
+                && parse_immediate_operand(instr->operands[0], &value)) {
+                pool->items[pool->count++] = (ConstPoolEntry){ value, 1, -1 };
+            }
+        }
+    }
+
+    qsort(pool->items, pool->count, sizeof(ConstPoolEntry), compare_pool_entries);
+    int distinct = 0;
+    for (int i = 0; i < pool->count; i++) {
+        if (distinct > 0 && pool->items[distinct - 1].value == pool->items[i].value) {
+            pool->items[distinct - 1].uses++;
+        } else {
+            pool->items[distinct++] = pool->items[i];
+        }
+    }
+    pool->count = distinct;
+
+    int eligible = 0;
+    for (int i = 0; i < pool->count; i++) {
+        eligible += pool_entry_saving(&pool->items[i]) > 0;
+    }
+
+    // Entries saving more than threshold are all kept; those saving exactly
+    // threshold fill the remaining places in value order.
+    int threshold = 0;
+    int at_threshold = eligible;
+    if (eligible > CONST_POOL_MAX_ENTRIES) {
+        int* savings = malloc(sizeof(int) * eligible);
+        if (!savings) {
+            free(pool->items);
+            pool->items = NULL;
+            pool->count = 0;
+            return false;
+        }
+        int saving_count = 0;
+        for (int i = 0; i < pool->count; i++) {
+            int saving = pool_entry_saving(&pool->items[i]);
+            if (saving > 0) {
+                savings[saving_count++] = saving;
+            }
+        }
+        qsort(savings, saving_count, sizeof(int), compare_savings_descending);
+        threshold = savings[CONST_POOL_MAX_ENTRIES - 1];
+        at_threshold = CONST_POOL_MAX_ENTRIES;
+        for (int i = 0; i < saving_count && savings[i] > threshold; i++) {
+            at_threshold--;
+        }
+        free(savings);
+    }
+
+    for (int i = 0; i < pool->count; i++) {
+        ConstPoolEntry* entry = &pool->items[i];
+        int saving = pool_entry_saving(entry);
+        if (saving <= 0 || saving < threshold) {
+            continue;
+        }
+        if (saving == threshold) {
+            if (at_threshold == 0) {
+                continue;
+            }
+            at_threshold--;
+        }
+        entry->id = pool->pooled_count++;
+    }
+    return true;
+}
+
+static bool image_add_literal_item(SubprogramImage* image, const char* name)
+{
+    for (int i = 0; i < image->data_item_count; i++) {
+        if (image->data_items[i].kind == DATA_ITEM_LITERAL && strcmp(image->data_items[i].value.literal_name, name) == 0) {
+            return true;
+        }
+    }
+
+    DataItem* items = realloc(image->data_items, sizeof(DataItem) * (image->data_item_count + 1));
+    char* copy = strdup(name);
+    if (!items || !copy) {
+        if (items) {
+            image->data_items = items;
+        }
+        free(copy);
+        return false;
+    }
+
+    image->data_items = items;
+    image->data_items[image->data_item_count].kind = DATA_ITEM_LITERAL;
+    image->data_items[image->data_item_count].value.literal_name = copy;
+    image->data_item_count++;
+    return true;
+}
+
+// Rewrites pooled pushi immediates to pushc and lists the entries the image
+// reads as DATA_ITEM_LITERAL items.
+static bool apply_constant_pool(SubprogramImage* image, const ConstPool* pool)
+{
+    for (int i = 0; image && i < image->instruction_count; i++) {
+        Instruction* instr = &image->instructions[i];
+        int value = 0;
+        if (!equals_ignore_case(instr->mnemonic, MYVM_MNEMONIC_PUSHI) || instr->operand_count != 1
+            || !parse_immediate_operand(instr->operands[0], &value)) {
+            continue;
+        }
+
+        const ConstPoolEntry* entry = find_pool_entry(pool, value);
+        if (!entry || entry->id < 0) {
+            continue;
+        }
+
+        char label[64];
+        snprintf(label, sizeof(label), "%s%d", CONST_POOL_LABEL_PREFIX, entry->id);
+        char* mnemonic = strdup(MYVM_MNEMONIC_PUSHC);
+        char* operand = strdup(label);
+        if (!mnemonic || !operand || !image_add_literal_item(image, label)) {
+            free(mnemonic);
+            free(operand);
+            return false;
+        }
+        free(instr->mnemonic);
+        free(instr->operands[0]);
+        instr->mnemonic = mnemonic;
+        instr->operands[0] = operand;
+    }
+    return true;
+}
+
+// The assembler has no data directive, so each entry is laid out as a pushi
+// whose immediate pushc reads. The pool opens CODE_CONST right after the jump
+// to main; build_constant_pool caps it so the last entry's address still fits
+// pushc's 16-bit operand.
+static void print_constant_pool(const ConstPool* pool, const char* entry_label, FILE* out)
+{
+    if (pool->pooled_count == 0) {
+        return;
+    }
+
+    // Ids were handed out in item order.
+    char* entry = sanitize_label(entry_label);
+    fprintf(out, "    " MYVM_MNEMONIC_JMP " %s\n", entry);
+    free(entry);
+    for (int i = 0; i < pool->count; i++) {
+        if (pool->items[i].id >= 0) {
+            fprintf(out, "%s%d:\n", CONST_POOL_LABEL_PREFIX, pool->items[i].id);
+            fprintf(out, "    " MYVM_MNEMONIC_PUSHI " %d\n", pool->items[i].value);
+        }
+    }
+    fprintf(out, "\n");
+}
+
 static void printTypeMetadata(const SubprogramCollection* subprograms, FILE* out)
 {
     if (!subprograms || !out || subprograms->user_type_count <= 0) {
@@ -1809,6 +5352,78 @@ static void printTypeMetadata(const SubprogramCollection* subprograms, FILE* out
     fprintf(out, "\n");
 }
 
+static void profile_counter_list_free(ProfileCounterList* list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].method);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+}
+
+// Main ends here instead of halting. Every counter goes to PROFILE_PORT as
+// -(count + 1): OUT separates nothing, so the leading '-' keeps consecutive
+// values apart and a zero count still prints a sign.
+static void print_profile_dump(const ProfileCounterList* list, FILE* out)
+{
+    fprintf(out, "%s:\n", PROFILE_DUMP_LABEL);
+    fprintf(out, "    " MYVM_MNEMONIC_SETPORT " %d\n", PROFILE_PORT);
+    for (int i = 0; i < list->count; i++) {
+        fprintf(out, "    " MYVM_MNEMONIC_PUSHI " -1\n");
+        fprintf(out, "    " MYVM_MNEMONIC_LDG " %d\n", PROFILE_FIRST_SLOT + i);
+        fprintf(out, "    " MYVM_MNEMONIC_SUB "\n");
+        fprintf(out, "    " MYVM_MNEMONIC_OUT "\n");
+    }
+    fprintf(out, "    " MYVM_MNEMONIC_HALT "\n");
+    fprintf(out, "\n");
+}
+
+// One line per counter, in dump order: counter index, method, CFG node id as
+// in cfgNodesToDot and node kind. The ENTRY_POINT counter counts calls.
+static void write_profile_map(const ProfileCounterList* list, FILE* out)
+{
+    fprintf(out, "# myvm profile map v1: port %d, first slot %d, %d counters\n",
+            PROFILE_PORT, PROFILE_FIRST_SLOT, list->count);
+    for (int i = 0; i < list->count; i++) {
+        fprintf(out, "%d %s %d %s\n", i, list->items[i].method, list->items[i].node_id,
+                nodeTypeToString(list->items[i].node_type));
+    }
+}
+
+// Maps every line-table label in the code to its source position, one
+// zero-byte label per entry in the style of TYPE_INFO.
+static void print_line_table(const SubprogramCollection* subprograms, SubprogramImage** images, FILE* out)
+{
+    bool any_lines = false;
+    for (int i = 0; i < subprograms->count && !any_lines; i++) {
+        any_lines = images[i] && images[i]->line_count > 0;
+    }
+    if (!any_lines) {
+        return;
+    }
+
+    fprintf(out, "[section LINE_INFO]\n");
+    for (int i = 0; i < subprograms->count; i++) {
+        const SubprogramInfo* info = &subprograms->items[i];
+        if (!images[i] || !is_emitted_subprogram(info)) {
+            continue;
+        }
+        char* entry = sanitize_label(info->asm_name ? info->asm_name : info->name);
+        if (!entry) {
+            continue;
+        }
+        for (int j = 0; j < images[i]->line_count; j++) {
+            char line_label[128];
+            format_line_label(line_label, sizeof(line_label), entry, j);
+            fprintf(out, "LINEINFO_%s_line_%d_col_%d:\n", line_label,
+                    images[i]->lines[j].line, images[i]->lines[j].column);
+        }
+        free(entry);
+    }
+    fprintf(out, "\n");
+}
+
 bool generateProgramAsm(const SubprogramCollection* subprograms, FILE* out, char** error_message)
 {
     if (error_message) {
@@ -1830,32 +5445,44 @@ bool generateProgramAsm(const SubprogramCollection* subprograms, FILE* out, char
     if (!main_method) {
         printTypeMetadata(subprograms, out);
         fprintf(out, "[section CODE_CONST]\n");
-        fprintf(out, "halt\n");
+        fprintf(out, MYVM_MNEMONIC_HALT "\n");
         return true;
     }
 
     ReturnSiteList return_sites;
     return_site_list_init(&return_sites);
+    ProfileCounterList profile_counters = { NULL, 0 };
 
-    SubprogramImage** images = calloc(subprograms->count, sizeof(SubprogramImage*));
+    // Only used to decide which calls may be inlined; without it every call
+    // keeps the full return-site protocol.
+    CallGraph* call_graph = buildCallGraph(subprograms);
+    bool* reachable = mark_reachable_subprograms(subprograms, call_graph, main_method);
+
+    // Inlining reads callee trees, so every body is annotated up front.
+    annotateSubprogramCollection(subprograms);
+
+    SubprogramImage** images = calloc(subprograms->count > 0 ? subprograms->count : 1, sizeof(SubprogramImage*));
     if (!images) {
         if (error_message) {
             *error_message = strdup("Out of memory while preparing ASM images.");
         }
+        free(reachable);
+        freeCallGraph(call_graph);
         return_site_list_free(&return_sites);
+        profile_counter_list_free(&profile_counters);
         return false;
     }
 
     for (int i = 0; i < subprograms->count; i++) {
         const SubprogramInfo* info = &subprograms->items[i];
-        if (!info || !info->name || is_method_builtin_declaration(info)
-            || info->import_info.is_imported || !info->has_body) {
+        if (!is_emitted_subprogram(info) || (reachable && !reachable[i])) {
             continue;
         }
 
         bool is_main = (info == main_method);
         char* local_error = NULL;
-        images[i] = toAsmModuleInternal(info, subprograms, &return_sites, is_main, false, &local_error);
+        images[i] = toAsmModuleInternal(info, subprograms, call_graph, &return_sites,
+                                        g_profile_map ? &profile_counters : NULL, is_main, false, &local_error);
         if (!images[i]) {
             if (error_message) {
                 if (local_error) {
@@ -1871,20 +5498,50 @@ bool generateProgramAsm(const SubprogramCollection* subprograms, FILE* out, char
                 freeSubprogramImage(images[j]);
             }
             free(images);
+            free(reachable);
+            freeCallGraph(call_graph);
             return_site_list_free(&return_sites);
+            profile_counter_list_free(&profile_counters);
             return false;
         }
     }
 
+    report_dead_methods(subprograms, reachable, g_dead_method_report);
+
+    ConstPool pool;
+    bool pool_ok = build_constant_pool(images, subprograms->count, &pool);
+    for (int i = 0; pool_ok && i < subprograms->count; i++) {
+        pool_ok = apply_constant_pool(images[i], &pool);
+    }
+    if (!pool_ok) {
+        if (error_message) {
+            *error_message = strdup("Out of memory while building the constant pool.");
+        }
+        free(pool.items);
+        for (int i = 0; i < subprograms->count; i++) {
+            freeSubprogramImage(images[i]);
+        }
+        free(images);
+        free(reachable);
+        freeCallGraph(call_graph);
+        return_site_list_free(&return_sites);
+        profile_counter_list_free(&profile_counters);
+        return false;
+    }
+
     printTypeMetadata(subprograms, out);
     fprintf(out, "[section CODE_CONST]\n");
     fprintf(out, "\n");
+    print_constant_pool(&pool, main_method->asm_name ? main_method->asm_name : main_method->name, out);
+    free(pool.items);
 
+    // A method whose every call was inlined still ends in a jump to the
+    // dispatch, so the label must exist even without return sites.
+    bool emitted_callee = false;
     for (int pass = 0; pass < 2; pass++) {
         for (int i = 0; i < subprograms->count; i++) {
             const SubprogramInfo* info = &subprograms->items[i];
-            if (!info || !info->name || is_method_builtin_declaration(info)
-                || info->import_info.is_imported || !info->has_body) {
+            if (!is_emitted_subprogram(info)) {
                 continue;
             }
 
@@ -1896,38 +5553,52 @@ bool generateProgramAsm(const SubprogramCollection* subprograms, FILE* out, char
             if (!images[i]) {
                 continue;
             }
+            emitted_callee = emitted_callee || !is_main;
 
-            printSubprogramImage(images[i], info->asm_name ? info->asm_name : info->name, out);
+            const char* entry_label = info->asm_name ? info->asm_name : info->name;
+            if (g_image_observer) {
+                g_image_observer(images[i], entry_label, g_image_observer_data);
+            }
+            printSubprogramImage(images[i], entry_label, out);
             fprintf(out, "\n");
         }
     }
 
-    if (return_sites.count > 0) {
+    if (return_sites.count > 0 || emitted_callee) {
         fprintf(out, "%s:\n", RUNTIME_DISPATCH_LABEL);
         for (int i = 0; i < return_sites.count; i++) {
             const ReturnSite* site = &return_sites.items[i];
-            fprintf(out, "    dup\n");
-            fprintf(out, "    pushi %d\n", site->id);
-            fprintf(out, "    eq\n");
-            fprintf(out, "    jnz M_sys_ret_case_%d\n", site->id);
+            fprintf(out, "    " MYVM_MNEMONIC_DUP "\n");
+            fprintf(out, "    " MYVM_MNEMONIC_PUSHI " %d\n", site->id);
+            fprintf(out, "    " MYVM_MNEMONIC_JEQ " M_sys_ret_case_%d\n", site->id);
         }
-        fprintf(out, "    pop\n");
-        fprintf(out, "    halt\n");
+        fprintf(out, "    " MYVM_MNEMONIC_POP "\n");
+        fprintf(out, "    " MYVM_MNEMONIC_HALT "\n");
 
         for (int i = 0; i < return_sites.count; i++) {
             const ReturnSite* site = &return_sites.items[i];
             fprintf(out, "M_sys_ret_case_%d:\n", site->id);
-            fprintf(out, "    pop\n");
-            fprintf(out, "    jmp %s\n", site->continue_label ? site->continue_label : "");
+            fprintf(out, "    " MYVM_MNEMONIC_POP "\n");
+            fprintf(out, "    " MYVM_MNEMONIC_JMP " %s\n", site->continue_label ? site->continue_label : "");
         }
         fprintf(out, "\n");
     }
 
+    if (g_profile_map) {
+        print_profile_dump(&profile_counters, out);
+        write_profile_map(&profile_counters, g_profile_map);
+    }
+
+    print_line_table(subprograms, images, out);
+
     for (int i = 0; i < subprograms->count; i++) {
         freeSubprogramImage(images[i]);
     }
     free(images);
+    free(reachable);
+    freeCallGraph(call_graph);
     return_site_list_free(&return_sites);
+    profile_counter_list_free(&profile_counters);
 
     return true;
 }
@@ -24,11 +24,42 @@ typedef struct {
     int operand_count;
 } Instruction;
 
+// Instructions emitted for one CFG node of the method's own body; inlined
+// callee code counts toward the node holding the call.
+typedef struct {
+    int node_id;
+    int first_instruction;
+    int instruction_count;
+    int loop_depth;
+} ImageBlock;
+
+// A call that keeps the return-site protocol: the caller saves and reloads
+// spill_count slots around it, and the return dispatch tests return_id - 1
+// other sites before reaching it.
+typedef struct {
+    int jump_instruction;
+    int spill_count;
+    int return_id;
+} ImageCallSite;
+
+// Source position of the code from first_instruction up to the next entry.
+typedef struct {
+    int first_instruction;
+    int line;
+    int column;
+} ImageLine;
+
 typedef struct {
     DataItem* data_items;
     int data_item_count;
     Instruction* instructions;
     int instruction_count;
+    ImageBlock* blocks;
+    int block_count;
+    ImageCallSite* call_sites;
+    int call_site_count;
+    ImageLine* lines;
+    int line_count;
 } SubprogramImage;
 
 SubprogramImage* toAsmModule(const SubprogramInfo* info);
@@ -36,5 +67,22 @@ bool generateProgramAsm(const SubprogramCollection* subprograms, FILE* out, char
 void freeSubprogramImage(SubprogramImage* image);
 void printSubprogramImage(const SubprogramImage* image, const char* entry_label, FILE* out);
 void printSubprogramImageConsole(const SubprogramImage* image, const char* entry_label);
+// Records resolved types and callees on every method body; generateProgramAsm
+// does this itself, other backends call it before reading resolved_callee.
+void annotateSubprogramCollection(const SubprogramCollection* subprograms);
+// Value of an int, char, bool, hex or binary literal as the backend reads it.
+bool parseIntLiteral(const char* text, int* out_value);
+// Maximum callee size, in OpNodes, that generateProgramAsm inlines; 0 disables inlining.
+void setAsmInlineBudget(int max_ops);
+// Where generateProgramAsm lists methods dropped as unreachable from main; NULL disables.
+void setAsmDeadMethodReport(FILE* out);
+// When set, every CFG node of every emitted method bumps its own counter in
+// a reserved global region, main dumps the counters before it halts, and the
+// counter-to-node map is written here; NULL disables.
+void setAsmProfileMap(FILE* out);
+// Called with every final image generateProgramAsm prints, before jump indices
+// become labels; NULL disables.
+typedef void (*AsmImageObserver)(const SubprogramImage* image, const char* entry_label, void* user_data);
+void setAsmImageObserver(AsmImageObserver observer, void* user_data);
 
 #endif
@@ -0,0 +1,1595 @@
+#include "to_c_module.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "to_asm_module.h"
+
+#define C_SYMBOL_PREFIX "MC_"
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} CBuffer;
+
+// One struct field. Consecutive slots "name[0]".."name[N-1]" share one
+// array field so that indexed access stays a plain C subscript.
+typedef struct {
+    char* name;
+    char* path;        // leaf path, or the array path for an array field
+    int first_slot;
+    int length;        // element count, 0 for a scalar field
+} CField;
+
+typedef struct {
+    const UserTypeInfo* type;
+    char* tag;
+    CField* fields;
+    int field_count;
+    int* slot_fields;  // field index of every flattened slot
+    int slot_count;
+} CTypeLayout;
+
+typedef struct {
+    const SubprogramCollection* subprograms;
+    CTypeLayout* layouts;
+    int layout_count;
+    bool has_error;
+    char error_message[256];
+} CProgram;
+
+typedef struct {
+    CProgram* program;
+    const SubprogramInfo* info;
+    CBuffer* out;
+    const CTypeLayout* self_layout;
+    bool* referenced;
+    // Calls evaluated into mc_t<id> before the current statement.
+    const OpNode** temp_nodes;
+    int* temp_ids;
+    int temp_count;
+    int temp_capacity;
+    int next_temp;
+} CMethod;
+
+typedef enum {
+    C_PLACE_SCALAR,
+    C_PLACE_ARRAY,
+    C_PLACE_CLASS
+} CPlaceKind;
+
+// A named storage location. Scalars and arrays carry their C expression;
+// a class value is a run of slots starting at slot below root.
+typedef struct {
+    CPlaceKind kind;
+    char* expr;
+    const CTypeLayout* layout;
+    const char* type_name;
+    int slot;
+    int length;
+} CPlace;
+
+static bool c_equals_ignore_case(const char* a, const char* b)
+{
+    if (!a || !b) {
+        return false;
+    }
+
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) {
+            return false;
+        }
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static void set_c_error(CProgram* program, const char* message)
+{
+    if (program->has_error) {
+        return;
+    }
+
+    program->has_error = true;
+    snprintf(program->error_message, sizeof(program->error_message), "%s", message ? message : "");
+}
+
+static void buffer_append(CBuffer* buffer, const char* text)
+{
+    size_t length = strlen(text);
+    if (buffer->failed) {
+        return;
+    }
+
+    if (buffer->length + length + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->length + length + 1) {
+            capacity *= 2;
+        }
+        char* data = realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, text, length + 1);
+    buffer->length += length;
+}
+
+static void buffer_appendf(CBuffer* buffer, const char* format, ...)
+{
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    buffer_append(buffer, text);
+}
+
+static char* buffer_take(CBuffer* buffer)
+{
+    char* data = buffer->failed ? NULL : buffer->data;
+    if (buffer->failed) {
+        free(buffer->data);
+    }
+    if (!data) {
+        data = strdup("");
+    }
+    memset(buffer, 0, sizeof(*buffer));
+    return data;
+}
+
+// Maps any name onto a C identifier with the given prefix.
+static char* make_identifier(const char* prefix, const char* name)
+{
+    size_t length = strlen(prefix) + strlen(name) + 1;
+    char* identifier = malloc(length);
+    if (!identifier) {
+        return NULL;
+    }
+
+    snprintf(identifier, length, "%s%s", prefix, name);
+    for (char* p = identifier; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_') {
+            *p = '_';
+        }
+    }
+    return identifier;
+}
+
+static char* make_symbol(const SubprogramInfo* info)
+{
+    return make_identifier(C_SYMBOL_PREFIX, info->asm_name ? info->asm_name : info->name);
+}
+
+static bool is_scalar_type(const char* type_name)
+{
+    return !type_name
+        || c_equals_ignore_case(type_name, "bool")
+        || c_equals_ignore_case(type_name, "byte")
+        || c_equals_ignore_case(type_name, "int")
+        || c_equals_ignore_case(type_name, "uint")
+        || c_equals_ignore_case(type_name, "long")
+        || c_equals_ignore_case(type_name, "ulong")
+        || c_equals_ignore_case(type_name, "char");
+}
+
+static bool returns_value(const SubprogramInfo* info)
+{
+    return info && info->return_type && !c_equals_ignore_case(info->return_type, "void");
+}
+
+// Declaration-only read()/write(int) are the I/O builtins, as in the VM backend.
+static bool is_builtin_declaration(const SubprogramInfo* info, const char* name, int param_count)
+{
+    if (!info || info->owner_type_name || info->has_body || info->import_info.is_imported
+        || !c_equals_ignore_case(info->name, name) || info->param_count != param_count) {
+        return false;
+    }
+    return param_count == 0 || c_equals_ignore_case(info->param_types[0], "int");
+}
+
+// read() is declared without a return type but yields the value read.
+static bool has_scalar_result(const SubprogramInfo* callee)
+{
+    if (is_builtin_declaration(callee, "read", 0)) {
+        return true;
+    }
+    return returns_value(callee) && is_scalar_type(callee->return_type)
+        && !is_builtin_declaration(callee, "write", 1);
+}
+
+// --- Struct layouts ---
+
+static const CTypeLayout* find_layout(const CProgram* program, const char* type_name)
+{
+    for (int i = 0; type_name && i < program->layout_count; i++) {
+        if (strcmp(program->layouts[i].type->name, type_name) == 0) {
+            return &program->layouts[i];
+        }
+    }
+    return NULL;
+}
+
+// Splits "path[k]" into its array path length and k.
+static bool split_element_path(const char* path, size_t* base_length, int* index)
+{
+    size_t length = strlen(path);
+    if (length < 4 || path[length - 1] != ']') {
+        return false;
+    }
+
+    const char* open = strrchr(path, '[');
+    if (!open || open == path) {
+        return false;
+    }
+
+    char* end = NULL;
+    long value = strtol(open + 1, &end, 10);
+    if (end != path + length - 1 || value < 0) {
+        return false;
+    }
+
+    *base_length = (size_t)(open - path);
+    *index = (int)value;
+    return true;
+}
+
+static bool add_field(CTypeLayout* layout, const char* path, size_t path_length, int slot)
+{
+    char* field_path = malloc(path_length + 1);
+    if (!field_path) {
+        return false;
+    }
+    memcpy(field_path, path, path_length);
+    field_path[path_length] = '\0';
+
+    char* name = make_identifier("f_", field_path[0] ? field_path : "value");
+    if (!name) {
+        free(field_path);
+        return false;
+    }
+    // Sanitising can merge "a_b" and "a.b"; the slot index keeps them apart.
+    for (int i = 0; i < layout->field_count; i++) {
+        if (strcmp(layout->fields[i].name, name) == 0) {
+            char* unique = malloc(strlen(name) + 16);
+            if (!unique) {
+                free(name);
+                free(field_path);
+                return false;
+            }
+            sprintf(unique, "%s_%d", name, slot);
+            free(name);
+            name = unique;
+            break;
+        }
+    }
+
+    CField* field = &layout->fields[layout->field_count++];
+    field->name = name;
+    field->path = field_path;
+    field->first_slot = slot;
+    field->length = 0;
+    return true;
+}
+
+static bool build_layout(const SubprogramCollection* subprograms, const UserTypeInfo* type, CTypeLayout* layout)
+{
+    memset(layout, 0, sizeof(*layout));
+    layout->type = type;
+    layout->tag = make_identifier(C_SYMBOL_PREFIX, type->name);
+    layout->slot_count = getFlattenedSlotCount(subprograms, type->name);
+    if (!layout->tag || layout->slot_count <= 0 || !type->flat_slots) {
+        return false;
+    }
+
+    layout->fields = calloc((size_t)layout->slot_count, sizeof(CField));
+    layout->slot_fields = malloc(sizeof(int) * layout->slot_count);
+    if (!layout->fields || !layout->slot_fields) {
+        return false;
+    }
+
+    for (int slot = 0; slot < layout->slot_count; slot++) {
+        const FlattenedSlotInfo* leaf = &type->flat_slots[slot];
+        size_t base_length = 0;
+        int index = 0;
+        bool element = is_scalar_type(leaf->type_name) && split_element_path(leaf->path, &base_length, &index);
+        if (element && index > 0 && layout->field_count > 0) {
+            CField* last = &layout->fields[layout->field_count - 1];
+            if (last->length == index && strlen(last->path) == base_length
+                && strncmp(last->path, leaf->path, base_length) == 0) {
+                last->length++;
+                layout->slot_fields[slot] = layout->field_count - 1;
+                continue;
+            }
+        }
+
+        bool starts_array = element && index == 0;
+        if (!add_field(layout, leaf->path, starts_array ? base_length : strlen(leaf->path), slot)) {
+            return false;
+        }
+        layout->fields[layout->field_count - 1].length = starts_array ? 1 : 0;
+        layout->slot_fields[slot] = layout->field_count - 1;
+    }
+    return true;
+}
+
+static void free_layout(CTypeLayout* layout)
+{
+    for (int i = 0; i < layout->field_count; i++) {
+        free(layout->fields[i].name);
+        free(layout->fields[i].path);
+    }
+    free(layout->fields);
+    free(layout->slot_fields);
+    free(layout->tag);
+}
+
+static void print_layout(const CTypeLayout* layout, FILE* out)
+{
+    fprintf(out, "struct %s {\n", layout->tag);
+    for (int i = 0; i < layout->field_count; i++) {
+        const CField* field = &layout->fields[i];
+        if (field->length > 0) {
+            fprintf(out, "    mc_int %s[%d];\n", field->name, field->length);
+        } else {
+            fprintf(out, "    mc_int %s;\n", field->name);
+        }
+    }
+    fprintf(out, "};\n\n");
+}
+
+// Appends the lvalue of one flattened slot of a value stored at root.
+static void append_slot(CBuffer* buffer, const CTypeLayout* layout, const char* root, int slot)
+{
+    const CField* field = &layout->fields[layout->slot_fields[slot]];
+    if (field->length > 0) {
+        buffer_appendf(buffer, "%s.%s[%d]", root, field->name, slot - field->first_slot);
+    } else {
+        buffer_appendf(buffer, "%s.%s", root, field->name);
+    }
+}
+
+static bool is_same_or_derived(const CProgram* program, const char* type_name, const char* base_name)
+{
+    const UserTypeInfo* type = findUserTypeInfo(program->subprograms, type_name);
+    while (type) {
+        if (strcmp(type->name, base_name) == 0) {
+            return true;
+        }
+        type = type->base_type_name ? findUserTypeInfo(program->subprograms, type->base_type_name) : NULL;
+    }
+    return false;
+}
+
+// --- Places ---
+
+static const char* find_variable_type(const SubprogramInfo* info, const char* name, bool* found)
+{
+    for (int i = 0; i < info->param_count; i++) {
+        if (strcmp(info->param_names[i], name) == 0) {
+            *found = true;
+            return info->param_types[i];
+        }
+    }
+    for (int i = 0; i < info->local_count; i++) {
+        if (strcmp(info->local_names[i], name) == 0) {
+            *found = true;
+            return info->local_types ? info->local_types[i] : NULL;
+        }
+    }
+    *found = false;
+    return NULL;
+}
+
+static void method_error(CMethod* m, const char* format, const char* subject)
+{
+    char buffer[256];
+    char message[192];
+    snprintf(message, sizeof(message), format, subject ? subject : "?");
+    snprintf(buffer, sizeof(buffer), "%s in '%s'.", message, m->info->name);
+    set_c_error(m->program, buffer);
+}
+
+// Resolves an identifier or member chain to its variable and the field path
+// below it. Bare field names inside a method read the receiver.
+static bool resolve_root(CMethod* m, const OpNode* node, char** root, const char** root_type, CBuffer* path)
+{
+    if (!node) {
+        return false;
+    }
+
+    if (node->type == OP_MEMBER_ACCESS && node->operand_count == 1) {
+        if (!resolve_root(m, node->operands[0], root, root_type, path)) {
+            return false;
+        }
+        if (path->length > 0) {
+            buffer_append(path, ".");
+        }
+        buffer_append(path, node->text);
+        return true;
+    }
+
+    if (node->type != OP_IDENTIFIER) {
+        return false;
+    }
+
+    bool found = false;
+    const char* type_name = find_variable_type(m->info, node->text, &found);
+    if (found) {
+        *root = make_identifier("v_", node->text);
+        *root_type = type_name;
+        return *root != NULL;
+    }
+
+    if (m->self_layout) {
+        bool is_this = strcmp(node->text, "this") == 0;
+        if (is_this || findResolvedFieldInfo(m->self_layout->type, node->text)) {
+            *root = strdup("self");
+            *root_type = m->self_layout->type->name;
+            if (!is_this) {
+                buffer_append(path, node->text);
+            }
+            return *root != NULL;
+        }
+    }
+
+    method_error(m, "Unknown variable '%s'", node->text);
+    return false;
+}
+
+static const char* sub_value_type(const CProgram* program, const char* type_name, const char* path)
+{
+    char segment[256];
+    while (type_name && *path) {
+        const char* dot = strchr(path, '.');
+        size_t length = dot ? (size_t)(dot - path) : strlen(path);
+        if (length >= sizeof(segment)) {
+            return NULL;
+        }
+        memcpy(segment, path, length);
+        segment[length] = '\0';
+
+        const FieldInfo* field = findResolvedFieldInfo(findUserTypeInfo(program->subprograms, type_name), segment);
+        type_name = field ? field->type_name : NULL;
+        path = dot ? dot + 1 : path + length;
+    }
+    return type_name;
+}
+
+static void free_place(CPlace* place)
+{
+    free(place->expr);
+    place->expr = NULL;
+}
+
+static bool resolve_place(CMethod* m, const OpNode* node, CPlace* place)
+{
+    memset(place, 0, sizeof(*place));
+    char* root = NULL;
+    const char* root_type = NULL;
+    CBuffer path_buffer;
+    memset(&path_buffer, 0, sizeof(path_buffer));
+    if (!resolve_root(m, node, &root, &root_type, &path_buffer)) {
+        free(root);
+        free(path_buffer.data);
+        return false;
+    }
+    char* path = buffer_take(&path_buffer);
+
+    bool ok = true;
+    const CTypeLayout* layout = find_layout(m->program, root_type);
+    int length = 0;
+    int dimensions = 0;
+    const char* element_type = NULL;
+    if (!layout) {
+        if (path[0]) {
+            method_error(m, "Unknown member '%s'", path);
+            ok = false;
+        } else if (getArrayTypeShape(root_type, &length, &dimensions, &element_type)) {
+            place->kind = C_PLACE_ARRAY;
+            place->length = length;
+            place->type_name = root_type;
+        } else if (is_scalar_type(root_type)) {
+            place->kind = C_PLACE_SCALAR;
+            place->type_name = root_type;
+        } else {
+            method_error(m, "Variable of type '%s' is not supported by the C backend", root_type);
+            ok = false;
+        }
+        place->expr = root;
+        root = NULL;
+    } else {
+        place->layout = layout;
+        place->expr = root;
+        root = NULL;
+        int first = -1;
+        size_t path_length = strlen(path);
+        for (int slot = 0; slot < layout->slot_count && first < 0; slot++) {
+            const char* leaf = layout->type->flat_slots[slot].path;
+            if (path_length == 0 || strcmp(leaf, path) == 0
+                || (strncmp(leaf, path, path_length) == 0 && leaf[path_length] == '.')) {
+                first = slot;
+            }
+        }
+
+        const CField* array = NULL;
+        for (int i = 0; i < layout->field_count && !array; i++) {
+            if (layout->fields[i].length > 0 && strcmp(layout->fields[i].path, path) == 0) {
+                array = &layout->fields[i];
+            }
+        }
+
+        if (array) {
+            CBuffer expr;
+            memset(&expr, 0, sizeof(expr));
+            buffer_appendf(&expr, "%s.%s", place->expr, array->name);
+            free(place->expr);
+            place->expr = buffer_take(&expr);
+            place->kind = C_PLACE_ARRAY;
+            place->length = array->length;
+        } else if (first >= 0 && path_length > 0 && strcmp(layout->type->flat_slots[first].path, path) == 0
+                   && is_scalar_type(layout->type->flat_slots[first].type_name)) {
+            CBuffer expr;
+            memset(&expr, 0, sizeof(expr));
+            append_slot(&expr, layout, place->expr, first);
+            free(place->expr);
+            place->expr = buffer_take(&expr);
+            place->kind = C_PLACE_SCALAR;
+            place->type_name = layout->type->flat_slots[first].type_name;
+        } else if (first >= 0) {
+            place->kind = C_PLACE_CLASS;
+            place->slot = first;
+            place->type_name = path_length == 0 ? layout->type->name : sub_value_type(m->program, layout->type->name, path);
+            if (!find_layout(m->program, place->type_name)) {
+                method_error(m, "Member '%s' is not supported by the C backend", path);
+                ok = false;
+            }
+        } else {
+            method_error(m, "Unknown member '%s'", path);
+            ok = false;
+        }
+    }
+
+    free(root);
+    free(path);
+    if (!ok) {
+        free_place(place);
+    }
+    return ok;
+}
+
+// Appends a value of type type_name read from a class place. A place of a
+// derived type, or a nested field, is rebuilt as a compound literal.
+static bool append_class_value(CMethod* m, const CPlace* place, const char* type_name, CBuffer* buffer)
+{
+    const CTypeLayout* target = find_layout(m->program, type_name);
+    if (!target || !place->type_name || !is_same_or_derived(m->program, place->type_name, type_name)) {
+        method_error(m, "Value of type '%s' is not supported by the C backend here", place->type_name);
+        return false;
+    }
+
+    if (place->slot == 0 && place->layout == target) {
+        buffer_append(buffer, place->expr);
+        return true;
+    }
+
+    buffer_appendf(buffer, "(struct %s){ ", target->tag);
+    for (int i = 0; i < target->field_count; i++) {
+        const CField* field = &target->fields[i];
+        buffer_append(buffer, i > 0 ? ", " : "");
+        if (field->length > 0) {
+            buffer_append(buffer, "{ ");
+            for (int k = 0; k < field->length; k++) {
+                buffer_append(buffer, k > 0 ? ", " : "");
+                append_slot(buffer, place->layout, place->expr, place->slot + field->first_slot + k);
+            }
+            buffer_append(buffer, " }");
+        } else {
+            append_slot(buffer, place->layout, place->expr, place->slot + field->first_slot);
+        }
+    }
+    buffer_append(buffer, " }");
+    return true;
+}
+
+// --- Expressions ---
+
+static bool append_expression(CMethod* m, const OpNode* node, CBuffer* buffer);
+static bool append_class_expression(CMethod* m, const OpNode* node, const char* type_name, CBuffer* buffer);
+
+static bool literal_value(const OpNode* node, int* value)
+{
+    return node && node->type == OP_LITERAL && parseIntLiteral(node->text, value);
+}
+
+static void append_literal(CBuffer* buffer, int value)
+{
+    if (value == INT_MIN) {
+        buffer_append(buffer, "(-2147483647 - 1)");
+    } else if (value < 0) {
+        buffer_appendf(buffer, "(%d)", value);
+    } else {
+        buffer_appendf(buffer, "%d", value);
+    }
+}
+
+static const SubprogramInfo* find_callee(const CProgram* program, const OpNode* node)
+{
+    if (node->resolved_callee) {
+        return node->resolved_callee;
+    }
+
+    const SubprogramCollection* subprograms = program->subprograms;
+    for (int i = 0; node->type == OP_FUNCTION_CALL && i < subprograms->count; i++) {
+        const SubprogramInfo* candidate = &subprograms->items[i];
+        if (!candidate->owner_type_name && candidate->name && strcmp(candidate->name, node->text) == 0
+            && candidate->param_count == node->operand_count) {
+            return candidate;
+        }
+    }
+    return NULL;
+}
+
+static const SubprogramInfo* resolve_callee(CMethod* m, const OpNode* node)
+{
+    return find_callee(m->program, node);
+}
+
+static int find_temp(const CMethod* m, const OpNode* node)
+{
+    for (int i = 0; i < m->temp_count; i++) {
+        if (m->temp_nodes[i] == node) {
+            return m->temp_ids[i];
+        }
+    }
+    return -1;
+}
+
+static bool append_call(CMethod* m, const OpNode* node, CBuffer* buffer)
+{
+    int temp = find_temp(m, node);
+    if (temp >= 0) {
+        buffer_appendf(buffer, "mc_t%d", temp);
+        return true;
+    }
+
+    const SubprogramInfo* callee = resolve_callee(m, node);
+    if (!callee) {
+        method_error(m, "Cannot resolve call to '%s'", node->text);
+        return false;
+    }
+
+    int first_arg = node->type == OP_MEMBER_CALL ? 1 : 0;
+    if (is_builtin_declaration(callee, "read", 0)) {
+        buffer_append(buffer, "mc_read()");
+        return true;
+    }
+    if (is_builtin_declaration(callee, "write", 1)) {
+        buffer_append(buffer, "mc_write(");
+        bool ok = append_expression(m, node->operands[first_arg], buffer);
+        buffer_append(buffer, ")");
+        return ok;
+    }
+    if (callee->import_info.is_imported || !callee->has_body) {
+        method_error(m, "Call to '%s' is not supported by the C backend", node->text);
+        return false;
+    }
+
+    char* symbol = make_symbol(callee);
+    if (!symbol) {
+        set_c_error(m->program, "Out of memory while generating C.");
+        return false;
+    }
+    buffer_appendf(buffer, "%s(", symbol);
+    free(symbol);
+
+    bool ok = true;
+    bool first = true;
+    if (callee->owner_type_name) {
+        CPlace receiver;
+        bool resolved = false;
+        if (node->type == OP_MEMBER_CALL && node->operand_count > 0) {
+            resolved = resolve_place(m, node->operands[0], &receiver);
+        } else if (m->self_layout) {
+            memset(&receiver, 0, sizeof(receiver));
+            receiver.kind = C_PLACE_CLASS;
+            receiver.expr = strdup("self");
+            receiver.layout = m->self_layout;
+            receiver.type_name = m->self_layout->type->name;
+            resolved = receiver.expr != NULL;
+        }
+        if (!resolved || receiver.kind != C_PLACE_CLASS) {
+            if (resolved) {
+                free_place(&receiver);
+            }
+            method_error(m, "Receiver of '%s' is not supported by the C backend", node->text);
+            return false;
+        }
+        ok = append_class_value(m, &receiver, callee->owner_type_name, buffer);
+        free_place(&receiver);
+        first = false;
+    }
+
+    for (int i = 0; ok && i < callee->param_count && first_arg + i < node->operand_count; i++) {
+        buffer_append(buffer, first ? "" : ", ");
+        first = false;
+        const OpNode* arg = node->operands[first_arg + i];
+        if (is_scalar_type(callee->param_types[i])) {
+            ok = append_expression(m, arg, buffer);
+        } else {
+            ok = append_class_expression(m, arg, callee->param_types[i], buffer);
+        }
+    }
+    buffer_append(buffer, ")");
+    return ok;
+}
+
+static bool append_class_expression(CMethod* m, const OpNode* node, const char* type_name, CBuffer* buffer)
+{
+    if (node && (node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL)) {
+        const SubprogramInfo* callee = resolve_callee(m, node);
+        if (!callee || !callee->return_type || strcmp(callee->return_type, type_name) != 0) {
+            method_error(m, "Call to '%s' does not return the expected class", node->text);
+            return false;
+        }
+        return append_call(m, node, buffer);
+    }
+
+    CPlace place;
+    if (!resolve_place(m, node, &place)) {
+        if (!m->program->has_error) {
+            method_error(m, "Expression of type '%s' is not supported by the C backend", type_name);
+        }
+        return false;
+    }
+    bool ok = place.kind == C_PLACE_CLASS && append_class_value(m, &place, type_name, buffer);
+    if (place.kind != C_PLACE_CLASS) {
+        method_error(m, "Expected a value of type '%s'", type_name);
+    }
+    free_place(&place);
+    return ok;
+}
+
+// Appends base[index] for a one-dimensional array of scalars. Literal indexes
+// are checked here; others go through mc_index, which halts like chkb.
+static bool append_element(CMethod* m, const OpNode* node, CBuffer* buffer)
+{
+    CPlace place;
+    if (node->operand_count != 2 || !resolve_place(m, node->operands[0], &place)) {
+        if (!m->program->has_error) {
+            method_error(m, "%s is not supported by the C backend", opTypeToString(node->type));
+        }
+        return false;
+    }
+
+    // Array fields of a class are always one-dimensional arrays of scalars.
+    int length = 0;
+    int dimensions = 1;
+    const char* element_type = NULL;
+    if (place.kind != C_PLACE_ARRAY || place.length <= 0
+        || (place.type_name && (!getArrayTypeShape(place.type_name, &length, &dimensions, &element_type)
+                                || dimensions != 1 || !is_scalar_type(element_type)))) {
+        free_place(&place);
+        method_error(m, "%s is not supported by the C backend", opTypeToString(node->type));
+        return false;
+    }
+
+    bool ok = true;
+    int constant = 0;
+    buffer_appendf(buffer, "%s[", place.expr);
+    if (literal_value(node->operands[1], &constant)) {
+        if (constant < 0 || constant >= place.length) {
+            char message[128];
+            snprintf(message, sizeof(message), "Array index %d is out of bounds for length %d.", constant, place.length);
+            set_c_error(m->program, message);
+            ok = false;
+        }
+        buffer_appendf(buffer, "%d", constant);
+    } else {
+        buffer_append(buffer, "mc_index(");
+        ok = append_expression(m, node->operands[1], buffer);
+        buffer_appendf(buffer, ", %d)", place.length);
+    }
+    buffer_append(buffer, "]");
+    free_place(&place);
+    return ok;
+}
+
+static const char* binary_operator(OpType type)
+{
+    switch (type) {
+        case OP_DIVISION:              return "/";
+        case OP_MODULO:                return "%";
+        case OP_LOGICAL_AND:           return "&&";
+        case OP_LOGICAL_OR:            return "||";
+        case OP_EQUAL:                 return "==";
+        case OP_NOT_EQUAL:             return "!=";
+        case OP_LESS_THAN:             return "<";
+        case OP_LESS_THAN_OR_EQUAL:    return "<=";
+        case OP_GREATER_THAN:          return ">";
+        case OP_GREATER_THAN_OR_EQUAL: return ">=";
+        default:                       return NULL;
+    }
+}
+
+// +, - and * wrap around like the VM's 64-bit cells, so they go through
+// unsigned helpers instead of overflowing a signed C int.
+static const char* wrapping_helper(OpType type)
+{
+    switch (type) {
+        case OP_ADDITION:       return "mc_add";
+        case OP_SUBTRACTION:    return "mc_sub";
+        case OP_MULTIPLICATION: return "mc_mul";
+        default:                return NULL;
+    }
+}
+
+static bool append_assignment(CMethod* m, const OpNode* node, bool statement, CBuffer* buffer);
+
+static bool append_expression(CMethod* m, const OpNode* node, CBuffer* buffer)
+{
+    if (!node) {
+        buffer_append(buffer, "0");
+        return true;
+    }
+
+    switch (node->type) {
+        case OP_LITERAL: {
+            int value = 0;
+            literal_value(node, &value);
+            append_literal(buffer, value);
+            return true;
+        }
+        case OP_IDENTIFIER:
+        case OP_MEMBER_ACCESS: {
+            CPlace place;
+            if (!resolve_place(m, node, &place)) {
+                return false;
+            }
+            bool ok = place.kind == C_PLACE_SCALAR;
+            if (ok) {
+                buffer_append(buffer, place.expr);
+            } else {
+                method_error(m, "'%s' is not a scalar value", node->text);
+            }
+            free_place(&place);
+            return ok;
+        }
+        case OP_ARRAY_INDEX:
+            return append_element(m, node, buffer);
+        case OP_ADDITION:
+        case OP_SUBTRACTION:
+        case OP_MULTIPLICATION:
+        case OP_DIVISION:
+        case OP_MODULO:
+        case OP_LOGICAL_AND:
+        case OP_LOGICAL_OR:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_LESS_THAN:
+        case OP_LESS_THAN_OR_EQUAL:
+        case OP_GREATER_THAN:
+        case OP_GREATER_THAN_OR_EQUAL: {
+            if (node->operand_count == 0) {
+                break;
+            }
+            // Operands fold from the left, as in the VM's evaluation order.
+            CBuffer value;
+            memset(&value, 0, sizeof(value));
+            bool ok = append_expression(m, node->operands[0], &value);
+            for (int i = 1; ok && i < node->operand_count; i++) {
+                CBuffer next;
+                memset(&next, 0, sizeof(next));
+                const char* helper = wrapping_helper(node->type);
+                char* left = buffer_take(&value);
+                if (helper) {
+                    buffer_appendf(&next, "%s(", helper);
+                    buffer_append(&next, left);
+                    buffer_append(&next, ", ");
+                } else {
+                    buffer_append(&next, "(");
+                    buffer_append(&next, left);
+                    buffer_appendf(&next, " %s ", binary_operator(node->type));
+                }
+                free(left);
+                ok = append_expression(m, node->operands[i], &next);
+                buffer_append(&next, ")");
+                value = next;
+            }
+            char* text = buffer_take(&value);
+            buffer_append(buffer, text);
+            free(text);
+            return ok;
+        }
+        case OP_UNARY_PLUS:
+            if (node->operand_count != 1) {
+                break;
+            }
+            return append_expression(m, node->operands[0], buffer);
+        case OP_UNARY_MINUS:
+        case OP_LOGICAL_NOT: {
+            if (node->operand_count != 1) {
+                break;
+            }
+            buffer_append(buffer, node->type == OP_UNARY_MINUS ? "mc_sub(0, " : "!(");
+            bool ok = append_expression(m, node->operands[0], buffer);
+            buffer_append(buffer, ")");
+            return ok;
+        }
+        case OP_FUNCTION_CALL:
+        case OP_MEMBER_CALL: {
+            // A call without a result reads as 0 in a value context.
+            const SubprogramInfo* callee = resolve_callee(m, node);
+            bool has_value = has_scalar_result(callee);
+            if (callee && returns_value(callee) && !is_scalar_type(callee->return_type)) {
+                method_error(m, "Class value returned by '%s' used as a scalar", node->text);
+                return false;
+            }
+            buffer_append(buffer, has_value ? "" : "(");
+            bool ok = append_call(m, node, buffer);
+            buffer_append(buffer, has_value ? "" : ", (mc_int)0)");
+            return ok;
+        }
+        case OP_ASSIGNMENT: {
+            buffer_append(buffer, "(");
+            bool ok = append_assignment(m, node, false, buffer);
+            buffer_append(buffer, ", (mc_int)0)");
+            return ok;
+        }
+        default:
+            break;
+    }
+
+    method_error(m, "%s is not supported by the C backend", opTypeToString(node->type));
+    return false;
+}
+
+// Appends an assignment without the trailing semicolon. A class value stored
+// into part of another value is copied slot by slot, which needs a statement.
+static bool append_assignment(CMethod* m, const OpNode* node, bool statement, CBuffer* buffer)
+{
+    if (node->operand_count < 2) {
+        method_error(m, "%s is not supported by the C backend", opTypeToString(node->type));
+        return false;
+    }
+
+    const OpNode* target = node->operands[0];
+    if (target && target->type == OP_ARRAY_INDEX) {
+        bool ok = append_element(m, target, buffer);
+        buffer_append(buffer, " = ");
+        return ok && append_expression(m, node->operands[1], buffer);
+    }
+
+    CPlace place;
+    if (!resolve_place(m, target, &place)) {
+        if (!m->program->has_error) {
+            method_error(m, "Assignment target '%s' is not supported by the C backend", target ? target->text : NULL);
+        }
+        return false;
+    }
+
+    bool ok = true;
+    if (place.kind == C_PLACE_SCALAR) {
+        buffer_appendf(buffer, "%s = ", place.expr);
+        ok = append_expression(m, node->operands[1], buffer);
+    } else if (place.kind == C_PLACE_CLASS && place.slot == 0 && strcmp(place.layout->type->name, place.type_name) == 0) {
+        buffer_appendf(buffer, "%s = ", place.expr);
+        ok = append_class_expression(m, node->operands[1], place.type_name, buffer);
+    } else if (place.kind == C_PLACE_CLASS && statement) {
+        const CTypeLayout* layout = find_layout(m->program, place.type_name);
+        int temp = m->next_temp++;
+        buffer_appendf(buffer, "{ struct %s mc_t%d = ", layout->tag, temp);
+        ok = append_class_expression(m, node->operands[1], place.type_name, buffer);
+        buffer_append(buffer, ";");
+        for (int slot = 0; slot < layout->slot_count; slot++) {
+            char source[64];
+            snprintf(source, sizeof(source), "mc_t%d", temp);
+            buffer_append(buffer, " ");
+            append_slot(buffer, place.layout, place.expr, place.slot + slot);
+            buffer_append(buffer, " = ");
+            append_slot(buffer, layout, source, slot);
+            buffer_append(buffer, ";");
+        }
+        buffer_append(buffer, " }");
+    } else {
+        method_error(m, "Assignment to '%s' is not supported by the C backend", target->text);
+        ok = false;
+    }
+    free_place(&place);
+    return ok;
+}
+
+// --- Statements ---
+
+static bool contains_call(const OpNode* node)
+{
+    if (!node) {
+        return false;
+    }
+    if (node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL) {
+        return true;
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        if (contains_call(node->operands[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True when two calls meet as operands C evaluates in no fixed order.
+// `and`/`or` sequence their operands, and a call's arguments run before it.
+static bool has_unsequenced_calls(const OpNode* node)
+{
+    if (!node) {
+        return false;
+    }
+
+    int operands_with_calls = 0;
+    for (int i = 0; i < node->operand_count; i++) {
+        if (has_unsequenced_calls(node->operands[i])) {
+            return true;
+        }
+        operands_with_calls += contains_call(node->operands[i]) ? 1 : 0;
+    }
+    return operands_with_calls >= 2 && node->type != OP_LOGICAL_AND && node->type != OP_LOGICAL_OR;
+}
+
+static bool add_temp(CMethod* m, const OpNode* node, int id)
+{
+    if (m->temp_count >= m->temp_capacity) {
+        int capacity = m->temp_capacity > 0 ? m->temp_capacity * 2 : 8;
+        const OpNode** nodes = realloc(m->temp_nodes, sizeof(OpNode*) * capacity);
+        if (nodes) {
+            m->temp_nodes = nodes;
+        }
+        int* ids = nodes ? realloc(m->temp_ids, sizeof(int) * capacity) : NULL;
+        if (!ids) {
+            set_c_error(m->program, "Out of memory while generating C.");
+            return false;
+        }
+        m->temp_ids = ids;
+        m->temp_capacity = capacity;
+    }
+
+    m->temp_nodes[m->temp_count] = node;
+    m->temp_ids[m->temp_count] = id;
+    m->temp_count++;
+    return true;
+}
+
+// C leaves the order of operand evaluation open, but read() and other calls
+// with effects must run left to right as on the VM. Scalar calls are therefore
+// evaluated into temporaries first, innermost first. Operands after the
+// first of `and`/`or` only run conditionally and are left in place.
+static void hoist_calls(CMethod* m, const OpNode* node, const char* indent)
+{
+    if (!node || m->program->has_error) {
+        return;
+    }
+
+    bool short_circuit = node->type == OP_LOGICAL_AND || node->type == OP_LOGICAL_OR;
+    int operand_count = short_circuit && node->operand_count > 0 ? 1 : node->operand_count;
+    for (int i = 0; i < operand_count; i++) {
+        hoist_calls(m, node->operands[i], indent);
+    }
+
+    if (node->type != OP_FUNCTION_CALL && node->type != OP_MEMBER_CALL) {
+        return;
+    }
+    const SubprogramInfo* callee = resolve_callee(m, node);
+    if (!has_scalar_result(callee)) {
+        return;
+    }
+
+    int id = m->next_temp++;
+    buffer_appendf(m->out, "%s    mc_int mc_t%d = ", indent, id);
+    append_call(m, node, m->out);
+    buffer_append(m->out, ";\n");
+    add_temp(m, node, id);
+}
+
+// Opens a block holding the hoisted calls of node when it needs one.
+static bool begin_statement(CMethod* m, const OpNode* node)
+{
+    m->temp_count = 0;
+    if (!has_unsequenced_calls(node)) {
+        return false;
+    }
+
+    buffer_append(m->out, "    {\n");
+    hoist_calls(m, node, "    ");
+    return true;
+}
+
+static void end_statement(CMethod* m, bool opened)
+{
+    m->temp_count = 0;
+    if (opened) {
+        buffer_append(m->out, "    }\n");
+    }
+}
+
+static void emit_statement(CMethod* m, const OpNode* node)
+{
+    if (!node || m->program->has_error) {
+        return;
+    }
+
+    bool opened = begin_statement(m, node);
+    buffer_append(m->out, opened ? "        " : "    ");
+    if (node->type == OP_ASSIGNMENT) {
+        append_assignment(m, node, true, m->out);
+    } else if (node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL) {
+        append_call(m, node, m->out);
+    } else {
+        buffer_append(m->out, "(void)");
+        append_expression(m, node, m->out);
+    }
+    buffer_append(m->out, ";\n");
+    end_statement(m, opened);
+}
+
+// A method's value is its last expression before the exit, as on the VM.
+static void emit_tail_value(CMethod* m, const OpNode* node)
+{
+    bool is_call = node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL;
+    const SubprogramInfo* callee = is_call ? resolve_callee(m, node) : NULL;
+    if (node->type == OP_ASSIGNMENT || (is_call && !has_scalar_result(callee) && !returns_value(callee))) {
+        emit_statement(m, node);
+        if (is_scalar_type(m->info->return_type)) {
+            buffer_append(m->out, "    mc_result = 0;\n");
+        }
+        return;
+    }
+
+    bool opened = begin_statement(m, node);
+    buffer_append(m->out, opened ? "        mc_result = " : "    mc_result = ");
+    if (is_scalar_type(m->info->return_type)) {
+        append_expression(m, node, m->out);
+    } else {
+        append_class_expression(m, node, m->info->return_type, m->out);
+    }
+    buffer_append(m->out, ";\n");
+    end_statement(m, opened);
+}
+
+static int find_node_index(const ControlFlowGraph* cfg, const CFGNode* node)
+{
+    for (int i = 0; node && i < cfg->node_count; i++) {
+        if (cfg->nodes[i] == node) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const CFGNode* default_successor(const CFGNode* node)
+{
+    bool conditional = node->type == NODE_IF || node->type == NODE_WHILE || node->type == NODE_REPEAT_CONDITION;
+    if (conditional && node->stmt_count > 0) {
+        return node->nextDefault;
+    }
+    return node->nextDefault ? node->nextDefault : node->nextConditional;
+}
+
+static bool has_condition(const CFGNode* node)
+{
+    bool conditional = node->type == NODE_IF || node->type == NODE_WHILE || node->type == NODE_REPEAT_CONDITION;
+    return conditional && node->stmt_count > 0 && node->nextConditional;
+}
+
+// A branch whose true edge leads to the next node jumps on the negated
+// condition instead, so the true path falls through.
+static bool inverts_condition(const ControlFlowGraph* cfg, int index)
+{
+    const CFGNode* node = cfg->nodes[index];
+    int fallback = find_node_index(cfg, default_successor(node));
+    return find_node_index(cfg, node->nextConditional) == index + 1 && fallback >= 0 && fallback != index + 1;
+}
+
+// Falls through into the next node when the edge allows it.
+static void emit_transfer(CMethod* m, int from, const CFGNode* target)
+{
+    const ControlFlowGraph* cfg = m->info->cfg;
+    int index = find_node_index(cfg, target);
+    if (index < 0) {
+        buffer_append(m->out, returns_value(m->info) ? "    return mc_result;\n" : "    return;\n");
+    } else if (index != from + 1) {
+        buffer_appendf(m->out, "    goto n%d;\n", index);
+    }
+}
+
+static void emit_node(CMethod* m, int index)
+{
+    const CFGNode* node = m->info->cfg->nodes[index];
+    if (m->referenced[index]) {
+        buffer_appendf(m->out, "n%d:\n", index);
+    }
+
+    if (node->type == NODE_EXIT) {
+        buffer_append(m->out, returns_value(m->info) ? "    return mc_result;\n" : "    return;\n");
+        return;
+    }
+
+    if (has_condition(node)) {
+        for (int i = 0; i < node->stmt_count - 1; i++) {
+            emit_statement(m, node->statements[i]);
+        }
+        const OpNode* condition = node->statements[node->stmt_count - 1];
+        bool inverted = inverts_condition(m->info->cfg, index);
+        const CFGNode* target = inverted ? default_successor(node) : node->nextConditional;
+        bool opened = begin_statement(m, condition);
+        buffer_append(m->out, opened ? "        if (" : "    if (");
+        buffer_append(m->out, inverted ? "!" : "");
+        append_expression(m, condition, m->out);
+        buffer_appendf(m->out, ") goto n%d;\n", find_node_index(m->info->cfg, target));
+        end_statement(m, opened);
+        if (!inverted) {
+            emit_transfer(m, index, default_successor(node));
+        }
+        return;
+    }
+
+    bool tail_value = returns_value(m->info) && node->stmt_count > 0 && node->nextDefault
+        && node->nextDefault->type == NODE_EXIT && !node->nextConditional;
+    int statement_count = tail_value ? node->stmt_count - 1 : node->stmt_count;
+    for (int i = 0; i < statement_count; i++) {
+        emit_statement(m, node->statements[i]);
+    }
+    if (tail_value) {
+        emit_tail_value(m, node->statements[node->stmt_count - 1]);
+    }
+    emit_transfer(m, index, default_successor(node));
+}
+
+static void mark_referenced(const ControlFlowGraph* cfg, bool* referenced)
+{
+    int entry = find_node_index(cfg, cfg->entry);
+    if (entry > 0) {
+        referenced[entry] = true;
+    }
+    for (int i = 0; i < cfg->node_count; i++) {
+        const CFGNode* node = cfg->nodes[i];
+        if (node->type == NODE_EXIT) {
+            continue;
+        }
+        if (has_condition(node) && !inverts_condition(cfg, i)) {
+            referenced[find_node_index(cfg, node->nextConditional)] = true;
+        }
+        int next = find_node_index(cfg, default_successor(node));
+        if (next >= 0 && next != i + 1) {
+            referenced[next] = true;
+        }
+    }
+}
+
+static bool append_c_type(CMethod* m, const char* type_name, CBuffer* buffer)
+{
+    const CTypeLayout* layout = find_layout(m->program, type_name);
+    if (layout) {
+        buffer_appendf(buffer, "struct %s", layout->tag);
+        return true;
+    }
+    if (is_scalar_type(type_name)) {
+        buffer_append(buffer, "mc_int");
+        return true;
+    }
+    return false;
+}
+
+static void append_signature(CMethod* m, CBuffer* buffer)
+{
+    const SubprogramInfo* info = m->info;
+    buffer_append(buffer, "static ");
+    if (!returns_value(info)) {
+        buffer_append(buffer, "void");
+    } else if (!append_c_type(m, info->return_type, buffer)) {
+        method_error(m, "Return type '%s' is not supported by the C backend", info->return_type);
+        return;
+    }
+
+    char* symbol = make_symbol(info);
+    buffer_appendf(buffer, " %s(", symbol ? symbol : "");
+    free(symbol);
+
+    bool first = true;
+    if (m->self_layout) {
+        buffer_appendf(buffer, "struct %s self", m->self_layout->tag);
+        first = false;
+    }
+    for (int i = 0; i < info->param_count; i++) {
+        buffer_append(buffer, first ? "" : ", ");
+        first = false;
+        if (!append_c_type(m, info->param_types[i], buffer)) {
+            method_error(m, "Parameter type '%s' is not supported by the C backend", info->param_types[i]);
+            return;
+        }
+        char* name = make_identifier("v_", info->param_names[i]);
+        buffer_appendf(buffer, " %s", name ? name : "");
+        free(name);
+    }
+    buffer_append(buffer, first ? "void)" : ")");
+}
+
+static void emit_locals(CMethod* m)
+{
+    const SubprogramInfo* info = m->info;
+    for (int i = 0; i < info->local_count; i++) {
+        const char* type_name = info->local_types ? info->local_types[i] : NULL;
+        char* name = make_identifier("v_", info->local_names[i]);
+        int length = 0;
+        int dimensions = 0;
+        const char* element_type = NULL;
+        if (getArrayTypeShape(type_name, &length, &dimensions, &element_type)) {
+            if (dimensions != 1 || length <= 0 || !is_scalar_type(element_type)) {
+                method_error(m, "Array type '%s' is not supported by the C backend", type_name);
+            } else {
+                buffer_appendf(m->out, "    mc_int %s[%d] = { 0 };\n", name ? name : "", length);
+            }
+        } else {
+            buffer_append(m->out, "    ");
+            if (!append_c_type(m, type_name, m->out)) {
+                method_error(m, "Variable of type '%s' is not supported by the C backend", type_name);
+            }
+            buffer_appendf(m->out, " %s = %s;\n", name ? name : "", find_layout(m->program, type_name) ? "{ 0 }" : "0");
+        }
+        free(name);
+    }
+
+    if (returns_value(info)) {
+        buffer_append(m->out, "    ");
+        append_c_type(m, info->return_type, m->out);
+        buffer_appendf(m->out, " mc_result = %s;\n", is_scalar_type(info->return_type) ? "0" : "{ 0 }");
+    }
+
+    // The source may ignore a parameter or local; the casts keep the output
+    // free of -Wunused warnings under -Wall -Wextra.
+    if (m->self_layout) {
+        buffer_append(m->out, "    (void)self;\n");
+    }
+    for (int i = 0; i < info->param_count; i++) {
+        char* name = make_identifier("v_", info->param_names[i]);
+        buffer_appendf(m->out, "    (void)%s;\n", name ? name : "");
+        free(name);
+    }
+    for (int i = 0; i < info->local_count; i++) {
+        char* name = make_identifier("v_", info->local_names[i]);
+        buffer_appendf(m->out, "    (void)%s;\n", name ? name : "");
+        free(name);
+    }
+}
+
+static bool is_emitted(const SubprogramInfo* info)
+{
+    return info->name && info->has_body && info->cfg && !info->import_info.is_imported;
+}
+
+static void mark_calls(const CProgram* program, const OpNode* node, bool* reachable, int* worklist, int* pending)
+{
+    if (!node) {
+        return;
+    }
+    if (node->type == OP_FUNCTION_CALL || node->type == OP_MEMBER_CALL) {
+        const SubprogramInfo* callee = find_callee(program, node);
+        int index = callee ? (int)(callee - program->subprograms->items) : -1;
+        if (index >= 0 && index < program->subprograms->count && !reachable[index]) {
+            reachable[index] = true;
+            worklist[(*pending)++] = index;
+        }
+    }
+    for (int i = 0; i < node->operand_count; i++) {
+        mark_calls(program, node->operands[i], reachable, worklist, pending);
+    }
+}
+
+// Methods main can reach through resolved calls. Only these are emitted, so
+// the output has no unused static functions. NULL when out of memory.
+static bool* mark_reachable_methods(const CProgram* program, int main_index)
+{
+    int count = program->subprograms->count;
+    bool* reachable = calloc((size_t)(count > 0 ? count : 1), sizeof(bool));
+    int* worklist = malloc(sizeof(int) * (size_t)(count > 0 ? count : 1));
+    if (!reachable || !worklist) {
+        free(reachable);
+        free(worklist);
+        return NULL;
+    }
+
+    int pending = 0;
+    reachable[main_index] = true;
+    worklist[pending++] = main_index;
+    while (pending > 0) {
+        const SubprogramInfo* info = &program->subprograms->items[worklist[--pending]];
+        const ControlFlowGraph* cfg = info->cfg;
+        for (int i = 0; cfg && i < cfg->node_count; i++) {
+            for (int s = 0; s < cfg->nodes[i]->stmt_count; s++) {
+                mark_calls(program, cfg->nodes[i]->statements[s], reachable, worklist, &pending);
+            }
+        }
+    }
+
+    free(worklist);
+    return reachable;
+}
+
+static void generate_method(CProgram* program, const SubprogramInfo* info, CBuffer* prototypes, CBuffer* bodies)
+{
+    CMethod m;
+    memset(&m, 0, sizeof(m));
+    m.program = program;
+    m.info = info;
+    m.out = bodies;
+    if (info->owner_type_name) {
+        m.self_layout = find_layout(program, info->owner_type_name);
+        if (!m.self_layout) {
+            method_error(&m, "Methods of '%s' are not supported by the C backend", info->owner_type_name);
+            return;
+        }
+    }
+
+    const ControlFlowGraph* cfg = info->cfg;
+    m.referenced = calloc((size_t)(cfg->node_count > 0 ? cfg->node_count : 1), sizeof(bool));
+    if (!m.referenced) {
+        set_c_error(program, "Out of memory while generating C.");
+        return;
+    }
+    mark_referenced(cfg, m.referenced);
+
+    append_signature(&m, prototypes);
+    buffer_append(prototypes, ";\n");
+    append_signature(&m, bodies);
+    buffer_append(bodies, "\n{\n");
+    emit_locals(&m);
+
+    int entry = find_node_index(cfg, cfg->entry);
+    if (entry > 0) {
+        buffer_appendf(bodies, "    goto n%d;\n", entry);
+    }
+    for (int i = 0; i < cfg->node_count && !program->has_error; i++) {
+        emit_node(&m, i);
+    }
+    buffer_append(bodies, "}\n\n");
+
+    free(m.referenced);
+    free(m.temp_nodes);
+    free(m.temp_ids);
+}
+
+static const char* const C_RUNTIME =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "typedef long long mc_int;\n"
+    "\n"
+    "static inline mc_int mc_read(void)\n"
+    "{\n"
+    "    mc_int value = 0;\n"
+    "    if (scanf(\"%lld\", &value) != 1) {\n"
+    "        return 0;\n"
+    "    }\n"
+    "    return value;\n"
+    "}\n"
+    "\n"
+    "static inline void mc_write(mc_int value)\n"
+    "{\n"
+    "    printf(\"%lld\\n\", value);\n"
+    "}\n"
+    "\n"
+    "/* Out-of-range indexes stop the program, as chkb halts the VM. */\n"
+    "static inline mc_int mc_index(mc_int index, mc_int length)\n"
+    "{\n"
+    "    if (index < 0 || index >= length) {\n"
+    "        exit(0);\n"
+    "    }\n"
+    "    return index;\n"
+    "}\n"
+    "\n"
+    "static inline mc_int mc_add(mc_int a, mc_int b) { return (mc_int)((unsigned long long)a + (unsigned long long)b); }\n"
+    "static inline mc_int mc_sub(mc_int a, mc_int b) { return (mc_int)((unsigned long long)a - (unsigned long long)b); }\n"
+    "static inline mc_int mc_mul(mc_int a, mc_int b) { return (mc_int)((unsigned long long)a * (unsigned long long)b); }\n"
+    "\n";
+
+bool generateProgramC(const SubprogramCollection* subprograms, FILE* out, char** error_message)
+{
+    if (error_message) {
+        *error_message = NULL;
+    }
+
+    if (!subprograms || !out) {
+        if (error_message) {
+            *error_message = strdup("Subprogram collection is null.");
+        }
+        return false;
+    }
+
+    annotateSubprogramCollection(subprograms);
+
+    CProgram program;
+    memset(&program, 0, sizeof(program));
+    program.subprograms = subprograms;
+
+    int main_index = -1;
+    for (int i = 0; i < subprograms->count && main_index < 0; i++) {
+        const SubprogramInfo* info = &subprograms->items[i];
+        if (info->name && !info->owner_type_name && strcmp(info->name, "main") == 0
+            && info->param_count == 0 && info->has_body) {
+            main_index = i;
+        }
+    }
+    if (main_index < 0) {
+        set_c_error(&program, "The C backend needs a main() method with a body.");
+    }
+
+    program.layouts = calloc((size_t)(subprograms->user_type_count > 0 ? subprograms->user_type_count : 1),
+                             sizeof(CTypeLayout));
+    if (!program.layouts) {
+        set_c_error(&program, "Out of memory while generating C.");
+    }
+    for (int i = 0; !program.has_error && i < subprograms->user_type_count; i++) {
+        const UserTypeInfo* type = &subprograms->user_types[i];
+        if (type->kind != USER_TYPE_CLASS) {
+            continue;
+        }
+        if (!build_layout(subprograms, type, &program.layouts[program.layout_count++])) {
+            set_c_error(&program, "Out of memory while generating C.");
+        }
+    }
+
+    bool* reachable = NULL;
+    if (!program.has_error) {
+        reachable = mark_reachable_methods(&program, main_index);
+        if (!reachable) {
+            set_c_error(&program, "Out of memory while generating C.");
+        }
+    }
+
+    CBuffer prototypes;
+    CBuffer bodies;
+    memset(&prototypes, 0, sizeof(prototypes));
+    memset(&bodies, 0, sizeof(bodies));
+    for (int i = 0; i < subprograms->count && !program.has_error; i++) {
+        if (reachable[i] && is_emitted(&subprograms->items[i])) {
+            generate_method(&program, &subprograms->items[i], &prototypes, &bodies);
+        }
+    }
+    free(reachable);
+    if (prototypes.failed || bodies.failed) {
+        set_c_error(&program, "Out of memory while generating C.");
+    }
+
+    bool ok = !program.has_error;
+    if (ok) {
+        const char* source = subprograms->count > 0 ? subprograms->items[0].source_file : NULL;
+        fprintf(out, "/* Generated by MyCompiler%s%s. Build with a C11 compiler, e.g. cc -O2. */\n",
+                source ? " from " : "", source ? source : "");
+        fputs(C_RUNTIME, out);
+        for (int i = 0; i < program.layout_count; i++) {
+            print_layout(&program.layouts[i], out);
+        }
+        fprintf(out, "%s\n%s", prototypes.data ? prototypes.data : "", bodies.data ? bodies.data : "");
+        fprintf(out, "int main(void)\n{\n    MC_main();\n    return 0;\n}\n");
+    } else if (error_message) {
+        *error_message = strdup(program.error_message);
+    }
+
+    for (int i = 0; i < program.layout_count; i++) {
+        free_layout(&program.layouts[i]);
+    }
+    free(program.layouts);
+    free(prototypes.data);
+    free(bodies.data);
+    return ok;
+}
@@ -0,0 +1,16 @@
+#ifndef TO_C_MODULE_H
+#define TO_C_MODULE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cfg_builder_module.h"
+
+// Writes one self-contained C11 translation unit for the whole program.
+// Every method with a body becomes a static function MC_<asm_name> whose CFG
+// nodes are labels joined by gotos; each class becomes a struct with one
+// field per flattened slot. read()/write() use stdio, and the generated C
+// main calls MC_main. Build with `cc -O2 program.c`.
+bool generateProgramC(const SubprogramCollection* subprograms, FILE* out, char** error_message);
+
+#endif
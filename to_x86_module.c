@@ -0,0 +1,1313 @@
+#include "to_x86_module.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "to_asm_module.h"
+
+#define X86_SYMBOL_PREFIX "MC_"
+#define X86_READ_SYMBOL "mc_read"
+#define X86_WRITE_SYMBOL "mc_write"
+#define X86_ARG_REGISTER_COUNT 6
+#define X86_CALLEE_SAVED_COUNT 5
+#define X86_REGISTER_COUNT 9
+
+// Three-address code over virtual registers. Every method variable owns one
+// vreg for its whole life; temporaries get fresh ones.
+typedef enum {
+    X86_IR_CONST,     // dst = imm
+    X86_IR_PARAM,     // dst = incoming argument imm
+    X86_IR_COPY,      // dst = a
+    X86_IR_BINARY,    // dst = a op b (b < 0: op imm)
+    X86_IR_NEGATE,    // dst = -a
+    X86_IR_COMPARE,   // dst = a op b ? 1 : 0 (b < 0: op imm)
+    X86_IR_LABEL,
+    X86_IR_JUMP,
+    X86_IR_BRANCH,    // if (a op b) goto label (b < 0: op imm)
+    X86_IR_CALL,      // dst = symbol(args), dst < 0 discards the result
+    X86_IR_RETURN     // return a, or 0 when a < 0
+} X86IrKind;
+
+typedef struct {
+    X86IrKind kind;
+    OpType op;
+    int dst;
+    int a;
+    int b;
+    long long imm;
+    int label;
+    char* symbol;
+    int* args;
+    int arg_count;
+} X86Ir;
+
+typedef struct {
+    const SubprogramCollection* subprograms;
+    const SubprogramInfo* info;
+    char* symbol;
+    X86Ir* code;
+    int count;
+    int capacity;
+    int vreg_count;
+    int label_count;
+    const char** var_names;
+    int* var_vregs;
+    int var_count;
+    int* node_labels;
+    int result_vreg;
+    bool has_error;
+    char error_message[256];
+} X86Function;
+
+// Where each vreg lives after linear scan: a register index, or a frame slot.
+typedef struct {
+    int* reg;
+    int* slot;
+    int slot_count;
+    bool used_regs[X86_REGISTER_COUNT];
+} X86Allocation;
+
+// Callee-saved registers come first: they are the only ones that may hold a
+// value across a call. rax, rcx, rdx, r10 and r11 stay free as scratch.
+static const char* const X86_REGISTERS[X86_REGISTER_COUNT] = {
+    "%rbx", "%r12", "%r13", "%r14", "%r15", "%rsi", "%rdi", "%r8", "%r9"
+};
+
+static const char* const X86_ARG_REGISTERS[X86_ARG_REGISTER_COUNT] = {
+    "%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"
+};
+
+static bool x86_equals_ignore_case(const char* a, const char* b)
+{
+    if (!a || !b) {
+        return false;
+    }
+
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) {
+            return false;
+        }
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static void set_x86_error(X86Function* fn, const char* message)
+{
+    if (fn->has_error) {
+        return;
+    }
+
+    fn->has_error = true;
+    snprintf(fn->error_message, sizeof(fn->error_message), "%s", message ? message : "");
+}
+
+static char* make_symbol(const SubprogramInfo* info)
+{
+    const char* name = info->asm_name ? info->asm_name : info->name;
+    size_t length = strlen(X86_SYMBOL_PREFIX) + strlen(name) + 1;
+    char* symbol = malloc(length);
+    if (!symbol) {
+        return NULL;
+    }
+
+    snprintf(symbol, length, "%s%s", X86_SYMBOL_PREFIX, name);
+    for (char* p = symbol; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_') {
+            *p = '_';
+        }
+    }
+    return symbol;
+}
+
+static bool is_scalar_type(const char* type_name)
+{
+    return !type_name
+        || x86_equals_ignore_case(type_name, "bool")
+        || x86_equals_ignore_case(type_name, "byte")
+        || x86_equals_ignore_case(type_name, "int")
+        || x86_equals_ignore_case(type_name, "uint")
+        || x86_equals_ignore_case(type_name, "long")
+        || x86_equals_ignore_case(type_name, "ulong")
+        || x86_equals_ignore_case(type_name, "char");
+}
+
+static bool returns_value(const SubprogramInfo* info)
+{
+    return info && info->return_type && !x86_equals_ignore_case(info->return_type, "void");
+}
+
+// Declaration-only read()/write(int) are the I/O builtins, as in the VM backend.
+static bool is_builtin_declaration(const SubprogramInfo* info, const char* name, int param_count)
+{
+    if (!info || info->owner_type_name || info->has_body || info->import_info.is_imported
+        || !x86_equals_ignore_case(info->name, name) || info->param_count != param_count) {
+        return false;
+    }
+    return param_count == 0 || x86_equals_ignore_case(info->param_types[0], "int");
+}
+
+static int ir_add(X86Function* fn, X86Ir ir)
+{
+    if (fn->count >= fn->capacity) {
+        int capacity = fn->capacity > 0 ? fn->capacity * 2 : 64;
+        X86Ir* code = realloc(fn->code, sizeof(X86Ir) * capacity);
+        if (!code) {
+            free(ir.symbol);
+            free(ir.args);
+            set_x86_error(fn, "Out of memory while lowering to x86-64.");
+            return -1;
+        }
+        fn->code = code;
+        fn->capacity = capacity;
+    }
+
+    fn->code[fn->count] = ir;
+    return fn->count++;
+}
+
+static X86Ir ir_make(X86IrKind kind)
+{
+    X86Ir ir;
+    memset(&ir, 0, sizeof(ir));
+    ir.kind = kind;
+    ir.dst = -1;
+    ir.a = -1;
+    ir.b = -1;
+    ir.label = -1;
+    return ir;
+}
+
+static int new_vreg(X86Function* fn)
+{
+    return fn->vreg_count++;
+}
+
+static int new_label(X86Function* fn)
+{
+    return fn->label_count++;
+}
+
+static void ir_const(X86Function* fn, int dst, long long value)
+{
+    X86Ir ir = ir_make(X86_IR_CONST);
+    ir.dst = dst;
+    ir.imm = value;
+    ir_add(fn, ir);
+}
+
+static void ir_copy(X86Function* fn, int dst, int src)
+{
+    if (dst == src) {
+        return;
+    }
+    X86Ir ir = ir_make(X86_IR_COPY);
+    ir.dst = dst;
+    ir.a = src;
+    ir_add(fn, ir);
+}
+
+static void ir_label(X86Function* fn, int label)
+{
+    X86Ir ir = ir_make(X86_IR_LABEL);
+    ir.label = label;
+    ir_add(fn, ir);
+}
+
+static void ir_jump(X86Function* fn, int label)
+{
+    X86Ir ir = ir_make(X86_IR_JUMP);
+    ir.label = label;
+    ir_add(fn, ir);
+}
+
+static int find_var_vreg(const X86Function* fn, const char* name)
+{
+    for (int i = 0; name && i < fn->var_count; i++) {
+        if (strcmp(fn->var_names[i], name) == 0) {
+            return fn->var_vregs[i];
+        }
+    }
+    return -1;
+}
+
+static bool literal_value(const OpNode* node, long long* value)
+{
+    int parsed = 0;
+    if (!node || node->type != OP_LITERAL || !parseIntLiteral(node->text, &parsed)) {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+static OpType negate_relation(OpType type)
+{
+    switch (type) {
+        case OP_LESS_THAN:             return OP_GREATER_THAN_OR_EQUAL;
+        case OP_LESS_THAN_OR_EQUAL:    return OP_GREATER_THAN;
+        case OP_GREATER_THAN:          return OP_LESS_THAN_OR_EQUAL;
+        case OP_GREATER_THAN_OR_EQUAL: return OP_LESS_THAN;
+        case OP_EQUAL:                 return OP_NOT_EQUAL;
+        default:                       return OP_EQUAL;
+    }
+}
+
+static bool is_relation(OpType type)
+{
+    return type == OP_EQUAL || type == OP_NOT_EQUAL
+        || type == OP_LESS_THAN || type == OP_LESS_THAN_OR_EQUAL
+        || type == OP_GREATER_THAN || type == OP_GREATER_THAN_OR_EQUAL;
+}
+
+static int lower_expression(X86Function* fn, const OpNode* node);
+static void lower_statement(X86Function* fn, const OpNode* node);
+
+// Right operands that are literals stay immediates in the instruction.
+static void lower_right_operand(X86Function* fn, const OpNode* node, X86Ir* ir)
+{
+    long long value = 0;
+    if (literal_value(node, &value)) {
+        ir->b = -1;
+        ir->imm = value;
+    } else {
+        ir->b = lower_expression(fn, node);
+    }
+}
+
+static const SubprogramInfo* resolve_callee(X86Function* fn, const OpNode* node)
+{
+    if (node->resolved_callee) {
+        return node->resolved_callee;
+    }
+
+    for (int i = 0; i < fn->subprograms->count; i++) {
+        const SubprogramInfo* candidate = &fn->subprograms->items[i];
+        if (!candidate->owner_type_name && candidate->name && strcmp(candidate->name, node->text) == 0
+            && candidate->param_count == node->operand_count) {
+            return candidate;
+        }
+    }
+    return NULL;
+}
+
+static int lower_call(X86Function* fn, const OpNode* node, bool want_value)
+{
+    char buffer[256];
+    const SubprogramInfo* callee = resolve_callee(fn, node);
+    if (!callee) {
+        snprintf(buffer, sizeof(buffer), "Cannot resolve call to '%s' in '%s'.", node->text, fn->info->name);
+        set_x86_error(fn, buffer);
+        return -1;
+    }
+
+    char* symbol = NULL;
+    if (is_builtin_declaration(callee, "read", 0)) {
+        symbol = strdup(X86_READ_SYMBOL);
+    } else if (is_builtin_declaration(callee, "write", 1)) {
+        symbol = strdup(X86_WRITE_SYMBOL);
+        want_value = false;
+    } else if (callee->import_info.is_imported || !callee->has_body || callee->owner_type_name) {
+        snprintf(buffer, sizeof(buffer), "Call to '%s' in '%s' is not supported by the x86-64 backend.",
+                 node->text, fn->info->name);
+        set_x86_error(fn, buffer);
+        return -1;
+    } else {
+        symbol = make_symbol(callee);
+    }
+
+    int* args = node->operand_count > 0 ? malloc(sizeof(int) * node->operand_count) : NULL;
+    if (!symbol || (node->operand_count > 0 && !args)) {
+        free(symbol);
+        free(args);
+        set_x86_error(fn, "Out of memory while lowering to x86-64.");
+        return -1;
+    }
+
+    for (int i = 0; i < node->operand_count; i++) {
+        args[i] = lower_expression(fn, node->operands[i]);
+    }
+
+    X86Ir ir = ir_make(X86_IR_CALL);
+    ir.symbol = symbol;
+    ir.args = args;
+    ir.arg_count = node->operand_count;
+    ir.dst = want_value ? new_vreg(fn) : -1;
+    ir_add(fn, ir);
+    return ir.dst;
+}
+
+// Jumps to label when node evaluates to jump_if_true; otherwise falls through.
+static void lower_condition(X86Function* fn, const OpNode* node, bool jump_if_true, int label)
+{
+    if (!node || fn->has_error) {
+        return;
+    }
+
+    if (node->type == OP_LOGICAL_NOT && node->operand_count == 1) {
+        lower_condition(fn, node->operands[0], !jump_if_true, label);
+        return;
+    }
+
+    if ((node->type == OP_LOGICAL_AND || node->type == OP_LOGICAL_OR) && node->operand_count >= 2) {
+        // An operand equal to the operator's short-circuit value decides it.
+        bool decisive = node->type == OP_LOGICAL_OR;
+        if (decisive == jump_if_true) {
+            for (int i = 0; i < node->operand_count; i++) {
+                lower_condition(fn, node->operands[i], jump_if_true, label);
+            }
+        } else {
+            int skip = new_label(fn);
+            for (int i = 0; i < node->operand_count - 1; i++) {
+                lower_condition(fn, node->operands[i], decisive, skip);
+            }
+            lower_condition(fn, node->operands[node->operand_count - 1], jump_if_true, label);
+            ir_label(fn, skip);
+        }
+        return;
+    }
+
+    X86Ir ir = ir_make(X86_IR_BRANCH);
+    ir.label = label;
+    if (is_relation(node->type) && node->operand_count == 2) {
+        ir.a = lower_expression(fn, node->operands[0]);
+        lower_right_operand(fn, node->operands[1], &ir);
+        ir.op = jump_if_true ? node->type : negate_relation(node->type);
+    } else {
+        ir.a = lower_expression(fn, node);
+        ir.b = -1;
+        ir.imm = 0;
+        ir.op = jump_if_true ? OP_NOT_EQUAL : OP_EQUAL;
+    }
+    ir_add(fn, ir);
+}
+
+static int lower_expression(X86Function* fn, const OpNode* node)
+{
+    char buffer[256];
+    if (!node || fn->has_error) {
+        int dst = new_vreg(fn);
+        ir_const(fn, dst, 0);
+        return dst;
+    }
+
+    switch (node->type) {
+        case OP_LITERAL: {
+            long long value = 0;
+            literal_value(node, &value);
+            int dst = new_vreg(fn);
+            ir_const(fn, dst, value);
+            return dst;
+        }
+        case OP_IDENTIFIER: {
+            int vreg = find_var_vreg(fn, node->text);
+            if (vreg < 0) {
+                snprintf(buffer, sizeof(buffer), "Unknown variable '%s' in '%s'.", node->text, fn->info->name);
+                set_x86_error(fn, buffer);
+                break;
+            }
+            return vreg;
+        }
+        case OP_ADDITION:
+        case OP_SUBTRACTION:
+        case OP_MULTIPLICATION:
+        case OP_DIVISION:
+        case OP_MODULO: {
+            if (node->operand_count == 0) {
+                break;
+            }
+            int value = lower_expression(fn, node->operands[0]);
+            for (int i = 1; i < node->operand_count; i++) {
+                X86Ir ir = ir_make(X86_IR_BINARY);
+                ir.op = node->type;
+                ir.a = value;
+                lower_right_operand(fn, node->operands[i], &ir);
+                ir.dst = new_vreg(fn);
+                value = ir.dst;
+                ir_add(fn, ir);
+            }
+            return value;
+        }
+        case OP_UNARY_PLUS:
+            return node->operand_count == 1 ? lower_expression(fn, node->operands[0]) : 0;
+        case OP_UNARY_MINUS: {
+            if (node->operand_count != 1) {
+                break;
+            }
+            X86Ir ir = ir_make(X86_IR_NEGATE);
+            ir.a = lower_expression(fn, node->operands[0]);
+            ir.dst = new_vreg(fn);
+            ir_add(fn, ir);
+            return ir.dst;
+        }
+        case OP_LOGICAL_NOT: {
+            if (node->operand_count != 1) {
+                break;
+            }
+            X86Ir ir = ir_make(X86_IR_COMPARE);
+            ir.op = OP_EQUAL;
+            ir.a = lower_expression(fn, node->operands[0]);
+            ir.imm = 0;
+            ir.dst = new_vreg(fn);
+            ir_add(fn, ir);
+            return ir.dst;
+        }
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_LESS_THAN:
+        case OP_LESS_THAN_OR_EQUAL:
+        case OP_GREATER_THAN:
+        case OP_GREATER_THAN_OR_EQUAL: {
+            if (node->operand_count != 2) {
+                break;
+            }
+            X86Ir ir = ir_make(X86_IR_COMPARE);
+            ir.op = node->type;
+            ir.a = lower_expression(fn, node->operands[0]);
+            lower_right_operand(fn, node->operands[1], &ir);
+            ir.dst = new_vreg(fn);
+            ir_add(fn, ir);
+            return ir.dst;
+        }
+        case OP_LOGICAL_AND:
+        case OP_LOGICAL_OR: {
+            int dst = new_vreg(fn);
+            int on_false = new_label(fn);
+            int done = new_label(fn);
+            lower_condition(fn, node, false, on_false);
+            ir_const(fn, dst, 1);
+            ir_jump(fn, done);
+            ir_label(fn, on_false);
+            ir_const(fn, dst, 0);
+            ir_label(fn, done);
+            return dst;
+        }
+        case OP_FUNCTION_CALL: {
+            // write() has no result; in a value context it reads as 0.
+            int value = lower_call(fn, node, true);
+            if (value >= 0) {
+                return value;
+            }
+            break;
+        }
+        case OP_ASSIGNMENT:
+            lower_statement(fn, node);
+            break;
+        case OP_MEMBER_ACCESS:
+        case OP_MEMBER_CALL:
+        case OP_ARRAY_INDEX:
+            snprintf(buffer, sizeof(buffer), "%s in '%s' is not supported by the x86-64 backend.",
+                     opTypeToString(node->type), fn->info->name);
+            set_x86_error(fn, buffer);
+            break;
+        default:
+            break;
+    }
+
+    int dst = new_vreg(fn);
+    ir_const(fn, dst, 0);
+    return dst;
+}
+
+static void lower_statement(X86Function* fn, const OpNode* node)
+{
+    if (!node || fn->has_error) {
+        return;
+    }
+
+    if (node->type == OP_ASSIGNMENT && node->operand_count >= 2) {
+        const OpNode* target = node->operands[0];
+        int dst = target && target->type == OP_IDENTIFIER ? find_var_vreg(fn, target->text) : -1;
+        if (dst < 0) {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "Assignment target in '%s' is not supported by the x86-64 backend.",
+                     fn->info->name);
+            set_x86_error(fn, buffer);
+            return;
+        }
+        ir_copy(fn, dst, lower_expression(fn, node->operands[1]));
+        return;
+    }
+
+    if (node->type == OP_FUNCTION_CALL) {
+        lower_call(fn, node, false);
+        return;
+    }
+
+    lower_expression(fn, node);
+}
+
+static int find_node_index(const ControlFlowGraph* cfg, const CFGNode* node)
+{
+    for (int i = 0; node && i < cfg->node_count; i++) {
+        if (cfg->nodes[i] == node) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void lower_transfer(X86Function* fn, const CFGNode* target)
+{
+    int index = find_node_index(fn->info->cfg, target);
+    if (index >= 0) {
+        ir_jump(fn, fn->node_labels[index]);
+    }
+}
+
+// Mirrors the VM backend: a method's value is its last expression before the
+// exit, and 0 when there is none.
+static void lower_node(X86Function* fn, const CFGNode* node)
+{
+    if (node->type == NODE_EXIT) {
+        X86Ir ir = ir_make(X86_IR_RETURN);
+        ir.a = fn->result_vreg;
+        ir_add(fn, ir);
+        return;
+    }
+
+    bool conditional = node->type == NODE_IF || node->type == NODE_WHILE || node->type == NODE_REPEAT_CONDITION;
+    if (conditional && node->stmt_count > 0) {
+        for (int i = 0; i < node->stmt_count - 1; i++) {
+            lower_statement(fn, node->statements[i]);
+        }
+        const OpNode* condition = node->statements[node->stmt_count - 1];
+        if (node->nextConditional) {
+            int index = find_node_index(fn->info->cfg, node->nextConditional);
+            lower_condition(fn, condition, true, fn->node_labels[index]);
+        } else {
+            lower_statement(fn, condition);
+        }
+        lower_transfer(fn, node->nextDefault);
+        return;
+    }
+
+    bool tail_value = fn->result_vreg >= 0 && node->stmt_count > 0 && node->nextDefault
+        && node->nextDefault->type == NODE_EXIT && !node->nextConditional;
+    int statement_count = tail_value ? node->stmt_count - 1 : node->stmt_count;
+    for (int i = 0; i < statement_count; i++) {
+        lower_statement(fn, node->statements[i]);
+    }
+    if (tail_value) {
+        ir_copy(fn, fn->result_vreg, lower_expression(fn, node->statements[node->stmt_count - 1]));
+    }
+
+    lower_transfer(fn, node->nextDefault ? node->nextDefault : node->nextConditional);
+}
+
+static bool add_variable(X86Function* fn, const char* name, const char* type_name)
+{
+    if (!is_scalar_type(type_name)) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "Variable '%s' of type '%s' in '%s' is not supported by the x86-64 backend.",
+                 name, type_name, fn->info->name);
+        set_x86_error(fn, buffer);
+        return false;
+    }
+
+    fn->var_names[fn->var_count] = name;
+    fn->var_vregs[fn->var_count] = new_vreg(fn);
+    fn->var_count++;
+    return true;
+}
+
+static void lower_function(X86Function* fn)
+{
+    const SubprogramInfo* info = fn->info;
+    const ControlFlowGraph* cfg = info->cfg;
+    int capacity = info->param_count + info->local_count;
+    fn->var_names = malloc(sizeof(char*) * (capacity > 0 ? capacity : 1));
+    fn->var_vregs = malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    fn->node_labels = malloc(sizeof(int) * (cfg->node_count > 0 ? cfg->node_count : 1));
+    if (!fn->var_names || !fn->var_vregs || !fn->node_labels) {
+        set_x86_error(fn, "Out of memory while lowering to x86-64.");
+        return;
+    }
+
+    for (int i = 0; i < info->param_count; i++) {
+        if (!add_variable(fn, info->param_names[i], info->param_types[i])) {
+            return;
+        }
+        X86Ir ir = ir_make(X86_IR_PARAM);
+        ir.dst = fn->var_vregs[fn->var_count - 1];
+        ir.imm = i;
+        ir_add(fn, ir);
+    }
+    for (int i = 0; i < info->local_count; i++) {
+        if (!add_variable(fn, info->local_names[i], info->local_types ? info->local_types[i] : NULL)) {
+            return;
+        }
+        ir_const(fn, fn->var_vregs[fn->var_count - 1], 0);
+    }
+
+    fn->result_vreg = -1;
+    if (returns_value(info)) {
+        fn->result_vreg = new_vreg(fn);
+        ir_const(fn, fn->result_vreg, 0);
+    }
+
+    for (int i = 0; i < cfg->node_count; i++) {
+        fn->node_labels[i] = new_label(fn);
+    }
+
+    lower_transfer(fn, cfg->entry);
+    for (int i = 0; i < cfg->node_count && !fn->has_error; i++) {
+        ir_label(fn, fn->node_labels[i]);
+        lower_node(fn, cfg->nodes[i]);
+    }
+}
+
+// --- Liveness and linear-scan allocation ---
+
+static int ir_uses(const X86Ir* ir, int* out)
+{
+    int count = 0;
+    switch (ir->kind) {
+        case X86_IR_COPY:
+        case X86_IR_NEGATE:
+        case X86_IR_RETURN:
+            if (ir->a >= 0) {
+                out[count++] = ir->a;
+            }
+            break;
+        case X86_IR_BINARY:
+        case X86_IR_COMPARE:
+        case X86_IR_BRANCH:
+            out[count++] = ir->a;
+            if (ir->b >= 0) {
+                out[count++] = ir->b;
+            }
+            break;
+        default:
+            break;
+    }
+    return count;
+}
+
+static bool ends_block(const X86Ir* ir)
+{
+    return ir->kind == X86_IR_JUMP || ir->kind == X86_IR_BRANCH || ir->kind == X86_IR_RETURN;
+}
+
+typedef struct {
+    int first;
+    int last;
+    int successors[2];
+    int successor_count;
+    uint64_t* live_in;
+    uint64_t* live_out;
+    uint64_t* use;
+    uint64_t* def;
+} X86Block;
+
+static void bit_set(uint64_t* bits, int index)
+{
+    bits[index / 64] |= (uint64_t)1 << (index % 64);
+}
+
+static bool bit_test(const uint64_t* bits, int index)
+{
+    return (bits[index / 64] >> (index % 64)) & 1;
+}
+
+// Splits the code into blocks and computes live-in/live-out sets. Each vreg's
+// interval then runs from its first to its last occurrence, widened over every
+// block boundary where it is live.
+static bool compute_intervals(const X86Function* fn, int* start, int* end)
+{
+    int n = fn->count;
+    int words = (fn->vreg_count + 63) / 64;
+    words = words > 0 ? words : 1;
+
+    int* block_of = malloc(sizeof(int) * (n > 0 ? n : 1));
+    int* label_block = malloc(sizeof(int) * (fn->label_count > 0 ? fn->label_count : 1));
+    X86Block* blocks = calloc(n > 0 ? n : 1, sizeof(X86Block));
+    uint64_t* bits = calloc((size_t)(n > 0 ? n : 1) * 4 * words, sizeof(uint64_t));
+    if (!block_of || !label_block || !blocks || !bits) {
+        free(block_of);
+        free(label_block);
+        free(blocks);
+        free(bits);
+        return false;
+    }
+
+    int block_count = 0;
+    for (int i = 0; i < n; i++) {
+        bool leader = i == 0 || fn->code[i].kind == X86_IR_LABEL || ends_block(&fn->code[i - 1]);
+        if (leader && !(i > 0 && fn->code[i].kind == X86_IR_LABEL && fn->code[i - 1].kind == X86_IR_LABEL)) {
+            X86Block* block = &blocks[block_count];
+            block->first = i;
+            block->live_in = bits + (size_t)block_count * 4 * words;
+            block->live_out = block->live_in + words;
+            block->use = block->live_out + words;
+            block->def = block->use + words;
+            block_count++;
+        }
+        block_of[i] = block_count - 1;
+        blocks[block_count - 1].last = i;
+        if (fn->code[i].kind == X86_IR_LABEL) {
+            label_block[fn->code[i].label] = block_count - 1;
+        }
+    }
+
+    for (int b = 0; b < block_count; b++) {
+        X86Block* block = &blocks[b];
+        const X86Ir* last = &fn->code[block->last];
+        if (last->kind == X86_IR_JUMP || last->kind == X86_IR_BRANCH) {
+            block->successors[block->successor_count++] = label_block[last->label];
+        }
+        if (last->kind != X86_IR_JUMP && last->kind != X86_IR_RETURN && b + 1 < block_count) {
+            block->successors[block->successor_count++] = b + 1;
+        }
+
+        for (int i = block->first; i <= block->last; i++) {
+            int uses[2];
+            int use_count = ir_uses(&fn->code[i], uses);
+            for (int u = 0; u < use_count; u++) {
+                if (!bit_test(block->def, uses[u])) {
+                    bit_set(block->use, uses[u]);
+                }
+            }
+            const X86Ir* ir = &fn->code[i];
+            for (int a = 0; ir->kind == X86_IR_CALL && a < ir->arg_count; a++) {
+                if (!bit_test(block->def, ir->args[a])) {
+                    bit_set(block->use, ir->args[a]);
+                }
+            }
+            if (ir->dst >= 0) {
+                bit_set(block->def, ir->dst);
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = block_count - 1; b >= 0; b--) {
+            X86Block* block = &blocks[b];
+            for (int w = 0; w < words; w++) {
+                uint64_t out = 0;
+                for (int s = 0; s < block->successor_count; s++) {
+                    out |= blocks[block->successors[s]].live_in[w];
+                }
+                uint64_t in = block->use[w] | (out & ~block->def[w]);
+                if (out != block->live_out[w] || in != block->live_in[w]) {
+                    block->live_out[w] = out;
+                    block->live_in[w] = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (int v = 0; v < fn->vreg_count; v++) {
+        start[v] = INT_MAX;
+        end[v] = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        const X86Ir* ir = &fn->code[i];
+        int uses[2];
+        int use_count = ir_uses(ir, uses);
+        for (int u = 0; u < use_count; u++) {
+            start[uses[u]] = i < start[uses[u]] ? i : start[uses[u]];
+            end[uses[u]] = i > end[uses[u]] ? i : end[uses[u]];
+        }
+        for (int a = 0; ir->kind == X86_IR_CALL && a < ir->arg_count; a++) {
+            start[ir->args[a]] = i < start[ir->args[a]] ? i : start[ir->args[a]];
+            end[ir->args[a]] = i > end[ir->args[a]] ? i : end[ir->args[a]];
+        }
+        if (ir->dst >= 0) {
+            start[ir->dst] = i < start[ir->dst] ? i : start[ir->dst];
+            end[ir->dst] = i > end[ir->dst] ? i : end[ir->dst];
+        }
+    }
+    for (int b = 0; b < block_count; b++) {
+        for (int v = 0; v < fn->vreg_count; v++) {
+            if (bit_test(blocks[b].live_in, v)) {
+                start[v] = blocks[b].first < start[v] ? blocks[b].first : start[v];
+                end[v] = blocks[b].first > end[v] ? blocks[b].first : end[v];
+            }
+            if (bit_test(blocks[b].live_out, v)) {
+                start[v] = blocks[b].last < start[v] ? blocks[b].last : start[v];
+                end[v] = blocks[b].last > end[v] ? blocks[b].last : end[v];
+            }
+        }
+    }
+
+    free(block_of);
+    free(label_block);
+    free(blocks);
+    free(bits);
+    return true;
+}
+
+typedef struct {
+    int start;
+    int vreg;
+} X86Interval;
+
+static int compare_intervals(const void* left, const void* right)
+{
+    const X86Interval* a = left;
+    const X86Interval* b = right;
+    if (a->start != b->start) {
+        return a->start < b->start ? -1 : 1;
+    }
+    return (a->vreg > b->vreg) - (a->vreg < b->vreg);
+}
+
+// Poletto-Sarkar linear scan. Intervals live across a call only get
+// callee-saved registers; when none is free, the interval ending last spills.
+static bool allocate_registers(const X86Function* fn, X86Allocation* alloc)
+{
+    int vregs = fn->vreg_count > 0 ? fn->vreg_count : 1;
+    int* start = malloc(sizeof(int) * vregs);
+    int* end = malloc(sizeof(int) * vregs);
+    X86Interval* order = malloc(sizeof(X86Interval) * vregs);
+    bool* spans_call = calloc(vregs, sizeof(bool));
+    int* active = malloc(sizeof(int) * vregs);
+    alloc->reg = malloc(sizeof(int) * vregs);
+    alloc->slot = malloc(sizeof(int) * vregs);
+    alloc->slot_count = 0;
+    memset(alloc->used_regs, 0, sizeof(alloc->used_regs));
+    if (!start || !end || !order || !spans_call || !active || !alloc->reg || !alloc->slot
+        || !compute_intervals(fn, start, end)) {
+        free(start);
+        free(end);
+        free(order);
+        free(spans_call);
+        free(active);
+        return false;
+    }
+
+    int order_count = 0;
+    for (int v = 0; v < fn->vreg_count; v++) {
+        alloc->reg[v] = -1;
+        alloc->slot[v] = -1;
+        if (start[v] <= end[v]) {
+            order[order_count++] = (X86Interval){ start[v], v };
+        }
+    }
+    for (int i = 0; i < fn->count; i++) {
+        if (fn->code[i].kind != X86_IR_CALL) {
+            continue;
+        }
+        for (int k = 0; k < order_count; k++) {
+            int v = order[k].vreg;
+            if (start[v] < i && end[v] > i) {
+                spans_call[v] = true;
+            }
+        }
+    }
+
+    qsort(order, order_count, sizeof(X86Interval), compare_intervals);
+
+    bool reg_free[X86_REGISTER_COUNT];
+    for (int r = 0; r < X86_REGISTER_COUNT; r++) {
+        reg_free[r] = true;
+    }
+
+    int active_count = 0;
+    for (int k = 0; k < order_count; k++) {
+        int v = order[k].vreg;
+
+        int kept = 0;
+        for (int a = 0; a < active_count; a++) {
+            if (end[active[a]] < start[v]) {
+                reg_free[alloc->reg[active[a]]] = true;
+            } else {
+                active[kept++] = active[a];
+            }
+        }
+        active_count = kept;
+
+        int limit = spans_call[v] ? X86_CALLEE_SAVED_COUNT : X86_REGISTER_COUNT;
+        int chosen = -1;
+        for (int r = 0; r < limit && chosen < 0; r++) {
+            // Short intervals take caller-saved registers first.
+            int candidate = spans_call[v] ? r : (r + X86_CALLEE_SAVED_COUNT) % X86_REGISTER_COUNT;
+            if (reg_free[candidate]) {
+                chosen = candidate;
+            }
+        }
+
+        if (chosen < 0) {
+            int victim = -1;
+            for (int a = 0; a < active_count; a++) {
+                int other = active[a];
+                if (alloc->reg[other] < limit && (victim < 0 || end[other] > end[active[victim]])) {
+                    victim = a;
+                }
+            }
+            if (victim >= 0 && end[active[victim]] > end[v]) {
+                int spilled = active[victim];
+                chosen = alloc->reg[spilled];
+                alloc->reg[spilled] = -1;
+                alloc->slot[spilled] = alloc->slot_count++;
+                active[victim] = active[--active_count];
+            } else {
+                alloc->slot[v] = alloc->slot_count++;
+                continue;
+            }
+        }
+
+        alloc->reg[v] = chosen;
+        reg_free[chosen] = false;
+        alloc->used_regs[chosen] = true;
+        active[active_count++] = v;
+    }
+
+    free(start);
+    free(end);
+    free(order);
+    free(spans_call);
+    free(active);
+    return true;
+}
+
+// --- Emission ---
+
+typedef struct {
+    const X86Function* fn;
+    const X86Allocation* alloc;
+    FILE* out;
+    int saved_reg_count;
+    int param_slots;
+} X86Emitter;
+
+static bool is_register(const X86Emitter* em, int vreg)
+{
+    return em->alloc->reg[vreg] >= 0;
+}
+
+// Frame slots sit below the saved registers: incoming register arguments
+// first, then spilled vregs.
+static int frame_slot_offset(const X86Emitter* em, int slot)
+{
+    return -8 * (em->saved_reg_count + slot + 1);
+}
+
+static const char* location(const X86Emitter* em, int vreg, char* buffer, size_t size)
+{
+    if (vreg < 0 || vreg >= em->fn->vreg_count) {
+        snprintf(buffer, size, "$0");
+    } else if (em->alloc->reg[vreg] >= 0) {
+        snprintf(buffer, size, "%s", X86_REGISTERS[em->alloc->reg[vreg]]);
+    } else if (em->alloc->slot[vreg] >= 0) {
+        snprintf(buffer, size, "%d(%%rbp)", frame_slot_offset(em, em->param_slots + em->alloc->slot[vreg]));
+    } else {
+        // Never live: defined and not read.
+        snprintf(buffer, size, "%%r11");
+    }
+    return buffer;
+}
+
+static bool same_location(const X86Emitter* em, int a, int b)
+{
+    char left[32];
+    char right[32];
+    return a >= 0 && b >= 0 && strcmp(location(em, a, left, sizeof(left)), location(em, b, right, sizeof(right))) == 0;
+}
+
+static void emit_move(const X86Emitter* em, const char* from, const char* to)
+{
+    if (strcmp(from, to) == 0) {
+        return;
+    }
+    if (from[0] != '%' && from[0] != '$' && to[0] != '%') {
+        fprintf(em->out, "    movq %s, %%rax\n", from);
+        fprintf(em->out, "    movq %%rax, %s\n", to);
+        return;
+    }
+    fprintf(em->out, "    movq %s, %s\n", from, to);
+}
+
+static const char* right_operand(const X86Emitter* em, const X86Ir* ir, char* buffer, size_t size)
+{
+    if (ir->b < 0) {
+        snprintf(buffer, size, "$%lld", ir->imm);
+        return buffer;
+    }
+    return location(em, ir->b, buffer, size);
+}
+
+static const char* condition_suffix(OpType relation)
+{
+    switch (relation) {
+        case OP_EQUAL:                 return "e";
+        case OP_NOT_EQUAL:             return "ne";
+        case OP_LESS_THAN:             return "l";
+        case OP_LESS_THAN_OR_EQUAL:    return "le";
+        case OP_GREATER_THAN:          return "g";
+        default:                       return "ge";
+    }
+}
+
+// Sets flags for a <op> b; `cmpq b, a` needs a in a register unless b is.
+static void emit_compare(const X86Emitter* em, const X86Ir* ir)
+{
+    char left[32];
+    char right[32];
+    const char* a = location(em, ir->a, left, sizeof(left));
+    const char* b = right_operand(em, ir, right, sizeof(right));
+    if (a[0] != '%' && b[0] != '%' && b[0] != '$') {
+        fprintf(em->out, "    movq %s, %%rax\n", a);
+        a = "%rax";
+    }
+    fprintf(em->out, "    cmpq %s, %s\n", b, a);
+}
+
+static void emit_binary(const X86Emitter* em, const X86Ir* ir)
+{
+    char left[32];
+    char right[32];
+    char dest[32];
+    const char* a = location(em, ir->a, left, sizeof(left));
+    const char* b = right_operand(em, ir, right, sizeof(right));
+    const char* dst = location(em, ir->dst, dest, sizeof(dest));
+
+    if (ir->op == OP_DIVISION || ir->op == OP_MODULO) {
+        fprintf(em->out, "    movq %s, %%rax\n", a);
+        fprintf(em->out, "    cqto\n");
+        fprintf(em->out, "    movq %s, %%rcx\n", b);
+        fprintf(em->out, "    idivq %%rcx\n");
+        emit_move(em, ir->op == OP_DIVISION ? "%rax" : "%rdx", dst);
+        return;
+    }
+
+    const char* mnemonic = ir->op == OP_ADDITION ? "addq" : ir->op == OP_SUBTRACTION ? "subq" : "imulq";
+    const char* target = is_register(em, ir->dst) && !(ir->b >= 0 && same_location(em, ir->b, ir->dst)) ? dst : "%rax";
+    emit_move(em, a, target);
+    fprintf(em->out, "    %s %s, %s\n", mnemonic, b, target);
+    emit_move(em, target, dst);
+}
+
+// Arguments are pushed and the register ones popped back into place, which
+// avoids ordering moves between argument registers.
+static void emit_call(const X86Emitter* em, const X86Ir* ir)
+{
+    char buffer[32];
+    int stack_args = ir->arg_count > X86_ARG_REGISTER_COUNT ? ir->arg_count - X86_ARG_REGISTER_COUNT : 0;
+    int padding = stack_args % 2;
+    if (padding) {
+        fprintf(em->out, "    subq $8, %%rsp\n");
+    }
+    for (int i = ir->arg_count - 1; i >= 0; i--) {
+        fprintf(em->out, "    pushq %s\n", location(em, ir->args[i], buffer, sizeof(buffer)));
+    }
+    int register_args = ir->arg_count - stack_args;
+    for (int i = 0; i < register_args; i++) {
+        fprintf(em->out, "    popq %s\n", X86_ARG_REGISTERS[i]);
+    }
+    fprintf(em->out, "    call %s\n", ir->symbol);
+    if (stack_args + padding > 0) {
+        fprintf(em->out, "    addq $%d, %%rsp\n", 8 * (stack_args + padding));
+    }
+    if (ir->dst >= 0) {
+        emit_move(em, "%rax", location(em, ir->dst, buffer, sizeof(buffer)));
+    }
+}
+
+static void emit_function(const X86Function* fn, const X86Allocation* alloc, FILE* out, bool is_main)
+{
+    X86Emitter em = { fn, alloc, out, 0, 0 };
+    int saved[X86_CALLEE_SAVED_COUNT];
+    for (int r = 0; r < X86_CALLEE_SAVED_COUNT; r++) {
+        if (alloc->used_regs[r]) {
+            saved[em.saved_reg_count++] = r;
+        }
+    }
+    em.param_slots = fn->info->param_count < X86_ARG_REGISTER_COUNT ? fn->info->param_count : X86_ARG_REGISTER_COUNT;
+    int slots = em.param_slots + alloc->slot_count;
+    int frame_bytes = 8 * (slots + (em.saved_reg_count + slots) % 2);
+
+    fprintf(out, "    .text\n");
+    if (is_main) {
+        fprintf(out, "    .globl %s\n", fn->symbol);
+    }
+    fprintf(out, "%s:\n", fn->symbol);
+    fprintf(out, "    pushq %%rbp\n");
+    fprintf(out, "    movq %%rsp, %%rbp\n");
+    for (int i = 0; i < em.saved_reg_count; i++) {
+        fprintf(out, "    pushq %s\n", X86_REGISTERS[saved[i]]);
+    }
+    if (frame_bytes > 0) {
+        fprintf(out, "    subq $%d, %%rsp\n", frame_bytes);
+    }
+    for (int i = 0; i < em.param_slots; i++) {
+        fprintf(out, "    movq %s, %d(%%rbp)\n", X86_ARG_REGISTERS[i], frame_slot_offset(&em, i));
+    }
+
+    char left[32];
+    char right[32];
+    for (int i = 0; i < fn->count; i++) {
+        const X86Ir* ir = &fn->code[i];
+        switch (ir->kind) {
+            case X86_IR_CONST:
+                fprintf(out, "    movq $%lld, %s\n", ir->imm, location(&em, ir->dst, left, sizeof(left)));
+                break;
+            case X86_IR_PARAM:
+                if (ir->imm < X86_ARG_REGISTER_COUNT) {
+                    snprintf(right, sizeof(right), "%d(%%rbp)", frame_slot_offset(&em, (int)ir->imm));
+                } else {
+                    snprintf(right, sizeof(right), "%lld(%%rbp)", 16 + 8 * (ir->imm - X86_ARG_REGISTER_COUNT));
+                }
+                emit_move(&em, right, location(&em, ir->dst, left, sizeof(left)));
+                break;
+            case X86_IR_COPY:
+                emit_move(&em, location(&em, ir->a, right, sizeof(right)), location(&em, ir->dst, left, sizeof(left)));
+                break;
+            case X86_IR_BINARY:
+                emit_binary(&em, ir);
+                break;
+            case X86_IR_NEGATE:
+                fprintf(out, "    movq %s, %%rax\n", location(&em, ir->a, right, sizeof(right)));
+                fprintf(out, "    negq %%rax\n");
+                emit_move(&em, "%rax", location(&em, ir->dst, left, sizeof(left)));
+                break;
+            case X86_IR_COMPARE:
+                emit_compare(&em, ir);
+                fprintf(out, "    set%s %%al\n", condition_suffix(ir->op));
+                fprintf(out, "    movzbq %%al, %%rax\n");
+                emit_move(&em, "%rax", location(&em, ir->dst, left, sizeof(left)));
+                break;
+            case X86_IR_LABEL:
+                fprintf(out, ".L%s_%d:\n", fn->symbol, ir->label);
+                break;
+            case X86_IR_JUMP: {
+                // Skip jumps to a label that directly follows.
+                int next = i + 1;
+                while (next < fn->count && fn->code[next].kind == X86_IR_LABEL && fn->code[next].label != ir->label) {
+                    next++;
+                }
+                if (next < fn->count && fn->code[next].kind == X86_IR_LABEL) {
+                    break;
+                }
+                fprintf(out, "    jmp .L%s_%d\n", fn->symbol, ir->label);
+                break;
+            }
+            case X86_IR_BRANCH:
+                emit_compare(&em, ir);
+                fprintf(out, "    j%s .L%s_%d\n", condition_suffix(ir->op), fn->symbol, ir->label);
+                break;
+            case X86_IR_CALL:
+                emit_call(&em, ir);
+                break;
+            case X86_IR_RETURN:
+                if (ir->a >= 0) {
+                    emit_move(&em, location(&em, ir->a, right, sizeof(right)), "%rax");
+                } else {
+                    fprintf(out, "    xorl %%eax, %%eax\n");
+                }
+                if (i + 1 < fn->count) {
+                    fprintf(out, "    jmp .L%s_ret\n", fn->symbol);
+                }
+                break;
+        }
+    }
+
+    fprintf(out, ".L%s_ret:\n", fn->symbol);
+    if (em.saved_reg_count > 0) {
+        fprintf(out, "    leaq %d(%%rbp), %%rsp\n", -8 * em.saved_reg_count);
+        for (int i = em.saved_reg_count - 1; i >= 0; i--) {
+            fprintf(out, "    popq %s\n", X86_REGISTERS[saved[i]]);
+        }
+    } else {
+        fprintf(out, "    movq %%rbp, %%rsp\n");
+    }
+    fprintf(out, "    popq %%rbp\n");
+    fprintf(out, "    ret\n\n");
+}
+
+static void free_function(X86Function* fn)
+{
+    for (int i = 0; i < fn->count; i++) {
+        free(fn->code[i].symbol);
+        free(fn->code[i].args);
+    }
+    free(fn->code);
+    free(fn->symbol);
+    free(fn->var_names);
+    free(fn->var_vregs);
+    free(fn->node_labels);
+}
+
+bool generateProgramX86(const SubprogramCollection* subprograms, FILE* out, char** error_message)
+{
+    if (error_message) {
+        *error_message = NULL;
+    }
+
+    if (!subprograms || !out) {
+        if (error_message) {
+            *error_message = strdup("Subprogram collection is null.");
+        }
+        return false;
+    }
+
+    annotateSubprogramCollection(subprograms);
+
+    bool has_main = false;
+    for (int i = 0; i < subprograms->count; i++) {
+        const SubprogramInfo* info = &subprograms->items[i];
+        has_main = has_main || (info->name && !info->owner_type_name && strcmp(info->name, "main") == 0
+                                && info->param_count == 0 && info->has_body);
+    }
+    if (!has_main) {
+        if (error_message) {
+            *error_message = strdup("The x86-64 backend needs a main() method with a body.");
+        }
+        return false;
+    }
+
+    for (int i = 0; i < subprograms->count; i++) {
+        const SubprogramInfo* info = &subprograms->items[i];
+        // Class methods are only reachable through member calls, which this
+        // backend rejects at the call site.
+        if (!info->name || !info->has_body || !info->cfg || info->owner_type_name || info->import_info.is_imported) {
+            continue;
+        }
+
+        X86Function fn;
+        memset(&fn, 0, sizeof(fn));
+        fn.subprograms = subprograms;
+        fn.info = info;
+        fn.symbol = make_symbol(info);
+        if (!fn.symbol) {
+            set_x86_error(&fn, "Out of memory while lowering to x86-64.");
+        } else {
+            lower_function(&fn);
+        }
+
+        X86Allocation alloc;
+        memset(&alloc, 0, sizeof(alloc));
+        if (!fn.has_error && !allocate_registers(&fn, &alloc)) {
+            set_x86_error(&fn, "Out of memory while allocating x86-64 registers.");
+        }
+
+        if (fn.has_error) {
+            if (error_message) {
+                *error_message = strdup(fn.error_message);
+            }
+            free(alloc.reg);
+            free(alloc.slot);
+            free_function(&fn);
+            return false;
+        }
+
+        bool is_main = strcmp(info->name, "main") == 0 && info->param_count == 0;
+        emit_function(&fn, &alloc, out, is_main);
+        free(alloc.reg);
+        free(alloc.slot);
+        free_function(&fn);
+    }
+
+    fprintf(out, "    .section .note.GNU-stack,\"\",@progbits\n");
+    return true;
+}
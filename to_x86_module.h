@@ -0,0 +1,15 @@
+#ifndef TO_X86_MODULE_H
+#define TO_X86_MODULE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cfg_builder_module.h"
+
+// Writes x86-64 System V assembly (AT&T syntax, GNU as) for every free method
+// with a body. Methods become MC_<asm_name>; read()/write() call mc_read and
+// mc_write from x86_runtime.c, whose C main calls MC_main. Build with
+// `cc program.s x86_runtime.c`.
+bool generateProgramX86(const SubprogramCollection* subprograms, FILE* out, char** error_message);
+
+#endif
@@ -0,0 +1,467 @@
+// Test runner: executes the textual myvm assembly written by MyCompiler the
+// way target-definitions.pdsl describes the VM, so the task5 harness can check
+// program results without the remote toolchain. Only [section CODE_CONST] is
+// loaded; jump and pushc operands may be labels or instruction indices.
+//
+// The section is also encoded into a CODE_CONST byte image. pushc takes the
+// entry's byte address, which must fit its u16 operand, and reads the 4
+// little-endian immediate bytes there, as the pdsl PUSHC does.
+//
+// `in` reads decimal integers from stdin. Unlike the VM, `out` ends every value
+// with a newline, which matches the C and x86-64 runtimes for cross-checks.
+//
+// Usage: myvm_run <program.asm> [max-steps]
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "myvm_isa.h"
+
+#define MAX_LINE 512
+#define MAX_LABEL 128
+#define DATA_CELLS (0x10000 / 8)
+#define GLOBAL_FIRST_CELL (0x2000 / 8)
+#define DEFAULT_MAX_STEPS 200000000LL
+
+typedef struct {
+    const MyVmInstructionInfo* info;
+    MyVmOpcode opcode;
+    char operands[MYVM_MAX_OPERANDS][MAX_LABEL];
+    int operand_count;
+    int64_t values[MYVM_MAX_OPERANDS];
+    bool is_label[MYVM_MAX_OPERANDS];
+    int address;
+    int line;
+} Instruction;
+
+typedef struct {
+    char name[MAX_LABEL];
+    int instruction;
+} Label;
+
+typedef struct {
+    Instruction* code;
+    int count;
+    int capacity;
+    Label* labels;
+    int label_count;
+    int label_capacity;
+    uint8_t* image;
+    int image_size;
+} Program;
+
+static void fail(const char* path, int line, const char* message, const char* detail)
+{
+    fprintf(stderr, "myvm_run: %s:%d: %s%s%s\n", path, line, message, detail ? " " : "", detail ? detail : "");
+    exit(2);
+}
+
+static void* grow(void* items, int count, int* capacity, size_t size)
+{
+    if (count < *capacity) {
+        return items;
+    }
+    *capacity = *capacity == 0 ? 64 : *capacity * 2;
+    void* grown = realloc(items, size * (size_t)*capacity);
+    if (!grown) {
+        fprintf(stderr, "myvm_run: out of memory\n");
+        exit(2);
+    }
+    return grown;
+}
+
+static const MyVmInstructionInfo* find_instruction(const char* mnemonic)
+{
+    for (int i = 0; i < MYVM_INSTRUCTION_COUNT; i++) {
+        if (strcmp(MYVM_INSTRUCTIONS[i].mnemonic, mnemonic) == 0) {
+            return &MYVM_INSTRUCTIONS[i];
+        }
+    }
+    return NULL;
+}
+
+static void load_program(const char* path, Program* program)
+{
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "myvm_run: cannot read %s\n", path);
+        exit(2);
+    }
+
+    char text[MAX_LINE];
+    int line = 0;
+    bool in_code = true;
+    while (fgets(text, sizeof(text), in)) {
+        line++;
+        char* comment = strchr(text, ';');
+        if (comment) {
+            *comment = '\0';
+        }
+        char* start = text;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        size_t length = strlen(start);
+        while (length > 0 && isspace((unsigned char)start[length - 1])) {
+            start[--length] = '\0';
+        }
+        if (length == 0) {
+            continue;
+        }
+        if (strncmp(start, "[section", 8) == 0) {
+            in_code = strstr(start, "CODE_CONST") != NULL;
+            continue;
+        }
+        if (!in_code) {
+            continue;
+        }
+
+        if (start[length - 1] == ':') {
+            start[length - 1] = '\0';
+            if (length > MAX_LABEL) {
+                fail(path, line, "label too long", NULL);
+            }
+            program->labels = grow(program->labels, program->label_count, &program->label_capacity, sizeof(Label));
+            Label* label = &program->labels[program->label_count++];
+            strcpy(label->name, start);
+            label->instruction = program->count;
+            continue;
+        }
+
+        char* mnemonic = strtok(start, " \t,");
+        const MyVmInstructionInfo* info = find_instruction(mnemonic);
+        if (!info) {
+            fail(path, line, "unknown mnemonic", mnemonic);
+        }
+        program->code = grow(program->code, program->count, &program->capacity, sizeof(Instruction));
+        Instruction* instr = &program->code[program->count++];
+        memset(instr, 0, sizeof(*instr));
+        instr->info = info;
+        instr->opcode = info->opcode;
+        instr->line = line;
+        char* operand;
+        while ((operand = strtok(NULL, " \t,")) != NULL) {
+            if (instr->operand_count >= MYVM_MAX_OPERANDS || strlen(operand) >= MAX_LABEL) {
+                fail(path, line, "bad operands for", info->mnemonic);
+            }
+            strcpy(instr->operands[instr->operand_count++], operand);
+        }
+        if (instr->operand_count != info->operand_count) {
+            fail(path, line, "wrong operand count for", info->mnemonic);
+        }
+    }
+    fclose(in);
+}
+
+static int find_label(const Program* program, const char* name)
+{
+    for (int i = 0; i < program->label_count; i++) {
+        if (strcmp(program->labels[i].name, name) == 0) {
+            return program->labels[i].instruction;
+        }
+    }
+    return -1;
+}
+
+// Jump targets and pushc become instruction indices, everything else a number.
+static void resolve_operands(const char* path, Program* program)
+{
+    for (int i = 0; i < program->count; i++) {
+        Instruction* instr = &program->code[i];
+        for (int op = 0; op < instr->operand_count; op++) {
+            const char* text = instr->operands[op];
+            char* end = NULL;
+            long long value = strtoll(text, &end, 0);
+            if (end == text || *end != '\0') {
+                int target = find_label(program, text);
+                if (target < 0) {
+                    fail(path, instr->line, "undefined label", text);
+                }
+                value = target;
+                instr->is_label[op] = true;
+            }
+            instr->values[op] = value;
+        }
+        if (instr->opcode == MYVM_OP_PUSHC) {
+            int target = (int)instr->values[0];
+            if (target < 0 || target >= program->count || program->code[target].opcode != MYVM_OP_PUSHI) {
+                fail(path, instr->line, "pushc does not name a pushi constant:", instr->operands[0]);
+            }
+        }
+    }
+}
+
+// Lays the instructions out at their encoded sizes and writes the bytes.
+// Label operands become byte addresses; pushc operands are then rewritten to
+// the address of their entry.
+static void encode_program(const char* path, Program* program)
+{
+    int address = 0;
+    for (int i = 0; i < program->count; i++) {
+        program->code[i].address = address;
+        address += program->code[i].info->size_bytes;
+    }
+    program->image_size = address;
+    program->image = calloc(address > 0 ? address : 1, 1);
+    if (!program->image) {
+        fprintf(stderr, "myvm_run: out of memory\n");
+        exit(2);
+    }
+
+    for (int i = 0; i < program->count; i++) {
+        Instruction* instr = &program->code[i];
+        int offset = instr->address;
+        program->image[offset++] = (uint8_t)instr->opcode;
+        for (int op = 0; op < instr->operand_count; op++) {
+            int64_t value = instr->values[op];
+            if (instr->is_label[op] || instr->opcode == MYVM_OP_PUSHC) {
+                value = value < program->count ? program->code[value].address : program->image_size;
+            }
+            int width = MYVM_OPERAND_SIZES[instr->info->operands[op]];
+            for (int b = 0; b < width; b++) {
+                program->image[offset++] = (uint8_t)((uint64_t)value >> (8 * b));
+            }
+        }
+        if (instr->opcode == MYVM_OP_PUSHC) {
+            int entry = program->code[instr->values[0]].address;
+            if (entry > 0xFFFF) {
+                fail(path, instr->line, "pushc entry address does not fit its u16 operand:", instr->operands[0]);
+            }
+            instr->values[0] = entry;
+        }
+    }
+}
+
+// PUSHC's read: 4 little-endian bytes, sign-extended to the 64-bit cell.
+static int64_t read_code_i32(const Program* program, int address)
+{
+    uint32_t raw = 0;
+    for (int b = 0; b < 4; b++) {
+        raw |= (uint32_t)program->image[address + b] << (8 * b);
+    }
+    return (int32_t)raw;
+}
+
+static int64_t read_integer(void)
+{
+    long long value = 0;
+    if (scanf("%lld", &value) != 1) {
+        return 0;
+    }
+    return value;
+}
+
+// Arithmetic wraps like the VM's 64-bit cells.
+static int64_t wrap(uint64_t value)
+{
+    return (int64_t)value;
+}
+
+static int run(const Program* program, long long max_steps)
+{
+    static int64_t data[DATA_CELLS];
+    int sp = DATA_CELLS;
+    int ip = 0;
+
+#define CELL(index) data[((index) % DATA_CELLS + DATA_CELLS) % DATA_CELLS]
+#define PUSH(value) do { if (sp == DATA_CELLS) sp = 0; data[sp] = (value); sp++; } while (0)
+#define GLOBAL(slot) CELL(GLOBAL_FIRST_CELL + (slot))
+
+    for (long long steps = 0; ; steps++) {
+        if (steps >= max_steps) {
+            fprintf(stderr, "myvm_run: step limit of %lld reached\n", max_steps);
+            return 3;
+        }
+        if (ip < 0 || ip >= program->count) {
+            fprintf(stderr, "myvm_run: ip %d is outside the program\n", ip);
+            return 2;
+        }
+        const Instruction* instr = &program->code[ip++];
+        const int64_t* v = instr->values;
+        int64_t a;
+        int64_t b;
+        switch (instr->opcode) {
+        case MYVM_OP_PUSHI:
+        case MYVM_OP_PUSHB:
+            PUSH(v[0]);
+            break;
+        case MYVM_OP_PUSHC:
+            PUSH(read_code_i32(program, (int)v[0] + 1));
+            break;
+        case MYVM_OP_LDG:
+            PUSH(GLOBAL(v[0]));
+            break;
+        case MYVM_OP_STG:
+            sp--;
+            GLOBAL(v[0]) = CELL(sp);
+            break;
+        case MYVM_OP_LDG2:
+            PUSH(GLOBAL(v[0]));
+            PUSH(GLOBAL(v[1]));
+            break;
+        case MYVM_OP_INCG:
+            GLOBAL(v[0]) = wrap((uint64_t)GLOBAL(v[0]) + (uint64_t)v[1]);
+            break;
+        case MYVM_OP_LDL:
+            PUSH(CELL(v[0] / 8));
+            break;
+        case MYVM_OP_STL:
+            sp--;
+            CELL(v[0] / 8) = CELL(sp);
+            break;
+        case MYVM_OP_LDSP:
+            if (sp == DATA_CELLS) {
+                sp = 0;
+            }
+            PUSH(sp);
+            break;
+        case MYVM_OP_LDGI:
+            CELL(sp - 1) = CELL(CELL(sp - 1) + v[0]);
+            break;
+        case MYVM_OP_STGI:
+            sp -= 2;
+            CELL(CELL(sp + 1) + v[0]) = CELL(sp);
+            break;
+        case MYVM_OP_LDGX:
+            CELL(sp - 1) = GLOBAL(v[0] + CELL(sp - 1));
+            break;
+        case MYVM_OP_STGX:
+            sp -= 2;
+            GLOBAL(v[0] + CELL(sp + 1)) = CELL(sp);
+            break;
+        case MYVM_OP_CHKB:
+            if (CELL(sp - 1) < 0 || CELL(sp - 1) >= v[0]) {
+                fprintf(stderr, "myvm_run: chkb %lld failed for index %lld\n",
+                        (long long)v[0], (long long)CELL(sp - 1));
+                return 0;
+            }
+            break;
+        case MYVM_OP_DUP:
+            a = CELL(sp - 1);
+            PUSH(a);
+            break;
+        case MYVM_OP_POP:
+            sp--;
+            break;
+        case MYVM_OP_ADD:
+        case MYVM_OP_SUB:
+        case MYVM_OP_MUL:
+        case MYVM_OP_DIV:
+        case MYVM_OP_MOD:
+        case MYVM_OP_EQ:
+        case MYVM_OP_NE:
+        case MYVM_OP_LT:
+        case MYVM_OP_LE:
+        case MYVM_OP_GT:
+        case MYVM_OP_GE:
+        case MYVM_OP_AND:
+        case MYVM_OP_OR:
+            b = CELL(sp - 1);
+            a = CELL(sp - 2);
+            sp--;
+            switch (instr->opcode) {
+            case MYVM_OP_ADD: a = wrap((uint64_t)a + (uint64_t)b); break;
+            case MYVM_OP_SUB: a = wrap((uint64_t)a - (uint64_t)b); break;
+            case MYVM_OP_MUL: a = wrap((uint64_t)a * (uint64_t)b); break;
+            case MYVM_OP_DIV:
+            case MYVM_OP_MOD:
+                if (b == 0 || (b == -1 && a == INT64_MIN)) {
+                    fprintf(stderr, "myvm_run: division fault at line %d\n", instr->line);
+                    return 2;
+                }
+                a = instr->opcode == MYVM_OP_DIV ? a / b : a % b;
+                break;
+            case MYVM_OP_EQ: a = a == b; break;
+            case MYVM_OP_NE: a = a != b; break;
+            case MYVM_OP_LT: a = a < b; break;
+            case MYVM_OP_LE: a = a <= b; break;
+            case MYVM_OP_GT: a = a > b; break;
+            case MYVM_OP_GE: a = a >= b; break;
+            case MYVM_OP_AND: a = a != 0 && b != 0; break;
+            default: a = a != 0 || b != 0; break;
+            }
+            CELL(sp - 1) = a;
+            break;
+        case MYVM_OP_JMP:
+            ip = (int)v[0];
+            break;
+        case MYVM_OP_JZ:
+        case MYVM_OP_JNZ:
+            sp--;
+            if ((CELL(sp) == 0) == (instr->opcode == MYVM_OP_JZ)) {
+                ip = (int)v[0];
+            }
+            break;
+        case MYVM_OP_JLT:
+        case MYVM_OP_JGE:
+        case MYVM_OP_JEQ:
+        case MYVM_OP_JNE: {
+            sp -= 2;
+            a = CELL(sp);
+            b = CELL(sp + 1);
+            bool taken = instr->opcode == MYVM_OP_JLT ? a < b
+                : instr->opcode == MYVM_OP_JGE ? a >= b
+                : instr->opcode == MYVM_OP_JEQ ? a == b
+                : a != b;
+            if (taken) {
+                ip = (int)v[0];
+            }
+            break;
+        }
+        case MYVM_OP_JMPT:
+            sp--;
+            ip = (int)(v[0] + CELL(sp));
+            break;
+        case MYVM_OP_HALT:
+            return 0;
+        case MYVM_OP_SETPORT:
+            break;
+        case MYVM_OP_IN:
+            PUSH(read_integer());
+            break;
+        case MYVM_OP_OUT:
+            sp--;
+            printf("%lld\n", (long long)CELL(sp));
+            break;
+        default:
+            fprintf(stderr, "myvm_run: opcode 0x%02X at line %d is not implemented\n", instr->opcode, instr->line);
+            return 2;
+        }
+    }
+
+#undef CELL
+#undef PUSH
+#undef GLOBAL
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s <program.asm> [max-steps]\n", argv[0]);
+        return 1;
+    }
+    long long max_steps = argc == 3 ? strtoll(argv[2], NULL, 10) : DEFAULT_MAX_STEPS;
+    if (max_steps <= 0) {
+        fprintf(stderr, "myvm_run: bad step limit %s\n", argv[2]);
+        return 1;
+    }
+
+    static Program program;
+    load_program(argv[1], &program);
+    if (program.count == 0) {
+        fprintf(stderr, "myvm_run: %s has no code\n", argv[1]);
+        return 1;
+    }
+    resolve_operands(argv[1], &program);
+    encode_program(argv[1], &program);
+
+    int status = run(&program, max_steps);
+    fflush(stdout);
+    free(program.code);
+    free(program.labels);
+    free(program.image);
+    return status;
+}
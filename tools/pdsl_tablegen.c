@@ -0,0 +1,625 @@
+// Build-time generator: reads the `instructions:` and `mnemonics:` sections of
+// target-definitions.pdsl and writes myvm_isa.h with the opcode enum, operand
+// kinds, encoded sizes and mnemonic strings used by the backend.
+//
+// Usage: pdsl_tablegen <target-definitions.pdsl> <myvm_isa.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NAME 64
+#define MAX_ITEMS 128
+#define MAX_SEQUENCE 4
+
+typedef enum {
+    TOKEN_END,
+    TOKEN_IDENTIFIER,
+    TOKEN_NUMBER,
+    TOKEN_STRING,
+    TOKEN_PUNCT
+} TokenKind;
+
+typedef struct {
+    TokenKind kind;
+    char text[MAX_NAME];
+    int line;
+} Token;
+
+typedef struct {
+    char name[MAX_NAME];
+    int bits;
+} FieldDef;
+
+typedef struct {
+    char name[MAX_NAME];
+    unsigned value;
+} OpcodeDef;
+
+typedef struct {
+    char name[MAX_NAME];
+    int field_indexes[MAX_SEQUENCE];
+    char operand_names[MAX_SEQUENCE][MAX_NAME];
+    int count;
+} SequenceDef;
+
+typedef struct {
+    char name[MAX_NAME];
+    int opcode;
+    int sequence;      // -1 when the instruction has no operands
+    int size_bytes;
+    int line;
+} InstructionDef;
+
+typedef struct {
+    char name[MAX_NAME];
+    int instruction;
+} MnemonicDef;
+
+typedef struct {
+    const char* path;
+    const char* text;
+    size_t pos;
+    int line;
+    Token current;
+
+    FieldDef fields[MAX_ITEMS];
+    int field_count;
+    OpcodeDef opcodes[MAX_ITEMS];
+    int opcode_count;
+    int opcode_bits;
+    char opcode_field[MAX_NAME];
+    SequenceDef sequences[MAX_ITEMS];
+    int sequence_count;
+    InstructionDef instructions[MAX_ITEMS];
+    int instruction_count;
+    MnemonicDef mnemonics[MAX_ITEMS];
+    int mnemonic_count;
+} Parser;
+
+static void fail(const Parser* parser, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "pdsl_tablegen: %s:%d: ", parser->path, parser->current.line);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+static void skip_space_and_comments(Parser* parser)
+{
+    const char* text = parser->text;
+    for (;;) {
+        while (isspace((unsigned char)text[parser->pos])) {
+            parser->line += text[parser->pos] == '\n';
+            parser->pos++;
+        }
+        if (text[parser->pos] == '/' && text[parser->pos + 1] == '*') {
+            parser->pos += 2;
+            while (text[parser->pos] && !(text[parser->pos] == '*' && text[parser->pos + 1] == '/')) {
+                parser->line += text[parser->pos] == '\n';
+                parser->pos++;
+            }
+            parser->pos += text[parser->pos] ? 2 : 0;
+            continue;
+        }
+        return;
+    }
+}
+
+static void next_token(Parser* parser)
+{
+    skip_space_and_comments(parser);
+
+    Token* token = &parser->current;
+    const char* text = parser->text;
+    size_t start = parser->pos;
+    size_t length = 0;
+    token->line = parser->line;
+
+    char c = text[parser->pos];
+    if (c == '\0') {
+        token->kind = TOKEN_END;
+        token->text[0] = '\0';
+        return;
+    }
+
+    if (isalpha((unsigned char)c) || c == '_') {
+        token->kind = TOKEN_IDENTIFIER;
+        while (isalnum((unsigned char)text[parser->pos]) || text[parser->pos] == '_') {
+            parser->pos++;
+        }
+    } else if (isdigit((unsigned char)c)) {
+        token->kind = TOKEN_NUMBER;
+        while (isalnum((unsigned char)text[parser->pos])) {
+            parser->pos++;
+        }
+    } else if (c == '"') {
+        token->kind = TOKEN_STRING;
+        parser->pos++;
+        start = parser->pos;
+        while (text[parser->pos] && text[parser->pos] != '"') {
+            parser->pos++;
+        }
+        length = parser->pos - start;
+        parser->pos += text[parser->pos] ? 1 : 0;
+    } else {
+        token->kind = TOKEN_PUNCT;
+        parser->pos++;
+    }
+
+    if (token->kind != TOKEN_STRING) {
+        length = parser->pos - start;
+    }
+    if (length >= MAX_NAME) {
+        fail(parser, "token too long");
+    }
+    memcpy(token->text, text + start, length);
+    token->text[length] = '\0';
+}
+
+static bool is_token(const Parser* parser, const char* text)
+{
+    return parser->current.kind != TOKEN_END && strcmp(parser->current.text, text) == 0;
+}
+
+static void expect(Parser* parser, const char* text)
+{
+    if (!is_token(parser, text)) {
+        fail(parser, "expected '%s', found '%s'", text, parser->current.text);
+    }
+    next_token(parser);
+}
+
+static void expect_name(Parser* parser, char* out)
+{
+    if (parser->current.kind != TOKEN_IDENTIFIER) {
+        fail(parser, "expected a name, found '%s'", parser->current.text);
+    }
+    snprintf(out, MAX_NAME, "%s", parser->current.text);
+    next_token(parser);
+}
+
+static int expect_number(Parser* parser, int base)
+{
+    char* end = NULL;
+    long value = strtol(parser->current.text, &end, base);
+    if (parser->current.kind != TOKEN_NUMBER || !end || *end != '\0') {
+        fail(parser, "expected a number, found '%s'", parser->current.text);
+    }
+    next_token(parser);
+    return (int)value;
+}
+
+static int find_field(const Parser* parser, const char* name)
+{
+    for (int i = 0; i < parser->field_count; i++) {
+        if (strcmp(parser->fields[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int find_sequence(const Parser* parser, const char* name)
+{
+    for (int i = 0; i < parser->sequence_count; i++) {
+        if (strcmp(parser->sequences[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int find_opcode(const Parser* parser, const char* name)
+{
+    for (int i = 0; i < parser->opcode_count; i++) {
+        if (strcmp(parser->opcodes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int find_instruction(const Parser* parser, const char* name)
+{
+    for (int i = 0; i < parser->instruction_count; i++) {
+        if (strcmp(parser->instructions[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void check_capacity(const Parser* parser, int count)
+{
+    if (count >= MAX_ITEMS) {
+        fail(parser, "too many definitions");
+    }
+}
+
+// encode NAME field = immediate[N];
+// encode NAME field = cases { OP = bits, ... };
+// encode NAME sequence = { field as OPERAND, ... };
+static void parse_encode(Parser* parser)
+{
+    char name[MAX_NAME];
+    expect(parser, "encode");
+    expect_name(parser, name);
+
+    if (is_token(parser, "sequence")) {
+        next_token(parser);
+        expect(parser, "=");
+        expect(parser, "{");
+        check_capacity(parser, parser->sequence_count);
+        SequenceDef* sequence = &parser->sequences[parser->sequence_count++];
+        snprintf(sequence->name, MAX_NAME, "%s", name);
+        while (!is_token(parser, "}")) {
+            char field[MAX_NAME];
+            expect_name(parser, field);
+            int index = find_field(parser, field);
+            if (index < 0) {
+                fail(parser, "unknown field '%s' in sequence %s", field, name);
+            }
+            if (sequence->count >= MAX_SEQUENCE) {
+                fail(parser, "sequence %s has too many operands", name);
+            }
+            expect(parser, "as");
+            sequence->field_indexes[sequence->count] = index;
+            expect_name(parser, sequence->operand_names[sequence->count]);
+            sequence->count++;
+            if (is_token(parser, ",")) {
+                next_token(parser);
+            }
+        }
+        expect(parser, "}");
+        expect(parser, ";");
+        return;
+    }
+
+    expect(parser, "field");
+    expect(parser, "=");
+    if (is_token(parser, "immediate")) {
+        next_token(parser);
+        expect(parser, "[");
+        check_capacity(parser, parser->field_count);
+        FieldDef* field = &parser->fields[parser->field_count++];
+        snprintf(field->name, MAX_NAME, "%s", name);
+        field->bits = expect_number(parser, 10);
+        if (field->bits <= 0 || field->bits % 8 != 0) {
+            fail(parser, "field %s is not a whole number of bytes", name);
+        }
+        expect(parser, "]");
+        expect(parser, ";");
+        return;
+    }
+
+    expect(parser, "cases");
+    expect(parser, "{");
+    snprintf(parser->opcode_field, MAX_NAME, "%s", name);
+    while (!is_token(parser, "}")) {
+        check_capacity(parser, parser->opcode_count);
+        OpcodeDef* opcode = &parser->opcodes[parser->opcode_count++];
+        expect_name(parser, opcode->name);
+        expect(parser, "=");
+        int bits = (int)strlen(parser->current.text);
+        if (parser->opcode_bits != 0 && bits != parser->opcode_bits) {
+            fail(parser, "opcode %s has %d bits, expected %d", opcode->name, bits, parser->opcode_bits);
+        }
+        parser->opcode_bits = bits;
+        opcode->value = (unsigned)expect_number(parser, 2);
+        for (int i = 0; i < parser->opcode_count - 1; i++) {
+            if (parser->opcodes[i].value == opcode->value) {
+                fail(parser, "opcodes %s and %s share one value", parser->opcodes[i].name, opcode->name);
+            }
+        }
+        if (is_token(parser, ",")) {
+            next_token(parser);
+        }
+    }
+    expect(parser, "}");
+    expect(parser, ";");
+    if (parser->opcode_bits % 8 != 0) {
+        fail(parser, "opcode field %s is not a whole number of bytes", name);
+    }
+}
+
+// instruction NAME = { OPC.OP_X, sequence FMT } { body };
+// Every `ip = ip + N` in the body must advance by the encoded size.
+static void parse_instruction(Parser* parser)
+{
+    expect(parser, "instruction");
+    check_capacity(parser, parser->instruction_count);
+    InstructionDef* instruction = &parser->instructions[parser->instruction_count++];
+    instruction->line = parser->current.line;
+    instruction->sequence = -1;
+    expect_name(parser, instruction->name);
+    expect(parser, "=");
+    expect(parser, "{");
+
+    char name[MAX_NAME];
+    expect_name(parser, name);
+    if (strcmp(name, parser->opcode_field) != 0) {
+        fail(parser, "instruction %s does not start with %s", instruction->name, parser->opcode_field);
+    }
+    expect(parser, ".");
+    expect_name(parser, name);
+    instruction->opcode = find_opcode(parser, name);
+    if (instruction->opcode < 0) {
+        fail(parser, "unknown opcode '%s'", name);
+    }
+
+    instruction->size_bytes = parser->opcode_bits / 8;
+    if (is_token(parser, ",")) {
+        next_token(parser);
+        expect(parser, "sequence");
+        expect_name(parser, name);
+        instruction->sequence = find_sequence(parser, name);
+        if (instruction->sequence < 0) {
+            fail(parser, "unknown sequence '%s'", name);
+        }
+        const SequenceDef* sequence = &parser->sequences[instruction->sequence];
+        for (int i = 0; i < sequence->count; i++) {
+            instruction->size_bytes += parser->fields[sequence->field_indexes[i]].bits / 8;
+        }
+    }
+    expect(parser, "}");
+
+    expect(parser, "{");
+    int depth = 1;
+    while (depth > 0) {
+        if (parser->current.kind == TOKEN_END) {
+            fail(parser, "unterminated body of %s", instruction->name);
+        }
+        if (is_token(parser, "{")) {
+            depth++;
+        } else if (is_token(parser, "}")) {
+            depth--;
+        } else if (is_token(parser, "ip")) {
+            next_token(parser);
+            if (is_token(parser, "=")) {
+                next_token(parser);
+                if (is_token(parser, "ip")) {
+                    next_token(parser);
+                    expect(parser, "+");
+                    int advance = expect_number(parser, 10);
+                    if (advance != instruction->size_bytes) {
+                        fail(parser, "%s advances ip by %d but encodes to %d bytes",
+                             instruction->name, advance, instruction->size_bytes);
+                    }
+                }
+            }
+            continue;
+        }
+        next_token(parser);
+    }
+    expect(parser, ";");
+}
+
+// format NAME is "...";  mnemonic name for INSTR (OPERANDS) FORMAT;
+static void parse_mnemonics(Parser* parser)
+{
+    while (parser->current.kind != TOKEN_END && !is_token(parser, "}")) {
+        if (is_token(parser, "format")) {
+            while (!is_token(parser, ";")) {
+                next_token(parser);
+            }
+            next_token(parser);
+            continue;
+        }
+
+        expect(parser, "mnemonic");
+        check_capacity(parser, parser->mnemonic_count);
+        MnemonicDef* mnemonic = &parser->mnemonics[parser->mnemonic_count++];
+        expect_name(parser, mnemonic->name);
+        expect(parser, "for");
+
+        char name[MAX_NAME];
+        expect_name(parser, name);
+        mnemonic->instruction = find_instruction(parser, name);
+        if (mnemonic->instruction < 0) {
+            fail(parser, "mnemonic %s names unknown instruction '%s'", mnemonic->name, name);
+        }
+
+        const InstructionDef* instruction = &parser->instructions[mnemonic->instruction];
+        const SequenceDef* sequence = instruction->sequence >= 0 ? &parser->sequences[instruction->sequence] : NULL;
+        int operand = 0;
+        expect(parser, "(");
+        while (!is_token(parser, ")")) {
+            expect_name(parser, name);
+            if (!sequence || operand >= sequence->count || strcmp(sequence->operand_names[operand], name) != 0) {
+                fail(parser, "mnemonic %s lists operand '%s' that %s does not encode", mnemonic->name, name,
+                     instruction->name);
+            }
+            operand++;
+            if (is_token(parser, ",")) {
+                next_token(parser);
+            }
+        }
+        if (operand != (sequence ? sequence->count : 0)) {
+            fail(parser, "mnemonic %s lists %d operands, %s encodes %d", mnemonic->name, operand,
+                 instruction->name, sequence ? sequence->count : 0);
+        }
+        expect(parser, ")");
+        expect_name(parser, name);
+        expect(parser, ";");
+    }
+}
+
+static void parse(Parser* parser)
+{
+    next_token(parser);
+    bool in_instructions = false;
+    while (parser->current.kind != TOKEN_END) {
+        if (in_instructions && is_token(parser, "encode")) {
+            parse_encode(parser);
+        } else if (in_instructions && is_token(parser, "instruction")) {
+            parse_instruction(parser);
+        } else if (parser->current.kind == TOKEN_IDENTIFIER) {
+            char name[MAX_NAME];
+            snprintf(name, sizeof(name), "%s", parser->current.text);
+            next_token(parser);
+            if (is_token(parser, ":") && strcmp(name, "instructions") == 0) {
+                next_token(parser);
+                in_instructions = true;
+                continue;
+            }
+            if (is_token(parser, ":") && strcmp(name, "mnemonics") == 0) {
+                next_token(parser);
+                parse_mnemonics(parser);
+                return;
+            }
+            if (is_token(parser, ":")) {
+                in_instructions = false;
+            }
+        } else {
+            next_token(parser);
+        }
+    }
+}
+
+static void upper_name(char* out, const char* name)
+{
+    size_t i = 0;
+    for (; name[i] && i + 1 < MAX_NAME; i++) {
+        out[i] = (char)toupper((unsigned char)name[i]);
+    }
+    out[i] = '\0';
+}
+
+static const char* opcode_suffix(const Parser* parser, int opcode)
+{
+    const char* name = parser->opcodes[opcode].name;
+    return strncmp(name, "OP_", 3) == 0 ? name + 3 : name;
+}
+
+static void write_header(const Parser* parser, FILE* out)
+{
+    char upper[MAX_NAME];
+    fprintf(out, "/* Generated by pdsl_tablegen from target-definitions.pdsl. Do not edit. */\n");
+    fprintf(out, "#ifndef MYVM_ISA_H\n#define MYVM_ISA_H\n\n");
+
+    fprintf(out, "typedef enum {\n");
+    for (int i = 0; i < parser->opcode_count; i++) {
+        fprintf(out, "    MYVM_OP_%s = 0x%02X%s\n", opcode_suffix(parser, i), parser->opcodes[i].value,
+                i + 1 < parser->opcode_count ? "," : "");
+    }
+    fprintf(out, "} MyVmOpcode;\n\n");
+
+    fprintf(out, "/* One per `encode ... field = immediate[N]` */\n");
+    fprintf(out, "typedef enum {\n");
+    for (int i = 0; i < parser->field_count; i++) {
+        upper_name(upper, parser->fields[i].name);
+        fprintf(out, "    MYVM_OPERAND_%s%s\n", upper, i + 1 < parser->field_count ? "," : "");
+    }
+    fprintf(out, "} MyVmOperandKind;\n\n");
+    for (int i = 0; i < parser->field_count; i++) {
+        upper_name(upper, parser->fields[i].name);
+        fprintf(out, "#define MYVM_OPERAND_SIZE_%s %d\n", upper, parser->fields[i].bits / 8);
+    }
+    fprintf(out, "\n/* pdsl field name and size in bytes of each operand kind */\n");
+    fprintf(out, "static const char* const MYVM_OPERAND_FIELD_NAMES[] = {");
+    for (int i = 0; i < parser->field_count; i++) {
+        fprintf(out, "%s \"%s\"", i > 0 ? "," : "", parser->fields[i].name);
+    }
+    fprintf(out, " };\n");
+    fprintf(out, "static const int MYVM_OPERAND_SIZES[] = {");
+    for (int i = 0; i < parser->field_count; i++) {
+        fprintf(out, "%s %d", i > 0 ? "," : "", parser->fields[i].bits / 8);
+    }
+    fprintf(out, " };\n");
+    fprintf(out, "\n#define MYVM_OPCODE_SIZE %d\n\n", parser->opcode_bits / 8);
+
+    fprintf(out, "/* Encoded size in bytes and assembler mnemonic of every instruction */\n");
+    for (int i = 0; i < parser->mnemonic_count; i++) {
+        const InstructionDef* instruction = &parser->instructions[parser->mnemonics[i].instruction];
+        fprintf(out, "#define MYVM_SIZE_%s %d\n", instruction->name, instruction->size_bytes);
+        fprintf(out, "#define MYVM_MNEMONIC_%s \"%s\"\n", instruction->name, parser->mnemonics[i].name);
+    }
+
+    int max_operands = 1;
+    for (int i = 0; i < parser->sequence_count; i++) {
+        max_operands = parser->sequences[i].count > max_operands ? parser->sequences[i].count : max_operands;
+    }
+    fprintf(out, "\n#define MYVM_INSTRUCTION_COUNT %d\n", parser->mnemonic_count);
+    fprintf(out, "#define MYVM_MAX_OPERANDS %d\n\n", max_operands);
+
+    fprintf(out, "typedef struct {\n");
+    fprintf(out, "    const char* mnemonic;\n");
+    fprintf(out, "    MyVmOpcode opcode;\n");
+    fprintf(out, "    int size_bytes;\n");
+    fprintf(out, "    int operand_count;\n");
+    fprintf(out, "    MyVmOperandKind operands[MYVM_MAX_OPERANDS];\n");
+    fprintf(out, "} MyVmInstructionInfo;\n\n");
+
+    fprintf(out, "static const MyVmInstructionInfo MYVM_INSTRUCTIONS[MYVM_INSTRUCTION_COUNT] = {\n");
+    for (int i = 0; i < parser->mnemonic_count; i++) {
+        const InstructionDef* instruction = &parser->instructions[parser->mnemonics[i].instruction];
+        const SequenceDef* sequence = instruction->sequence >= 0 ? &parser->sequences[instruction->sequence] : NULL;
+        fprintf(out, "    { MYVM_MNEMONIC_%s, MYVM_OP_%s, MYVM_SIZE_%s, %d, {", instruction->name,
+                opcode_suffix(parser, instruction->opcode), instruction->name, sequence ? sequence->count : 0);
+        for (int k = 0; sequence && k < sequence->count; k++) {
+            upper_name(upper, parser->fields[sequence->field_indexes[k]].name);
+            fprintf(out, "%s MYVM_OPERAND_%s", k > 0 ? "," : "", upper);
+        }
+        fprintf(out, "%s}%s\n", sequence && sequence->count > 0 ? " " : " 0 ", i + 1 < parser->mnemonic_count ? " }," : " }");
+    }
+    fprintf(out, "};\n\n#endif\n");
+}
+
+static char* read_file(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (text) {
+        size_t read = fread(text, 1, (size_t)size, file);
+        text[read] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <target-definitions.pdsl> <myvm_isa.h>\n", argv[0]);
+        return 1;
+    }
+
+    char* text = read_file(argv[1]);
+    if (!text) {
+        fprintf(stderr, "pdsl_tablegen: cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    static Parser parser;
+    parser.path = argv[1];
+    parser.text = text;
+    parser.line = 1;
+    parse(&parser);
+    if (parser.opcode_count == 0 || parser.mnemonic_count == 0) {
+        fail(&parser, "no instructions or mnemonics found");
+    }
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "pdsl_tablegen: cannot write %s\n", argv[2]);
+        free(text);
+        return 1;
+    }
+    write_header(&parser, out);
+    fclose(out);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,238 @@
+// Post-processor for --profile: reads the <name>.profile.map written by the
+// compiler and the output of the profiled myvm program, and prints call
+// counts per method and the hottest CFG nodes with their cfgNodesToDot ids.
+//
+// The dump prints every counter as -(count + 1) because OUT writes no
+// separator; the counters are the last map-count numbers of the output.
+//
+// Usage: profile_report <name.profile.map> [vm-output] (stdin by default)
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NAME 128
+#define HOT_NODE_COUNT 20
+
+typedef struct {
+    char method[MAX_NAME];
+    int node_id;
+    char node_type[MAX_NAME];
+    long long count;
+} Counter;
+
+typedef struct {
+    const char* method;
+    long long calls;
+    long long node_visits;
+} MethodTotal;
+
+static char* read_stream(FILE* in)
+{
+    size_t capacity = 4096;
+    size_t length = 0;
+    char* text = malloc(capacity);
+    if (!text) {
+        return NULL;
+    }
+    size_t read;
+    while ((read = fread(text + length, 1, capacity - length - 1, in)) > 0) {
+        length += read;
+        if (capacity - length <= 1) {
+            char* grown = realloc(text, capacity * 2);
+            if (!grown) {
+                free(text);
+                return NULL;
+            }
+            text = grown;
+            capacity *= 2;
+        }
+    }
+    text[length] = '\0';
+    return text;
+}
+
+static Counter* read_map(const char* path, int* count)
+{
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "profile_report: cannot read %s\n", path);
+        return NULL;
+    }
+
+    char line[512];
+    int expected = -1;
+    if (!fgets(line, sizeof(line), in)
+        || sscanf(line, "# myvm profile map v1: port %*d, first slot %*d, %d counters", &expected) != 1
+        || expected < 0) {
+        fprintf(stderr, "profile_report: %s is not a myvm profile map\n", path);
+        fclose(in);
+        return NULL;
+    }
+
+    Counter* counters = calloc(expected > 0 ? expected : 1, sizeof(Counter));
+    if (!counters) {
+        fclose(in);
+        return NULL;
+    }
+    int loaded = 0;
+    while (loaded < expected && fgets(line, sizeof(line), in)) {
+        int index;
+        Counter* counter = &counters[loaded];
+        if (sscanf(line, "%d %127s %d %127s", &index, counter->method, &counter->node_id, counter->node_type) != 4
+            || index != loaded) {
+            fprintf(stderr, "profile_report: %s: bad entry '%s'\n", path, line);
+            free(counters);
+            fclose(in);
+            return NULL;
+        }
+        loaded++;
+    }
+    fclose(in);
+    if (loaded != expected) {
+        fprintf(stderr, "profile_report: %s: expected %d counters, found %d\n", path, expected, loaded);
+        free(counters);
+        return NULL;
+    }
+    *count = loaded;
+    return counters;
+}
+
+// Walks back from the end of the output: every counter is '-' and digits,
+// optionally separated by whitespace.
+static int parse_counters(const char* output, Counter* counters, int count)
+{
+    const char* end = output + strlen(output);
+    for (int i = count - 1; i >= 0; i--) {
+        while (end > output && isspace((unsigned char)end[-1])) {
+            end--;
+        }
+        const char* digits = end;
+        while (digits > output && isdigit((unsigned char)digits[-1])) {
+            digits--;
+        }
+        if (digits == end || digits == output || digits[-1] != '-') {
+            return i + 1;
+        }
+        long long value = strtoll(digits, NULL, 10);
+        if (value < 1) {
+            return i + 1;
+        }
+        counters[i].count = value - 1;
+        end = digits - 1;
+    }
+    return 0;
+}
+
+static int compare_counters(const void* left, const void* right)
+{
+    const Counter* a = *(const Counter* const*)left;
+    const Counter* b = *(const Counter* const*)right;
+    if (a->count != b->count) {
+        return a->count > b->count ? -1 : 1;
+    }
+    int by_method = strcmp(a->method, b->method);
+    return by_method != 0 ? by_method : a->node_id - b->node_id;
+}
+
+static int compare_methods(const void* left, const void* right)
+{
+    const MethodTotal* a = left;
+    const MethodTotal* b = right;
+    if (a->node_visits != b->node_visits) {
+        return a->node_visits > b->node_visits ? -1 : 1;
+    }
+    return strcmp(a->method, b->method);
+}
+
+static void write_report(Counter* counters, int count, FILE* out)
+{
+    MethodTotal* methods = calloc(count > 0 ? count : 1, sizeof(MethodTotal));
+    const Counter** sorted = malloc(sizeof(Counter*) * (count > 0 ? count : 1));
+    if (!methods || !sorted) {
+        free(methods);
+        free(sorted);
+        return;
+    }
+
+    int method_count = 0;
+    long long total_visits = 0;
+    for (int i = 0; i < count; i++) {
+        const Counter* counter = &counters[i];
+        int m = 0;
+        while (m < method_count && strcmp(methods[m].method, counter->method) != 0) {
+            m++;
+        }
+        if (m == method_count) {
+            methods[method_count++].method = counter->method;
+        }
+        if (strcmp(counter->node_type, "ENTRY_POINT") == 0) {
+            methods[m].calls += counter->count;
+        }
+        methods[m].node_visits += counter->count;
+        total_visits += counter->count;
+        sorted[i] = counter;
+    }
+    qsort(methods, method_count, sizeof(MethodTotal), compare_methods);
+    qsort(sorted, count, sizeof(Counter*), compare_counters);
+
+    fprintf(out, "%-32s %12s %14s %6s\n", "method", "calls", "node visits", "share");
+    for (int i = 0; i < method_count; i++) {
+        int share = total_visits > 0 ? (int)(methods[i].node_visits * 100 / total_visits) : 0;
+        fprintf(out, "%-32s %12lld %14lld %5d%%\n",
+                methods[i].method, methods[i].calls, methods[i].node_visits, share);
+    }
+
+    fprintf(out, "\nhottest nodes (ids as in the method's CFG .dot):\n");
+    fprintf(out, "%-32s %6s %-18s %12s\n", "method", "node", "kind", "visits");
+    for (int i = 0; i < count && i < HOT_NODE_COUNT && sorted[i]->count > 0; i++) {
+        fprintf(out, "%-32s %6d %-18s %12lld\n",
+                sorted[i]->method, sorted[i]->node_id, sorted[i]->node_type, sorted[i]->count);
+    }
+
+    free(methods);
+    free(sorted);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s <name.profile.map> [vm-output]\n", argv[0]);
+        return 1;
+    }
+
+    int count = 0;
+    Counter* counters = read_map(argv[1], &count);
+    if (!counters) {
+        return 1;
+    }
+
+    FILE* in = argc == 3 ? fopen(argv[2], "r") : stdin;
+    if (!in) {
+        fprintf(stderr, "profile_report: cannot read %s\n", argv[2]);
+        free(counters);
+        return 1;
+    }
+    char* output = read_stream(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (!output) {
+        fprintf(stderr, "profile_report: cannot read the program output\n");
+        free(counters);
+        return 1;
+    }
+
+    int missing = parse_counters(output, counters, count);
+    free(output);
+    if (missing > 0) {
+        fprintf(stderr, "profile_report: %d of %d counters missing from the output; did main return?\n",
+                missing, count);
+        free(counters);
+        return 1;
+    }
+
+    write_report(counters, count, stdout);
+    free(counters);
+    return 0;
+}
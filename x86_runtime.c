@@ -0,0 +1,25 @@
+// Runtime linked with the output of the x86-64 backend (to_x86_module.c).
+// It is not part of the compiler itself.
+#include <stdio.h>
+
+extern void MC_main(void);
+
+long long mc_read(void)
+{
+    long long value = 0;
+    if (scanf("%lld", &value) != 1) {
+        return 0;
+    }
+    return value;
+}
+
+void mc_write(long long value)
+{
+    printf("%lld\n", value);
+}
+
+int main(void)
+{
+    MC_main();
+    return 0;
+}